@@ -43,6 +43,10 @@ android {
             cmake {
                 cppFlags("-std=c++17")
                 arguments("-DCMAKE_VERBOSE_MAKEFILE=ON")
+                // off, sampled or calls, e.g. -Pgl.check=sampled for profiling a debug build.
+                if (project.hasProperty("gl.check")) {
+                    arguments("-DLOOKAROUND_GL_CHECK=${project.properties["gl.check"]}")
+                }
             }
         }
     }
@@ -78,6 +82,8 @@ android {
     buildFeatures {
         viewBinding = true
         compose = true
+        // GLSL of the Vulkan renderer in src/main/shaders, compiled into assets/shaders.
+        shaders = true
     }
 
     composeOptions { kotlinCompilerExtensionVersion = "1.2.0-beta02" }
@@ -0,0 +1,20 @@
+#include "animation.h"
+
+namespace lookaround {
+    GLfloat Ease(Easing easing, GLfloat progress) {
+        switch (easing) {
+            case Easing::EASE_OUT_CUBIC: {
+                const GLfloat remaining = 1.f - progress;
+                return 1.f - remaining * remaining * remaining;
+            }
+            case Easing::EASE_IN_OUT_CUBIC: {
+                if (progress < .5f) return 4.f * progress * progress * progress;
+                const GLfloat remaining = 2.f - 2.f * progress;
+                return 1.f - remaining * remaining * remaining / 2.f;
+            }
+            case Easing::LINEAR:
+            default:
+                return progress;
+        }
+    }
+}  // namespace lookaround
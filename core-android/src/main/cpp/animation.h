@@ -0,0 +1,91 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace lookaround {
+    enum class Easing {
+        LINEAR,
+        EASE_OUT_CUBIC,
+        EASE_IN_OUT_CUBIC,
+    };
+
+    // Maps linear progress in [0, 1] onto the curve.
+    GLfloat Ease(Easing easing, GLfloat progress);
+
+    // N floats animated from their current values to a target over a duration, evaluated from
+    // frame timestamps rather than counted frames - so skipped or coalesced frames and the
+    // camera frame rate do not change the animation speed.
+    template<size_t N>
+    class Animation {
+    public:
+        using Values = std::array<GLfloat, N>;
+
+        explicit Animation(const Values &initial) : from(initial), to(initial), current(initial) {}
+
+        // Sets the values at once, cancelling a running animation.
+        void Jump(const Values &values) {
+            from = to = values;
+            changed = changed || values != current;
+            current = values;
+            running = false;
+        }
+
+        // Animates from the current values to target, starting at startNs. Restarting towards
+        // another target midway continues from wherever the values are.
+        void Start(const Values &target, int64_t startNs, int64_t durationNs, Easing easing) {
+            if (durationNs <= 0) {
+                Jump(target);
+                return;
+            }
+            from = current;
+            to = target;
+            this->startNs = startNs;
+            this->durationNs = durationNs;
+            this->easing = easing;
+            running = true;
+        }
+
+        // Evaluates the animation at timeNs. Returns whether the values changed since the
+        // previous call, so frames which would look the same can be skipped.
+        bool Update(int64_t timeNs) {
+            if (running) {
+                const auto progress = std::clamp(
+                        static_cast<GLfloat>(timeNs - startNs) / static_cast<GLfloat>(durationNs),
+                        0.f, 1.f);
+                const GLfloat eased = Ease(easing, progress);
+                Values next;
+                for (size_t i = 0; i < N; ++i) next[i] = from[i] + (to[i] - from[i]) * eased;
+                if (progress >= 1.f) {
+                    next = to;
+                    running = false;
+                }
+                changed = changed || next != current;
+                current = next;
+            }
+            const bool updated = changed;
+            changed = false;
+            return updated;
+        }
+
+        [[nodiscard]] bool IsRunning() const { return running; }
+
+        [[nodiscard]] const Values &Get() const { return current; }
+
+        [[nodiscard]] const Values &Target() const { return to; }
+
+    private:
+        Values from;
+        Values to;
+        Values current;
+        int64_t startNs = 0;
+        int64_t durationNs = 0;
+        Easing easing = Easing::LINEAR;
+        bool running = false;
+        bool changed = false;
+    };
+}  // namespace lookaround
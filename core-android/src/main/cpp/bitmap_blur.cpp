@@ -0,0 +1,158 @@
+#include "bitmap_blur.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    bool BitmapBlur::Init() {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        // Reference counted by Android's EGL like for the renderers, see Release.
+        if (display == EGL_NO_DISPLAY ||
+            eglInitialize(display, /*major=*/nullptr, /*minor=*/nullptr) != EGL_TRUE) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Bitmap blur disabled: EGL initialization failed.");
+            display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+                                  EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                  EGL_NONE};
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+        EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        if (eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) == EGL_TRUE &&
+            numConfigs > 0) {
+            context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+            pbuffer = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        }
+        if (context == EGL_NO_CONTEXT || pbuffer == EGL_NO_SURFACE ||
+            eglMakeCurrent(display, pbuffer, pbuffer, context) != EGL_TRUE) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Bitmap blur disabled: creating context failed with EGL error: %s",
+                                EGLErrorString(eglGetError()).c_str());
+            Release();
+            return false;
+        }
+
+        // Compute shaders would not even compile before 3.1, which CHECK_GL treats as a bug.
+        GLint major = 0;
+        GLint minor = 0;
+        CHECK_GL(glGetIntegerv(GL_MAJOR_VERSION, &major));
+        CHECK_GL(glGetIntegerv(GL_MINOR_VERSION, &minor));
+        const bool initialized = (major > 3 || (major == 3 && minor >= 1)) && satBlur.Init();
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (!initialized) {
+            __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                "Bitmap blur disabled on ES %d.%d.",
+                                major, minor);
+            Release();
+        }
+        return initialized;
+    }
+
+    void BitmapBlur::Release() {
+        if (display == EGL_NO_DISPLAY) return;
+
+        if (context != EGL_NO_CONTEXT && pbuffer != EGL_NO_SURFACE &&
+            eglMakeCurrent(display, pbuffer, pbuffer, context) == EGL_TRUE) {
+            satBlur.Release();
+            for (GLuint *texture: {&inputTextureId, &outputTextureId}) {
+                if (*texture) CHECK_GL(glDeleteTextures(1, texture));
+            }
+            if (outputFboId) CHECK_GL(glDeleteFramebuffers(1, &outputFboId));
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        }
+        inputTextureId = outputTextureId = outputFboId = 0;
+        width = height = 0;
+        levels = -1;
+
+        if (pbuffer != EGL_NO_SURFACE) eglDestroySurface(display, pbuffer);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+        pbuffer = EGL_NO_SURFACE;
+        context = EGL_NO_CONTEXT;
+        display = EGL_NO_DISPLAY;
+    }
+
+    GLsizei BitmapBlur::OutputSize(GLsizei size, GLint levels) {
+        return std::max(size >> levels, 1);
+    }
+
+    void BitmapBlur::Resize(GLsizei newWidth, GLsizei newHeight, GLint newLevels) {
+        if (newWidth == width && newHeight == height && newLevels == levels) return;
+        width = newWidth;
+        height = newHeight;
+        levels = newLevels;
+
+        // Immutable, so recreated along with the size.
+        if (inputTextureId) CHECK_GL(glDeleteTextures(1, &inputTextureId));
+        CHECK_GL(glGenTextures(1, &inputTextureId));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, inputTextureId));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        CHECK_GL(glTexStorage2D(GL_TEXTURE_2D, levels + 1, GL_RGBA8, width, height));
+
+        if (outputTextureId) CHECK_GL(glDeleteTextures(1, &outputTextureId));
+        CHECK_GL(glGenTextures(1, &outputTextureId));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, outputTextureId));
+        CHECK_GL(glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8,
+                                OutputSize(width, levels), OutputSize(height, levels)));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+
+        if (!outputFboId) CHECK_GL(glGenFramebuffers(1, &outputFboId));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, outputFboId));
+        CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                        outputTextureId, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+
+    bool BitmapBlur::Blur(const uint8_t *pixels, GLsizei imageWidth, GLsizei imageHeight,
+                          GLsizei stride, GLint imageLevels, GLfloat sigma,
+                          uint8_t *output, GLsizei outputStride) {
+        // The mip chain ends at 1x1.
+        if (imageWidth <= 0 || imageHeight <= 0 || imageLevels < 0 ||
+            (std::max(imageWidth, imageHeight) >> imageLevels) == 0) {
+            return false;
+        }
+        if (context == EGL_NO_CONTEXT ||
+            eglMakeCurrent(display, pbuffer, pbuffer, context) != EGL_TRUE) {
+            return false;
+        }
+        // Errors of the last call would fail this one.
+        while (glGetError() != GL_NO_ERROR) {}
+
+        Resize(imageWidth, imageHeight, imageLevels);
+        const GLsizei outputWidth = OutputSize(width, levels);
+        const GLsizei outputHeight = OutputSize(height, levels);
+
+        // Rows go in top-down and come out the same way, nothing is flipped.
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, inputTextureId));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / 4));
+        CHECK_GL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA,
+                                 GL_UNSIGNED_BYTE, pixels));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ROW_LENGTH, 0));
+        CHECK_GL(glGenerateMipmap(GL_TEXTURE_2D));
+        // The blur fetches level 0 relative to the base, that is the downsampled level.
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+
+        satBlur.Blur(inputTextureId, outputFboId, outputWidth, outputHeight, sigma);
+
+        CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, outputFboId));
+        CHECK_GL(glPixelStorei(GL_PACK_ROW_LENGTH, outputStride / 4));
+        CHECK_GL(glReadPixels(0, 0, outputWidth, outputHeight, GL_RGBA, GL_UNSIGNED_BYTE,
+                              output));
+        CHECK_GL(glPixelStorei(GL_PACK_ROW_LENGTH, 0));
+        CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+
+        const bool succeeded = glGetError() == GL_NO_ERROR;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        return succeeded;
+    }
+}  // namespace lookaround
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES3/gl31.h>
+
+#include <cstdint>
+
+#include "sat_blur.h"
+
+namespace lookaround {
+    // Blurs images off screen, e.g. map screenshots behind the bottom sheets, with the SatBlur of
+    // the renderer in a context of its own on a 1x1 pbuffer. The image is uploaded into a
+    // mipmapped texture, whose level of the requested downsampling is blurred and read back -
+    // small, so the readback is cheap compared to blurring on the CPU. Needs ES 3.1.
+    //
+    // Not thread safe, but not bound to a thread either: the context is current only during
+    // each call.
+    class BitmapBlur {
+    public:
+        // Returns false if the context could not be created or does not support compute.
+        bool Init();
+
+        void Release();
+
+        // Size of the output of an image of size downsampled 1 << levels times, at least 1.
+        static GLsizei OutputSize(GLsizei size, GLint levels);
+
+        // Blurs the top-down RGBA rows of pixels, stride bytes apart, downsampled 1 << levels
+        // times, by sigma pixels of the output. Writes OutputSize rows outputStride bytes apart
+        // to output. Returns false on any GL error, or if levels would downsample below 1x1.
+        bool Blur(const uint8_t *pixels, GLsizei width, GLsizei height, GLsizei stride,
+                  GLint levels, GLfloat sigma, uint8_t *output, GLsizei outputStride);
+
+    private:
+        void Resize(GLsizei width, GLsizei height, GLint levels);
+
+        EGLDisplay display = EGL_NO_DISPLAY;
+        EGLContext context = EGL_NO_CONTEXT;
+        EGLSurface pbuffer = EGL_NO_SURFACE;
+        SatBlur satBlur;
+
+        GLsizei width = 0;
+        GLsizei height = 0;
+        GLint levels = -1;
+        GLuint inputTextureId = 0;
+        GLuint outputTextureId = 0;
+        GLuint outputFboId = 0;
+    };
+}  // namespace lookaround
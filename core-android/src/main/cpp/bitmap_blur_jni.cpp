@@ -0,0 +1,107 @@
+#include <android/bitmap.h>
+#include <android/log.h>
+#include <jni.h>
+
+#include "bitmap_blur.h"
+#include "color_extractor.h"
+#include "gl_check.h"
+
+using namespace lookaround;
+
+namespace {
+    struct LockedBitmap {
+        uint8_t *pixels;
+        GLsizei width;
+        GLsizei height;
+        GLsizei stride;
+    };
+
+    bool LockBitmap(JNIEnv *env, jobject bitmap, LockedBitmap &locked) {
+        AndroidBitmapInfo info;
+        void *pixels = nullptr;
+        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+            info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+            AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Blurred bitmap is not a lockable ARGB_8888 bitmap.");
+            return false;
+        }
+        locked = {static_cast<uint8_t *>(pixels),
+                  static_cast<GLsizei>(info.width),
+                  static_cast<GLsizei>(info.height),
+                  static_cast<GLsizei>(info.stride)};
+        return true;
+    }
+
+    // Blurs pixels into joutput, which must be of BitmapBlur::OutputSize.
+    jboolean BlurInto(JNIEnv *env, BitmapBlur *bitmapBlur, const uint8_t *pixels,
+                      GLsizei width, GLsizei height, GLsizei stride, jint levels, jfloat sigma,
+                      jobject joutput) {
+        LockedBitmap output{};
+        if (!LockBitmap(env, joutput, output)) return JNI_FALSE;
+        bool blurred = false;
+        if (output.width == BitmapBlur::OutputSize(width, levels) &&
+            output.height == BitmapBlur::OutputSize(height, levels)) {
+            blurred = bitmapBlur->Blur(pixels, width, height, stride, levels, sigma,
+                                       output.pixels, output.stride);
+        }
+        AndroidBitmap_unlockPixels(env, joutput);
+        return blurred ? JNI_TRUE : JNI_FALSE;
+    }
+}  // namespace
+
+extern "C" {
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_blur_BitmapBlur_create(JNIEnv *env, jclass clazz) {
+    auto *bitmapBlur = new BitmapBlur();
+    if (!bitmapBlur->Init()) {
+        delete bitmapBlur;
+        return 0;
+    }
+    return reinterpret_cast<jlong>(bitmapBlur);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_blur_BitmapBlur_destroy(
+        JNIEnv *env, jclass clazz, jlong blur) {
+    auto *bitmapBlur = reinterpret_cast<BitmapBlur *>(blur);
+    bitmapBlur->Release();
+    delete bitmapBlur;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_blur_BitmapBlur_blurBitmap(
+        JNIEnv *env, jclass clazz, jlong blur, jobject jinput, jint levels, jfloat sigma,
+        jobject joutput) {
+    LockedBitmap input{};
+    if (!LockBitmap(env, jinput, input)) return JNI_FALSE;
+    const jboolean blurred = BlurInto(env, reinterpret_cast<BitmapBlur *>(blur), input.pixels,
+                                      input.width, input.height, input.stride, levels, sigma,
+                                      joutput);
+    AndroidBitmap_unlockPixels(env, jinput);
+    return blurred;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_blur_BitmapBlur_blurBuffer(
+        JNIEnv *env, jclass clazz, jlong blur, jobject jbuffer, jint width, jint height,
+        jint stride, jint levels, jfloat sigma, jobject joutput) {
+    auto *pixels = static_cast<const uint8_t *>(env->GetDirectBufferAddress(jbuffer));
+    if (!pixels || env->GetDirectBufferCapacity(jbuffer) < static_cast<jlong>(stride) * height) {
+        return JNI_FALSE;
+    }
+    return BlurInto(env, reinterpret_cast<BitmapBlur *>(blur), pixels, width, height, stride,
+                    levels, sigma, joutput);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_blur_BitmapBlur_dominantColor(
+        JNIEnv *env, jclass clazz, jobject jbitmap) {
+    LockedBitmap bitmap{};
+    if (!LockBitmap(env, jbitmap, bitmap)) return 0;
+    const uint32_t color = ColorExtractor::DominantColor(bitmap.pixels, bitmap.width,
+                                                         bitmap.height, bitmap.stride);
+    AndroidBitmap_unlockPixels(env, jbitmap);
+    return static_cast<jint>(color);
+}
+}
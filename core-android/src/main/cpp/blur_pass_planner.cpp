@@ -0,0 +1,98 @@
+#include "blur_pass_planner.h"
+
+#include <android/log.h>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    void BlurPassPlanner::Reset(bool supported) {
+        timerSupported = supported;
+        levels.fill(LevelState{});
+    }
+
+    BlurPassPlanner::LevelPlan BlurPassPlanner::Plan(GLint level,
+                                                     GLsizei width,
+                                                     GLsizei height,
+                                                     bool canMeasure) {
+        if (level < 0 || level >= MAX_LEVELS) return {LevelMode::SEPARABLE, false};
+
+        auto &state = levels[level];
+        if (state.decided) return {state.mode, false};
+
+        if (width * height > FUSED_MAX_LEVEL_PIXELS) {
+            Decide(level, LevelMode::SEPARABLE);
+            return {state.mode, false};
+        }
+
+        // Without timer queries there is nothing to measure, keep the cheaper kernel.
+        if (!timerSupported) {
+            Decide(level, LevelMode::SEPARABLE);
+            return {state.mode, false};
+        }
+
+        if (!canMeasure) return {LevelMode::SEPARABLE, false};
+
+        auto separableIssued = state.issued[static_cast<size_t>(LevelMode::SEPARABLE)];
+        auto fusedIssued = state.issued[static_cast<size_t>(LevelMode::FUSED)];
+        if (separableIssued >= MAX_ISSUED_PER_MODE && fusedIssued >= MAX_ISSUED_PER_MODE) {
+            // Timer results keep getting discarded (disjoint), so as without timer queries.
+            Decide(level, LevelMode::SEPARABLE);
+            return {state.mode, false};
+        }
+
+        auto mode = separableIssued <= fusedIssued ? LevelMode::SEPARABLE : LevelMode::FUSED;
+        return {mode, true};
+    }
+
+    void BlurPassPlanner::OnMeasurementIssued(GLint level, LevelMode mode) {
+        if (level < 0 || level >= MAX_LEVELS || levels[level].decided) return;
+        ++levels[level].issued[static_cast<size_t>(mode)];
+    }
+
+    void BlurPassPlanner::OnTimerResult(GLint tag, uint64_t elapsedNs) {
+        if (tag < TIMER_TAG_BASE || tag >= TIMER_TAG_BASE + TIMER_TAG_COUNT) return;
+
+        auto level = (tag - TIMER_TAG_BASE) / 2;
+        auto modeIndex = static_cast<size_t>((tag - TIMER_TAG_BASE) % 2);
+        auto &state = levels[level];
+        if (state.decided) return;
+
+        ++state.samples[modeIndex];
+        state.totalNs[modeIndex] += elapsedNs;
+
+        auto separableIndex = static_cast<size_t>(LevelMode::SEPARABLE);
+        auto fusedIndex = static_cast<size_t>(LevelMode::FUSED);
+        if (state.samples[separableIndex] < SAMPLES_PER_MODE ||
+            state.samples[fusedIndex] < SAMPLES_PER_MODE) {
+            return;
+        }
+
+        auto separableAvgNs = state.totalNs[separableIndex] / state.samples[separableIndex];
+        auto fusedAvgNs = state.totalNs[fusedIndex] / state.samples[fusedIndex];
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                            "Blur level %d cost [separable: %llu ns, fused: %llu ns]",
+                            level,
+                            static_cast<unsigned long long>(separableAvgNs),
+                            static_cast<unsigned long long>(fusedAvgNs));
+        Decide(level, fusedAvgNs < separableAvgNs ? LevelMode::FUSED : LevelMode::SEPARABLE);
+    }
+
+    void BlurPassPlanner::Seed(GLint level, LevelMode mode) {
+        if (level < 0 || level >= MAX_LEVELS) return;
+        Decide(level, mode);
+    }
+
+    bool BlurPassPlanner::IsDecided(GLint level, LevelMode &mode) const {
+        if (level < 0 || level >= MAX_LEVELS || !levels[level].decided) return false;
+        mode = levels[level].mode;
+        return true;
+    }
+
+    void BlurPassPlanner::Decide(GLint level, LevelMode mode) {
+        auto &state = levels[level];
+        state.decided = true;
+        state.mode = mode;
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "Blur level %d uses %s pass.", level,
+                            mode == LevelMode::FUSED ? "fused 2D" : "separable");
+    }
+}  // namespace lookaround
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <array>
+#include <cstdint>
+
+namespace lookaround {
+    // Decides per blur pyramid level whether the separable V + H pass pair or a single fused
+    // 2D-kernel pass is cheaper. Only small levels are eligible for fusing: there the two FBO
+    // switches and program binds of the separable pair dominate over the extra taps. Eligible
+    // levels alternate both variants under GPU timer queries until enough samples are
+    // collected, after which the faster one is kept until the next Reset. Larger levels, and
+    // all levels when nothing can be measured, are decided separable straight away: the fused
+    // pass has 5.5 times the taps, too costly to take unmeasured.
+    class BlurPassPlanner {
+    public:
+        enum class LevelMode {
+            SEPARABLE = 0, FUSED = 1
+        };
+
+        struct LevelPlan {
+            LevelMode mode;
+            bool measure;
+        };
+
+        static constexpr GLint MAX_LEVELS = 4;
+        // Taps per pixel of the 11 tap kernel, as two 1D passes or one 2D pass.
+        static constexpr GLint SEPARABLE_TAPS = 2 * 11;
+        static constexpr GLint FUSED_TAPS = 11 * 11;
+        // Fusing saves the fixed cost of a pass (a render target switch, which flushes the
+        // tiles on mobile GPUs, a program bind and a draw) but adds FUSED_TAPS - SEPARABLE_TAPS
+        // fetches per pixel. It can only win while those take less time than the saved pass,
+        // so levels are worth measuring up to PASS_OVERHEAD_NS * MAX_TEXELS_PER_NS / (extra
+        // taps) pixels. Both are generous: ~100 us for a pass is the slow end of mobile GPUs,
+        // 150 texels per ns the fill rate of current flagships. That is ~150k pixels, e.g.
+        // the quarter size level of a 1080 x 1920 window.
+        static constexpr GLsizei PASS_OVERHEAD_NS = 100'000;
+        static constexpr GLsizei MAX_TEXELS_PER_NS = 150;
+        static constexpr GLsizei FUSED_MAX_LEVEL_PIXELS =
+                PASS_OVERHEAD_NS * MAX_TEXELS_PER_NS / (FUSED_TAPS - SEPARABLE_TAPS);
+        static constexpr GLint SAMPLES_PER_MODE = 24;
+        static constexpr GLint MAX_ISSUED_PER_MODE = SAMPLES_PER_MODE * 4;
+        static constexpr GLint TIMER_TAG_BASE = 0;
+        static constexpr GLint TIMER_TAG_COUNT = MAX_LEVELS * 2;
+
+        // Forgets all decisions, e.g. after the output surface (and so level sizes) changed.
+        void Reset(bool timerSupported);
+
+        // canMeasure should be false for frames not representative of a full blur
+        // (e.g. during lod animation), an undecided level then uses the separable passes.
+        LevelPlan Plan(GLint level, GLsizei width, GLsizei height, bool canMeasure);
+
+        // Counts a measurement of a plan once its timer query actually began, so a mode whose
+        // queries fail is planned again rather than given up on unmeasured.
+        void OnMeasurementIssued(GLint level, LevelMode mode);
+
+        [[nodiscard]] static GLint TimerTag(GLint level, LevelMode mode) {
+            return TIMER_TAG_BASE + level * 2 + static_cast<GLint>(mode);
+        }
+
+        [[nodiscard]] static GLint TimerTagLevel(GLint tag) {
+            return (tag - TIMER_TAG_BASE) / 2;
+        }
+
+        // Tags outside of the planner's range are ignored.
+        void OnTimerResult(GLint tag, uint64_t elapsedNs);
+
+        // Takes mode for level without measuring, e.g. one decided on an earlier launch.
+        void Seed(GLint level, LevelMode mode);
+
+        // Whether the mode of level is final until the next Reset.
+        bool IsDecided(GLint level, LevelMode &mode) const;
+
+    private:
+        struct LevelState {
+            bool decided = false;
+            LevelMode mode = LevelMode::SEPARABLE;
+            std::array<GLint, 2> issued{};
+            std::array<GLint, 2> samples{};
+            std::array<uint64_t, 2> totalNs{};
+        };
+
+        void Decide(GLint level, LevelMode mode);
+
+        bool timerSupported = false;
+        std::array<LevelState, MAX_LEVELS> levels{};
+    };
+}  // namespace lookaround
@@ -0,0 +1,240 @@
+#include "color_extractor.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+
+#include "gl_check.h"
+#include "gl_program.h"
+
+namespace lookaround {
+    namespace {
+        constexpr char VERTEX_SHADER_SRC_REDUCTION[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+in vec4 position;
+
+void main() {
+    gl_Position = position;
+}
+)SRC";
+
+        // Every output texel averages an 8x8 grid of bilinear taps over its cell of the source.
+        constexpr char FRAGMENT_SHADER_SRC_REDUCTION[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform sampler2D sampler;
+
+out vec4 fragColor;
+
+const float gridSize = 4.;
+const float taps = 8.;
+
+void main() {
+    vec2 cellOrigin = floor(gl_FragCoord.xy) / gridSize;
+    vec3 sum = vec3(0.);
+    for (float i = 0.; i < taps; ++i) {
+        for (float j = 0.; j < taps; ++j) {
+            vec2 offset = (vec2(i, j) + vec2(.5)) / (taps * gridSize);
+            sum += texture(sampler, cellOrigin + offset).rgb;
+        }
+    }
+    fragColor = vec4(sum / (taps * taps), 1.);
+}
+)SRC";
+
+        constexpr GLfloat VERTICES[] = {-1.f, -1.f, 3.f, -1.f, -1.f, 3.f};
+
+        GLint ColorDistance(const uint8_t *lhs, const uint8_t *rhs) {
+            return std::abs(lhs[0] - rhs[0]) + std::abs(lhs[1] - rhs[1]) +
+                   std::abs(lhs[2] - rhs[2]);
+        }
+
+        uint32_t PackColor(GLint red, GLint green, GLint blue) {
+            return 0xFF000000u |
+                   (static_cast<uint32_t>(red) << 16) |
+                   (static_cast<uint32_t>(green) << 8) |
+                   static_cast<uint32_t>(blue);
+        }
+
+        // The dominant color is the mean of the largest cluster of similar cells - close to
+        // what Palette reports as the dominant swatch, but for 16 cells instead of a bitmap.
+        uint32_t DominantColorOf(const uint8_t *rgba) {
+            constexpr GLint cellsCount = ColorExtractor::GRID_SIZE * ColorExtractor::GRID_SIZE;
+            GLint bestCell = 0;
+            GLint bestNeighbours = -1;
+            for (GLint cell = 0; cell < cellsCount; ++cell) {
+                GLint neighbours = 0;
+                for (GLint other = 0; other < cellsCount; ++other) {
+                    if (ColorDistance(rgba + cell * 4, rgba + other * 4) <=
+                        ColorExtractor::CLUSTER_COLOR_DISTANCE) {
+                        ++neighbours;
+                    }
+                }
+                if (neighbours > bestNeighbours) {
+                    bestNeighbours = neighbours;
+                    bestCell = cell;
+                }
+            }
+
+            std::array<GLint, 3> sum{};
+            GLint count = 0;
+            for (GLint other = 0; other < cellsCount; ++other) {
+                const uint8_t *color = rgba + other * 4;
+                if (ColorDistance(rgba + bestCell * 4, color) >
+                    ColorExtractor::CLUSTER_COLOR_DISTANCE) {
+                    continue;
+                }
+                sum[0] += color[0];
+                sum[1] += color[1];
+                sum[2] += color[2];
+                ++count;
+            }
+            return PackColor(sum[0] / count, sum[1] / count, sum[2] / count);
+        }
+    }  // namespace
+
+    bool ColorExtractor::Init() {
+        program = CreateGlProgram(VERTEX_SHADER_SRC_REDUCTION, FRAGMENT_SHADER_SRC_REDUCTION);
+        if (!program) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Color extraction disabled: creating GL program failed.");
+            return false;
+        }
+        positionHandle = CHECK_GL(glGetAttribLocation(program, "position"));
+        samplerHandle = CHECK_GL(glGetUniformLocation(program, "sampler"));
+
+        CHECK_GL(glGenTextures(1, &textureId));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, textureId));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, GRID_SIZE, GRID_SIZE, 0, GL_RGBA,
+                              GL_UNSIGNED_BYTE, nullptr));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+
+        CHECK_GL(glGenFramebuffers(1, &fboId));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, fboId));
+        CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                        textureId, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        CHECK_GL(glGenBuffers(1, &pboId));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboId));
+        CHECK_GL(glBufferData(GL_PIXEL_PACK_BUFFER, READBACK_SIZE, nullptr, GL_STREAM_READ));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+        initialized = true;
+        return true;
+    }
+
+    void ColorExtractor::Release() {
+        if (!initialized) return;
+
+        if (fence) {
+            CHECK_GL(glDeleteSync(fence));
+            fence = nullptr;
+        }
+        CHECK_GL(glDeleteBuffers(1, &pboId));
+        CHECK_GL(glDeleteFramebuffers(1, &fboId));
+        CHECK_GL(glDeleteTextures(1, &textureId));
+        CHECK_GL(glDeleteProgram(program));
+        initialized = false;
+    }
+
+    void ColorExtractor::Extract(GLuint sourceTextureId) {
+        if (!initialized || fence) return;
+        if (framesUntilExtraction > 0) {
+            --framesUntilExtraction;
+            return;
+        }
+        framesUntilExtraction = EXTRACTION_INTERVAL_FRAMES;
+
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, fboId));
+        CHECK_GL(glViewport(0, 0, GRID_SIZE, GRID_SIZE));
+        CHECK_GL(glVertexAttribPointer(positionHandle, 2, GL_FLOAT, GL_FALSE, 0, VERTICES));
+        CHECK_GL(glEnableVertexAttribArray(positionHandle));
+        CHECK_GL(glUseProgram(program));
+        CHECK_GL(glUniform1i(samplerHandle, 0));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, sourceTextureId));
+        CHECK_GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboId));
+        CHECK_GL(glReadPixels(0, 0, GRID_SIZE, GRID_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        fence = CHECK_GL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+
+    void ColorExtractor::Poll() {
+        if (!fence) return;
+
+        GLenum status = CHECK_GL(glClientWaitSync(fence, 0, 0));
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+        CHECK_GL(glDeleteSync(fence));
+        fence = nullptr;
+
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboId));
+        auto *pixels = static_cast<const uint8_t *>(CHECK_GL(
+                glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, READBACK_SIZE, GL_MAP_READ_BIT)));
+        if (pixels) {
+            dominantColor = DominantColorOf(pixels);
+            CHECK_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        }
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    }
+
+    uint32_t ColorExtractor::DominantColor(const uint8_t *pixels, GLsizei width,
+                                           GLsizei height, GLsizei stride) {
+        if (width <= 0 || height <= 0) return 0;
+
+        // Cells of images smaller than the grid repeat their pixels.
+        const auto cellBegin = [](GLint cell, GLsizei size) { return cell * size / GRID_SIZE; };
+        const auto cellEnd = [&](GLint cell, GLsizei size) {
+            return std::max((cell + 1) * size / GRID_SIZE, cellBegin(cell, size) + 1);
+        };
+        uint8_t cells[READBACK_SIZE];
+        for (GLint cellY = 0; cellY < GRID_SIZE; ++cellY) {
+            for (GLint cellX = 0; cellX < GRID_SIZE; ++cellX) {
+                std::array<uint32_t, 3> sum{};
+                uint32_t count = 0;
+                for (GLint y = cellBegin(cellY, height); y < cellEnd(cellY, height); ++y) {
+                    const uint8_t *row = pixels + y * stride;
+                    for (GLint x = cellBegin(cellX, width); x < cellEnd(cellX, width); ++x) {
+                        sum[0] += row[x * 4];
+                        sum[1] += row[x * 4 + 1];
+                        sum[2] += row[x * 4 + 2];
+                        ++count;
+                    }
+                }
+                uint8_t *cell = cells + (cellY * GRID_SIZE + cellX) * 4;
+                for (GLint channel = 0; channel < 3; ++channel) {
+                    cell[channel] = static_cast<uint8_t>(sum[channel] / count);
+                }
+                cell[3] = 0xFF;
+            }
+        }
+        return DominantColorOf(cells);
+    }
+
+    uint32_t ColorExtractor::TakeDominantColor() {
+        if (!dominantColor || dominantColor == reportedColor) return 0;
+
+        if (reportedColor) {
+            const uint8_t current[] = {
+                    static_cast<uint8_t>(dominantColor >> 16),
+                    static_cast<uint8_t>(dominantColor >> 8),
+                    static_cast<uint8_t>(dominantColor)};
+            const uint8_t reported[] = {
+                    static_cast<uint8_t>(reportedColor >> 16),
+                    static_cast<uint8_t>(reportedColor >> 8),
+                    static_cast<uint8_t>(reportedColor)};
+            if (ColorDistance(current, reported) < MIN_REPORTED_COLOR_DISTANCE) return 0;
+        }
+        reportedColor = dominantColor;
+        return dominantColor;
+    }
+}  // namespace lookaround
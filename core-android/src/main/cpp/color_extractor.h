@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <cstdint>
+
+namespace lookaround {
+    // Extracts the dominant color of the smallest blur pyramid level on the GPU. A reduction
+    // pass averages the level into a GRID_SIZE x GRID_SIZE target which is read back through a
+    // pixel buffer object guarded by a fence, so the result becomes available a frame (or a few)
+    // later without ever stalling the render loop.
+    class ColorExtractor {
+    public:
+        static constexpr GLsizei GRID_SIZE = 4;
+        static constexpr GLint EXTRACTION_INTERVAL_FRAMES = 15;
+        // Sum of absolute RGB channel differences (0-765) under which colors are treated alike.
+        static constexpr GLint CLUSTER_COLOR_DISTANCE = 48;
+        static constexpr GLint MIN_REPORTED_COLOR_DISTANCE = 24;
+
+        // Must be called with a current context. Returns false if the reduction program could
+        // not be created, the extractor then stays inactive.
+        bool Init();
+
+        void Release();
+
+        // Queues the reduction of sourceTextureId unless a readback is still in flight or the
+        // extraction interval has not elapsed yet. Leaves GL_FRAMEBUFFER bound to 0.
+        void Extract(GLuint sourceTextureId);
+
+        // Picks up a finished readback, if any. Never blocks.
+        void Poll();
+
+        // Whether a readback is waiting for the GPU, for Poll to pick up.
+        [[nodiscard]] bool IsReadbackPending() const { return fence != nullptr; }
+
+        // Returns the dominant color as 0xAARRGGBB if it changed noticeably since the last call,
+        // 0 (fully transparent) otherwise.
+        uint32_t TakeDominantColor();
+
+        // Dominant color of the RGBA rows of pixels, stride bytes apart, as 0xAARRGGBB - the same
+        // clustering over GRID_SIZE x GRID_SIZE cell means, averaged on the CPU. For images
+        // already small, e.g. blurred by BitmapBlur.
+        static uint32_t DominantColor(const uint8_t *pixels, GLsizei width, GLsizei height,
+                                      GLsizei stride);
+
+    private:
+        static constexpr GLsizeiptr READBACK_SIZE = GRID_SIZE * GRID_SIZE * 4;
+
+        bool initialized = false;
+        GLuint program = 0;
+        GLint positionHandle = -1;
+        GLint samplerHandle = -1;
+        GLuint textureId = 0;
+        GLuint fboId = 0;
+        GLuint pboId = 0;
+        GLsync fence = nullptr;
+        GLint framesUntilExtraction = 0;
+
+        uint32_t dominantColor = 0;
+        uint32_t reportedColor = 0;
+    };
+}  // namespace lookaround
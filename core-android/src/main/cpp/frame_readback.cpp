@@ -0,0 +1,148 @@
+#include "frame_readback.h"
+
+#include "gl_check.h"
+
+namespace lookaround {
+    void FrameReadback::Init() {
+        GLuint pboIds[RING_SIZE];
+        CHECK_GL(glGenBuffers(RING_SIZE, pboIds));
+        for (size_t i = 0; i < RING_SIZE; ++i) slots[i].pboId = pboIds[i];
+        CHECK_GL(glGenTextures(1, &flipTextureId));
+        CHECK_GL(glGenFramebuffers(1, &flipFboId));
+        initialized = true;
+    }
+
+    void FrameReadback::Release() {
+        if (!initialized) return;
+
+        for (auto &slot: slots) {
+            if (slot.state == SlotState::MAPPED) {
+                CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pboId));
+                CHECK_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+            }
+            if (slot.fence) CHECK_GL(glDeleteSync(slot.fence));
+            CHECK_GL(glDeleteBuffers(1, &slot.pboId));
+            slot = Slot{};
+        }
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        CHECK_GL(glDeleteFramebuffers(1, &flipFboId));
+        CHECK_GL(glDeleteTextures(1, &flipTextureId));
+        flipWidth = 0;
+        flipHeight = 0;
+        requestedLevel = NO_REQUEST;
+        initialized = false;
+    }
+
+    void FrameReadback::PrepareFlipTarget(GLsizei width, GLsizei height) {
+        if (width == flipWidth && height == flipHeight) return;
+
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, flipTextureId));
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                              GL_UNSIGNED_BYTE, nullptr));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, flipFboId));
+        CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                        flipTextureId, 0));
+        flipWidth = width;
+        flipHeight = height;
+    }
+
+    bool FrameReadback::Capture(GLuint sourceFboId, GLsizei width, GLsizei height) {
+        if (!initialized || width <= 0 || height <= 0) return false;
+
+        Slot *freeSlot = nullptr;
+        for (auto &slot: slots) {
+            if (slot.state == SlotState::FREE) {
+                freeSlot = &slot;
+                break;
+            }
+        }
+        if (!freeSlot) return false;
+
+        PrepareFlipTarget(width, height);
+        // Scissor would clip the blit - the caller restores it at the start of every frame.
+        CHECK_GL(glDisable(GL_SCISSOR_TEST));
+        CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, sourceFboId));
+        CHECK_GL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, flipFboId));
+        CHECK_GL(glBlitFramebuffer(0, 0, width, height,
+                                   0, height, width, 0,
+                                   GL_COLOR_BUFFER_BIT, GL_NEAREST));
+        CHECK_GL(glEnable(GL_SCISSOR_TEST));
+
+        const GLsizeiptr size = static_cast<GLsizeiptr>(width) * height * 4;
+        CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, flipFboId));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, freeSlot->pboId));
+        if (freeSlot->capacity < size) {
+            CHECK_GL(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+            freeSlot->capacity = size;
+        }
+        CHECK_GL(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+        freeSlot->fence = CHECK_GL(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        freeSlot->width = width;
+        freeSlot->height = height;
+        freeSlot->sequence = nextSequence++;
+        freeSlot->state = SlotState::PENDING;
+        requestedLevel = NO_REQUEST;
+        return true;
+    }
+
+    void FrameReadback::Poll() {
+        for (auto &slot: slots) {
+            if (slot.state != SlotState::PENDING) continue;
+
+            GLenum status = CHECK_GL(glClientWaitSync(slot.fence, 0, 0));
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) continue;
+            CHECK_GL(glDeleteSync(slot.fence));
+            slot.fence = nullptr;
+            slot.state = SlotState::READY;
+        }
+    }
+
+    bool FrameReadback::IsCapturePending() const {
+        for (const auto &slot: slots) {
+            if (slot.state == SlotState::PENDING) return true;
+        }
+        return false;
+    }
+
+    const uint8_t *FrameReadback::AcquireSnapshot(GLsizei *width, GLsizei *height) {
+        Slot *oldest = nullptr;
+        for (auto &slot: slots) {
+            if (slot.state == SlotState::MAPPED) return nullptr;
+            if (slot.state == SlotState::READY && (!oldest || slot.sequence < oldest->sequence)) {
+                oldest = &slot;
+            }
+        }
+        if (!oldest) return nullptr;
+
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, oldest->pboId));
+        auto *pixels = static_cast<const uint8_t *>(CHECK_GL(glMapBufferRange(
+                GL_PIXEL_PACK_BUFFER, 0,
+                static_cast<GLsizeiptr>(oldest->width) * oldest->height * 4,
+                GL_MAP_READ_BIT)));
+        CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        if (!pixels) {
+            oldest->state = SlotState::FREE;
+            return nullptr;
+        }
+
+        oldest->state = SlotState::MAPPED;
+        *width = oldest->width;
+        *height = oldest->height;
+        return pixels;
+    }
+
+    void FrameReadback::ReleaseSnapshot() {
+        for (auto &slot: slots) {
+            if (slot.state != SlotState::MAPPED) continue;
+
+            CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pboId));
+            CHECK_GL(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+            CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+            slot.state = SlotState::FREE;
+        }
+    }
+}  // namespace lookaround
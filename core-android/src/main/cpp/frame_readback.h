@@ -0,0 +1,72 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace lookaround {
+    // Captures frames (or blur pyramid levels) into a ring of pixel buffer objects. Every capture
+    // is guarded by a fence and only handed out once the GPU signalled it, so reading the pixels
+    // back never stalls the render loop. Captured rows are flipped on the GPU, the mapped memory
+    // is top-down RGBA_8888 - the layout of an ARGB_8888 Bitmap.
+    class FrameReadback {
+    public:
+        static constexpr size_t RING_SIZE = 3;
+        static constexpr GLint NO_REQUEST = -1;
+
+        // Must be called with a current context.
+        void Init();
+
+        void Release();
+
+        void Request(GLint level) { requestedLevel = level; }
+
+        [[nodiscard]] GLint RequestedLevel() const { return requestedLevel; }
+
+        // Copies width x height pixels of sourceFboId (0 for the window surface) into the next
+        // free slot and clears the request. Returns false if every slot is still in use.
+        // Leaves GL_FRAMEBUFFER bound to 0.
+        bool Capture(GLuint sourceFboId, GLsizei width, GLsizei height);
+
+        // Marks captures signalled by the GPU as ready. Never blocks.
+        void Poll();
+
+        // Whether a capture is waiting for the GPU, for Poll to mark ready.
+        [[nodiscard]] bool IsCapturePending() const;
+
+        // Maps the oldest ready capture, nullptr if there is none. The memory stays valid until
+        // ReleaseSnapshot, which must be called before acquiring the next one.
+        const uint8_t *AcquireSnapshot(GLsizei *width, GLsizei *height);
+
+        void ReleaseSnapshot();
+
+    private:
+        enum class SlotState {
+            FREE, PENDING, READY, MAPPED
+        };
+
+        struct Slot {
+            GLuint pboId = 0;
+            GLsizeiptr capacity = 0;
+            GLsync fence = nullptr;
+            GLsizei width = 0;
+            GLsizei height = 0;
+            uint64_t sequence = 0;
+            SlotState state = SlotState::FREE;
+        };
+
+        void PrepareFlipTarget(GLsizei width, GLsizei height);
+
+        bool initialized = false;
+        GLint requestedLevel = NO_REQUEST;
+        std::array<Slot, RING_SIZE> slots{};
+        uint64_t nextSequence = 0;
+
+        GLuint flipTextureId = 0;
+        GLuint flipFboId = 0;
+        GLsizei flipWidth = 0;
+        GLsizei flipHeight = 0;
+    };
+}  // namespace lookaround
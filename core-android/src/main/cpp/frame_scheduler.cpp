@@ -0,0 +1,54 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace lookaround {
+    int64_t MonotonicFrameClock::NowNs() const {
+        // steady_clock is CLOCK_MONOTONIC on Android, the base of SurfaceTexture timestamps.
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    FrameScheduler::Decision FrameScheduler::Schedule(int64_t timestampNs,
+                                                      uint32_t coalescedCount) {
+        stats.coalesced += coalescedCount;
+        if (hasPresented && timestampNs <= lastTimestampNs) {
+            ++stats.stale;
+            return {};
+        }
+
+        const int64_t nowNs = clock.NowNs();
+        const int64_t latencyNs = nowNs - timestampNs;
+        int64_t presentationTimeNs = nowNs;
+        if (latencyNs >= 0 && latencyNs <= MAX_TRUSTED_LATENCY_NS) {
+            smoothedLatencyNs = hasLatency
+                                ? smoothedLatencyNs +
+                                  (latencyNs - smoothedLatencyNs) / LATENCY_SMOOTHING
+                                : latencyNs;
+            hasLatency = true;
+            // One interval on top of the usual latency leaves time to draw the frame. Late
+            // frames are shown as soon as possible, early ones are held back at most two
+            // intervals.
+            presentationTimeNs = std::clamp(timestampNs + smoothedLatencyNs + frameIntervalNs,
+                                            nowNs, nowNs + 2 * frameIntervalNs);
+        }
+        // The compositor drops frames queued with a time before the previous one.
+        if (hasPresented) {
+            presentationTimeNs = std::max(presentationTimeNs,
+                                          lastPresentationTimeNs + frameIntervalNs / 2);
+        }
+
+        hasPresented = true;
+        lastTimestampNs = timestampNs;
+        lastPresentationTimeNs = presentationTimeNs;
+        ++stats.rendered;
+        return {true, presentationTimeNs};
+    }
+
+    void FrameScheduler::Reset() {
+        hasPresented = false;
+        hasLatency = false;
+        smoothedLatencyNs = 0;
+    }
+}  // namespace lookaround
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lookaround {
+    // Time source of the frame scheduler, injectable so scheduling can be tested without a
+    // display. Times are in the CLOCK_MONOTONIC base of SurfaceTexture timestamps.
+    class FrameClock {
+    public:
+        virtual ~FrameClock() = default;
+
+        [[nodiscard]] virtual int64_t NowNs() const = 0;
+    };
+
+    class MonotonicFrameClock : public FrameClock {
+    public:
+        [[nodiscard]] int64_t NowNs() const override;
+    };
+
+    // Picks presentation times for camera frames. Each frame is presented a steady latency
+    // after it was captured, so render jitter does not turn into uneven frame pacing on
+    // screen. Frames which are not newer than the last presented one are rejected.
+    class FrameScheduler {
+    public:
+        static constexpr int64_t DEFAULT_FRAME_INTERVAL_NS = 16'666'667;
+        // Larger capture to render latencies mean the timestamps use another time base.
+        static constexpr int64_t MAX_TRUSTED_LATENCY_NS = 500'000'000;
+        static constexpr int64_t LATENCY_SMOOTHING = 8;
+
+        struct Decision {
+            bool render = false;
+            int64_t presentationTimeNs = 0;
+        };
+
+        struct Stats {
+            uint64_t rendered = 0;
+            // Frames replaced by a newer one before they were drawn.
+            uint64_t coalesced = 0;
+            // Frames rejected for not being newer than the last presented one.
+            uint64_t stale = 0;
+        };
+
+        explicit FrameScheduler(const FrameClock &clock,
+                                int64_t frameIntervalNs = DEFAULT_FRAME_INTERVAL_NS)
+                : clock(clock), frameIntervalNs(frameIntervalNs) {}
+
+        // Decides whether to draw the frame captured at timestampNs, which replaced
+        // coalescedCount older frames, and when to present it.
+        Decision Schedule(int64_t timestampNs, uint32_t coalescedCount);
+
+        // Forgets the presented frames, e.g. after switching to another camera stream.
+        void Reset();
+
+        [[nodiscard]] const Stats &GetStats() const { return stats; }
+
+    private:
+        const FrameClock &clock;
+        const int64_t frameIntervalNs;
+
+        bool hasPresented = false;
+        int64_t lastTimestampNs = 0;
+        int64_t lastPresentationTimeNs = 0;
+        bool hasLatency = false;
+        int64_t smoothedLatencyNs = 0;
+        Stats stats;
+    };
+}  // namespace lookaround
@@ -0,0 +1,195 @@
+#include "frame_trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace lookaround {
+    namespace {
+        constexpr size_t PaddedSize(size_t size) { return (size + 7) & ~size_t{7}; }
+
+        template<typename Payload>
+        bool ReadPayload(const uint8_t *payload, size_t payloadBytes, Payload &out) {
+            if (payloadBytes < sizeof(Payload)) return false;
+            memcpy(&out, payload, sizeof(Payload));
+            return true;
+        }
+    }  // namespace
+
+    bool FrameTraceWriter::Open(const char *path, size_t capacityBytes) {
+        Close();
+        if (capacityBytes < sizeof(FrameTraceHeader)) return false;
+
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) return false;
+        if (ftruncate(fd, static_cast<off_t>(capacityBytes)) != 0) {
+            Close();
+            return false;
+        }
+        void *mapped = mmap(nullptr, capacityBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            Close();
+            return false;
+        }
+
+        data = static_cast<uint8_t *>(mapped);
+        capacity = capacityBytes;
+        used = sizeof(FrameTraceHeader);
+        droppedRecords = 0;
+        const FrameTraceHeader header{FRAME_TRACE_MAGIC, FRAME_TRACE_VERSION, used};
+        memcpy(data, &header, sizeof(header));
+        return true;
+    }
+
+    void FrameTraceWriter::Close() {
+        if (data) {
+            munmap(data, capacity);
+            data = nullptr;
+        }
+        if (fd >= 0) {
+            if (used) {
+                [[maybe_unused]] const int trimmed = ftruncate(fd, static_cast<off_t>(used));
+            }
+            close(fd);
+            fd = -1;
+        }
+        capacity = 0;
+        used = 0;
+    }
+
+    void FrameTraceWriter::AppendState(const FrameTraceState &state) {
+        Append(FrameTraceRecordType::STATE, &state, sizeof(state), nullptr, 0);
+    }
+
+    void FrameTraceWriter::AppendCommand(const FrameTraceCommand &command) {
+        Append(FrameTraceRecordType::COMMAND, &command, sizeof(command), nullptr, 0);
+    }
+
+    void FrameTraceWriter::AppendFrame(const FrameTraceFrame &frame, const float *rects) {
+        const size_t rectsBytes =
+                rects ? frame.allRectsCount * FRAME_TRACE_RECT_COMPONENTS * sizeof(float) : 0;
+        Append(FrameTraceRecordType::FRAME, &frame, PaddedSize(sizeof(frame)), rects,
+               rectsBytes);
+    }
+
+    void FrameTraceWriter::AppendImage(const FrameTraceImage &image, const uint8_t *pixels) {
+        Append(FrameTraceRecordType::IMAGE, &image, PaddedSize(sizeof(image)), pixels,
+               static_cast<size_t>(image.width) * image.height * 4);
+    }
+
+    void FrameTraceWriter::Append(FrameTraceRecordType type,
+                                  const void *payload, size_t payloadBytes,
+                                  const void *extra, size_t extraBytes) {
+        if (!data) return;
+
+        // The payload struct is read back with its padding, extra starts 8 byte aligned.
+        const size_t recordBytes =
+                sizeof(FrameTraceRecordHeader) + PaddedSize(payloadBytes + extraBytes);
+        // Once one record is dropped so are all later ones, a replay never skips a record.
+        if (droppedRecords || recordBytes > capacity - used ||
+            payloadBytes + extraBytes > UINT32_MAX) {
+            ++droppedRecords;
+            return;
+        }
+
+        uint8_t *record = data + used;
+        const FrameTraceRecordHeader header{type,
+                                            static_cast<uint32_t>(payloadBytes + extraBytes)};
+        memcpy(record, &header, sizeof(header));
+        record += sizeof(header);
+        memcpy(record, payload, payloadBytes);
+        if (extraBytes) memcpy(record + payloadBytes, extra, extraBytes);
+
+        used += recordBytes;
+        memcpy(data + offsetof(FrameTraceHeader, usedBytes), &used, sizeof(uint64_t));
+    }
+
+    bool FrameTraceReader::Open(const char *path) {
+        Close();
+        const int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat fileStat{};
+        void *mapped = MAP_FAILED;
+        if (fstat(fd, &fileStat) == 0 &&
+            static_cast<size_t>(fileStat.st_size) >= sizeof(FrameTraceHeader)) {
+            mapped = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ,
+                          MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (mapped == MAP_FAILED) return false;
+
+        data = static_cast<const uint8_t *>(mapped);
+        size = static_cast<size_t>(fileStat.st_size);
+        FrameTraceHeader header{};
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != FRAME_TRACE_MAGIC || header.version != FRAME_TRACE_VERSION ||
+            header.usedBytes < sizeof(header) || header.usedBytes > size) {
+            Close();
+            return false;
+        }
+        used = static_cast<size_t>(header.usedBytes);
+        Rewind();
+        return true;
+    }
+
+    void FrameTraceReader::Close() {
+        if (data) munmap(const_cast<uint8_t *>(data), size);
+        data = nullptr;
+        size = 0;
+        used = 0;
+        offset = 0;
+    }
+
+    bool FrameTraceReader::Next(Record &record) {
+        while (data && used - offset >= sizeof(FrameTraceRecordHeader)) {
+            FrameTraceRecordHeader header{};
+            memcpy(&header, data + offset, sizeof(header));
+            const size_t recordBytes =
+                    sizeof(FrameTraceRecordHeader) + PaddedSize(header.payloadBytes);
+            if (recordBytes > used - offset) return false;
+            const uint8_t *payload = data + offset + sizeof(header);
+            offset += recordBytes;
+
+            record.type = header.type;
+            switch (header.type) {
+                case FrameTraceRecordType::STATE:
+                    return ReadPayload(payload, header.payloadBytes, record.state);
+                case FrameTraceRecordType::COMMAND:
+                    return ReadPayload(payload, header.payloadBytes, record.command);
+                case FrameTraceRecordType::FRAME: {
+                    if (!ReadPayload(payload, header.payloadBytes, record.frame)) return false;
+                    const size_t frameBytes = PaddedSize(sizeof(FrameTraceFrame));
+                    const size_t rectsBytes = record.frame.allRectsCount *
+                                              FRAME_TRACE_RECT_COMPONENTS * sizeof(float);
+                    if (rectsBytes > header.payloadBytes - frameBytes) {
+                        record.frame.allRectsCount = 0;
+                        record.frame.otherRectsCount = 0;
+                    }
+                    record.rects = record.frame.allRectsCount
+                                   ? reinterpret_cast<const float *>(payload + frameBytes)
+                                   : nullptr;
+                    return true;
+                }
+                case FrameTraceRecordType::IMAGE: {
+                    if (!ReadPayload(payload, header.payloadBytes, record.image)) return false;
+                    const size_t imageBytes = PaddedSize(sizeof(FrameTraceImage));
+                    const auto &image = record.image;
+                    if (image.width <= 0 || image.height <= 0 ||
+                        static_cast<uint64_t>(image.width) * image.height * 4 >
+                        header.payloadBytes - imageBytes) {
+                        return false;
+                    }
+                    record.pixels = payload + imageBytes;
+                    return true;
+                }
+                default:
+                    break;
+            }
+        }
+        return false;
+    }
+}  // namespace lookaround
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lookaround {
+    // Binary trace of the renderer inputs, replayable frame by frame. The file starts with a
+    // FrameTraceHeader followed by records, each a FrameTraceRecordHeader and its payload
+    // padded to 8 bytes. Fields are in the byte order of the recording device, little endian
+    // on every supported ABI.
+    //
+    // No GL or Android dependencies, so traces can be read on the host.
+
+    constexpr uint32_t FRAME_TRACE_MAGIC = 0x5254414c;  // "LATR"
+    constexpr uint32_t FRAME_TRACE_VERSION = 1;
+
+    struct FrameTraceHeader {
+        uint32_t magic;
+        uint32_t version;
+        // Of the header and the complete records. Updated after every record, so a trace
+        // cut short by a crash stays readable up to its last record.
+        uint64_t usedBytes;
+    };
+
+    enum class FrameTraceRecordType : uint32_t {
+        // Renderer state when recording started, first in every trace.
+        STATE = 1,
+        // A RenderCommand applied before the following frame.
+        COMMAND = 2,
+        // A RenderFrame call, followed by allRectsCount rects of 5 floats.
+        FRAME = 3,
+        // Pixels of a frame, followed by height rows of width RGBA pixels, top-down.
+        IMAGE = 4,
+    };
+
+    struct FrameTraceRecordHeader {
+        FrameTraceRecordType type;
+        uint32_t payloadBytes;
+    };
+
+    struct FrameTraceState {
+        uint32_t blurEnabled;
+        // Values of the animations, which are not in flight when replayed.
+        float lod;
+        float contrastingColorMix;
+        float contrastingColor[3];
+    };
+
+    struct FrameTraceCommand {
+        int64_t timestampNs;
+        // RenderCommand::Type.
+        uint32_t type;
+        uint32_t enabled;
+        uint32_t animated;
+        float color[3];
+    };
+
+    // The frame result is RenderFrame's, 0 drawn, 1 unchanged, 2 failed.
+    struct FrameTraceFrame {
+        int64_t timestampNs;
+        int32_t width;
+        int32_t height;
+        float vertTransform[16];
+        float texTransform[16];
+        uint32_t allRectsCount;
+        uint32_t otherRectsCount;
+        uint32_t result;
+        // CPU time of RenderFrame.
+        int64_t renderNs;
+        // Until glFinish returned after RenderFrame, only measured by replays, 0 otherwise.
+        int64_t finishNs;
+    };
+
+    constexpr size_t FRAME_TRACE_RECT_COMPONENTS = 5;
+
+    enum class FrameTraceImageRole : uint32_t {
+        // Drawn as the camera frame by the following frames of a replay, sampled through their
+        // texTransform like a SurfaceTexture frame.
+        CAMERA = 0,
+        // What a replay drew for a frame.
+        OUTPUT = 1,
+    };
+
+    struct FrameTraceImage {
+        FrameTraceImageRole role;
+        // Of the FRAME record drawing an OUTPUT image, counted from 0.
+        uint32_t frameIndex;
+        int32_t width;
+        int32_t height;
+    };
+
+    // Appends records to a file mapped in memory, so appending is a copy without system calls.
+    // The file is created at its full capacity; recording stops at the first record which does
+    // not fit anymore.
+    class FrameTraceWriter {
+    public:
+        FrameTraceWriter() = default;
+
+        ~FrameTraceWriter() { Close(); }
+
+        FrameTraceWriter(const FrameTraceWriter &) = delete;
+
+        FrameTraceWriter &operator=(const FrameTraceWriter &) = delete;
+
+        // Truncates an existing file. Returns false if it could not be created or mapped.
+        bool Open(const char *path, size_t capacityBytes);
+
+        // Trims the file to the recorded records.
+        void Close();
+
+        [[nodiscard]] bool IsOpen() const { return data != nullptr; }
+
+        [[nodiscard]] size_t DroppedRecords() const { return droppedRecords; }
+
+        void AppendState(const FrameTraceState &state);
+
+        void AppendCommand(const FrameTraceCommand &command);
+
+        void AppendFrame(const FrameTraceFrame &frame, const float *rects);
+
+        void AppendImage(const FrameTraceImage &image, const uint8_t *pixels);
+
+    private:
+        void Append(FrameTraceRecordType type,
+                    const void *payload, size_t payloadBytes,
+                    const void *extra, size_t extraBytes);
+
+        int fd = -1;
+        uint8_t *data = nullptr;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t droppedRecords = 0;
+    };
+
+    class FrameTraceReader {
+    public:
+        struct Record {
+            FrameTraceRecordType type;
+            // Only the members matching type are set. rects and pixels point into the mapped
+            // file.
+            FrameTraceState state;
+            FrameTraceCommand command;
+            FrameTraceFrame frame;
+            const float *rects;
+            FrameTraceImage image;
+            const uint8_t *pixels;
+        };
+
+        FrameTraceReader() = default;
+
+        ~FrameTraceReader() { Close(); }
+
+        FrameTraceReader(const FrameTraceReader &) = delete;
+
+        FrameTraceReader &operator=(const FrameTraceReader &) = delete;
+
+        // Returns false if the file is missing or not a trace of this version.
+        bool Open(const char *path);
+
+        void Close();
+
+        // Returns false at the end of the trace or at a malformed record. Records of unknown
+        // types are skipped.
+        bool Next(Record &record);
+
+        void Rewind() { offset = sizeof(FrameTraceHeader); }
+
+    private:
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+        size_t used = 0;
+        size_t offset = 0;
+    };
+}  // namespace lookaround
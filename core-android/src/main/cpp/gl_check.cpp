@@ -0,0 +1,79 @@
+#include "gl_check.h"
+
+#include <EGL/egl.h>
+
+#include <cstdio>
+
+#include "gl_extensions.h"
+
+namespace lookaround {
+#if LOOKAROUND_GL_CHECK == GL_CHECK_OFF
+    void InitGlCheck(bool debugContext) {}
+#else
+    bool glDebugOutputEnabled = false;
+    thread_local const GlCallSite *currentGlCallSite = nullptr;
+    thread_local unsigned int glCallsUntilSample = GL_CHECK_SAMPLE_INTERVAL;
+
+    namespace {
+        void ReportGlMessage(int priority, const char *kind, const char *message,
+                             const GlCallSite *site) {
+            const char *call = site ? site->call : "unchecked call";
+            const char *file = site ? site->file : "?";
+            const unsigned int line = site ? site->line : 0;
+#if LOOKAROUND_GL_CHECK == GL_CHECK_CALLS
+            if (priority == ANDROID_LOG_ERROR) {
+                __android_log_assert(nullptr, LOG_TAG, "OpenGL %s: %s at %s [%s:%u]",
+                                     kind, message, call, file, line);
+            }
+#endif
+            // Sampled errors and asynchronous debug messages surface after the call raising
+            // them, the site is only the nearest checked one.
+            __android_log_print(priority, LOG_TAG, "OpenGL %s: %s near %s [%s:%u]",
+                                kind, message, call, file, line);
+        }
+
+        void GL_APIENTRY OnGlDebugMessage(GLenum source, GLenum type, GLuint id,
+                                          GLenum severity, GLsizei length,
+                                          const GLchar *message, const void *userParam) {
+            const bool error = type == GL_DEBUG_TYPE_ERROR_KHR;
+            ReportGlMessage(error ? ANDROID_LOG_ERROR : ANDROID_LOG_WARN,
+                            error ? "Error" : "Debug", message, currentGlCallSite);
+        }
+    }  // namespace
+
+    void ReportGlError(GLenum error, const GlCallSite &site) {
+        const char *name = GLErrorName(error);
+        char unknown[32];
+        if (!name) {
+            snprintf(unknown, sizeof(unknown), "<Unknown GL Error 0x%04x>", error);
+            name = unknown;
+        }
+        ReportGlMessage(ANDROID_LOG_ERROR, "Error", name, &site);
+    }
+
+    void InitGlCheck(bool debugContext) {
+        if (!HasGlExtension("GL_KHR_debug")) return;
+        auto debugMessageCallback = reinterpret_cast<PFNGLDEBUGMESSAGECALLBACKKHRPROC>(
+                eglGetProcAddress("glDebugMessageCallbackKHR"));
+        auto debugMessageControl = reinterpret_cast<PFNGLDEBUGMESSAGECONTROLKHRPROC>(
+                eglGetProcAddress("glDebugMessageControlKHR"));
+        if (!debugMessageCallback || !debugMessageControl) return;
+
+        // Notifications are chatty, e.g. every buffer upload on some drivers.
+        debugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION_KHR, 0,
+                            nullptr, GL_FALSE);
+        debugMessageCallback(OnGlDebugMessage, nullptr);
+        glEnable(GL_DEBUG_OUTPUT_KHR);
+#if LOOKAROUND_GL_CHECK == GL_CHECK_CALLS
+        // Messages are delivered during the call raising them, so they carry its site.
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
+#endif
+        // Other contexts may leave errors out of the debug output, so they are still checked
+        // with glGetError. An error from the setup would be misattributed to a checked call.
+        glDebugOutputEnabled = glGetError() == GL_NO_ERROR && debugContext;
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                            "GL check: KHR_debug output enabled, debug context %d.",
+                            debugContext);
+    }
+#endif
+}  // namespace lookaround
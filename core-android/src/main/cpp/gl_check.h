@@ -0,0 +1,172 @@
+#pragma once
+
+#include <android/log.h>
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace lookaround {
+    auto constexpr LOG_TAG = "OpenGLRendererJni";
+
+    // Null for errors without a name.
+    inline const char *GLErrorName(GLenum error) {
+        switch (error) {
+            case GL_NO_ERROR:
+                return "GL_NO_ERROR";
+            case GL_INVALID_ENUM:
+                return "GL_INVALID_ENUM";
+            case GL_INVALID_VALUE:
+                return "GL_INVALID_VALUE";
+            case GL_INVALID_OPERATION:
+                return "GL_INVALID_OPERATION";
+            case GL_STACK_OVERFLOW_KHR:
+                return "GL_STACK_OVERFLOW";
+            case GL_STACK_UNDERFLOW_KHR:
+                return "GL_STACK_UNDERFLOW";
+            case GL_OUT_OF_MEMORY:
+                return "GL_OUT_OF_MEMORY";
+            case GL_INVALID_FRAMEBUFFER_OPERATION:
+                return "GL_INVALID_FRAMEBUFFER_OPERATION";
+            default:
+                return nullptr;
+        }
+    }
+
+    inline std::string GLErrorString(GLenum error) {
+        if (const char *name = GLErrorName(error)) return name;
+        std::ostringstream oss;
+        oss << "<Unknown GL Error 0x" << std::setfill('0') <<
+            std::setw(4) << std::right << std::hex << error << ">";
+        return oss.str();
+    }
+
+    inline std::string EGLErrorString(EGLenum error) {
+        switch (error) {
+            case EGL_SUCCESS:
+                return "EGL_SUCCESS";
+            case EGL_NOT_INITIALIZED:
+                return "EGL_NOT_INITIALIZED";
+            case EGL_BAD_ACCESS:
+                return "EGL_BAD_ACCESS";
+            case EGL_BAD_ALLOC:
+                return "EGL_BAD_ALLOC";
+            case EGL_BAD_ATTRIBUTE:
+                return "EGL_BAD_ATTRIBUTE";
+            case EGL_BAD_CONTEXT:
+                return "EGL_BAD_CONTEXT";
+            case EGL_BAD_CONFIG:
+                return "EGL_BAD_CONFIG";
+            case EGL_BAD_CURRENT_SURFACE:
+                return "EGL_BAD_CURRENT_SURFACE";
+            case EGL_BAD_DISPLAY:
+                return "EGL_BAD_DISPLAY";
+            case EGL_BAD_SURFACE:
+                return "EGL_BAD_SURFACE";
+            case EGL_BAD_MATCH:
+                return "EGL_BAD_MATCH";
+            case EGL_BAD_PARAMETER:
+                return "EGL_BAD_PARAMETER";
+            case EGL_BAD_NATIVE_PIXMAP:
+                return "EGL_BAD_NATIVE_PIXMAP";
+            case EGL_BAD_NATIVE_WINDOW:
+                return "EGL_BAD_NATIVE_WINDOW";
+            case EGL_CONTEXT_LOST:
+                return "EGL_CONTEXT_LOST";
+            default: {
+                std::ostringstream oss;
+                oss << "<Unknown EGL Error 0x" << std::setfill('0') <<
+                    std::setw(4) << std::right << std::hex << error << ">";
+                return oss.str();
+            }
+        }
+    }
+}  // namespace lookaround
+
+// CHECK_GL(glCall) reports GL errors raised by glCall with its source and call site. The mode is
+// picked at build time by LOOKAROUND_GL_CHECK:
+// - GL_CHECK_OFF, the release default: no checking.
+// - GL_CHECK_SAMPLED: glGetError after every GL_CHECK_SAMPLE_INTERVAL-th call and errors the
+//   driver reports through KHR_debug, logged without aborting. Close to release speed.
+// - GL_CHECK_CALLS, the debug default: every call, aborting on the first error. With KHR_debug
+//   the driver reports errors synchronously during the call instead of glGetError after it.
+// Neither mode allocates, the call site is stringified at compile time.
+#define GL_CHECK_OFF 0
+#define GL_CHECK_SAMPLED 1
+#define GL_CHECK_CALLS 2
+
+#ifndef LOOKAROUND_GL_CHECK
+#ifdef NDEBUG
+#define LOOKAROUND_GL_CHECK GL_CHECK_OFF
+#else
+#define LOOKAROUND_GL_CHECK GL_CHECK_CALLS
+#endif
+#endif
+
+namespace lookaround {
+    // Installs the KHR_debug message callback if the driver supports it. Must be called with a
+    // current context, a no-op with GL_CHECK_OFF. Only a debug context is relied on to report
+    // every error, see EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR.
+    void InitGlCheck(bool debugContext);
+}  // namespace lookaround
+
+#if LOOKAROUND_GL_CHECK == GL_CHECK_OFF
+#define CHECK_GL(gl_func) [&]() { return gl_func; }()
+#else
+namespace lookaround {
+    struct GlCallSite {
+        const char *call;
+        const char *file;
+        unsigned int line;
+    };
+
+    constexpr unsigned int GL_CHECK_SAMPLE_INTERVAL = 64;
+
+    // Set by InitGlCheck, errors are reported by the driver instead of polled.
+    extern bool glDebugOutputEnabled;
+    // The innermost checked call in progress on this thread, for attributing debug messages.
+    extern thread_local const GlCallSite *currentGlCallSite;
+    extern thread_local unsigned int glCallsUntilSample;
+
+    // Out of line to keep the checked calls small.
+    void ReportGlError(GLenum error, const GlCallSite &site);
+
+    class CheckGlErrorOnExit {
+    public:
+        explicit CheckGlErrorOnExit(const GlCallSite &site) :
+                mSite(site),
+                mEnclosingSite(currentGlCallSite) {
+            currentGlCallSite = &site;
+        }
+
+        ~CheckGlErrorOnExit() {
+            currentGlCallSite = mEnclosingSite;
+#if LOOKAROUND_GL_CHECK == GL_CHECK_CALLS
+            if (glDebugOutputEnabled) return;
+#else
+            if (--glCallsUntilSample != 0) return;
+            glCallsUntilSample = GL_CHECK_SAMPLE_INTERVAL;
+#endif
+            GLenum err = glGetError();
+            if (err != GL_NO_ERROR) ReportGlError(err, mSite);
+        }
+
+        CheckGlErrorOnExit(const CheckGlErrorOnExit &) = delete;
+
+        CheckGlErrorOnExit &operator=(const CheckGlErrorOnExit &) = delete;
+
+    private:
+        const GlCallSite &mSite;
+        const GlCallSite *mEnclosingSite;
+    };  // class CheckGlErrorOnExit
+}   // namespace lookaround
+#define CHECK_GL(glFunc)                                                    \
+  [&]() {                                                                   \
+    static constexpr lookaround::GlCallSite site{#glFunc, __FILE__, __LINE__};\
+    lookaround::CheckGlErrorOnExit assertOnExit(site);                      \
+    return glFunc;                                                          \
+  }()
+#endif
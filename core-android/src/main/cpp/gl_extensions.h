@@ -0,0 +1,32 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include <cstring>
+
+namespace lookaround {
+    // Returns true if the space separated extension list contains the exact name.
+    inline bool ContainsExtension(const char *extensions, const char *name) {
+        if (extensions == nullptr || name == nullptr) return false;
+        const size_t nameLength = strlen(name);
+        const char *candidate = extensions;
+        while ((candidate = strstr(candidate, name)) != nullptr) {
+            const bool startsToken = candidate == extensions || candidate[-1] == ' ';
+            const char end = candidate[nameLength];
+            if (startsToken && (end == ' ' || end == '\0')) return true;
+            candidate += nameLength;
+        }
+        return false;
+    }
+
+    // Must be called with a current context.
+    inline bool HasGlExtension(const char *name) {
+        return ContainsExtension(
+                reinterpret_cast<const char *>(glGetString(GL_EXTENSIONS)), name);
+    }
+
+    inline bool HasEglExtension(EGLDisplay display, const char *name) {
+        return ContainsExtension(eglQueryString(display, EGL_EXTENSIONS), name);
+    }
+}  // namespace lookaround
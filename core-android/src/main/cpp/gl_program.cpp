@@ -0,0 +1,161 @@
+#include "gl_program.h"
+
+#include <android/log.h>
+#include <GLES3/gl31.h>
+
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    namespace {
+        const char *ShaderTypeString(GLenum shaderType) {
+            switch (shaderType) {
+                case GL_VERTEX_SHADER:
+                    return "GL_VERTEX_SHADER";
+                case GL_FRAGMENT_SHADER:
+                    return "GL_FRAGMENT_SHADER";
+                case GL_COMPUTE_SHADER:
+                    return "GL_COMPUTE_SHADER";
+                default:
+                    return "<Unknown shader type>";
+            }
+        }
+
+        struct ProgramBinary {
+            GLenum format;
+            std::vector<uint8_t> data;
+        };
+
+        // Binaries of the programs linked so far, keyed by their sources. Program objects are
+        // shareable, but their uniform values are not synchronized between contexts, so every
+        // renderer links its own from the binary instead of compiling the sources again.
+        std::mutex programBinariesMutex;
+        std::map<std::pair<std::string, std::string>, ProgramBinary> programBinaries;
+
+        GLuint LoadProgramBinary(const ProgramBinary &binary) {
+            GLuint program = CHECK_GL(glCreateProgram());
+            if (!program) return 0;
+            CHECK_GL(glProgramBinary(program, binary.format, binary.data.data(),
+                                     static_cast<GLsizei>(binary.data.size())));
+            GLint linkStatus = 0;
+            CHECK_GL(glGetProgramiv(program, GL_LINK_STATUS, &linkStatus));
+            if (!linkStatus) {
+                // Rejected by the driver, only expected after a driver update.
+                CHECK_GL(glDeleteProgram(program));
+                program = 0;
+            }
+            return program;
+        }
+
+        void SaveProgramBinary(GLuint program, std::pair<std::string, std::string> &&sources) {
+            GLint length = 0;
+            CHECK_GL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+            if (length <= 0) return;
+            ProgramBinary binary{0, std::vector<uint8_t>(length)};
+            CHECK_GL(glGetProgramBinary(program, length, /*length=*/nullptr, &binary.format,
+                                        binary.data.data()));
+            std::lock_guard<std::mutex> lock(programBinariesMutex);
+            programBinaries[std::move(sources)] = std::move(binary);
+        }
+    }  // namespace
+
+    // Returns a handle to the shader
+    GLuint CompileShader(GLenum shaderType, const char *shaderSrc) {
+        GLuint shader = CHECK_GL(glCreateShader(shaderType));
+        if (!shader) return 0;
+        CHECK_GL(glShaderSource(shader, 1, &shaderSrc, /*length=*/nullptr));
+        CHECK_GL(glCompileShader(shader));
+        GLint compileStatus = 0;
+        CHECK_GL(glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus));
+        if (!compileStatus) {
+            GLint logLength = 0;
+            CHECK_GL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength));
+            std::vector<char> logBuffer(logLength);
+            if (logLength > 0) {
+                CHECK_GL(glGetShaderInfoLog(shader, logLength, /*length=*/nullptr,
+                                            &logBuffer[0]));
+            }
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Unable to compile %s shader:\n %s.",
+                                ShaderTypeString(shaderType),
+                                logLength > 0 ? &logBuffer[0] : "(unknown error)");
+            CHECK_GL(glDeleteShader(shader));
+            shader = 0;
+        }
+        return shader;
+    }
+
+    namespace {
+        // Builds a program from one shader of each of types, or loads it from the binary built
+        // the first time. sources is the cache key, the second source is empty for compute.
+        GLuint BuildProgram(std::pair<std::string, std::string> &&sources,
+                            std::initializer_list<GLenum> types) {
+            {
+                std::unique_lock<std::mutex> lock(programBinariesMutex);
+                auto found = programBinaries.find(sources);
+                if (found != programBinaries.end()) {
+                    const ProgramBinary binary = found->second;
+                    lock.unlock();
+                    if (GLuint program = LoadProgramBinary(binary)) return program;
+                }
+            }
+
+            std::vector<GLuint> shaders;
+            const std::string *shaderSrc = &sources.first;
+            for (GLenum type: types) {
+                GLuint shader = CompileShader(type, shaderSrc->c_str());
+                if (!shader) break;
+                shaders.push_back(shader);
+                shaderSrc = &sources.second;
+            }
+            GLuint program = 0;
+            if (shaders.size() == types.size()) program = CHECK_GL(glCreateProgram());
+            if (!program) {
+                for (GLuint shader: shaders) CHECK_GL(glDeleteShader(shader));
+                return 0;
+            }
+
+            for (GLuint shader: shaders) CHECK_GL(glAttachShader(program, shader));
+            CHECK_GL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+            CHECK_GL(glLinkProgram(program));
+            // Flagged for deletion, freed along with the program.
+            for (GLuint shader: shaders) CHECK_GL(glDeleteShader(shader));
+            GLint linkStatus = 0;
+            CHECK_GL(glGetProgramiv(program, GL_LINK_STATUS, &linkStatus));
+            if (!linkStatus) {
+                GLint logLength = 0;
+                CHECK_GL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength));
+                std::vector<char> logBuffer(logLength);
+                if (logLength > 0) {
+                    CHECK_GL(glGetProgramInfoLog(program, logLength, /*length=*/nullptr,
+                                                 &logBuffer[0]));
+                }
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                    "Unable to link program:\n %s.",
+                                    logLength > 0 ? &logBuffer[0] : "(unknown error)");
+                CHECK_GL(glDeleteProgram(program));
+                program = 0;
+            } else {
+                SaveProgramBinary(program, std::move(sources));
+            }
+
+            return program;
+        }
+    }  // namespace
+
+    // Returns a handle to the output program
+    GLuint CreateGlProgram(const char *vertexShaderSrc, const char *fragmentShaderSrc) {
+        return BuildProgram({vertexShaderSrc, fragmentShaderSrc},
+                            {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER});
+    }
+
+    GLuint CreateGlComputeProgram(const char *computeShaderSrc) {
+        return BuildProgram({computeShaderSrc, {}}, {GL_COMPUTE_SHADER});
+    }
+}  // namespace lookaround
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+namespace lookaround {
+    // Returns a handle to the shader
+    GLuint CompileShader(GLenum shaderType, const char *shaderSrc);
+
+    // Returns a handle to the output program
+    GLuint CreateGlProgram(const char *vertexShaderSrc, const char *fragmentShaderSrc);
+
+    // Returns a handle to the output program, needs ES 3.1
+    GLuint CreateGlComputeProgram(const char *computeShaderSrc);
+}  // namespace lookaround
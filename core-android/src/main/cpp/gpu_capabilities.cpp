@@ -0,0 +1,171 @@
+#include "gpu_capabilities.h"
+
+#include <android/log.h>
+#include <GLES2/gl2ext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "gl_check.h"
+#include "gl_extensions.h"
+
+namespace lookaround {
+    namespace {
+        const char *GlString(GLenum name) {
+            const auto *string = reinterpret_cast<const char *>(glGetString(name));
+            return string ? string : "";
+        }
+
+        const char *EglString(EGLDisplay display, EGLint name) {
+            const char *string = eglQueryString(display, name);
+            return string ? string : "";
+        }
+    }  // namespace
+
+    void GpuCapabilityCache::Init(EGLDisplay display, std::string path) {
+        cachePath = std::move(path);
+        driver = std::string(GlString(GL_VENDOR)) + '\n' + GlString(GL_RENDERER) + '\n' +
+                 GlString(GL_VERSION) + '\n' + EglString(display, EGL_VENDOR) + '\n' +
+                 EglString(display, EGL_VERSION);
+        if (!cachePath.empty() && Load()) {
+            __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "GPU capabilities loaded from %s.",
+                                cachePath.c_str());
+            return;
+        }
+
+        Probe(display);
+        if (!cachePath.empty()) Save();
+    }
+
+    void GpuCapabilityCache::Probe(EGLDisplay display) {
+        capabilities = GpuCapabilities{};
+        auto &probed = capabilities;
+
+        // "OpenGL ES <major>.<minor> <vendor specific>".
+        if (sscanf(GlString(GL_VERSION), "OpenGL ES %d.%d", &probed.esMajorVersion,
+                   &probed.esMinorVersion) != 2) {
+            probed.esMajorVersion = 2;
+            probed.esMinorVersion = 0;
+        }
+        const bool es3 = probed.esMajorVersion >= 3;
+        const bool es31 = es3 && (probed.esMajorVersion > 3 || probed.esMinorVersion >= 1);
+        const bool es32 = es3 && (probed.esMajorVersion > 3 || probed.esMinorVersion >= 2);
+        probed.computeShaders = es31;
+        probed.invalidateFramebuffer = es3;
+        probed.timerQueries = HasGlExtension("GL_EXT_disjoint_timer_query");
+        probed.floatRenderTargets = es32 || HasGlExtension("GL_EXT_color_buffer_float");
+        probed.halfFloatRenderTargets =
+                probed.floatRenderTargets || HasGlExtension("GL_EXT_color_buffer_half_float");
+        probed.khrDebug = es32 || HasGlExtension("GL_KHR_debug");
+        probed.partialUpdate = HasEglExtension(display, "EGL_KHR_partial_update");
+        probed.bufferAge = probed.partialUpdate || HasEglExtension(display, "EGL_EXT_buffer_age");
+        probed.swapBuffersWithDamageKhr =
+                HasEglExtension(display, "EGL_KHR_swap_buffers_with_damage");
+        probed.swapBuffersWithDamageExt =
+                HasEglExtension(display, "EGL_EXT_swap_buffers_with_damage");
+        if (es3 || HasGlExtension("GL_OES_get_program_binary")) {
+            CHECK_GL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES,
+                                   &probed.programBinaryFormats));
+        }
+
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                            "GPU capabilities probed [ES %d.%d, compute %d, invalidate %d, "
+                            "timer queries %d, float targets %d/%d, KHR_debug %d, "
+                            "buffer age %d, partial update %d, damaged swap %d/%d, "
+                            "program binary formats %d]",
+                            probed.esMajorVersion, probed.esMinorVersion, probed.computeShaders,
+                            probed.invalidateFramebuffer, probed.timerQueries,
+                            probed.floatRenderTargets, probed.halfFloatRenderTargets,
+                            probed.khrDebug, probed.bufferAge, probed.partialUpdate,
+                            probed.swapBuffersWithDamageKhr, probed.swapBuffersWithDamageExt,
+                            probed.programBinaryFormats);
+    }
+
+    void GpuCapabilityCache::SeedBlurLevel(BlurPassPlanner &planner, GLint level,
+                                           GLsizei width, GLsizei height) const {
+        for (const auto &plan: capabilities.blurLevelPlans) {
+            if (plan.mode == GpuCapabilities::UNDECIDED) return;
+            if (plan.width != width || plan.height != height) continue;
+            planner.Seed(level, static_cast<BlurPassPlanner::LevelMode>(plan.mode));
+            return;
+        }
+    }
+
+    bool GpuCapabilityCache::SaveBlurLevel(const BlurPassPlanner &planner, GLint level,
+                                           GLsizei width, GLsizei height) {
+        BlurPassPlanner::LevelMode mode;
+        if (!planner.IsDecided(level, mode)) return false;
+        if (width * height > BlurPassPlanner::FUSED_MAX_LEVEL_PIXELS) return true;
+
+        auto &plans = capabilities.blurLevelPlans;
+        const GpuCapabilities::BlurLevelPlan plan{width, height, static_cast<int8_t>(mode)};
+        auto found = std::find_if(plans.begin(), plans.end(), [width, height](const auto &entry) {
+            return entry.width == width && entry.height == height;
+        });
+        if (found == plans.begin() && found->mode == plan.mode) return true;
+
+        // Moves the plan to the front, dropping the least recently saved one if it is new.
+        if (found == plans.end()) found = plans.end() - 1;
+        std::move_backward(plans.begin(), found, found + 1);
+        plans.front() = plan;
+        if (!cachePath.empty()) Save();
+        return true;
+    }
+
+    bool GpuCapabilityCache::Load() {
+        FILE *file = fopen(cachePath.c_str(), "rb");
+        if (!file) return false;
+
+        CacheHeader header{};
+        bool loaded = fread(&header, sizeof(header), 1, file) == 1 &&
+                      header.magic == CACHE_MAGIC &&
+                      header.version == CACHE_VERSION &&
+                      header.driverLength == driver.size() &&
+                      header.capabilitiesSize == sizeof(GpuCapabilities);
+        if (loaded) {
+            // A driver update may change any capability.
+            std::vector<char> cachedDriver(header.driverLength);
+            GpuCapabilities cached;
+            loaded = fread(cachedDriver.data(), 1, cachedDriver.size(), file) ==
+                     cachedDriver.size() &&
+                     std::equal(cachedDriver.begin(), cachedDriver.end(), driver.begin()) &&
+                     fread(&cached, sizeof(cached), 1, file) == 1;
+            if (loaded) capabilities = cached;
+        }
+        fclose(file);
+        return loaded;
+    }
+
+    bool GpuCapabilityCache::Save() const {
+        // Write to a temporary file first so a crash never leaves a truncated cache behind.
+        // Its name is unique, as renderers of several windows may save at the same time.
+        std::string tmpPath = cachePath + ".XXXXXX";
+        const int fd = mkstemp(tmpPath.data());
+        if (fd < 0) return false;
+        FILE *file = fdopen(fd, "wb");
+        if (!file) {
+            close(fd);
+            remove(tmpPath.c_str());
+            return false;
+        }
+
+        const CacheHeader header{CACHE_MAGIC, CACHE_VERSION,
+                                 static_cast<uint32_t>(driver.size()),
+                                 static_cast<uint32_t>(sizeof(GpuCapabilities))};
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       fwrite(driver.data(), 1, driver.size(), file) == driver.size() &&
+                       fwrite(&capabilities, sizeof(capabilities), 1, file) == 1;
+        written = fclose(file) == 0 && written;
+        if (!written || rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+            remove(tmpPath.c_str());
+            __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                "Failed to cache GPU capabilities at %s.", cachePath.c_str());
+            return false;
+        }
+        return true;
+    }
+}  // namespace lookaround
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES2/gl2.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "blur_pass_planner.h"
+
+namespace lookaround {
+    // What the driver of the context supports, and the fastest pipeline variants picked for it.
+    // Trivially copyable, it is cached as is.
+    struct GpuCapabilities {
+        static constexpr int8_t UNDECIDED = -1;
+
+        GLint esMajorVersion = 2;
+        GLint esMinorVersion = 0;
+        // ES 3.1.
+        bool computeShaders = false;
+        // ES 3.0 glInvalidateFramebuffer.
+        bool invalidateFramebuffer = false;
+        bool timerQueries = false;
+        // Color-renderable 32 and 16 bit float formats.
+        bool floatRenderTargets = false;
+        bool halfFloatRenderTargets = false;
+        bool khrDebug = false;
+        bool bufferAge = false;
+        bool partialUpdate = false;
+        bool swapBuffersWithDamageKhr = false;
+        bool swapBuffersWithDamageExt = false;
+        GLint programBinaryFormats = 0;
+
+        // BlurPassPlanner::LevelMode measured for pyramid levels of width x height, whichever
+        // window they belong to. Most recently saved first, UNDECIDED for unused entries.
+        struct BlurLevelPlan {
+            GLsizei width = 0;
+            GLsizei height = 0;
+            int8_t mode = UNDECIDED;
+        };
+        // The eligible levels of a few window sizes: portrait, landscape and split screen.
+        static constexpr size_t BLUR_LEVEL_PLANS_COUNT = 12;
+        std::array<BlurLevelPlan, BLUR_LEVEL_PLANS_COUNT> blurLevelPlans{};
+    };
+
+    // Probes GpuCapabilities once per driver version: later launches on the same driver load
+    // them from a file instead, along with the pipeline variants measured on earlier launches.
+    class GpuCapabilityCache {
+    public:
+        // Must be called with a current context. An empty cachePath probes every time.
+        void Init(EGLDisplay display, std::string cachePath);
+
+        [[nodiscard]] const GpuCapabilities &Get() const { return capabilities; }
+
+        // Seeds level of planner with the mode cached for levels of width x height, if any.
+        void SeedBlurLevel(BlurPassPlanner &planner, GLint level,
+                           GLsizei width, GLsizei height) const;
+
+        // Caches the mode planner settled for level, of width x height. Returns whether it was
+        // settled. Levels too large to fuse are settled without measuring and not cached.
+        bool SaveBlurLevel(const BlurPassPlanner &planner, GLint level,
+                           GLsizei width, GLsizei height);
+
+    private:
+        static constexpr uint32_t CACHE_MAGIC = 0x50414347;  // "GCAP"
+        // 2: blur plans taken without measurements are no longer fused.
+        // 3: blur plans are kept per level size rather than for one window size.
+        static constexpr uint32_t CACHE_VERSION = 3;
+
+        struct CacheHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t driverLength;
+            uint32_t capabilitiesSize;
+        };
+
+        void Probe(EGLDisplay display);
+
+        bool Load();
+
+        bool Save() const;
+
+        std::string cachePath;
+        // Vendor, renderer and version strings of GL and EGL.
+        std::string driver;
+        GpuCapabilities capabilities;
+    };
+}  // namespace lookaround
@@ -0,0 +1,67 @@
+#include "gpu_timer.h"
+
+#include <EGL/egl.h>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    void GpuTimer::Init(const GpuCapabilities &capabilities) {
+        if (!capabilities.timerQueries) {
+            __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                                "GL_EXT_disjoint_timer_query unavailable - GPU timing disabled.");
+            return;
+        }
+
+        genQueries = reinterpret_cast<PFNGLGENQUERIESEXTPROC>(
+                eglGetProcAddress("glGenQueriesEXT"));
+        deleteQueries = reinterpret_cast<PFNGLDELETEQUERIESEXTPROC>(
+                eglGetProcAddress("glDeleteQueriesEXT"));
+        beginQuery = reinterpret_cast<PFNGLBEGINQUERYEXTPROC>(
+                eglGetProcAddress("glBeginQueryEXT"));
+        endQuery = reinterpret_cast<PFNGLENDQUERYEXTPROC>(
+                eglGetProcAddress("glEndQueryEXT"));
+        getQueryObjectuiv = reinterpret_cast<PFNGLGETQUERYOBJECTUIVEXTPROC>(
+                eglGetProcAddress("glGetQueryObjectuivEXT"));
+        getQueryObjectui64v = reinterpret_cast<PFNGLGETQUERYOBJECTUI64VEXTPROC>(
+                eglGetProcAddress("glGetQueryObjectui64vEXT"));
+        if (!genQueries || !deleteQueries || !beginQuery || !endQuery || !getQueryObjectuiv ||
+            !getQueryObjectui64v) {
+            return;
+        }
+
+        GLuint ids[MAX_PENDING_QUERIES];
+        CHECK_GL(genQueries(MAX_PENDING_QUERIES, ids));
+        for (size_t i = 0; i < MAX_PENDING_QUERIES; ++i) queries[i].id = ids[i];
+        supported = true;
+    }
+
+    void GpuTimer::Release() {
+        if (!supported) return;
+
+        if (active) End();
+        GLuint ids[MAX_PENDING_QUERIES];
+        for (size_t i = 0; i < MAX_PENDING_QUERIES; ++i) ids[i] = queries[i].id;
+        CHECK_GL(deleteQueries(MAX_PENDING_QUERIES, ids));
+        supported = false;
+        oldestPending = 0;
+        pendingCount = 0;
+    }
+
+    bool GpuTimer::Begin(GLint tag) {
+        if (!supported || active || pendingCount == MAX_PENDING_QUERIES) return false;
+
+        auto &query = queries[(oldestPending + pendingCount) % MAX_PENDING_QUERIES];
+        query.tag = tag;
+        CHECK_GL(beginQuery(GL_TIME_ELAPSED_EXT, query.id));
+        active = true;
+        return true;
+    }
+
+    void GpuTimer::End() {
+        if (!active) return;
+
+        CHECK_GL(endQuery(GL_TIME_ELAPSED_EXT));
+        active = false;
+        ++pendingCount;
+    }
+}  // namespace lookaround
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gpu_capabilities.h"
+
+namespace lookaround {
+    // Measures GPU time of tagged command ranges with GL_EXT_disjoint_timer_query.
+    // Results arrive a few frames late and are collected by polling, so timing never
+    // stalls the render loop. Every method is a no-op when the extension is missing.
+    class GpuTimer {
+    public:
+        static constexpr size_t MAX_PENDING_QUERIES = 16;
+
+        // Must be called with a current context.
+        void Init(const GpuCapabilities &capabilities);
+
+        void Release();
+
+        [[nodiscard]] bool IsSupported() const { return supported; }
+
+        // Returns false if timing could not be started (unsupported, already timing or
+        // too many queries in flight). End must only be called after a successful Begin.
+        bool Begin(GLint tag);
+
+        void End();
+
+        // Calls onResult(tag, elapsedNs) for each finished query in submission order.
+        template<typename OnResult>
+        void Collect(OnResult &&onResult) {
+            if (!supported || pendingCount == 0) return;
+
+            GLint disjoint = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+            while (pendingCount > 0) {
+                auto &query = queries[oldestPending];
+                GLuint available = GL_FALSE;
+                getQueryObjectuiv(query.id, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+                if (!available) break;
+
+                GLuint64 elapsedNs = 0;
+                getQueryObjectui64v(query.id, GL_QUERY_RESULT_EXT, &elapsedNs);
+                if (!disjoint) onResult(query.tag, static_cast<uint64_t>(elapsedNs));
+                oldestPending = (oldestPending + 1) % MAX_PENDING_QUERIES;
+                --pendingCount;
+            }
+        }
+
+    private:
+        struct Query {
+            GLuint id = 0;
+            GLint tag = -1;
+        };
+
+        bool supported = false;
+        bool active = false;
+        std::array<Query, MAX_PENDING_QUERIES> queries{};
+        size_t oldestPending = 0;
+        size_t pendingCount = 0;
+
+        PFNGLGENQUERIESEXTPROC genQueries = nullptr;
+        PFNGLDELETEQUERIESEXTPROC deleteQueries = nullptr;
+        PFNGLBEGINQUERYEXTPROC beginQuery = nullptr;
+        PFNGLENDQUERYEXTPROC endQuery = nullptr;
+        PFNGLGETQUERYOBJECTUIVEXTPROC getQueryObjectuiv = nullptr;
+        PFNGLGETQUERYOBJECTUI64VEXTPROC getQueryObjectui64v = nullptr;
+    };
+}  // namespace lookaround
@@ -0,0 +1,100 @@
+#include "hardware_buffer_texture.h"
+
+#include <android/log.h>
+#include <GLES2/gl2ext.h>
+
+#include <cstring>
+
+#include "gl_check.h"
+#include "gl_extensions.h"
+
+namespace lookaround {
+    bool HardwareBufferTexture::Allocate(EGLDisplay display, GLsizei newWidth, GLsizei newHeight) {
+        auto getNativeClientBuffer = reinterpret_cast<PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC>(
+                eglGetProcAddress("eglGetNativeClientBufferANDROID"));
+        auto createImage = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(
+                eglGetProcAddress("eglCreateImageKHR"));
+        auto imageTargetTexture = reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(
+                eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+        if (!getNativeClientBuffer || !createImage || !imageTargetTexture ||
+            !HasGlExtension("GL_OES_EGL_image_external")) {
+            return false;
+        }
+
+        AHardwareBuffer_Desc desc{};
+        desc.width = static_cast<uint32_t>(newWidth);
+        desc.height = static_cast<uint32_t>(newHeight);
+        desc.layers = 1;
+        desc.format = AHARDWAREBUFFER_FORMAT_R8G8B8A8_UNORM;
+        desc.usage = AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN |
+                     AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+        if (AHardwareBuffer_allocate(&desc, &buffer) != 0) {
+            buffer = nullptr;
+            return false;
+        }
+
+        EGLint imageAttribs[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+        image = createImage(display, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID,
+                            getNativeClientBuffer(buffer), imageAttribs);
+        if (image == EGL_NO_IMAGE_KHR) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to create hardware buffer image with EGL error: %s",
+                                EGLErrorString(eglGetError()).c_str());
+            return false;
+        }
+
+        if (!textureId) CHECK_GL(glGenTextures(1, &textureId));
+        CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, textureId));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        CHECK_GL(imageTargetTexture(GL_TEXTURE_EXTERNAL_OES, image));
+        CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, 0));
+        width = newWidth;
+        height = newHeight;
+        return true;
+    }
+
+    bool HardwareBufferTexture::Upload(EGLDisplay display, const uint8_t *pixels,
+                                       GLsizei newWidth, GLsizei newHeight) {
+        if (!buffer || newWidth != width || newHeight != height) {
+            Release(display);
+            if (!Allocate(display, newWidth, newHeight)) {
+                Release(display);
+                return false;
+            }
+        }
+
+        // Rows of the buffer may be padded.
+        AHardwareBuffer_Desc desc{};
+        AHardwareBuffer_describe(buffer, &desc);
+        void *address = nullptr;
+        if (AHardwareBuffer_lock(buffer, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, /*fence=*/-1,
+                                 /*rect=*/nullptr, &address) != 0) {
+            return false;
+        }
+        const size_t rowBytes = static_cast<size_t>(width) * 4;
+        for (GLsizei y = 0; y < height; ++y) {
+            memcpy(static_cast<uint8_t *>(address) + static_cast<size_t>(y) * desc.stride * 4,
+                   pixels + y * rowBytes, rowBytes);
+        }
+        // Waits for the write to land, the image is sampled right after.
+        AHardwareBuffer_unlock(buffer, /*fence=*/nullptr);
+        return true;
+    }
+
+    void HardwareBufferTexture::Release(EGLDisplay display) {
+        if (textureId) CHECK_GL(glDeleteTextures(1, &textureId));
+        textureId = 0;
+        if (image != EGL_NO_IMAGE_KHR) {
+            auto destroyImage = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(
+                    eglGetProcAddress("eglDestroyImageKHR"));
+            if (destroyImage) destroyImage(display, image);
+            image = EGL_NO_IMAGE_KHR;
+        }
+        if (buffer) AHardwareBuffer_release(buffer);
+        buffer = nullptr;
+        width = height = 0;
+    }
+}  // namespace lookaround
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <android/hardware_buffer.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+#include <cstdint>
+
+namespace lookaround {
+    // A GL_TEXTURE_EXTERNAL_OES texture with pixels written by the CPU into an AHardwareBuffer
+    // bound as its EGLImage - external textures take no glTexImage2D. Stands in for the camera
+    // texture while a replay draws the camera frame stored in its trace.
+    class HardwareBufferTexture {
+    public:
+        // Must be called with a current context. Reallocates the buffer when the size changes.
+        // Returns false if the driver cannot bind hardware buffers to textures.
+        bool Upload(EGLDisplay display, const uint8_t *pixels, GLsizei width, GLsizei height);
+
+        // Must be called with a current context.
+        void Release(EGLDisplay display);
+
+        [[nodiscard]] GLuint TextureId() const { return textureId; }
+
+    private:
+        bool Allocate(EGLDisplay display, GLsizei width, GLsizei height);
+
+        AHardwareBuffer *buffer = nullptr;
+        EGLImageKHR image = EGL_NO_IMAGE_KHR;
+        GLuint textureId = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+    };
+}  // namespace lookaround
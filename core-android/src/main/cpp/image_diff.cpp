@@ -0,0 +1,181 @@
+#include "image_diff.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace lookaround {
+    namespace {
+        constexpr int SSIM_WINDOW = 8;
+        constexpr int SSIM_STEP = 4;
+        // Stabilizing constants of the SSIM paper for 8 bit values.
+        constexpr double SSIM_C1 = (.01 * 255.) * (.01 * 255.);
+        constexpr double SSIM_C2 = (.03 * 255.) * (.03 * 255.);
+        constexpr double PI = 3.14159265358979323846;
+
+        double Radians(double degrees) { return degrees * PI / 180.; }
+
+        // sRGB to linear light, by channel value.
+        const std::array<double, 256> &LinearTable() {
+            static const std::array<double, 256> table = [] {
+                std::array<double, 256> values{};
+                for (int i = 0; i < 256; ++i) {
+                    const double c = i / 255.;
+                    values[i] = c <= .04045 ? c / 12.92 : std::pow((c + .055) / 1.055, 2.4);
+                }
+                return values;
+            }();
+            return table;
+        }
+
+        double LabF(double t) {
+            constexpr double epsilon = 216. / 24389.;
+            constexpr double kappa = 24389. / 27.;
+            return t > epsilon ? std::cbrt(t) : (kappa * t + 16.) / 116.;
+        }
+
+        std::vector<double> Luma(const uint8_t *rgba, int width, int height) {
+            std::vector<double> luma(static_cast<size_t>(width) * height);
+            for (size_t i = 0; i < luma.size(); ++i) {
+                const uint8_t *pixel = rgba + i * 4;
+                luma[i] = .299 * pixel[0] + .587 * pixel[1] + .114 * pixel[2];
+            }
+            return luma;
+        }
+    }  // namespace
+
+    Lab SrgbToLab(const uint8_t *rgb) {
+        const auto &linear = LinearTable();
+        const double r = linear[rgb[0]];
+        const double g = linear[rgb[1]];
+        const double b = linear[rgb[2]];
+        const double x = (.4124564 * r + .3575761 * g + .1804375 * b) / .95047;
+        const double y = .2126729 * r + .7151522 * g + .0721750 * b;
+        const double z = (.0193339 * r + .1191920 * g + .9503041 * b) / 1.08883;
+        const double fx = LabF(x);
+        const double fy = LabF(y);
+        const double fz = LabF(z);
+        return {116. * fy - 16., 500. * (fx - fy), 200. * (fy - fz)};
+    }
+
+    double DeltaE2000(const Lab &first, const Lab &second) {
+        const double c1 = std::hypot(first.a, first.b);
+        const double c2 = std::hypot(second.a, second.b);
+        const double meanC7 = std::pow((c1 + c2) / 2., 7.);
+        const double g = .5 * (1. - std::sqrt(meanC7 / (meanC7 + std::pow(25., 7.))));
+        const double a1 = (1. + g) * first.a;
+        const double a2 = (1. + g) * second.a;
+        const double c1p = std::hypot(a1, first.b);
+        const double c2p = std::hypot(a2, second.b);
+        const auto hue = [](double b, double a) {
+            if (a == 0. && b == 0.) return 0.;
+            const double h = std::atan2(b, a) * 180. / PI;
+            return h < 0. ? h + 360. : h;
+        };
+        const double h1 = hue(first.b, a1);
+        const double h2 = hue(second.b, a2);
+
+        const double deltaL = second.l - first.l;
+        const double deltaC = c2p - c1p;
+        double deltaH = 0.;
+        if (c1p * c2p != 0.) {
+            deltaH = h2 - h1;
+            if (deltaH > 180.) deltaH -= 360.;
+            if (deltaH < -180.) deltaH += 360.;
+        }
+        const double deltaBigH = 2. * std::sqrt(c1p * c2p) * std::sin(Radians(deltaH / 2.));
+
+        const double meanL = (first.l + second.l) / 2.;
+        const double meanCp = (c1p + c2p) / 2.;
+        double meanH = h1 + h2;
+        if (c1p * c2p != 0.) {
+            if (std::abs(h1 - h2) <= 180.) {
+                meanH /= 2.;
+            } else {
+                meanH = h1 + h2 < 360. ? (meanH + 360.) / 2. : (meanH - 360.) / 2.;
+            }
+        }
+        const double t = 1. - .17 * std::cos(Radians(meanH - 30.)) +
+                         .24 * std::cos(Radians(2. * meanH)) +
+                         .32 * std::cos(Radians(3. * meanH + 6.)) -
+                         .20 * std::cos(Radians(4. * meanH - 63.));
+        const double deltaTheta = 30. * std::exp(-std::pow((meanH - 275.) / 25., 2.));
+        const double meanCp7 = std::pow(meanCp, 7.);
+        const double rc = 2. * std::sqrt(meanCp7 / (meanCp7 + std::pow(25., 7.)));
+        const double meanL50 = (meanL - 50.) * (meanL - 50.);
+        const double sl = 1. + .015 * meanL50 / std::sqrt(20. + meanL50);
+        const double sc = 1. + .045 * meanCp;
+        const double sh = 1. + .015 * meanCp * t;
+        const double rt = -std::sin(Radians(2. * deltaTheta)) * rc;
+
+        const double l = deltaL / sl;
+        const double c = deltaC / sc;
+        const double h = deltaBigH / sh;
+        return std::sqrt(l * l + c * c + h * h + rt * c * h);
+    }
+
+    ImageDiff DiffImages(const uint8_t *first, const uint8_t *second, int width, int height) {
+        ImageDiff diff;
+
+        const auto firstLuma = Luma(first, width, height);
+        const auto secondLuma = Luma(second, width, height);
+        double ssimSum = 0.;
+        int windows = 0;
+        constexpr double samples = SSIM_WINDOW * SSIM_WINDOW;
+        for (int top = 0; top + SSIM_WINDOW <= height; top += SSIM_STEP) {
+            for (int left = 0; left + SSIM_WINDOW <= width; left += SSIM_STEP) {
+                double sumX = 0., sumY = 0., sumXX = 0., sumYY = 0., sumXY = 0.;
+                for (int y = top; y < top + SSIM_WINDOW; ++y) {
+                    for (int x = left; x < left + SSIM_WINDOW; ++x) {
+                        const double a = firstLuma[static_cast<size_t>(y) * width + x];
+                        const double b = secondLuma[static_cast<size_t>(y) * width + x];
+                        sumX += a;
+                        sumY += b;
+                        sumXX += a * a;
+                        sumYY += b * b;
+                        sumXY += a * b;
+                    }
+                }
+                const double meanX = sumX / samples;
+                const double meanY = sumY / samples;
+                const double varianceX = sumXX / samples - meanX * meanX;
+                const double varianceY = sumYY / samples - meanY * meanY;
+                const double covariance = sumXY / samples - meanX * meanY;
+                const double ssim = ((2. * meanX * meanY + SSIM_C1) *
+                                     (2. * covariance + SSIM_C2)) /
+                                    ((meanX * meanX + meanY * meanY + SSIM_C1) *
+                                     (varianceX + varianceY + SSIM_C2));
+                ssimSum += ssim;
+                diff.minSsim = std::min(diff.minSsim, ssim);
+                ++windows;
+            }
+        }
+        if (windows) diff.meanSsim = ssimSum / windows;
+
+        // Most pixels of two variants are equal, those are skipped.
+        const size_t pixels = static_cast<size_t>(width) * height;
+        std::vector<float> deltaEs;
+        double deltaESum = 0.;
+        for (size_t i = 0; i < pixels; ++i) {
+            const uint8_t *a = first + i * 4;
+            const uint8_t *b = second + i * 4;
+            if (a[0] == b[0] && a[1] == b[1] && a[2] == b[2]) continue;
+            const double deltaE = DeltaE2000(SrgbToLab(a), SrgbToLab(b));
+            deltaEs.push_back(static_cast<float>(deltaE));
+            deltaESum += deltaE;
+            diff.maxDeltaE = std::max(diff.maxDeltaE, deltaE);
+        }
+        if (!pixels) return diff;
+        diff.meanDeltaE = deltaESum / static_cast<double>(pixels);
+        // Nearest rank, ceil(.99 * pixels) - 1. The equal pixels are the lowest differences.
+        const size_t p99Rank = (pixels * 99 + 99) / 100 - 1;
+        const size_t equalPixels = pixels - deltaEs.size();
+        if (p99Rank >= equalPixels) {
+            auto p99 = deltaEs.begin() + static_cast<std::ptrdiff_t>(p99Rank - equalPixels);
+            std::nth_element(deltaEs.begin(), p99, deltaEs.end());
+            diff.p99DeltaE = *p99;
+        }
+        return diff;
+    }
+}  // namespace lookaround
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+namespace lookaround {
+    // Perceptual difference between two renderings of a frame, to tell whether a change of the
+    // pipeline is visible. No GL or Android dependencies, used by the host tools.
+    struct ImageDiff {
+        // Mean and minimum over 8x8 windows stepped by 4 of the SSIM of the luma, 1 for
+        // identical images. The minimum catches differences confined to a small area.
+        double meanSsim = 1.;
+        double minSsim = 1.;
+        // CIEDE2000 color differences of the pixels. About 1 is the smallest visible side by
+        // side, 2.3 a just noticeable difference.
+        double meanDeltaE = 0.;
+        double p99DeltaE = 0.;
+        double maxDeltaE = 0.;
+    };
+
+    // Compares two images of height rows of width RGBA pixels, top-down, ignoring alpha.
+    ImageDiff DiffImages(const uint8_t *first, const uint8_t *second, int width, int height);
+
+    struct Lab {
+        double l, a, b;
+    };
+
+    // 8 bit sRGB to CIELAB under D65.
+    Lab SrgbToLab(const uint8_t *rgb);
+
+    // From "The CIEDE2000 Color-Difference Formula: Implementation Notes, Supplementary Test
+    // Data, and Mathematical Observations" by G. Sharma, W. Wu and E. N. Dalal.
+    double DeltaE2000(const Lab &first, const Lab &second);
+}  // namespace lookaround
@@ -0,0 +1,147 @@
+#include "marker_clusterer.h"
+
+#include <cmath>
+
+namespace lookaround {
+    void MarkerClusterer::SetCardSize(GLfloat width, GLfloat height, GLfloat cornerRadius) {
+        if (width == cardWidth && height == cardHeight) {
+            cardCornerRadius = cornerRadius;
+            return;
+        }
+        cardWidth = width;
+        cardHeight = height;
+        cardCornerRadius = cornerRadius;
+        // Cells of the old size mean nothing in the new grid.
+        lastCells.clear();
+        lastRootCells.clear();
+    }
+
+    uint64_t MarkerClusterer::CellKey(const Cell &cell) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32) |
+               static_cast<uint32_t>(cell.y);
+    }
+
+    MarkerClusterer::Cell MarkerClusterer::CellOf(int64_t id, GLfloat x, GLfloat y) const {
+        const auto last = lastCells.find(id);
+        if (last != lastCells.end()) {
+            const Cell &cell = last->second;
+            const GLfloat left = (static_cast<GLfloat>(cell.x) - HYSTERESIS) * cardWidth;
+            const GLfloat top = (static_cast<GLfloat>(cell.y) - HYSTERESIS) * cardHeight;
+            const GLfloat right = (static_cast<GLfloat>(cell.x) + 1.f + HYSTERESIS) * cardWidth;
+            const GLfloat bottom = (static_cast<GLfloat>(cell.y) + 1.f + HYSTERESIS) * cardHeight;
+            if (x >= left && x < right && y >= top && y < bottom) return cell;
+        }
+        return {static_cast<int32_t>(std::floor(x / cardWidth)),
+                static_cast<int32_t>(std::floor(y / cardHeight))};
+    }
+
+    uint32_t MarkerClusterer::RootOf(uint32_t accumulator) {
+        while (accumulators[accumulator].mergedInto != accumulator) {
+            auto &parent = accumulators[accumulator].mergedInto;
+            parent = accumulators[parent].mergedInto;
+            accumulator = parent;
+        }
+        return accumulator;
+    }
+
+    bool MarkerClusterer::CardsIntersect(const Accumulator &a, const Accumulator &b) const {
+        // Cards merged during the last call are kept together across a gap of HYSTERESIS.
+        GLfloat scale = 1.f;
+        const auto lastA = lastRootCells.find(a.cellKey);
+        const auto lastB = lastRootCells.find(b.cellKey);
+        if (lastA != lastRootCells.end() && lastB != lastRootCells.end() &&
+            lastA->second == lastB->second) {
+            scale += HYSTERESIS;
+        }
+        const GLfloat dx = a.sumX / static_cast<GLfloat>(a.count) -
+                           b.sumX / static_cast<GLfloat>(b.count);
+        const GLfloat dy = a.sumY / static_cast<GLfloat>(a.count) -
+                           b.sumY / static_cast<GLfloat>(b.count);
+        return std::fabs(dx) < cardWidth * scale && std::fabs(dy) < cardHeight * scale;
+    }
+
+    void MarkerClusterer::MergeIntersectingCards() {
+        // A merged card moves to the mean of both, so pairs are checked again until none merge.
+        // Only cells with drawn markers have accumulators, which keeps them about one per cell
+        // of the view.
+        const auto size = static_cast<uint32_t>(accumulators.size());
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (uint32_t i = 0; i < size; ++i) {
+                auto &into = accumulators[i];
+                if (into.mergedInto != i) continue;
+                for (uint32_t j = i + 1; j < size; ++j) {
+                    auto &from = accumulators[j];
+                    if (from.mergedInto != j || !CardsIntersect(into, from)) continue;
+                    into.sumX += from.sumX;
+                    into.sumY += from.sumY;
+                    into.count += from.count;
+                    from.mergedInto = i;
+                    merged = true;
+                }
+            }
+        }
+    }
+
+    size_t MarkerClusterer::Cluster(const int64_t *ids, const GLfloat *x, const GLfloat *y,
+                                    size_t count, GLfloat viewWidth, GLfloat viewHeight) {
+        rects.clear();
+        memberCounts.clear();
+        markerClusters.assign(count, NO_CLUSTER);
+        if (cardWidth <= 0.f || cardHeight <= 0.f) return 0;
+
+        // Accumulators are numbered in the order of the first marker of their cell.
+        cells.clear();
+        accumulatorOfCell.clear();
+        accumulators.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (std::isnan(x[i]) || std::isnan(y[i])) continue;
+            const Cell cell = CellOf(ids[i], x[i], y[i]);
+            cells[ids[i]] = cell;
+            const auto inserted = accumulatorOfCell.emplace(
+                    CellKey(cell), static_cast<uint32_t>(accumulators.size()));
+            if (inserted.second) {
+                accumulators.push_back(
+                        {0.f, 0.f, 0, CellKey(cell), static_cast<uint32_t>(accumulators.size())});
+            }
+            auto &accumulator = accumulators[inserted.first->second];
+            accumulator.sumX += x[i];
+            accumulator.sumY += y[i];
+            ++accumulator.count;
+            markerClusters[i] = static_cast<int32_t>(inserted.first->second);
+        }
+        lastCells.swap(cells);
+
+        MergeIntersectingCards();
+        rootCells.clear();
+        for (uint32_t i = 0; i < accumulators.size(); ++i) {
+            rootCells[accumulators[i].cellKey] = accumulators[RootOf(i)].cellKey;
+        }
+        lastRootCells.swap(rootCells);
+
+        // Off screen cards are dropped, the others renumbered in the same order.
+        clusterOfAccumulator.assign(accumulators.size(), NO_CLUSTER);
+        for (size_t i = 0; i < accumulators.size(); ++i) {
+            const auto &accumulator = accumulators[i];
+            if (accumulator.mergedInto != i) continue;
+            const auto members = static_cast<GLfloat>(accumulator.count);
+            const GLfloat left = accumulator.sumX / members - cardWidth / 2.f;
+            const GLfloat top = accumulator.sumY / members - cardHeight / 2.f;
+            if (left >= viewWidth || top >= viewHeight || left + cardWidth <= 0.f ||
+                top + cardHeight <= 0.f) {
+                continue;
+            }
+            clusterOfAccumulator[i] = static_cast<int32_t>(memberCounts.size());
+            memberCounts.push_back(accumulator.count);
+            rects.insert(rects.end(),
+                         {left, top + cardHeight, cardWidth, cardHeight, cardCornerRadius});
+        }
+        for (auto &cluster: markerClusters) {
+            if (cluster != NO_CLUSTER) {
+                cluster = clusterOfAccumulator[RootOf(static_cast<uint32_t>(cluster))];
+            }
+        }
+        return memberCounts.size();
+    }
+}  // namespace lookaround
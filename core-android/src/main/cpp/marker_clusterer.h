@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lookaround {
+    // Merges markers close on screen into cluster cards, so the rects passed to renderTexture
+    // stay about one per card sized cell of the view however dense the POIs are. Markers are
+    // binned into a uniform grid of card sized cells; a marker keeps the cell it was in during
+    // the last call until it moves HYSTERESIS of a cell past its edges, so markers jittering
+    // over a cell edge do not make clusters split and merge from frame to frame. Clusters whose
+    // cards still intersect once centered on their markers are merged, and stay merged until
+    // their cards are HYSTERESIS of a card apart.
+    class MarkerClusterer {
+    public:
+        // Floats per card rect, in the layout of renderTexture: left, bottom (window pixels,
+        // top-left origin), width, height, corner radius.
+        static constexpr size_t RECT_COMPONENTS = 5;
+        static constexpr GLfloat HYSTERESIS = .25f;
+        static constexpr int32_t NO_CLUSTER = -1;
+
+        void SetCardSize(GLfloat width, GLfloat height, GLfloat cornerRadius);
+
+        // Clusters markers centered at x and y, identified across calls by ids. Markers at NaN
+        // are not drawn, neither are clusters whose card is outside of the view. A cluster of
+        // one marker is its card centered on it, the cards of others are centered on the mean
+        // of their markers. Clusters are in the order of their first marker. Returns their
+        // number.
+        size_t Cluster(const int64_t *ids, const GLfloat *x, const GLfloat *y, size_t count,
+                       GLfloat viewWidth, GLfloat viewHeight);
+
+        // RECT_COMPONENTS floats per cluster.
+        [[nodiscard]] const std::vector<GLfloat> &Rects() const { return rects; }
+
+        [[nodiscard]] const std::vector<int32_t> &MemberCounts() const { return memberCounts; }
+
+        // Cluster of each marker, NO_CLUSTER if it is not drawn.
+        [[nodiscard]] const std::vector<int32_t> &MarkerClusters() const {
+            return markerClusters;
+        }
+
+    private:
+        struct Cell {
+            int32_t x, y;
+        };
+
+        struct Accumulator {
+            GLfloat sumX, sumY;
+            int32_t count;
+            uint64_t cellKey;
+            // Accumulator this one was merged into, its own index if it was not.
+            uint32_t mergedInto;
+        };
+
+        [[nodiscard]] Cell CellOf(int64_t id, GLfloat x, GLfloat y) const;
+
+        static uint64_t CellKey(const Cell &cell);
+
+        uint32_t RootOf(uint32_t accumulator);
+
+        [[nodiscard]] bool CardsIntersect(const Accumulator &a, const Accumulator &b) const;
+
+        // Merges accumulators into the first of those their cards intersect, until none do.
+        void MergeIntersectingCards();
+
+        GLfloat cardWidth = 0.f;
+        GLfloat cardHeight = 0.f;
+        GLfloat cardCornerRadius = 0.f;
+
+        // Of the last and this call, swapped after each so their buckets are reused.
+        std::unordered_map<int64_t, Cell> lastCells;
+        std::unordered_map<int64_t, Cell> cells;
+        // Cell of the root accumulator of each cell, of the last and this call.
+        std::unordered_map<uint64_t, uint64_t> lastRootCells;
+        std::unordered_map<uint64_t, uint64_t> rootCells;
+        std::unordered_map<uint64_t, uint32_t> accumulatorOfCell;
+        std::vector<Accumulator> accumulators;
+        std::vector<int32_t> clusterOfAccumulator;
+
+        std::vector<GLfloat> rects;
+        std::vector<int32_t> memberCounts;
+        std::vector<int32_t> markerClusters;
+    };
+}  // namespace lookaround
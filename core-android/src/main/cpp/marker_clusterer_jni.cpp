@@ -0,0 +1,55 @@
+#include <jni.h>
+
+#include "marker_clusterer.h"
+
+using namespace lookaround;
+
+extern "C" {
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerClusterer_create(JNIEnv *env, jclass clazz) {
+    return reinterpret_cast<jlong>(new MarkerClusterer());
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerClusterer_destroy(
+        JNIEnv *env, jclass clazz, jlong clusterer) {
+    delete reinterpret_cast<MarkerClusterer *>(clusterer);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerClusterer_setCardSize(
+        JNIEnv *env, jclass clazz, jlong clusterer, jfloat width, jfloat height,
+        jfloat cornerRadius) {
+    reinterpret_cast<MarkerClusterer *>(clusterer)->SetCardSize(width, height, cornerRadius);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerClusterer_cluster(
+        JNIEnv *env, jclass clazz, jlong clusterer, jlongArray jids, jfloatArray jx,
+        jfloatArray jy, jint count, jfloat viewWidth, jfloat viewHeight,
+        jfloatArray jrectsCoordinates, jintArray jmemberCounts, jintArray jmarkerClusters) {
+    auto *markerClusterer = reinterpret_cast<MarkerClusterer *>(clusterer);
+    static_assert(sizeof(jlong) == sizeof(int64_t));
+    jlong *ids = env->GetLongArrayElements(jids, nullptr);
+    jfloat *x = env->GetFloatArrayElements(jx, nullptr);
+    jfloat *y = env->GetFloatArrayElements(jy, nullptr);
+    const size_t clusters = markerClusterer->Cluster(reinterpret_cast<const int64_t *>(ids), x, y,
+                                                     static_cast<size_t>(count), viewWidth,
+                                                     viewHeight);
+    env->ReleaseFloatArrayElements(jy, y, JNI_ABORT);
+    env->ReleaseFloatArrayElements(jx, x, JNI_ABORT);
+    env->ReleaseLongArrayElements(jids, ids, JNI_ABORT);
+
+    // Clusters are never more than markers, for which the arrays are sized.
+    const auto &rects = markerClusterer->Rects();
+    env->SetFloatArrayRegion(jrectsCoordinates, 0, static_cast<jsize>(rects.size()),
+                             rects.data());
+    static_assert(sizeof(jint) == sizeof(int32_t));
+    env->SetIntArrayRegion(jmemberCounts, 0, static_cast<jsize>(clusters),
+                           reinterpret_cast<const jint *>(markerClusterer->MemberCounts().data()));
+    env->SetIntArrayRegion(jmarkerClusters, 0, count,
+                           reinterpret_cast<const jint *>(
+                                   markerClusterer->MarkerClusters().data()));
+    return static_cast<jint>(clusters);
+}
+}
@@ -1,6 +1,8 @@
+#include <android/bitmap.h>
 #include <android/log.h>
 #include <android/native_window.h>
 #include <android/native_window_jni.h>
+#include <android/surface_texture_jni.h>
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
 #include <EGL/eglplatform.h>
@@ -8,119 +10,45 @@
 #include <GLES2/gl2ext.h>
 #include <jni.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
-#include <iomanip>
-#include <sstream>
+#include <cmath>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
-namespace {
-    auto constexpr LOG_TAG = "OpenGLRendererJni";
-
-    std::string GLErrorString(GLenum error) {
-        switch (error) {
-            case GL_NO_ERROR:
-                return "GL_NO_ERROR";
-            case GL_INVALID_ENUM:
-                return "GL_INVALID_ENUM";
-            case GL_INVALID_VALUE:
-                return "GL_INVALID_VALUE";
-            case GL_INVALID_OPERATION:
-                return "GL_INVALID_OPERATION";
-            case GL_STACK_OVERFLOW_KHR:
-                return "GL_STACK_OVERFLOW";
-            case GL_STACK_UNDERFLOW_KHR:
-                return "GL_STACK_UNDERFLOW";
-            case GL_OUT_OF_MEMORY:
-                return "GL_OUT_OF_MEMORY";
-            case GL_INVALID_FRAMEBUFFER_OPERATION:
-                return "GL_INVALID_FRAMEBUFFER_OPERATION";
-            default: {
-                std::ostringstream oss;
-                oss << "<Unknown GL Error 0x" << std::setfill('0') <<
-                    std::setw(4) << std::right << std::hex << error << ">";
-                return oss.str();
-            }
-        }
-    }
-
-    std::string EGLErrorString(EGLenum error) {
-        switch (error) {
-            case EGL_SUCCESS:
-                return "EGL_SUCCESS";
-            case EGL_NOT_INITIALIZED:
-                return "EGL_NOT_INITIALIZED";
-            case EGL_BAD_ACCESS:
-                return "EGL_BAD_ACCESS";
-            case EGL_BAD_ALLOC:
-                return "EGL_BAD_ALLOC";
-            case EGL_BAD_ATTRIBUTE:
-                return "EGL_BAD_ATTRIBUTE";
-            case EGL_BAD_CONTEXT:
-                return "EGL_BAD_CONTEXT";
-            case EGL_BAD_CONFIG:
-                return "EGL_BAD_CONFIG";
-            case EGL_BAD_CURRENT_SURFACE:
-                return "EGL_BAD_CURRENT_SURFACE";
-            case EGL_BAD_DISPLAY:
-                return "EGL_BAD_DISPLAY";
-            case EGL_BAD_SURFACE:
-                return "EGL_BAD_SURFACE";
-            case EGL_BAD_MATCH:
-                return "EGL_BAD_MATCH";
-            case EGL_BAD_PARAMETER:
-                return "EGL_BAD_PARAMETER";
-            case EGL_BAD_NATIVE_PIXMAP:
-                return "EGL_BAD_NATIVE_PIXMAP";
-            case EGL_BAD_NATIVE_WINDOW:
-                return "EGL_BAD_NATIVE_WINDOW";
-            case EGL_CONTEXT_LOST:
-                return "EGL_CONTEXT_LOST";
-            default: {
-                std::ostringstream oss;
-                oss << "<Unknown EGL Error 0x" << std::setfill('0') <<
-                    std::setw(4) << std::right << std::hex << error << ">";
-                return oss.str();
-            }
-        }
-    }
-}
-
-#ifdef NDEBUG
-#define CHECK_GL(gl_func) [&]() { return gl_func; }()
-#else
-namespace {
-    class CheckGlErrorOnExit {
-    public:
-        explicit CheckGlErrorOnExit(std::string glFunStr, unsigned int lineNum) :
-                mGlFunStr(std::move(glFunStr)),
-                mLineNum(lineNum) {}
-
-        ~CheckGlErrorOnExit() {
-            GLenum err = glGetError();
-            if (err != GL_NO_ERROR) {
-                __android_log_assert(nullptr, LOG_TAG, "OpenGL Error: %s at %s [%s:%d]",
-                                     GLErrorString(err).c_str(), mGlFunStr.c_str(), __FILE__,
-                                     mLineNum);
-            }
-        }
-
-        CheckGlErrorOnExit(const CheckGlErrorOnExit &) = delete;
-
-        CheckGlErrorOnExit &operator=(const CheckGlErrorOnExit &) = delete;
-
-    private:
-        std::string mGlFunStr;
-        unsigned int mLineNum;
-    };  // class CheckGlErrorOnExit
-}   // namespace
-#define CHECK_GL(glFunc)                                                    \
-  [&]() {                                                                   \
-    auto assertOnExit = CheckGlErrorOnExit(#glFunc, __LINE__);              \
-    return glFunc;                                                          \
-  }()
-#endif
+#include "animation.h"
+#include "blur_pass_planner.h"
+#include "color_extractor.h"
+#include "frame_readback.h"
+#include "frame_scheduler.h"
+#include "frame_trace.h"
+#include "gl_check.h"
+#include "gl_extensions.h"
+#include "gl_program.h"
+#include "gpu_capabilities.h"
+#include "gpu_timer.h"
+#include "hardware_buffer_texture.h"
+#include "rect_coalescer.h"
+#include "rect_grid_index.h"
+#include "rect_stencil.h"
+#include "render_command.h"
+#include "render_graph.h"
+#include "render_loop.h"
+#include "sat_blur.h"
+#include "sdf_glyph_atlas.h"
+#include "shader_variants.h"
+#include "shared_gl_resources.h"
+#include "sprite_batcher.h"
+#include "surface_texture_frame_source.h"
+#include "surface_fanout.h"
+#include "surface_transform.h"
+#include "swap_damage.h"
+#include "text_batcher.h"
+
+using namespace lookaround;
 
 namespace {
     constexpr char VERTEX_SHADER_SRC_NO_BLUR[] = R"SRC(#version 310 es
@@ -166,6 +94,32 @@ void main() {
 }
 )SRC";
 
+    // Preprocessor defines specializing the shaders below, see ShaderVariants. Blur passes
+    // without BLUR copy their input.
+    constexpr uint32_t FEATURE_ROUNDED_CORNERS = 1u << 0;
+    constexpr uint32_t FEATURE_BLUR = 1u << 1;
+    constexpr uint32_t FEATURE_CONTRASTING_COLOR = 1u << 2;
+    const std::vector<const char *> SHADER_FEATURE_DEFINES = {
+            "ROUNDED_CORNERS", "BLUR", "CONTRASTING_COLOR"};
+
+    // Uniforms known to the variants, indices into ShaderVariants::Program::uniformHandles.
+    enum Uniform : size_t {
+        UNIFORM_SAMPLER,
+        UNIFORM_VERT_TRANSFORM,
+        UNIFORM_TEX_TRANSFORM,
+        UNIFORM_WIDTH,
+        UNIFORM_HEIGHT,
+        UNIFORM_X,
+        UNIFORM_Y,
+        UNIFORM_CORNER_RADIUS,
+        UNIFORM_LOD,
+        UNIFORM_CONTRASTING_COLOR,
+        UNIFORM_CONTRASTING_COLOR_MIX,
+    };
+    const std::vector<const char *> UNIFORM_NAMES = {
+            "sampler", "vertTransform", "texTransform", "width", "height", "x", "y",
+            "cornerRadius", "lod", "contrastingColor", "contrastingColorMix"};
+
     constexpr char FRAGMENT_SHADER_SRC_NO_BLUR[] = R"SRC(#version 310 es
 #extension GL_OES_EGL_image_external : require
 precision mediump float;
@@ -173,15 +127,17 @@ precision mediump int;
 
 uniform samplerExternalOES sampler;
 uniform mat4 texTransform;
+
+in vec2 texCoord;
+out vec4 fragColor;
+
+#ifdef ROUNDED_CORNERS
 uniform float width;
 uniform float height;
 uniform int x;
 uniform int y;
 uniform float cornerRadius;
 
-in vec2 texCoord;
-out vec4 fragColor;
-
 float udRoundBox(vec2 p, vec2 b, float r) {
     return length(max(abs(p) - b + r, 0.)) - r;
 }
@@ -191,21 +147,14 @@ float computeBox() {
     vec2 coord = vec2(gl_FragCoord.x - float(x), gl_FragCoord.y - float(y));
     return udRoundBox(2. * coord - res, res, cornerRadius);
 }
+#endif
 
 void main() {
     vec2 transTexCoord = (texTransform * vec4(texCoord, 0., 1.)).xy;
-    vec4 texColor = texture(sampler, transTexCoord);
-    if (cornerRadius > 0.) {
-        float box = computeBox();
-        vec3 color = mix(texColor.rgb, vec3(0.), smoothstep(0., 1., box));
-        if (box > 1.) {
-            discard;
-        } else {
-            fragColor = texColor;
-        }
-    } else {
-        fragColor = texColor;
-    }
+#ifdef ROUNDED_CORNERS
+    if (computeBox() > 1.) discard;
+#endif
+    fragColor = texture(sampler, transTexCoord);
 }
 )SRC";
 
@@ -216,15 +165,14 @@ precision mediump int;
 
 uniform samplerExternalOES sampler;
 uniform mat4 texTransform;
-uniform float height;
-uniform float lod;
-uniform float minLod;
-uniform vec3 contrastingColor;
-uniform float contrastingColorMix;
 
 in vec2 texCoord;
 out vec4 fragColor;
 
+#ifdef BLUR
+uniform float height;
+uniform float lod;
+
 const float sigma = 3.;
 const float r = sigma * 2.;
 const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
@@ -240,19 +188,15 @@ vec4 gaussBlur( samplerExternalOES tex, vec2 uv, vec2 d, float l )
     }
     return c / c.a;
 }
+#endif
 
 void main() {
     vec2 transTexCoord = (texTransform * vec4(texCoord, 0., 1.)).xy;
-    if (lod > minLod) {
-        vec4 blurred = gaussBlur(sampler, transTexCoord, vec2(0., exp2(lod) / height), lod);
-        if (contrastingColor != vec3(-1.)) {
-            fragColor = vec4(mix(vec3(blurred.rgb), contrastingColor, contrastingColorMix), blurred.a);
-        } else {
-            fragColor = blurred;
-        }
-    } else {
-        fragColor = texture(sampler, transTexCoord);
-    }
+#ifdef BLUR
+    fragColor = gaussBlur(sampler, transTexCoord, vec2(0., exp2(lod) / height), lod);
+#else
+    fragColor = texture(sampler, transTexCoord);
+#endif
 }
 )SRC";
 
@@ -261,15 +205,14 @@ precision mediump float;
 precision mediump int;
 
 uniform sampler2D sampler;
-uniform float height;
-uniform float lod;
-uniform float minLod;
-uniform vec3 contrastingColor;
-uniform float contrastingColorMix;
 
 in vec2 texCoord;
 out vec4 fragColor;
 
+#ifdef BLUR
+uniform float height;
+uniform float lod;
+
 const float sigma = 3.;
 const float r = sigma * 2.;
 const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
@@ -285,18 +228,14 @@ vec4 gaussBlur( sampler2D tex, vec2 uv, vec2 d, float l )
     }
     return c / c.a;
 }
+#endif
 
 void main() {
-    if (lod > minLod) {
-        vec4 blurred = gaussBlur(sampler, texCoord, vec2(0., exp2(lod) / height), lod);
-        if (contrastingColor != vec3(-1.)) {
-            fragColor = vec4(mix(vec3(blurred.rgb), contrastingColor, contrastingColorMix), blurred.a);
-        } else {
-            fragColor = blurred;
-        }
-    } else {
-        fragColor = texture(sampler, texCoord);
-    }
+#ifdef BLUR
+    fragColor = gaussBlur(sampler, texCoord, vec2(0., exp2(lod) / height), lod);
+#else
+    fragColor = texture(sampler, texCoord);
+#endif
 }
 )SRC";
 
@@ -305,15 +244,14 @@ precision mediump float;
 precision mediump int;
 
 uniform sampler2D sampler;
-uniform float width;
-uniform float lod;
-uniform float minLod;
-uniform vec3 contrastingColor;
-uniform float contrastingColorMix;
 
 in vec2 texCoord;
 out vec4 fragColor;
 
+#ifdef BLUR
+uniform float width;
+uniform float lod;
+
 const float sigma = 3.;
 const float r = sigma * 2.;
 const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
@@ -329,18 +267,73 @@ vec4 gaussBlur( sampler2D tex, vec2 uv, vec2 d, float l )
     }
     return c / c.a;
 }
+#endif
+
+#ifdef CONTRASTING_COLOR
+uniform vec3 contrastingColor;
+uniform float contrastingColorMix;
+#endif
 
 void main() {
-    if (lod > minLod) {
-        vec4 blurred = gaussBlur(sampler, texCoord, vec2(exp2(lod) / width, 0.), lod);
-        if (contrastingColor != vec3(-1.)) {
-            fragColor = vec4(mix(vec3(blurred.rgb), contrastingColor, contrastingColorMix), blurred.a);
-        } else {
-            fragColor = blurred;
+#ifdef BLUR
+    vec4 color = gaussBlur(sampler, texCoord, vec2(exp2(lod) / width, 0.), lod);
+#else
+    vec4 color = texture(sampler, texCoord);
+#endif
+#ifdef CONTRASTING_COLOR
+    color.rgb = mix(color.rgb, contrastingColor, contrastingColorMix);
+#endif
+    fragColor = color;
+}
+)SRC";
+
+    constexpr char FRAGMENT_SHADER_SRC_FUSED_2D[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform sampler2D sampler;
+
+in vec2 texCoord;
+out vec4 fragColor;
+
+#ifdef BLUR
+uniform float width;
+uniform float height;
+uniform float lod;
+
+const float sigma = 3.;
+const float r = sigma * 2.;
+const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
+
+// Same kernel as the separable V + H pair, applied in one pass - the 2D gaussian weight
+// is the product of both 1D weights.
+vec4 gaussBlur2D( sampler2D tex, vec2 uv, vec2 d, float l )
+{
+    vec4 c = vec4(0.);
+    for (float i = 1. - r; i < r; ++i) {
+        for (float j = 1. - r; j < r; ++j) {
+            c += texture(tex, uv + d * vec2(i, j), l) * exp(- (i * i + j * j) * invTwoSigmaSqr);
         }
-    } else {
-        fragColor = texture(sampler, texCoord);
     }
+    return c / c.a;
+}
+#endif
+
+#ifdef CONTRASTING_COLOR
+uniform vec3 contrastingColor;
+uniform float contrastingColorMix;
+#endif
+
+void main() {
+#ifdef BLUR
+    vec4 color = gaussBlur2D(sampler, texCoord, exp2(lod) / vec2(width, height), lod);
+#else
+    vec4 color = texture(sampler, texCoord);
+#endif
+#ifdef CONTRASTING_COLOR
+    color.rgb = mix(color.rgb, contrastingColor, contrastingColorMix);
+#endif
+    fragColor = color;
 }
 )SRC";
 
@@ -351,77 +344,49 @@ void main() {
         std::pair<ANativeWindow *, EGLSurface> windowSurface;
         EGLSurface bufferSurface;
 
-        GLuint programNoBlur = -1;
-        GLint positionHandleNoBlur = -1;
-        GLint samplerHandleNoBlur = -1;
-        GLint vertTransformHandleNoBlur = -1;
-        GLint texTransformHandleNoBlur = -1;
-        GLint widthHandleNoBlur = -1;
-        GLint heightHandleNoBlur = -1;
-        GLint xHandleNoBlur = -1;
-        GLint yHandleNoBlur = -1;
-        GLint cornerRadiusHandleNoBlur = -1;
-
-        GLuint programVOES = -1;
-        GLint positionHandleVOES = -1;
-        GLint samplerHandleVOES = -1;
-        GLint vertTransformHandleVOES = -1;
-        GLint texTransformHandleVOES = -1;
-        GLint heightHandleVOES = -1;
-        GLint lodHandleVOES = -1;
-        GLint minLodHandleVOES = -1;
-        GLint contrastingColorHandleVOES = -1;
-        GLint contrastingColorMixHandleVOES = -1;
-
-        GLuint programH = -1;
-        GLint positionHandleH = -1;
-        GLint samplerHandleH = -1;
-        GLint widthHandleH = -1;
-        GLint lodHandleH = -1;
-        GLint minLodHandleH = -1;
-        GLint contrastingColorHandleH = -1;
-        GLint contrastingColorMixHandleH = -1;
-
-        GLuint programV2D = -1;
-        GLint positionHandleV2D = -1;
-        GLint samplerHandleV2D = -1;
-        GLint heightHandleV2D = -1;
-        GLint lodHandleV2D = -1;
-        GLint minLodHandleV2D = -1;
-        GLint contrastingColorHandleV2D = -1;
-        GLint contrastingColorMixHandleV2D = -1;
+        // Specialized for the features of each draw when first used.
+        ShaderVariants programsNoBlur{VERTEX_SHADER_SRC_NO_BLUR, FRAGMENT_SHADER_SRC_NO_BLUR,
+                                      SHADER_FEATURE_DEFINES, UNIFORM_NAMES};
+        ShaderVariants programsVOES{VERTEX_SHADER_SRC_TRANSFORM, FRAGMENT_SHADER_SRC_V_OES,
+                                    SHADER_FEATURE_DEFINES, UNIFORM_NAMES};
+        ShaderVariants programsH{VERTEX_SHADER_SRC_NO_TRANSFORM, FRAGMENT_SHADER_SRC_H,
+                                 SHADER_FEATURE_DEFINES, UNIFORM_NAMES};
+        ShaderVariants programsV2D{VERTEX_SHADER_SRC_NO_TRANSFORM, FRAGMENT_SHADER_SRC_V_2D,
+                                   SHADER_FEATURE_DEFINES, UNIFORM_NAMES};
+        ShaderVariants programsFused{VERTEX_SHADER_SRC_NO_TRANSFORM, FRAGMENT_SHADER_SRC_FUSED_2D,
+                                     SHADER_FEATURE_DEFINES, UNIFORM_NAMES};
 
         GLuint inputTextureId = -1;
-        GLuint pass1TextureId = -1;
-        GLuint fbo1Id = -1;
-        GLuint pass2TextureId = -1;
-        GLuint fbo2Id = -1;
-        GLuint pass3TextureId = -1;
-        GLuint fbo3Id = -1;
-        GLuint pass4TextureId = -1;
-        GLuint fbo4Id = -1;
-        GLuint pass5TextureId = -1;
-        GLuint fbo5Id = -1;
-        GLuint pass6TextureId = -1;
-        GLuint fbo6Id = -1;
-        GLuint pass7TextureId = -1;
-        GLuint fbo7Id = -1;
 
         GLboolean blurEnabled = GL_FALSE;
+        // lod and contrastingColorMix - the contrasting color fades out as the blur fades in.
+        Animation<2> blurAnimation{{MIN_LOD, MAX_CONTRASTING_COLOR_MIX}};
         GLfloat lod = MIN_LOD;
-        GLint currentBlurAnimationFrame = -1;
-
         GLfloat contrastingColorMix = MAX_CONTRASTING_COLOR_MIX;
 
-        GLint currentContrastingColorAnimationFrame
-                = NativeContext::CONTRASTING_COLOR_ANIMATION_FRAMES;
-        GLfloat targetContrastingRed = -1.f;
-        GLfloat targetContrastingGreen = -1.f;
-        GLfloat targetContrastingBlue = -1.f;
+        Animation<3> contrastingColorAnimation{{-1.f, -1.f, -1.f}};
         GLfloat contrastingRed = -1.f;
         GLfloat contrastingGreen = -1.f;
         GLfloat contrastingBlue = -1.f;
 
+        // Inputs of the last drawn frame, so frames which would look the same are skipped.
+        // Changes to state which is not passed along with every frame set outputDirty.
+        bool outputDirty = true;
+        int64_t lastFrameTimestampNs = -1;
+        std::array<GLfloat, 16> lastVertTransform{};
+        std::array<GLfloat, 16> lastTexTransform{};
+        std::vector<GLfloat> lastRects;
+        GLuint lastAllRectsCount = 0;
+        GLuint lastOtherRectsCount = 0;
+
+        // Frames which only move marker rects over the same camera frame redraw and present
+        // just the window region they changed.
+        SwapDamage swapDamage;
+        DamageRect windowRedraw;
+
+        // Further surfaces presenting the frames drawn into the window surface.
+        SurfaceFanout outputFanout;
+
         GLint vertexComponents = 2;
         GLenum vertexType = GL_FLOAT;
         GLboolean normalized = GL_FALSE;
@@ -430,6 +395,81 @@ void main() {
         GLsizei numMatrices = 1;
         GLboolean transpose = GL_FALSE;
 
+        // Probed on the first launch on a driver, then loaded along with the blur pass modes
+        // blurPassPlanner measured.
+        GpuCapabilityCache gpuCapabilities;
+        GpuTimer gpuTimer;
+        BlurPassPlanner blurPassPlanner;
+
+        // Blur pyramid, declared for the level modes picked by blurPassPlanner.
+        static constexpr GLint BLUR_LEVEL_COUNT = 3;
+        // Levels whose mode is in gpuCapabilities, for the current window size.
+        std::array<bool, BLUR_LEVEL_COUNT> blurLevelsSaved{};
+        RenderGraph blurGraph{VERTICES};
+        std::array<BlurPassPlanner::LevelPlan, BLUR_LEVEL_COUNT> blurLevelPlans{};
+        std::array<BlurPassPlanner::LevelMode, BLUR_LEVEL_COUNT> blurGraphModes{};
+        bool blurGraphDeclared = false;
+        // Whether blurGraph is declared for satBlur rather than the separable passes.
+        bool blurGraphSat = false;
+        RenderGraph::ResourceId quarterBlurLevel = RenderGraph::WINDOW;
+        RenderGraph::ResourceId halfBlurLevel = RenderGraph::WINDOW;
+        // Parameters of the DrawBlur call executing the graph.
+        const GLfloat *blurVertTransform = nullptr;
+        const GLfloat *blurTexTransform = nullptr;
+        bool blurWithMaxLod = false;
+        bool blurFinalMix = false;
+
+        // Alternative to the separable passes, selected by a render command where supported.
+        SatBlur satBlur;
+        bool satBlurEnabled = false;
+
+        ColorExtractor colorExtractor;
+        // Whether the blur pyramid (and so its quarter level) is up to date for the current
+        // frame.
+        bool blurPyramidDrawn = false;
+        bool blurPyramidFullyBlurred = false;
+
+        FrameReadback frameReadback;
+
+        RectGridIndex rectGridIndex;
+        std::vector<uint32_t> visibleRectIndices;
+        RectStencil rectStencil;
+        std::vector<RectCoalescer::Rect> stencilRects;
+
+        SpriteBatcher spriteBatcher;
+        TextBatcher textBatcher;
+
+        // Setters from the UI thread, applied at frame boundaries.
+        std::shared_ptr<RenderCommandQueue> commandQueue;
+        std::shared_ptr<SharedGlResources> sharedResources;
+
+        // Inputs of every frame and command while a trace is being recorded.
+        FrameTraceWriter frameTrace;
+        std::vector<GLfloat> replayRects;
+        // Camera frame stored in a replayed trace, drawn instead of the camera texture.
+        HardwareBufferTexture replayCamera;
+        std::vector<uint8_t> replayPixels;
+
+        // Native render loop, which draws camera frames on its own thread instead of
+        // renderTexture calls from the JVM. While it runs, the loop thread owns the context and
+        // the frame inputs below are only touched there.
+        MonotonicFrameClock frameClock;
+        SurfaceTextureFrameSource frameSource;
+        std::unique_ptr<RenderLoop> renderLoop;
+        GLfloat previewWidth = 0.f;
+        GLfloat previewHeight = 0.f;
+        GLfloat surfaceWidth = 0.f;
+        GLfloat surfaceHeight = 0.f;
+        GLint surfaceRotationDegrees = 0;
+        std::vector<GLfloat> frameRects;
+        GLuint frameAllRectsCount = 0;
+        GLuint frameOtherRectsCount = 0;
+        // Renderer notified of every frame drawn by the loop.
+        JavaVM *javaVm = nullptr;
+        JNIEnv *renderLoopEnv = nullptr;
+        jobject renderer = nullptr;
+        jmethodID onFrameRenderedMethod = nullptr;
+
         // We use a single triangle with the viewport inscribed within for our
         // VERTICES. This could also be done with a quad or two triangles.
         //                          ^
@@ -449,18 +489,33 @@ void main() {
 
         static constexpr GLfloat MAX_LOD = 2.f;
         static constexpr GLfloat MIN_LOD = -2.f;
-        static constexpr GLint BLUR_ANIMATION_FRAMES = 18;
-        static constexpr GLfloat LOD_INCREMENT = (NativeContext::MAX_LOD - NativeContext::MIN_LOD) /
-                                                 (GLfloat) NativeContext::BLUR_ANIMATION_FRAMES;
+        // Used to be 18 and 60 frames of a 60 fps camera.
+        static constexpr int64_t BLUR_ANIMATION_DURATION_NS = 300'000'000;
+        static constexpr int64_t CONTRASTING_COLOR_ANIMATION_DURATION_NS = 1'000'000'000;
 
         static constexpr GLfloat MAX_CONTRASTING_COLOR_MIX = .05f;
         static constexpr GLfloat MIN_CONTRASTING_COLOR_MIX = 0.f;
-        static constexpr GLfloat CONTRASTING_COLOR_MIX_INCREMENT =
-                (NativeContext::MAX_CONTRASTING_COLOR_MIX -
-                 NativeContext::MIN_CONTRASTING_COLOR_MIX) /
-                (GLfloat) NativeContext::BLUR_ANIMATION_FRAMES;
+        // Passes of DrawBlur with every level separable.
+        static constexpr GLint SEPARABLE_BLUR_PASS_COUNT = 8;
+        // Sigma of the separable passes at lod 0 in quarter size pixels: the camera, quarter,
+        // half and full size passes of sigma 3 compound to about
+        // sqrt(6^2 + 12^2 + 6^2 + 3^2) = 15 window pixels.
+        static constexpr GLfloat SAT_BLUR_SIGMA = 3.75f;
+
+        // Pyramid levels whose V + H pass pair may be fused by the BlurPassPlanner.
+        static constexpr GLint QUARTER_BLUR_LEVEL = 0;
+        static constexpr GLint HALF_BLUR_LEVEL = 1;
+        static constexpr GLint FULL_BLUR_LEVEL = 2;
+
+        // Size of a pyramid level along an axis of windowSize: quarter, half and full size.
+        static GLsizei BlurLevelSize(GLsizei windowSize, GLint level) {
+            return windowSize / (GLsizei{4} >> level);
+        }
 
-        static constexpr GLint CONTRASTING_COLOR_ANIMATION_FRAMES = 60;
+        // Levels accepted by requestBlurredSnapshot.
+        static constexpr GLint SNAPSHOT_LEVEL_FULL = 0;
+        static constexpr GLint SNAPSHOT_LEVEL_HALF = 1;
+        static constexpr GLint SNAPSHOT_LEVEL_QUARTER = 2;
 
         NativeContext(EGLDisplay display,
                       EGLConfig config,
@@ -475,104 +530,210 @@ void main() {
                   bufferSurface(pbufferSurface) {}
 
     private:
-        void PrepareDrawNoBlur(const GLfloat *vertTransformArray,
-                               const GLfloat *texTransformArray,
-                               GLfloat width,
-                               GLfloat height,
-                               GLint x,
-                               GLint y,
-                               GLfloat cornerRadius) const {
-            CHECK_GL(glVertexAttribPointer(positionHandleNoBlur,
+        // Binds the variant of programs for features along with the fullscreen triangle.
+        // Returns null if it could not be built, the draw is skipped then.
+        const ShaderVariants::Program *UseProgram(ShaderVariants &programs, uint32_t features) {
+            const auto *program = programs.Get(features);
+            if (!program) return nullptr;
+
+            CHECK_GL(glVertexAttribPointer(program->positionHandle,
                                            vertexComponents, vertexType, normalized,
                                            vertexStride, VERTICES));
-            CHECK_GL(glEnableVertexAttribArray(positionHandleNoBlur));
-            CHECK_GL(glUseProgram(programNoBlur));
-            CHECK_GL(glUniformMatrix4fv(vertTransformHandleNoBlur, numMatrices, transpose,
-                                        vertTransformArray));
-            CHECK_GL(glUniform1i(samplerHandleNoBlur, 0));
-            CHECK_GL(glUniformMatrix4fv(texTransformHandleNoBlur, numMatrices,
-                                        transpose, texTransformArray));
-            CHECK_GL(glUniform1f(widthHandleNoBlur, width));
-            CHECK_GL(glUniform1f(heightHandleNoBlur, height));
-            CHECK_GL(glUniform1i(xHandleNoBlur, x));
-            CHECK_GL(glUniform1i(yHandleNoBlur, y));
-            CHECK_GL(glUniform1f(cornerRadiusHandleNoBlur, cornerRadius));
-            CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, inputTextureId));
+            CHECK_GL(glEnableVertexAttribArray(program->positionHandle));
+            CHECK_GL(glUseProgram(program->id));
+            return program;
         }
 
-        void PrepareDrawVOES(const GLfloat *vertTransformArray,
-                             const GLfloat *texTransformArray,
-                             GLfloat height,
-                             bool withMaxLod,
-                             bool mixContrastingColor) const {
-            CHECK_GL(glVertexAttribPointer(positionHandleVOES,
-                                           vertexComponents, vertexType, normalized,
-                                           vertexStride, VERTICES));
-            CHECK_GL(glEnableVertexAttribArray(positionHandleVOES));
-            CHECK_GL(glUseProgram(programVOES));
-            CHECK_GL(glUniformMatrix4fv(
-                    vertTransformHandleVOES, numMatrices, transpose,
-                    vertTransformArray));
-            CHECK_GL(glUniform1i(samplerHandleVOES, 0));
-            CHECK_GL(glUniformMatrix4fv(texTransformHandleVOES, numMatrices,
-                                        transpose, texTransformArray));
-            CHECK_GL(glUniform1f(heightHandleVOES, height));
-            CHECK_GL(glUniform1f(lodHandleVOES, withMaxLod ? NativeContext::MAX_LOD : lod));
-            CHECK_GL(glUniform1f(minLodHandleVOES, NativeContext::MIN_LOD));
-            if (mixContrastingColor) {
-                CHECK_GL(glUniform3f(contrastingColorHandleVOES,
-                                     contrastingRed, contrastingGreen, contrastingBlue));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleVOES, contrastingColorMix));
-            } else {
-                CHECK_GL(glUniform3f(contrastingColorHandleVOES, -1.f, -1.f, -1.f));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleVOES, 0.f));
-            }
+        [[nodiscard]] GLfloat PassLod(bool withMaxLod) const {
+            return withMaxLod ? NativeContext::MAX_LOD : lod;
         }
 
-        void PrepareDrawV2D(GLfloat height, bool withMaxLod, bool mixContrastingColor) const {
-            CHECK_GL(glVertexAttribPointer(positionHandleV2D,
-                                           vertexComponents, vertexType, normalized,
-                                           vertexStride, VERTICES));
-            CHECK_GL(glEnableVertexAttribArray(positionHandleV2D));
-            CHECK_GL(glUseProgram(programV2D));
-            CHECK_GL(glUniform1i(samplerHandleV2D, 0));
-            CHECK_GL(glUniform1f(heightHandleV2D, height));
-            CHECK_GL(glUniform1f(lodHandleV2D, withMaxLod ? NativeContext::MAX_LOD : lod));
-            CHECK_GL(glUniform1f(minLodHandleV2D, NativeContext::MIN_LOD));
-            if (mixContrastingColor) {
-                CHECK_GL(glUniform3f(contrastingColorHandleV2D,
-                                     contrastingRed, contrastingGreen, contrastingBlue));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleV2D, contrastingColorMix));
-            } else {
-                CHECK_GL(glUniform3f(contrastingColorHandleV2D, -1.f, -1.f, -1.f));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleV2D, 0.f));
-            }
+        // Passes at the minimal lod copy their input. The contrasting color is only mixed in by
+        // the pass drawing the final level.
+        [[nodiscard]] uint32_t BlurPassFeatures(bool withMaxLod, bool finalMix) const {
+            if (PassLod(withMaxLod) <= NativeContext::MIN_LOD) return 0;
+
+            const bool hasContrastingColor = contrastingRed != -1.f ||
+                                             contrastingGreen != -1.f ||
+                                             contrastingBlue != -1.f;
+            return finalMix && hasContrastingColor && contrastingColorMix > 0.f
+                   ? FEATURE_BLUR | FEATURE_CONTRASTING_COLOR : FEATURE_BLUR;
         }
 
-        void PrepareDrawH(GLfloat width, bool withMaxLod, bool mixContrastingColor) const {
-            CHECK_GL(glVertexAttribPointer(positionHandleH,
-                                           vertexComponents, vertexType, normalized,
-                                           vertexStride, VERTICES));
-            CHECK_GL(glEnableVertexAttribArray(positionHandleH));
-            CHECK_GL(glUseProgram(programH));
-            CHECK_GL(glUniform1i(samplerHandleH, 0));
-            CHECK_GL(glUniform1f(widthHandleH, width));
-            CHECK_GL(glUniform1f(lodHandleH, withMaxLod ? NativeContext::MAX_LOD : lod));
-            CHECK_GL(glUniform1f(minLodHandleH, NativeContext::MIN_LOD));
-            if (mixContrastingColor) {
-                CHECK_GL(glUniform3f(contrastingColorHandleH,
-                                     contrastingRed, contrastingGreen, contrastingBlue));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleH, contrastingColorMix));
-            } else {
-                CHECK_GL(glUniform3f(contrastingColorHandleH, -1.f, -1.f, -1.f));
-                CHECK_GL(glUniform1f(contrastingColorMixHandleH, 0.f));
+        void SetBlurPassUniforms(const ShaderVariants::Program &program,
+                                 GLsizei width,
+                                 GLsizei height) const {
+            const auto &uniforms = program.uniformHandles;
+            CHECK_GL(glUniformMatrix4fv(uniforms[UNIFORM_VERT_TRANSFORM], numMatrices, transpose,
+                                        blurVertTransform));
+            CHECK_GL(glUniformMatrix4fv(uniforms[UNIFORM_TEX_TRANSFORM], numMatrices,
+                                        transpose, blurTexTransform));
+            CHECK_GL(glUniform1i(uniforms[UNIFORM_SAMPLER], 0));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_WIDTH], (GLfloat) width));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_HEIGHT], (GLfloat) height));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_LOD], PassLod(blurWithMaxLod)));
+            // Used to be mixed in by each pass of the separable pyramid. The blur leaves a
+            // constant color as it is, so mixing once by the compounded factor looks the same.
+            const GLfloat finalMix =
+                    1.f - std::pow(1.f - contrastingColorMix,
+                                   static_cast<GLfloat>(SEPARABLE_BLUR_PASS_COUNT));
+            CHECK_GL(glUniform3f(uniforms[UNIFORM_CONTRASTING_COLOR],
+                                 contrastingRed, contrastingGreen, contrastingBlue));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_CONTRASTING_COLOR_MIX], finalMix));
+        }
+
+        RenderGraph::Pass BlurPass(const char *name,
+                                   ShaderVariants &programs,
+                                   RenderGraph::ResourceId input,
+                                   RenderGraph::ResourceId output,
+                                   GLint timerTag) {
+            const bool finalPass = output == RenderGraph::WINDOW;
+            RenderGraph::Pass pass;
+            pass.name = name;
+            pass.programs = &programs;
+            pass.input = input;
+            pass.output = output;
+            pass.timerTag = timerTag;
+            pass.features = [this, finalPass] {
+                return BlurPassFeatures(blurWithMaxLod, finalPass && blurFinalMix);
+            };
+            pass.setUniforms = [this](const ShaderVariants::Program &program,
+                                      GLsizei width,
+                                      GLsizei height) {
+                SetBlurPassUniforms(program, width, height);
+            };
+            return pass;
+        }
+
+        // A pyramid level of 1 / divisor of the window size, blurred from input either with
+        // the separable V + H passes (through an intermediate target) or a single fused pass.
+        void DeclareBlurLevel(GLint level,
+                              BlurPassPlanner::LevelMode mode,
+                              RenderGraph::ResourceId input,
+                              RenderGraph::ResourceId output,
+                              GLsizei divisor) {
+            static constexpr const char *FUSED_NAMES[] = {"quarter fused", "half fused",
+                                                          "full fused"};
+            static constexpr const char *V_NAMES[] = {"quarter V", "half V", "full V"};
+            static constexpr const char *H_NAMES[] = {"quarter H", "half H", "full H"};
+
+            const GLint timerTag = BlurPassPlanner::TimerTag(level, mode);
+            if (mode == BlurPassPlanner::LevelMode::FUSED) {
+                blurGraph.AddPass(BlurPass(FUSED_NAMES[level], programsFused,
+                                           input, output, timerTag));
+                return;
             }
+            const auto intermediate = blurGraph.CreateTarget(divisor);
+            blurGraph.AddPass(BlurPass(V_NAMES[level], programsV2D, input, intermediate, timerTag));
+            blurGraph.AddPass(BlurPass(H_NAMES[level], programsH, intermediate, output, timerTag));
         }
 
-        static void BindAndDraw(GLuint fboId, GLuint textureId, GLenum texTarget = GL_TEXTURE_2D) {
-            CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, fboId));
-            CHECK_GL(glBindTexture(texTarget, textureId));
-            CHECK_GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+        // The camera frame blurred into a half size target, then blurred further by the
+        // quarter, half and full size levels - the last one drawing to the window.
+        void DeclareBlurGraph(
+                const std::array<BlurPassPlanner::LevelMode, BLUR_LEVEL_COUNT> &modes) {
+            blurGraph.Clear();
+            const auto camera = blurGraph.ImportTexture(GL_TEXTURE_EXTERNAL_OES, inputTextureId);
+            const auto cameraV = blurGraph.CreateTarget(2);
+            const auto cameraBlurred = blurGraph.CreateTarget(2);
+            blurGraph.AddPass(BlurPass("camera V", programsVOES, camera, cameraV, -1));
+            blurGraph.AddPass(BlurPass("camera H", programsH, cameraV, cameraBlurred, -1));
+
+            quarterBlurLevel = blurGraph.CreateTarget(4);
+            DeclareBlurLevel(QUARTER_BLUR_LEVEL, modes[QUARTER_BLUR_LEVEL],
+                             cameraBlurred, quarterBlurLevel, 4);
+            halfBlurLevel = blurGraph.CreateTarget(2);
+            DeclareBlurLevel(HALF_BLUR_LEVEL, modes[HALF_BLUR_LEVEL],
+                             quarterBlurLevel, halfBlurLevel, 2);
+            DeclareBlurLevel(FULL_BLUR_LEVEL, modes[FULL_BLUR_LEVEL],
+                             halfBlurLevel, RenderGraph::WINDOW, 1);
+
+            // Read after the frame by the color extractor and the snapshots.
+            blurGraph.Export(quarterBlurLevel);
+            blurGraph.Export(halfBlurLevel);
+
+            blurGraphModes = modes;
+            blurGraphDeclared = true;
+            blurGraphSat = false;
+        }
+
+        // A pass of the blur chain which only scales its input, the blur is satBlur's.
+        RenderGraph::Pass ScalePass(const char *name,
+                                    ShaderVariants &programs,
+                                    RenderGraph::ResourceId input,
+                                    RenderGraph::ResourceId output) {
+            auto pass = BlurPass(name, programs, input, output, -1);
+            const bool finalPass = output == RenderGraph::WINDOW;
+            pass.features = [this, finalPass] {
+                return BlurPassFeatures(blurWithMaxLod, finalPass && blurFinalMix) &
+                       ~FEATURE_BLUR;
+            };
+            return pass;
+        }
+
+        // The camera frame scaled down to a quarter of the window size and blurred there by
+        // satBlur, then scaled up through the half size level - the last pass drawing to the
+        // window. The levels are exported like those of the separable graph.
+        void DeclareSatBlurGraph() {
+            blurGraph.Clear();
+            const auto camera = blurGraph.ImportTexture(GL_TEXTURE_EXTERNAL_OES, inputTextureId);
+            const auto cameraQuarter = blurGraph.CreateTarget(4);
+            blurGraph.AddPass(ScalePass("camera quarter", programsVOES, camera, cameraQuarter));
+
+            quarterBlurLevel = blurGraph.CreateTarget(4);
+            RenderGraph::Pass satPass;
+            satPass.name = "quarter SAT";
+            satPass.input = cameraQuarter;
+            satPass.output = quarterBlurLevel;
+            satPass.run = [this](GLuint inputTextureId, GLuint outputFramebuffer,
+                                 GLsizei width, GLsizei height) {
+                const GLfloat passLod = PassLod(blurWithMaxLod);
+                const GLfloat sigma = passLod <= NativeContext::MIN_LOD
+                                      ? 0.f : SAT_BLUR_SIGMA * std::exp2(passLod);
+                satBlur.Blur(inputTextureId, outputFramebuffer, width, height, sigma);
+            };
+            blurGraph.AddPass(std::move(satPass));
+
+            halfBlurLevel = blurGraph.CreateTarget(2);
+            blurGraph.AddPass(ScalePass("half", programsH, quarterBlurLevel, halfBlurLevel));
+            blurGraph.AddPass(ScalePass("full", programsH, halfBlurLevel, RenderGraph::WINDOW));
+
+            blurGraph.Export(quarterBlurLevel);
+            blurGraph.Export(halfBlurLevel);
+
+            blurGraphDeclared = true;
+            blurGraphSat = true;
+        }
+
+        bool PrepareDrawNoBlur(const GLfloat *vertTransformArray,
+                               const GLfloat *texTransformArray,
+                               GLfloat width,
+                               GLfloat height,
+                               GLint x,
+                               GLint y,
+                               GLfloat cornerRadius) {
+            const auto *program = UseProgram(
+                    programsNoBlur, cornerRadius > 0.f ? FEATURE_ROUNDED_CORNERS : 0);
+            if (!program) return false;
+
+            const auto &uniforms = program->uniformHandles;
+            CHECK_GL(glUniformMatrix4fv(uniforms[UNIFORM_VERT_TRANSFORM], numMatrices, transpose,
+                                        vertTransformArray));
+            CHECK_GL(glUniform1i(uniforms[UNIFORM_SAMPLER], 0));
+            CHECK_GL(glUniformMatrix4fv(uniforms[UNIFORM_TEX_TRANSFORM], numMatrices,
+                                        transpose, texTransformArray));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_WIDTH], width));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_HEIGHT], height));
+            CHECK_GL(glUniform1i(uniforms[UNIFORM_X], x));
+            CHECK_GL(glUniform1i(uniforms[UNIFORM_Y], y));
+            CHECK_GL(glUniform1f(uniforms[UNIFORM_CORNER_RADIUS], cornerRadius));
+            CHECK_GL(glBindTexture(GL_TEXTURE_EXTERNAL_OES, inputTextureId));
+            return true;
+        }
+
+        void ScissorWindowRedraw() const {
+            CHECK_GL(glScissor(windowRedraw.x, windowRedraw.y,
+                               windowRedraw.width, windowRedraw.height));
         }
 
         static void PrepareStencilForDrawingRects() {
@@ -585,9 +746,9 @@ void main() {
         void DrawBlurredRects(const GLfloat *vertTransformArray,
                               const GLfloat *texTransformArray,
                               GLfloat width,
-                              GLfloat height) const {
+                              GLfloat height) {
             CHECK_GL(glStencilFunc(GL_EQUAL, 1, 0xFF));
-            CHECK_GL(glScissor(0, 0, width, height));
+            ScissorWindowRedraw();
             DrawBlur(vertTransformArray, texTransformArray, width, height, true, true);
         }
 
@@ -596,9 +757,25 @@ void main() {
                                          GLfloat *rectsCoordinates,
                                          GLuint rectsCount,
                                          GLfloat width,
-                                         GLfloat height) const {
-            GLfloat *rectCoordinate = rectsCoordinates;
-            for (GLuint i = 0; i < rectsCount; ++i) {
+                                         GLfloat height) {
+            // Off screen rects and rects under another one add nothing to the stencil.
+            rectGridIndex.Update(rectsCoordinates, rectsCount);
+            rectGridIndex.QueryVisible(width, height, visibleRectIndices);
+
+            if (rectStencil.IsInitialized()) {
+                stencilRects.clear();
+                for (auto index: visibleRectIndices) {
+                    const GLfloat *rect =
+                            rectsCoordinates + index * RectGridIndex::RECT_COMPONENTS;
+                    stencilRects.push_back({rect[0], rect[1] - rect[3], rect[0] + rect[2], rect[1],
+                                            rect[4] / RectGridIndex::CORNER_RADIUS_SCALE});
+                }
+                rectStencil.Draw(stencilRects, (GLsizei) width, (GLsizei) height);
+                return;
+            }
+
+            for (auto index: visibleRectIndices) {
+                GLfloat *rectCoordinate = rectsCoordinates + index * RectGridIndex::RECT_COMPONENTS;
                 auto rectLeftX = *rectCoordinate;
                 ++rectCoordinate;
                 auto rectBottomY = height - *rectCoordinate;
@@ -608,7 +785,6 @@ void main() {
                 auto rectHeight = *rectCoordinate;
                 ++rectCoordinate;
                 auto cornerRadius = *rectCoordinate;
-                ++rectCoordinate;
                 CHECK_GL(glScissor(rectLeftX, rectBottomY, rectWidth, rectHeight));
                 DrawNoBlur(vertTransformArray, texTransformArray,
                            rectWidth, rectHeight,
@@ -618,59 +794,160 @@ void main() {
         }
 
     public:
-        [[nodiscard]] GLboolean IsAnimatingContrastingColor() const {
-            return currentContrastingColorAnimationFrame
-                   < NativeContext::CONTRASTING_COLOR_ANIMATION_FRAMES;
+        enum class FrameChange {
+            NONE,
+            // Only the marker rects changed, the camera frame and its transforms did not.
+            RECTS,
+            FULL,
+        };
+
+        enum class FrameResult {
+            DRAWN,
+            // Nothing changed since the last drawn frame, which is still on screen.
+            UNCHANGED,
+            FAILED,
+        };
+
+        void ApplyCommands(int64_t timestampNs) {
+            if (!commandQueue) return;
+
+            RenderCommand command;
+            while (commandQueue->TryPop(command)) {
+                if (frameTrace.IsOpen()) {
+                    frameTrace.AppendCommand(
+                            {timestampNs, static_cast<uint32_t>(command.type), command.enabled,
+                             command.animated, {command.red, command.green, command.blue}});
+                }
+                ApplyCommand(command, timestampNs);
+            }
         }
 
-        void AnimateContrastingColor() {
-            auto fraction = (GLfloat) (currentContrastingColorAnimationFrame + 1) /
-                            (GLfloat) NativeContext::CONTRASTING_COLOR_ANIMATION_FRAMES;
-            contrastingRed = (targetContrastingRed - contrastingRed) * fraction + contrastingRed;
-            contrastingGreen =
-                    (targetContrastingGreen - contrastingGreen) * fraction + contrastingGreen;
-            contrastingBlue =
-                    (targetContrastingBlue - contrastingBlue) * fraction + contrastingBlue;
-            ++currentContrastingColorAnimationFrame;
+        void ApplyCommand(const RenderCommand &command, int64_t timestampNs) {
+            switch (command.type) {
+                case RenderCommand::Type::SET_BLUR_ENABLED:
+                    SetBlurEnabled(command.enabled, command.animated, timestampNs);
+                    break;
+                case RenderCommand::Type::SET_CONTRASTING_COLOR:
+                    SetContrastingColor(command.red, command.green, command.blue, timestampNs);
+                    break;
+                case RenderCommand::Type::SET_SAT_BLUR_ENABLED:
+                    satBlurEnabled = command.enabled;
+                    break;
+            }
+            outputDirty = true;
         }
 
-        [[nodiscard]] GLboolean IsAnimatingLod() const {
-            return currentBlurAnimationFrame > -1 &&
-                   currentBlurAnimationFrame < NativeContext::BLUR_ANIMATION_FRAMES;
+        void SetBlurEnabled(bool enabled, bool animated, int64_t timestampNs) {
+            if (blurEnabled == enabled) return;
+
+            blurEnabled = enabled;
+            const Animation<2>::Values target =
+                    enabled ? Animation<2>::Values{MAX_LOD, MIN_CONTRASTING_COLOR_MIX}
+                            : Animation<2>::Values{MIN_LOD, MAX_CONTRASTING_COLOR_MIX};
+            if (!animated) {
+                blurAnimation.Jump(target);
+                return;
+            }
+            // Turning around midway takes as long as it took to get there.
+            const GLfloat distance = std::abs(target[0] - blurAnimation.Get()[0]) /
+                                     (NativeContext::MAX_LOD - NativeContext::MIN_LOD);
+            blurAnimation.Start(target, timestampNs,
+                                static_cast<int64_t>(
+                                        static_cast<double>(BLUR_ANIMATION_DURATION_NS) *
+                                        distance),
+                                Easing::EASE_IN_OUT_CUBIC);
         }
 
-        void AnimateLod() {
-            if (blurEnabled) {
-                if (lod < NativeContext::MAX_LOD) {
-                    lod += NativeContext::LOD_INCREMENT;
-                }
-                if (contrastingColorMix > NativeContext::MIN_CONTRASTING_COLOR_MIX) {
-                    contrastingColorMix -= CONTRASTING_COLOR_MIX_INCREMENT;
-                }
-                ++currentBlurAnimationFrame;
+        void SetContrastingColor(GLfloat red, GLfloat green, GLfloat blue, int64_t timestampNs) {
+            const auto &color = contrastingColorAnimation.Get();
+            if (color[0] == -1.f && color[1] == -1.f && color[2] == -1.f) {
+                contrastingColorAnimation.Jump({red, green, blue});
             } else {
-                if (lod > NativeContext::MIN_LOD) {
-                    lod -= NativeContext::LOD_INCREMENT;
-                }
-                if (contrastingColorMix <
-                    NativeContext::MAX_CONTRASTING_COLOR_MIX) {
-                    contrastingColorMix += NativeContext::CONTRASTING_COLOR_MIX_INCREMENT;
-                }
-                --currentBlurAnimationFrame;
+                contrastingColorAnimation.Start({red, green, blue}, timestampNs,
+                                                CONTRASTING_COLOR_ANIMATION_DURATION_NS,
+                                                Easing::EASE_OUT_CUBIC);
             }
         }
 
+        // Evaluates the animations at the frame timestamp. Returns whether any animated value
+        // changed since the previous frame.
+        bool Animate(int64_t timestampNs) {
+            bool changed = blurAnimation.Update(timestampNs);
+            changed = contrastingColorAnimation.Update(timestampNs) || changed;
+
+            lod = blurAnimation.Get()[0];
+            contrastingColorMix = blurAnimation.Get()[1];
+            const auto &color = contrastingColorAnimation.Get();
+            contrastingRed = color[0];
+            contrastingGreen = color[1];
+            contrastingBlue = color[2];
+            return changed;
+        }
+
+        [[nodiscard]] bool IsAnimatingLod() const {
+            return blurAnimation.IsRunning();
+        }
+
+        // Records the inputs of the frame about to be drawn and compares them with those of
+        // the last drawn frame. When only the rects changed, rectsDamage is the window region
+        // they cover before and after.
+        FrameChange TrackFrameInputs(int64_t timestampNs,
+                                     const GLfloat *vertTransformArray,
+                                     const GLfloat *texTransformArray,
+                                     const GLfloat *rectsCoordinates,
+                                     GLuint allRectsCount,
+                                     GLuint otherRectsCount,
+                                     GLsizei width,
+                                     GLsizei height,
+                                     DamageRect &rectsDamage) {
+            const size_t rectsSize =
+                    rectsCoordinates ? allRectsCount * RectGridIndex::RECT_COMPONENTS : 0;
+            const bool sameCameraFrame =
+                    timestampNs == lastFrameTimestampNs &&
+                    std::equal(lastVertTransform.begin(), lastVertTransform.end(),
+                               vertTransformArray) &&
+                    std::equal(lastTexTransform.begin(), lastTexTransform.end(),
+                               texTransformArray);
+            const bool sameRects =
+                    allRectsCount == lastAllRectsCount &&
+                    std::equal(lastRects.begin(), lastRects.end(),
+                               rectsCoordinates, rectsCoordinates + rectsSize);
+            if (sameCameraFrame && sameRects && otherRectsCount == lastOtherRectsCount) {
+                return FrameChange::NONE;
+            }
+
+            // Another count of other rects changes which rects are drawn, not only where.
+            const bool rectsOnly = sameCameraFrame && otherRectsCount == lastOtherRectsCount;
+            if (rectsOnly) {
+                rectsDamage = RectsDamage(lastRects.data(),
+                                          lastRects.size() / RectGridIndex::RECT_COMPONENTS,
+                                          rectsCoordinates,
+                                          rectsSize / RectGridIndex::RECT_COMPONENTS,
+                                          width, height);
+            }
+
+            lastFrameTimestampNs = timestampNs;
+            std::copy(vertTransformArray, vertTransformArray + 16, lastVertTransform.begin());
+            std::copy(texTransformArray, texTransformArray + 16, lastTexTransform.begin());
+            lastRects.assign(rectsCoordinates, rectsCoordinates + rectsSize);
+            lastAllRectsCount = allRectsCount;
+            lastOtherRectsCount = otherRectsCount;
+            return rectsOnly ? FrameChange::RECTS : FrameChange::FULL;
+        }
+
         void DrawNoBlur(const GLfloat *vertTransformArray,
                         const GLfloat *texTransformArray,
                         GLfloat width,
                         GLfloat height,
                         GLint x,
                         GLint y,
-                        GLfloat cornerRadius) const {
-            PrepareDrawNoBlur(vertTransformArray, texTransformArray,
-                              width, height,
-                              x, y,
-                              cornerRadius);
+                        GLfloat cornerRadius) {
+            if (!PrepareDrawNoBlur(vertTransformArray, texTransformArray,
+                                   width, height,
+                                   x, y,
+                                   cornerRadius)) {
+                return;
+            }
             CHECK_GL(glViewport(x, y, width, height));
             CHECK_GL(glDrawArrays(GL_TRIANGLES, 0, 3));
         }
@@ -680,35 +957,78 @@ void main() {
                       GLfloat width,
                       GLfloat height,
                       bool withMaxLod = false,
-                      bool mixContrastingColor = false) const {
-            PrepareDrawVOES(vertTransformArray, texTransformArray, height / 2.f,
-                            withMaxLod, mixContrastingColor);
-            CHECK_GL(glViewport(0, 0, width / 2.f, height / 2.f));
-            BindAndDraw(fbo1Id, inputTextureId, GL_TEXTURE_EXTERNAL_OES);
-
-            PrepareDrawH(width / 2.f, withMaxLod, mixContrastingColor);
-            BindAndDraw(fbo2Id, pass1TextureId);
-
-            PrepareDrawV2D(height / 4.f, withMaxLod, mixContrastingColor);
-            CHECK_GL(glViewport(0, 0, width / 4.f, height / 4.f));
-            BindAndDraw(fbo3Id, pass2TextureId);
-
-            PrepareDrawH(width / 4.f, withMaxLod, mixContrastingColor);
-            BindAndDraw(fbo4Id, pass3TextureId);
-
-            PrepareDrawV2D(height / 2.f, withMaxLod, mixContrastingColor);
-            CHECK_GL(glViewport(0, 0, width / 2.f, height / 2.f));
-            BindAndDraw(fbo5Id, pass4TextureId);
-
-            PrepareDrawH(width / 2.f, withMaxLod, mixContrastingColor);
-            BindAndDraw(fbo6Id, pass5TextureId);
-
-            PrepareDrawV2D(height, withMaxLod, mixContrastingColor);
-            CHECK_GL(glViewport(0, 0, width, height));
-            BindAndDraw(fbo7Id, pass6TextureId);
+                      bool mixContrastingColor = false) {
+            gpuTimer.Collect([this](GLint tag, uint64_t elapsedNs) {
+                blurPassPlanner.OnTimerResult(tag, elapsedNs);
+            });
+            blurPyramidDrawn = true;
+            blurPyramidFullyBlurred = withMaxLod || lod >= NativeContext::MAX_LOD;
+
+            if (satBlurEnabled && satBlur.IsInitialized()) {
+                if (!blurGraphDeclared || !blurGraphSat) DeclareSatBlurGraph();
+            } else {
+                std::array<BlurPassPlanner::LevelMode, BLUR_LEVEL_COUNT> modes{};
+                for (GLint level = 0; level < BLUR_LEVEL_COUNT; ++level) {
+                    const GLsizei levelWidth = BlurLevelSize((GLsizei) width, level);
+                    const GLsizei levelHeight = BlurLevelSize((GLsizei) height, level);
+                    blurLevelPlans[level] = blurPassPlanner.Plan(level, levelWidth, levelHeight,
+                                                                 blurPyramidFullyBlurred);
+                    modes[level] = blurLevelPlans[level].mode;
+                    if (!blurLevelsSaved[level]) {
+                        blurLevelsSaved[level] = gpuCapabilities.SaveBlurLevel(
+                                blurPassPlanner, level, levelWidth, levelHeight);
+                    }
+                }
+                if (!blurGraphDeclared || blurGraphSat || modes != blurGraphModes) {
+                    DeclareBlurGraph(modes);
+                }
+            }
+            if (!blurGraph.Compile((GLsizei) width, (GLsizei) height)) return;
+
+            blurVertTransform = vertTransformArray;
+            blurTexTransform = texTransformArray;
+            blurWithMaxLod = withMaxLod;
+            blurFinalMix = mixContrastingColor;
+
+            bool timed = false;
+            RenderGraph::Hooks hooks;
+            hooks.onPassBegin = [this, &timed](const RenderGraph::PassEvent &event) {
+                if (!event.firstOfTag || event.timerTag < 0) return;
+                const GLint level = BlurPassPlanner::TimerTagLevel(event.timerTag);
+                timed = blurLevelPlans[level].measure && gpuTimer.Begin(event.timerTag);
+                if (timed) blurPassPlanner.OnMeasurementIssued(level, blurLevelPlans[level].mode);
+            };
+            hooks.onPassEnd = [this, &timed](const RenderGraph::PassEvent &event) {
+                if (!event.lastOfTag || !timed) return;
+                gpuTimer.End();
+                timed = false;
+            };
+            blurGraph.Execute(hooks);
+        }
 
-            PrepareDrawH(width, withMaxLod, mixContrastingColor);
-            BindAndDraw(0, pass7TextureId);
+        // Captures the requested snapshot level if this frame has it fully blurred.
+        // frameFullyBlurred tells whether the window surface currently holds a fully blurred
+        // frame (as opposed to the camera preview or a blur animation step).
+        void CaptureRequestedSnapshot(bool frameFullyBlurred, GLsizei width, GLsizei height) {
+            switch (frameReadback.RequestedLevel()) {
+                case NativeContext::SNAPSHOT_LEVEL_FULL:
+                    if (frameFullyBlurred) frameReadback.Capture(0, width, height);
+                    break;
+                case NativeContext::SNAPSHOT_LEVEL_HALF:
+                    if (blurPyramidDrawn && blurPyramidFullyBlurred) {
+                        frameReadback.Capture(blurGraph.FramebufferId(halfBlurLevel),
+                                              width / 2, height / 2);
+                    }
+                    break;
+                case NativeContext::SNAPSHOT_LEVEL_QUARTER:
+                    if (blurPyramidDrawn && blurPyramidFullyBlurred) {
+                        frameReadback.Capture(blurGraph.FramebufferId(quarterBlurLevel),
+                                              width / 4, height / 4);
+                    }
+                    break;
+                default:
+                    break;
+            }
         }
 
         void DrawBlurredRects(const GLfloat *vertTransformArray,
@@ -723,95 +1043,340 @@ void main() {
                                         width, height);
             DrawBlurredRects(vertTransformArray, texTransformArray, width, height);
         }
-    };
 
-    void InitFrameBuffer(GLuint *textureId, GLuint *fboId, GLsizei width, GLsizei height) {
-        CHECK_GL(glGenTextures(1, textureId));
-        CHECK_GL(glBindTexture(GL_TEXTURE_2D, *textureId));
-        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE,
-                              nullptr));
-        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
-
-        CHECK_GL(glGenFramebuffers(1, fboId));
-        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, *fboId));
-        CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                                        *textureId, 0));
-        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-    }
+        // Makes the context current on the calling thread, with the window surface if there is
+        // one.
+        void MakeCurrent() const {
+            EGLSurface surface = windowSurface.first ? windowSurface.second : bufferSurface;
+            eglMakeCurrent(display, surface, surface, context);
+        }
 
-    const char *ShaderTypeString(GLenum shaderType) {
-        switch (shaderType) {
-            case GL_VERTEX_SHADER:
-                return "GL_VERTEX_SHADER";
-            case GL_FRAGMENT_SHADER:
-                return "GL_FRAGMENT_SHADER";
-            default:
-                return "<Unknown shader type>";
+        // Of the window surface, or of the pbuffer standing in for it during a replay.
+        void GetSurfaceSize(GLsizei &width, GLsizei &height) const {
+            if (windowSurface.first) {
+                width = ANativeWindow_getWidth(windowSurface.first);
+                height = ANativeWindow_getHeight(windowSurface.first);
+                return;
+            }
+            EGLint surfaceWidth = 0;
+            EGLint surfaceHeight = 0;
+            eglQuerySurface(display, windowSurface.second, EGL_WIDTH, &surfaceWidth);
+            eglQuerySurface(display, windowSurface.second, EGL_HEIGHT, &surfaceHeight);
+            width = surfaceWidth;
+            height = surfaceHeight;
         }
-    }
 
-    // Returns a handle to the shader
-    GLuint CompileShader(GLenum shaderType, const char *shaderSrc) {
-        GLuint shader = CHECK_GL(glCreateShader(shaderType));
-        if (!shader) return 0;
-        CHECK_GL(glShaderSource(shader, 1, &shaderSrc, /*length=*/nullptr));
-        CHECK_GL(glCompileShader(shader));
-        GLint compileStatus = 0;
-        CHECK_GL(glGetShaderiv(shader, GL_COMPILE_STATUS, &compileStatus));
-        if (!compileStatus) {
-            GLint logLength = 0;
-            CHECK_GL(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength));
-            std::vector<char> logBuffer(logLength);
-            if (logLength > 0) {
-                CHECK_GL(glGetShaderInfoLog(shader, logLength, /*length=*/nullptr,
-                                            &logBuffer[0]));
+        // DrawFrame, recorded into frameTrace while tracing.
+        FrameResult RenderFrame(int64_t timestampNs,
+                                const GLfloat *vertTransformArray,
+                                const GLfloat *texTransformArray,
+                                GLfloat *rectsCoordinates,
+                                GLuint allRectsCount,
+                                GLuint otherRectsCount) {
+            if (!frameTrace.IsOpen()) {
+                return DrawFrame(timestampNs, vertTransformArray, texTransformArray,
+                                 rectsCoordinates, allRectsCount, otherRectsCount);
             }
-            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                                "Unable to compile %s shader:\n %s.",
-                                ShaderTypeString(shaderType),
-                                logLength > 0 ? &logBuffer[0] : "(unknown error)");
-            CHECK_GL(glDeleteShader(shader));
-            shader = 0;
+
+            const int64_t startNs = frameClock.NowNs();
+            const FrameResult result = DrawFrame(timestampNs,
+                                                 vertTransformArray, texTransformArray,
+                                                 rectsCoordinates,
+                                                 allRectsCount, otherRectsCount);
+            FrameTraceFrame frame{};
+            frame.timestampNs = timestampNs;
+            GetSurfaceSize(frame.width, frame.height);
+            std::copy_n(vertTransformArray, 16, frame.vertTransform);
+            std::copy_n(texTransformArray, 16, frame.texTransform);
+            frame.allRectsCount = rectsCoordinates ? allRectsCount : 0;
+            frame.otherRectsCount = rectsCoordinates ? otherRectsCount : 0;
+            frame.result = static_cast<uint32_t>(result);
+            frame.renderNs = frameClock.NowNs() - startNs;
+            frameTrace.AppendFrame(frame, rectsCoordinates);
+            return result;
+        }
+
+        [[nodiscard]] FrameTraceState GetTraceState() const {
+            const auto &blur = blurAnimation.Get();
+            const auto &color = contrastingColorAnimation.Get();
+            return {blurEnabled, blur[0], blur[1], {color[0], color[1], color[2]}};
+        }
+
+        void ApplyTraceState(const FrameTraceState &state) {
+            blurEnabled = state.blurEnabled ? GL_TRUE : GL_FALSE;
+            blurAnimation.Jump({state.lod, state.contrastingColorMix});
+            contrastingColorAnimation.Jump(
+                    {state.contrastingColor[0], state.contrastingColor[1],
+                     state.contrastingColor[2]});
+            outputDirty = true;
         }
-        return shader;
-    }
 
-    // Returns a handle to the output program
-    GLuint CreateGlProgram(const char *vertexShaderSrc, const char *fragmentShaderSrc) {
-        GLuint vertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSrc);
-        if (!vertexShader) return 0;
-
-        GLuint fragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
-        if (!fragmentShader) return 0;
-
-        GLuint program = CHECK_GL(glCreateProgram());
-        if (!program) return 0;
-
-        CHECK_GL(glAttachShader(program, vertexShader));
-        CHECK_GL(glAttachShader(program, fragmentShader));
-        CHECK_GL(glLinkProgram(program));
-        GLint linkStatus = 0;
-        CHECK_GL(glGetProgramiv(program, GL_LINK_STATUS, &linkStatus));
-        if (!linkStatus) {
-            GLint logLength = 0;
-            CHECK_GL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength));
-            std::vector<char> logBuffer(logLength);
-            if (logLength > 0) {
-                CHECK_GL(glGetProgramInfoLog(program, logLength, /*length=*/nullptr,
-                                             &logBuffer[0]));
+        // Appends what the replay surface holds after the frameIndex-th frame to output.
+        void CaptureReplayOutput(FrameTraceWriter &output, uint32_t frameIndex,
+                                 GLsizei width, GLsizei height) {
+            const size_t rowBytes = static_cast<size_t>(width) * 4;
+            replayPixels.resize(rowBytes * height * 2);
+            uint8_t *bottomUp = replayPixels.data() + rowBytes * height;
+            CHECK_GL(glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+            CHECK_GL(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, bottomUp));
+            for (GLsizei y = 0; y < height; ++y) {
+                std::copy_n(bottomUp + (height - 1 - y) * rowBytes, rowBytes,
+                            replayPixels.data() + y * rowBytes);
             }
-            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                                "Unable to link program:\n %s.",
-                                logLength > 0 ? &logBuffer[0] : "(unknown error)");
-            CHECK_GL(glDeleteProgram(program));
-            program = 0;
+            output.AppendImage({FrameTraceImageRole::OUTPUT, frameIndex, width, height},
+                               replayPixels.data());
         }
 
-        return program;
-    }
+        // Draws the frames of trace into an offscreen surface of the size of its first frame,
+        // recording them with their timings into output, along with the drawn pixels of each
+        // frame if captureOutputs. The camera texture keeps its last frame unless the trace
+        // stores one, sprites and labels are the current ones. Returns the number of frames
+        // replayed, -1 if the surface could not be created.
+        int ReplayFrameTrace(FrameTraceReader &trace, FrameTraceWriter &output,
+                             bool captureOutputs) {
+            FrameTraceReader::Record record{};
+            GLsizei width = 0;
+            GLsizei height = 0;
+            while (trace.Next(record)) {
+                if (record.type != FrameTraceRecordType::FRAME) continue;
+                width = record.frame.width;
+                height = record.frame.height;
+                break;
+            }
+            trace.Rewind();
+            if (width <= 0 || height <= 0) return 0;
+
+            EGLint pbufferAttribs[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+            EGLSurface pbuffer = eglCreatePbufferSurface(display, config, pbufferAttribs);
+            if (pbuffer == EGL_NO_SURFACE) return -1;
+
+            // Setters from the UI are applied once the replay is done.
+            const auto presentedSurface = windowSurface;
+            auto uiCommandQueue = std::move(commandQueue);
+            const GLuint cameraTextureId = inputTextureId;
+            windowSurface = std::make_pair(nullptr, pbuffer);
+            eglMakeCurrent(display, pbuffer, pbuffer, context);
+            swapDamage.Reset();
+            outputDirty = true;
+
+            int frames = 0;
+            while (trace.Next(record)) {
+                switch (record.type) {
+                    case FrameTraceRecordType::STATE:
+                        ApplyTraceState(record.state);
+                        output.AppendState(record.state);
+                        break;
+                    case FrameTraceRecordType::COMMAND: {
+                        RenderCommand command;
+                        command.type = static_cast<RenderCommand::Type>(record.command.type);
+                        command.enabled = record.command.enabled != 0;
+                        command.animated = record.command.animated != 0;
+                        command.red = record.command.color[0];
+                        command.green = record.command.color[1];
+                        command.blue = record.command.color[2];
+                        ApplyCommand(command, record.command.timestampNs);
+                        output.AppendCommand(record.command);
+                        break;
+                    }
+                    case FrameTraceRecordType::FRAME: {
+                        FrameTraceFrame frame = record.frame;
+                        // DrawFrame takes the rects as mutable.
+                        replayRects.assign(
+                                record.rects,
+                                record.rects +
+                                frame.allRectsCount * FRAME_TRACE_RECT_COMPONENTS);
+                        const int64_t startNs = frameClock.NowNs();
+                        const FrameResult result = DrawFrame(
+                                frame.timestampNs, frame.vertTransform, frame.texTransform,
+                                frame.allRectsCount ? replayRects.data() : nullptr,
+                                frame.allRectsCount, frame.otherRectsCount);
+                        frame.renderNs = frameClock.NowNs() - startNs;
+                        CHECK_GL(glFinish());
+                        frame.finishNs = frameClock.NowNs() - startNs;
+                        frame.result = static_cast<uint32_t>(result);
+                        GetSurfaceSize(frame.width, frame.height);
+                        output.AppendFrame(frame, record.rects);
+                        if (captureOutputs && result == FrameResult::DRAWN) {
+                            CaptureReplayOutput(output, static_cast<uint32_t>(frames),
+                                                frame.width, frame.height);
+                        }
+                        ++frames;
+                        break;
+                    }
+                    case FrameTraceRecordType::IMAGE:
+                        if (record.image.role != FrameTraceImageRole::CAMERA) break;
+                        if (!replayCamera.Upload(display, record.pixels,
+                                                 record.image.width, record.image.height)) {
+                            __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                                "Replaying with the last camera frame, the "
+                                                "stored one could not be uploaded.");
+                            break;
+                        }
+                        // The blur graph imports the camera texture when declared.
+                        inputTextureId = replayCamera.TextureId();
+                        blurGraphDeclared = false;
+                        outputDirty = true;
+                        output.AppendImage(record.image, record.pixels);
+                        break;
+                }
+            }
+
+            if (inputTextureId != cameraTextureId) {
+                inputTextureId = cameraTextureId;
+                blurGraphDeclared = false;
+            }
+            replayCamera.Release(display);
+            windowSurface = presentedSurface;
+            commandQueue = std::move(uiCommandQueue);
+            MakeCurrent();
+            eglDestroySurface(display, pbuffer);
+            swapDamage.Reset();
+            outputDirty = true;
+            return frames;
+        }
+
+        // Picks up the dominant color and snapshots the GPU finished reading back. Returns
+        // whether some are still in flight. Also polled between frames, as a frame which looks
+        // the same as the last one is never drawn and would leave them pending.
+        bool PollReadbacks() {
+            colorExtractor.Poll();
+            frameReadback.Poll();
+            return colorExtractor.IsReadbackPending() || frameReadback.IsCapturePending();
+        }
+
+        // Draws the camera frame captured at timestampNs with the blur, marker rects, sprites
+        // and labels into the window surface, unless it would look the same as the last one.
+        FrameResult DrawFrame(int64_t timestampNs,
+                              const GLfloat *vertTransformArray,
+                              const GLfloat *texTransformArray,
+                              GLfloat *rectsCoordinates,
+                              GLuint allRectsCount,
+                              GLuint otherRectsCount) {
+            ApplyCommands(timestampNs);
+            PollReadbacks();
+
+            GLsizei width = 0;
+            GLsizei height = 0;
+            GetSurfaceSize(width, height);
+
+            const bool animated = Animate(timestampNs);
+            DamageRect rectsDamage;
+            const FrameChange change = TrackFrameInputs(timestampNs,
+                                                        vertTransformArray, texTransformArray,
+                                                        rectsCoordinates,
+                                                        allRectsCount, otherRectsCount,
+                                                        width, height, rectsDamage);
+            const bool onlyRectsChanged =
+                    !outputDirty && !animated && change == FrameChange::RECTS &&
+                    frameReadback.RequestedLevel() == FrameReadback::NO_REQUEST;
+            if (!outputDirty && !animated && change == FrameChange::NONE &&
+                frameReadback.RequestedLevel() == FrameReadback::NO_REQUEST) {
+                return FrameResult::UNCHANGED;
+            }
+            // Rects which moved only off screen.
+            if (onlyRectsChanged && rectsDamage.IsEmpty()) return FrameResult::UNCHANGED;
+            outputDirty = false;
+
+            // The scissored fallback path of the stencil overwrites the scissor box.
+            const bool partial = onlyRectsChanged && rectStencil.IsInitialized();
+            windowRedraw = swapDamage.BeginFrame(display, windowSurface.second, width, height,
+                                                 partial ? &rectsDamage : nullptr);
+            CHECK_GL(glEnable(GL_SCISSOR_TEST));
+            ScissorWindowRedraw();
+
+            CHECK_GL(glEnable(GL_STENCIL_TEST));
+            CHECK_GL(glClear(GL_STENCIL_BUFFER_BIT));
+            CHECK_GL(glDisable(GL_STENCIL_TEST));
+
+            blurPyramidDrawn = false;
+
+            if (blurEnabled || IsAnimatingLod()) {
+                DrawBlur(vertTransformArray, texTransformArray, (GLfloat) width,
+                         (GLfloat) height);
+                CaptureRequestedSnapshot(blurPyramidFullyBlurred, width, height);
+            } else {
+                DrawNoBlur(vertTransformArray, texTransformArray, (GLfloat) width,
+                           (GLfloat) height, 0, 0, .0f);
+            }
+
+            if (allRectsCount > 0) {
+                const GLuint rectsCount = !blurEnabled || IsAnimatingLod()
+                                          ? allRectsCount : otherRectsCount;
+                DrawBlurredRects(vertTransformArray, texTransformArray,
+                                 rectsCoordinates, rectsCount,
+                                 (GLfloat) width, (GLfloat) height);
+            }
+
+            if (blurPyramidDrawn) {
+                CaptureRequestedSnapshot(false, width, height);
+                colorExtractor.Extract(blurGraph.TextureId(quarterBlurLevel));
+            }
+
+            spriteBatcher.Draw(width, height);
+            textBatcher.Draw(width, height);
+
+            // Check that all GL operations completed successfully. If not, log an error.
+            GLenum glError = glGetError();
+            if (glError != GL_NO_ERROR) {
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                    "Failed to draw frame due to OpenGL error: %s",
+                                    GLErrorString(glError).c_str());
+                outputDirty = true;
+                return FrameResult::FAILED;
+            }
+            return FrameResult::DRAWN;
+        }
+
+        bool SwapBuffers(int64_t presentationTimeNs) {
+            if (!outputFanout.IsEmpty()) {
+                GLsizei width = 0;
+                GLsizei height = 0;
+                GetSurfaceSize(width, height);
+                outputFanout.Present(display, context, windowSurface.second, width, height,
+                                     presentationTimeNs);
+            }
+// Only attempt to set presentation time if EGL_EGLEXT_PROTOTYPES is defined.
+// Otherwise, we'll ignore the timestamp.
+#ifdef EGL_EGLEXT_PROTOTYPES
+            eglPresentationTimeANDROID(display, windowSurface.second, presentationTimeNs);
+#endif  // EGL_EGLEXT_PROTOTYPES
+            EGLBoolean swapped = swapDamage.Swap(display, windowSurface.second);
+            if (!swapped) {
+                EGLenum eglError = eglGetError();
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                    "Failed to swap buffers with EGL error: %s",
+                                    EGLErrorString(eglError).c_str());
+                return false;
+            }
+            return true;
+        }
+
+        // Frame callback of the render loop - the native counterpart of
+        // OpenGLRenderer.renderLatest.
+        void DrawRenderLoopFrame(int64_t timestampNs, int64_t presentationTimeNs) {
+            if (!windowSurface.first || surfaceWidth == 0.f || previewWidth == 0.f) return;
+
+            GLfloat texTransform[16];
+            GLfloat vertTransform[16];
+            frameSource.GetTransformMatrix(texTransform);
+            CalculateSurfaceTransform(texTransform, previewWidth, previewHeight,
+                                      surfaceWidth, surfaceHeight, surfaceRotationDegrees,
+                                      vertTransform);
+            if (RenderFrame(timestampNs, vertTransform, texTransform, frameRects.data(),
+                            frameAllRectsCount, frameOtherRectsCount) != FrameResult::DRAWN ||
+                !SwapBuffers(presentationTimeNs)) {
+                return;
+            }
+
+            if (!renderLoopEnv) return;
+            renderLoopEnv->CallVoidMethod(renderer, onFrameRenderedMethod,
+                                          static_cast<jlong>(timestampNs));
+            if (renderLoopEnv->ExceptionCheck()) {
+                renderLoopEnv->ExceptionDescribe();
+                renderLoopEnv->ExceptionClear();
+            }
+        }
+    };
 
     void DestroySurface(NativeContext *nativeContext) {
         if (nativeContext->windowSurface.first) {
@@ -825,6 +1390,75 @@ void main() {
         }
     }
 
+    // Replaces the window surface (and the render targets sized after it) of the context.
+    bool SetWindowSurface(NativeContext *nativeContext, ANativeWindow *nativeWindow) {
+        nativeContext->outputDirty = true;
+        nativeContext->swapDamage.Reset();
+
+        // Destroy previously connected surface
+        DestroySurface(nativeContext);
+
+        // Null window may have just been passed in to destroy previous surface.
+        if (!nativeWindow) {
+            return false;
+        }
+
+        EGLSurface surface =
+                eglCreateWindowSurface(nativeContext->display, nativeContext->config,
+                                       nativeWindow, /*attrib_list=*/nullptr);
+        if (surface == EGL_NO_SURFACE) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to create window surface.");
+            return false;
+        }
+
+        nativeContext->windowSurface = std::make_pair(nativeWindow, surface);
+        eglMakeCurrent(nativeContext->display, surface, surface, nativeContext->context);
+
+        auto width = ANativeWindow_getWidth(nativeWindow);
+        auto height = ANativeWindow_getHeight(nativeWindow);
+        CHECK_GL(glViewport(0, 0, width, height));
+
+        nativeContext->blurPassPlanner.Reset(nativeContext->gpuTimer.IsSupported());
+        for (GLint level = 0; level < NativeContext::BLUR_LEVEL_COUNT; ++level) {
+            nativeContext->gpuCapabilities.SeedBlurLevel(
+                    nativeContext->blurPassPlanner, level,
+                    NativeContext::BlurLevelSize(width, level),
+                    NativeContext::BlurLevelSize(height, level));
+        }
+        nativeContext->blurLevelsSaved.fill(false);
+
+        glEnable(GL_SCISSOR_TEST);
+        CHECK_GL(glScissor(0, 0, width, height));
+
+        return true;
+    }
+
+    // Runs work which touches GL or state read by the frame being drawn on the thread owning
+    // the context: inline on the JVM executor, on the loop thread while the native render loop
+    // runs. JNIEnv must not be used inside work.
+    template<typename Work>
+    void RunOnGlThread(NativeContext *nativeContext, Work &&work) {
+        if (nativeContext->renderLoop) {
+            nativeContext->renderLoop->RunSync(work);
+        } else {
+            work();
+        }
+    }
+
+    // Joins the render loop thread and takes the context back to the calling thread.
+    void StopRenderLoop(JNIEnv *env, NativeContext *nativeContext) {
+        if (!nativeContext->renderLoop) return;
+
+        nativeContext->renderLoop->RunSync([nativeContext] {
+            nativeContext->frameSource.Release();
+        });
+        nativeContext->renderLoop->Stop();
+        nativeContext->renderLoop.reset();
+        env->DeleteGlobalRef(nativeContext->renderer);
+        nativeContext->renderer = nullptr;
+        nativeContext->MakeCurrent();
+    }
+
     void ThrowException(JNIEnv *env, const char *exceptionName, const char *msg) {
         jclass exClass = env->FindClass(exceptionName);
         assert(exClass != nullptr);
@@ -837,7 +1471,7 @@ void main() {
 extern "C" {
 JNIEXPORT jlong JNICALL
 Java_com_lookaround_core_android_camera_OpenGLRenderer_initContext(
-        JNIEnv *env, jobject clazz) {
+        JNIEnv *env, jobject clazz, jlong commandQueue, jstring jcapabilitiesCachePath) {
     EGLDisplay eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
     if (eglDisplay == EGL_NO_DISPLAY) {
         ThrowException(env, "java/lang/RuntimeException",
@@ -886,9 +1520,34 @@ Java_com_lookaround_core_android_camera_OpenGLRenderer_initContext(
         return 0;
     }
 
-    int contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
-    EGLContext eglContext = eglCreateContext(
-            eglDisplay, config, EGL_NO_CONTEXT, static_cast<EGLint *>(contextAttribs));
+    int contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3, EGL_NONE};
+    // Every renderer context joins the share group of the resources, which outlive it as long
+    // as another renderer holds them.
+    std::shared_ptr<SharedGlResources> sharedResources =
+            SharedGlResources::Acquire(eglDisplay, config, static_cast<EGLint *>(contextAttribs));
+    if (!sharedResources) {
+        ThrowException(env, "java/lang/RuntimeException",
+                       "EGL Error: creating shared context failed.");
+        return 0;
+    }
+    EGLContext shareContext = sharedResources->ShareContext();
+    EGLContext eglContext = EGL_NO_CONTEXT;
+    bool debugContext = false;
+#if LOOKAROUND_GL_CHECK != GL_CHECK_OFF
+    // A debug context reports every GL error through KHR_debug, see InitGlCheck.
+    if (HasEglExtension(eglDisplay, "EGL_KHR_create_context")) {
+        int debugContextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, 3,
+                                     EGL_CONTEXT_FLAGS_KHR, EGL_CONTEXT_OPENGL_DEBUG_BIT_KHR,
+                                     EGL_NONE};
+        eglContext = eglCreateContext(
+                eglDisplay, config, shareContext, static_cast<EGLint *>(debugContextAttribs));
+        debugContext = eglContext != EGL_NO_CONTEXT;
+    }
+#endif
+    if (eglContext == EGL_NO_CONTEXT) {
+        eglContext = eglCreateContext(
+                eglDisplay, config, shareContext, static_cast<EGLint *>(contextAttribs));
+    }
     if (eglContext == EGL_NO_CONTEXT) {
         ThrowException(env, "java/lang/RuntimeException",
                        "EGL Error: eglCreateContext failed.");
@@ -906,6 +1565,7 @@ Java_com_lookaround_core_android_camera_OpenGLRenderer_initContext(
     }
 
     eglMakeCurrent(eglDisplay, eglPbuffer, eglPbuffer, eglContext);
+    InitGlCheck(debugContext);
 
     //Print debug OpenGL information
     const GLubyte *glVendorString = CHECK_GL(glGetString(GL_VENDOR));
@@ -922,126 +1582,40 @@ Java_com_lookaround_core_android_camera_OpenGLRenderer_initContext(
     auto *nativeContext =
             new NativeContext(eglDisplay, config, eglContext, /*window=*/nullptr,
                     /*surface=*/nullptr, eglPbuffer);
+    nativeContext->commandQueue =
+            *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+    nativeContext->sharedResources = std::move(sharedResources);
 
-    nativeContext->programNoBlur = CreateGlProgram(VERTEX_SHADER_SRC_NO_BLUR,
-                                                   FRAGMENT_SHADER_SRC_NO_BLUR);
-    if (!nativeContext->programNoBlur) {
+    // The other variants are built when first drawn, the plain preview is the first.
+    if (!nativeContext->programsNoBlur.Get(0)) {
         ThrowException(env, "java/lang/RuntimeException",
                        "OGL Error: creating GL program failed.");
         return 0;
     }
 
-    nativeContext->positionHandleNoBlur =
-            CHECK_GL(glGetAttribLocation(nativeContext->programNoBlur, "position"));
-    assert(nativeContext->positionHandleNoBlur != -1);
-    nativeContext->samplerHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "sampler"));
-    assert(nativeContext->samplerHandleNoBlur != -1);
-    nativeContext->vertTransformHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "vertTransform"));
-    assert(nativeContext->vertTransformHandleNoBlur != -1);
-    nativeContext->texTransformHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "texTransform"));
-    assert(nativeContext->texTransformHandleNoBlur != -1);
-    nativeContext->widthHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "width"));
-    assert(nativeContext->widthHandleNoBlur != -1);
-    nativeContext->heightHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "height"));
-    assert(nativeContext->heightHandleNoBlur != -1);
-    nativeContext->xHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "x"));
-    assert(nativeContext->xHandleNoBlur != -1);
-    nativeContext->yHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "y"));
-    assert(nativeContext->yHandleNoBlur != -1);
-    nativeContext->cornerRadiusHandleNoBlur =
-            CHECK_GL(glGetUniformLocation(nativeContext->programNoBlur, "cornerRadius"));
-    assert(nativeContext->cornerRadiusHandleNoBlur != -1);
-
-    nativeContext->programVOES = CreateGlProgram(VERTEX_SHADER_SRC_TRANSFORM,
-                                                 FRAGMENT_SHADER_SRC_V_OES);
-    assert(nativeContext->programVOES);
-    nativeContext->positionHandleVOES =
-            CHECK_GL(glGetAttribLocation(nativeContext->programVOES, "position"));
-    assert(nativeContext->positionHandleVOES != -1);
-    nativeContext->samplerHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "sampler"));
-    assert(nativeContext->samplerHandleVOES != -1);
-    nativeContext->vertTransformHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "vertTransform"));
-    assert(nativeContext->vertTransformHandleVOES != -1);
-    nativeContext->heightHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "height"));
-    assert(nativeContext->heightHandleVOES != -1);
-    nativeContext->lodHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "lod"));
-    assert(nativeContext->lodHandleVOES != -1);
-    nativeContext->minLodHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "minLod"));
-    assert(nativeContext->minLodHandleVOES != -1);
-    nativeContext->contrastingColorHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "contrastingColor"));
-    assert(nativeContext->contrastingColorHandleVOES != -1);
-    nativeContext->contrastingColorMixHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "contrastingColorMix"));
-    assert(nativeContext->contrastingColorMixHandleVOES != -1);
-    nativeContext->texTransformHandleVOES =
-            CHECK_GL(glGetUniformLocation(nativeContext->programVOES, "texTransform"));
-    assert(nativeContext->texTransformHandleVOES != -1);
-
-    nativeContext->programH = CreateGlProgram(VERTEX_SHADER_SRC_NO_TRANSFORM,
-                                              FRAGMENT_SHADER_SRC_H);
-    assert(nativeContext->programH);
-    nativeContext->positionHandleH =
-            CHECK_GL(glGetAttribLocation(nativeContext->programH, "position"));
-    assert(nativeContext->positionHandleH != -1);
-    nativeContext->samplerHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "sampler"));
-    assert(nativeContext->samplerHandleH != -1);
-    nativeContext->widthHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "width"));
-    assert(nativeContext->widthHandleH != -1);
-    nativeContext->lodHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "lod"));
-    assert(nativeContext->lodHandleH != -1);
-    nativeContext->minLodHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "minLod"));
-    assert(nativeContext->minLodHandleH != -1);
-    nativeContext->contrastingColorHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "contrastingColor"));
-    assert(nativeContext->contrastingColorHandleH != -1);
-    nativeContext->contrastingColorMixHandleH =
-            CHECK_GL(glGetUniformLocation(nativeContext->programH, "contrastingColorMix"));
-    assert(nativeContext->contrastingColorMixHandleH != -1);
-
-    nativeContext->programV2D = CreateGlProgram(VERTEX_SHADER_SRC_NO_TRANSFORM,
-                                                FRAGMENT_SHADER_SRC_V_2D);
-    assert(nativeContext->programV2D);
-    nativeContext->positionHandleV2D =
-            CHECK_GL(glGetAttribLocation(nativeContext->programV2D, "position"));
-    assert(nativeContext->positionHandleV2D != -1);
-    nativeContext->samplerHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "sampler"));
-    assert(nativeContext->samplerHandleV2D != -1);
-    nativeContext->heightHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "height"));
-    assert(nativeContext->heightHandleV2D != -1);
-    nativeContext->lodHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "lod"));
-    assert(nativeContext->lodHandleV2D != -1);
-    nativeContext->minLodHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "minLod"));
-    assert(nativeContext->minLodHandleV2D != -1);
-    nativeContext->contrastingColorHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "contrastingColor"));
-    assert(nativeContext->contrastingColorHandleV2D != -1);
-    nativeContext->contrastingColorMixHandleV2D =
-            CHECK_GL(glGetUniformLocation(nativeContext->programV2D, "contrastingColorMix"));
-    assert(nativeContext->contrastingColorMixHandleV2D != -1);
-
     CHECK_GL(glGenTextures(1, &(nativeContext->inputTextureId)));
 
+    if (jcapabilitiesCachePath) {
+        const char *capabilitiesCachePath = env->GetStringUTFChars(jcapabilitiesCachePath,
+                                                                   nullptr);
+        nativeContext->gpuCapabilities.Init(eglDisplay, capabilitiesCachePath);
+        env->ReleaseStringUTFChars(jcapabilitiesCachePath, capabilitiesCachePath);
+    } else {
+        nativeContext->gpuCapabilities.Init(eglDisplay, {});
+    }
+    const auto &capabilities = nativeContext->gpuCapabilities.Get();
+    nativeContext->blurGraph.SetInvalidateTargets(capabilities.invalidateFramebuffer);
+
+    nativeContext->gpuTimer.Init(capabilities);
+    nativeContext->blurPassPlanner.Reset(nativeContext->gpuTimer.IsSupported());
+    nativeContext->colorExtractor.Init();
+    nativeContext->frameReadback.Init();
+    nativeContext->rectStencil.Init(*nativeContext->sharedResources);
+    nativeContext->spriteBatcher.Init(*nativeContext->sharedResources);
+    nativeContext->textBatcher.Init(*nativeContext->sharedResources);
+    nativeContext->swapDamage.Init(capabilities);
+    if (capabilities.computeShaders) nativeContext->satBlur.Init();
+
     return reinterpret_cast<jlong>(nativeContext);
 }
 
@@ -1050,69 +1624,54 @@ Java_com_lookaround_core_android_camera_OpenGLRenderer_setWindowSurface(
         JNIEnv *env, jobject clazz, jlong context, jobject jsurface) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
 
-    // Destroy previously connected surface
-    DestroySurface(nativeContext);
-
-    // Null surface may have just been passed in to destroy previous surface.
-    if (!jsurface) {
-        return JNI_FALSE;
+    ANativeWindow *nativeWindow = nullptr;
+    if (jsurface) {
+        nativeWindow = ANativeWindow_fromSurface(env, jsurface);
+        if (nativeWindow == nullptr) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to set window surface: "
+                                                            "Unable to acquire native window.");
+        }
     }
 
+    bool attached = false;
+    RunOnGlThread(nativeContext, [&] {
+        attached = SetWindowSurface(nativeContext, nativeWindow);
+    });
+    return attached ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_addMirrorSurface(
+        JNIEnv *env, jobject clazz, jlong context, jobject jsurface, jint maxFramesPerSecond) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
     ANativeWindow *nativeWindow = ANativeWindow_fromSurface(env, jsurface);
     if (nativeWindow == nullptr) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to set window surface: Unable to "
-                                                        "acquire native window.");
-        return JNI_FALSE;
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to add mirror surface: "
+                                                        "Unable to acquire native window.");
+        return -1;
     }
 
-    EGLSurface surface =
-            eglCreateWindowSurface(nativeContext->display, nativeContext->config,
-                                   nativeWindow, /*attrib_list=*/nullptr);
-    if (surface == EGL_NO_SURFACE) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to create window surface.");
-        return JNI_FALSE;
-    }
-
-    nativeContext->windowSurface = std::make_pair(nativeWindow, surface);
-    eglMakeCurrent(nativeContext->display, surface, surface, nativeContext->context);
-
-    auto width = ANativeWindow_getWidth(nativeWindow);
-    auto height = ANativeWindow_getHeight(nativeWindow);
-    CHECK_GL(glViewport(0, 0, width, height));
-
-    InitFrameBuffer(&(nativeContext->pass1TextureId),
-                    &(nativeContext->fbo1Id),
-                    width / 2,
-                    height / 2);
-    InitFrameBuffer(&(nativeContext->pass2TextureId),
-                    &(nativeContext->fbo2Id),
-                    width / 2,
-                    height / 2);
-    InitFrameBuffer(&(nativeContext->pass3TextureId),
-                    &(nativeContext->fbo3Id),
-                    width / 4,
-                    height / 4);
-    InitFrameBuffer(&(nativeContext->pass4TextureId),
-                    &(nativeContext->fbo4Id),
-                    width / 4,
-                    height / 4);
-    InitFrameBuffer(&(nativeContext->pass5TextureId),
-                    &(nativeContext->fbo5Id),
-                    width / 2,
-                    height / 2);
-    InitFrameBuffer(&(nativeContext->pass6TextureId),
-                    &(nativeContext->fbo6Id),
-                    width / 2,
-                    height / 2);
-    InitFrameBuffer(&(nativeContext->pass7TextureId),
-                    &(nativeContext->fbo7Id),
-                    width,
-                    height);
-
-    glEnable(GL_SCISSOR_TEST);
-    CHECK_GL(glScissor(0, 0, width, height));
+    const int64_t minFrameIntervalNs =
+            maxFramesPerSecond > 0 ? 1'000'000'000 / maxFramesPerSecond : 0;
+    int id = -1;
+    RunOnGlThread(nativeContext, [&] {
+        id = nativeContext->outputFanout.Add(nativeContext->display, nativeContext->config,
+                                             nativeWindow, minFrameIntervalNs);
+        // Draws the next frame even if it looks the same, so the new surface gets it.
+        nativeContext->outputDirty = true;
+    });
+    return id;
+}
 
-    return JNI_TRUE;
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_removeMirrorSurface(
+        JNIEnv *env, jobject clazz, jlong context, jint id) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    bool removed = false;
+    RunOnGlThread(nativeContext, [&] {
+        removed = nativeContext->outputFanout.Remove(nativeContext->display, id);
+    });
+    return removed ? JNI_TRUE : JNI_FALSE;
 }
 
 JNIEXPORT jint JNICALL
@@ -1128,148 +1687,515 @@ Java_com_lookaround_core_android_camera_OpenGLRenderer_renderTexture(
         jfloatArray jvertTransformArray, jfloatArray jtexTransformArray,
         jfloatArray jrectsCoordinates, jint jallRectsCount, jint jotherRectsCount) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
-    auto nativeWindow = nativeContext->windowSurface.first;
 
     GLfloat *vertTransformArray = env->GetFloatArrayElements(jvertTransformArray, nullptr);
     GLfloat *texTransformArray = env->GetFloatArrayElements(jtexTransformArray, nullptr);
-
-    auto width = ANativeWindow_getWidth(nativeWindow);
-    auto height = ANativeWindow_getHeight(nativeWindow);
-    CHECK_GL(glScissor(0, 0, width, height));
-
-    CHECK_GL(glEnable(GL_STENCIL_TEST));
-    CHECK_GL(glClear(GL_STENCIL_BUFFER_BIT));
-    CHECK_GL(glDisable(GL_STENCIL_TEST));
-
-    if (nativeContext->blurEnabled || nativeContext->IsAnimatingLod()) {
-        if (nativeContext->IsAnimatingLod()) nativeContext->AnimateLod();
-        nativeContext->DrawBlur(vertTransformArray, texTransformArray, (GLfloat) width,
-                                (GLfloat) height);
-    } else {
-        nativeContext->DrawNoBlur(vertTransformArray, texTransformArray, (GLfloat) width,
-                                  (GLfloat) height, 0, 0, .0f);
-    }
-
     GLfloat *rectsCoordinates =
             jallRectsCount == 0
             ? nullptr
             : env->GetFloatArrayElements(jrectsCoordinates, nullptr);
-    if (rectsCoordinates != nullptr) {
-        if (nativeContext->IsAnimatingContrastingColor()) {
-            nativeContext->AnimateContrastingColor();
-        }
 
-        const GLuint rectsCount = !nativeContext->blurEnabled ||
-                                  nativeContext->IsAnimatingLod()
-                                  ? jallRectsCount : jotherRectsCount;
-        nativeContext->DrawBlurredRects(vertTransformArray, texTransformArray,
-                                        rectsCoordinates, rectsCount,
-                                        (GLfloat) width, (GLfloat) height);
-        env->ReleaseFloatArrayElements(jrectsCoordinates, rectsCoordinates,
-                                       JNI_ABORT);
-    }
+    auto result = nativeContext->RenderFrame(timestampNs,
+                                             vertTransformArray, texTransformArray,
+                                             rectsCoordinates,
+                                             static_cast<GLuint>(jallRectsCount),
+                                             static_cast<GLuint>(jotherRectsCount));
 
+    if (rectsCoordinates != nullptr) {
+        env->ReleaseFloatArrayElements(jrectsCoordinates, rectsCoordinates, JNI_ABORT);
+    }
     env->ReleaseFloatArrayElements(jvertTransformArray, vertTransformArray, JNI_ABORT);
     env->ReleaseFloatArrayElements(jtexTransformArray, texTransformArray, JNI_ABORT);
 
-    // Check that all GL operations completed successfully. If not, log an error and return.
-    GLenum glError = glGetError();
-    if (glError != GL_NO_ERROR) {
-        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                            "Failed to draw frame due to OpenGL error: %s",
-                            GLErrorString(glError).c_str());
-        return JNI_FALSE;
+    // Skipping the swap of an unchanged frame leaves the last one on screen.
+    if (result != NativeContext::FrameResult::DRAWN) return JNI_FALSE;
+    return nativeContext->SwapBuffers(timestampNs) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setRenderLoopInput(
+        JNIEnv *env, jobject jrenderer, jlong context, jobject jsurfaceTexture,
+        jint previewWidth, jint previewHeight) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (!jsurfaceTexture) {
+        RunOnGlThread(nativeContext, [&] {
+            nativeContext->frameSource.Release();
+            nativeContext->previewWidth = 0.f;
+            nativeContext->previewHeight = 0.f;
+        });
+        return JNI_TRUE;
     }
 
-// Only attempt to set presentation time if EGL_EGLEXT_PROTOTYPES is defined.
-// Otherwise, we'll ignore the timestamp.
-#ifdef EGL_EGLEXT_PROTOTYPES
-    eglPresentationTimeANDROID(nativeContext->display,
-                               nativeContext->windowSurface.second, timestampNs);
-#endif  // EGL_EGLEXT_PROTOTYPES
-    EGLBoolean swapped = eglSwapBuffers(nativeContext->display,
-                                        nativeContext->windowSurface.second);
-    if (!swapped) {
-        EGLenum eglError = eglGetError();
+    ASurfaceTexture *surfaceTexture = ASurfaceTexture_fromSurfaceTexture(env, jsurfaceTexture);
+    if (!surfaceTexture) {
         __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
-                            "Failed to swap buffers with EGL error: %s",
-                            EGLErrorString(eglError).c_str());
+                            "Failed to set render loop input: Unable to acquire SurfaceTexture.");
         return JNI_FALSE;
     }
 
+    if (!nativeContext->renderLoop) {
+        jclass rendererClass = env->GetObjectClass(jrenderer);
+        nativeContext->onFrameRenderedMethod =
+                env->GetMethodID(rendererClass, "onNativeFrameRendered", "(J)V");
+        env->DeleteLocalRef(rendererClass);
+        env->GetJavaVM(&nativeContext->javaVm);
+        nativeContext->renderer = env->NewGlobalRef(jrenderer);
+
+        RenderLoop::Callbacks callbacks;
+        callbacks.onStart = [nativeContext] {
+            JavaVMAttachArgs attachArgs{JNI_VERSION_1_6, "GLRenderLoop", nullptr};
+            nativeContext->javaVm->AttachCurrentThread(&nativeContext->renderLoopEnv,
+                                                       &attachArgs);
+            nativeContext->MakeCurrent();
+        };
+        callbacks.onStop = [nativeContext] {
+            eglMakeCurrent(nativeContext->display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                           EGL_NO_CONTEXT);
+            nativeContext->javaVm->DetachCurrentThread();
+            nativeContext->renderLoopEnv = nullptr;
+        };
+        callbacks.onFrame = [nativeContext](int64_t timestampNs, int64_t presentationTimeNs) {
+            nativeContext->DrawRenderLoopFrame(timestampNs, presentationTimeNs);
+        };
+        nativeContext->renderLoop = std::make_unique<RenderLoop>(
+                nativeContext->frameSource, nativeContext->frameClock, std::move(callbacks));
+
+        // A context is current on at most one thread - hand it over to the loop.
+        eglMakeCurrent(nativeContext->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        nativeContext->renderLoop->Start();
+    }
+
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->frameSource.Reset(surfaceTexture);
+        nativeContext->previewWidth = static_cast<GLfloat>(previewWidth);
+        nativeContext->previewHeight = static_cast<GLfloat>(previewHeight);
+        nativeContext->renderLoop->ResetSchedule();
+    });
     return JNI_TRUE;
 }
 
 JNIEXPORT void JNICALL
-Java_com_lookaround_core_android_camera_OpenGLRenderer_setBlurEnabled(
-        JNIEnv *env, jobject clazz, jlong context, jboolean enabled, jboolean animated) {
+Java_com_lookaround_core_android_camera_OpenGLRenderer_notifyFrameAvailable(
+        JNIEnv *env, jobject clazz, jlong context) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
-    if (nativeContext->blurEnabled == enabled) return;
+    if (nativeContext->renderLoop) nativeContext->renderLoop->OnFrameAvailable();
+}
 
-    nativeContext->blurEnabled = enabled;
-    if (enabled && nativeContext->currentBlurAnimationFrame == -1) {
-        if (animated) {
-            nativeContext->currentBlurAnimationFrame = 0;
-        } else {
-            nativeContext->currentBlurAnimationFrame = NativeContext::BLUR_ANIMATION_FRAMES;
-            nativeContext->lod = NativeContext::MAX_LOD;
-            nativeContext->contrastingColorMix = NativeContext::MIN_CONTRASTING_COLOR_MIX;
-        }
-    } else if (!enabled &&
-               nativeContext->currentBlurAnimationFrame == NativeContext::BLUR_ANIMATION_FRAMES) {
-        if (animated) {
-            nativeContext->currentBlurAnimationFrame = NativeContext::BLUR_ANIMATION_FRAMES - 1;
-        } else {
-            nativeContext->currentBlurAnimationFrame = -1;
-            nativeContext->lod = NativeContext::MIN_LOD;
-            nativeContext->contrastingColorMix = NativeContext::MAX_CONTRASTING_COLOR_MIX;
-        }
-    }
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setRenderLoopSurface(
+        JNIEnv *env, jobject clazz, jlong context, jint width, jint height,
+        jint rotationDegrees) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->surfaceWidth = static_cast<GLfloat>(width);
+        nativeContext->surfaceHeight = static_cast<GLfloat>(height);
+        nativeContext->surfaceRotationDegrees = rotationDegrees;
+        nativeContext->outputDirty = true;
+    });
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setRenderLoopRects(
+        JNIEnv *env, jobject clazz, jlong context, jfloatArray jrectsCoordinates,
+        jint jallRectsCount, jint jotherRectsCount) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const jsize coordinatesCount = env->GetArrayLength(jrectsCoordinates);
+    GLfloat *rectsCoordinates = env->GetFloatArrayElements(jrectsCoordinates, nullptr);
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->frameRects.assign(rectsCoordinates, rectsCoordinates + coordinatesCount);
+        nativeContext->frameAllRectsCount = static_cast<GLuint>(jallRectsCount);
+        nativeContext->frameOtherRectsCount = static_cast<GLuint>(jotherRectsCount);
+    });
+    env->ReleaseFloatArrayElements(jrectsCoordinates, rectsCoordinates, JNI_ABORT);
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_createCommandQueue(
+        JNIEnv *env, jobject clazz) {
+    return reinterpret_cast<jlong>(
+            new std::shared_ptr<RenderCommandQueue>(std::make_shared<RenderCommandQueue>()));
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_shareCommandQueue(
+        JNIEnv *env, jobject clazz, jlong commandQueue) {
+    return reinterpret_cast<jlong>(new std::shared_ptr<RenderCommandQueue>(
+            *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue)));
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_releaseCommandQueue(
+        JNIEnv *env, jobject clazz, jlong commandQueue) {
+    delete reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setBlurEnabled(
+        JNIEnv *env, jobject clazz, jlong commandQueue, jboolean enabled, jboolean animated) {
+    RenderCommand command;
+    command.type = RenderCommand::Type::SET_BLUR_ENABLED;
+    command.enabled = enabled;
+    command.animated = animated;
+    auto &queue = *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+    queue->Push(command);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setSatBlurEnabled(
+        JNIEnv *env, jobject clazz, jlong commandQueue, jboolean enabled) {
+    RenderCommand command;
+    command.type = RenderCommand::Type::SET_SAT_BLUR_ENABLED;
+    command.enabled = enabled;
+    auto &queue = *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+    queue->Push(command);
 }
 
 JNIEXPORT void JNICALL
 Java_com_lookaround_core_android_camera_OpenGLRenderer_setContrastingColor(
-        JNIEnv *env, jobject clazz, jlong context,
+        JNIEnv *env, jobject clazz, jlong commandQueue,
         jfloat red, jfloat green, jfloat blue) {
+    RenderCommand command;
+    command.type = RenderCommand::Type::SET_CONTRASTING_COLOR;
+    command.red = red;
+    command.green = green;
+    command.blue = blue;
+    auto &queue = *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+    queue->Push(command);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_getDominantColor(
+        JNIEnv *env, jobject clazz, jlong context) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
-    nativeContext->targetContrastingRed = red;
-    nativeContext->targetContrastingGreen = green;
-    nativeContext->targetContrastingBlue = blue;
-    if (nativeContext->contrastingRed == -1.f
-        && nativeContext->contrastingGreen == -1.f
-        && nativeContext->contrastingBlue == -1.f) {
-        nativeContext->contrastingRed = red;
-        nativeContext->contrastingGreen = green;
-        nativeContext->contrastingBlue = blue;
-    } else {
-        nativeContext->currentContrastingColorAnimationFrame = 0;
+    uint32_t dominantColor = 0;
+    RunOnGlThread(nativeContext, [&] {
+        dominantColor = nativeContext->colorExtractor.TakeDominantColor();
+    });
+    return static_cast<jint>(dominantColor);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_pollReadbacks(
+        JNIEnv *env, jobject clazz, jlong context) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    bool pending = false;
+    RunOnGlThread(nativeContext, [&] { pending = nativeContext->PollReadbacks(); });
+    return pending ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_requestBlurredSnapshot(
+        JNIEnv *env, jobject clazz, jlong context, jint level) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (level < NativeContext::SNAPSHOT_LEVEL_FULL ||
+        level > NativeContext::SNAPSHOT_LEVEL_QUARTER) {
+        ThrowException(env, "java/lang/IllegalArgumentException",
+                       "Unknown blurred snapshot level.");
+        return;
     }
+    RunOnGlThread(nativeContext, [&] { nativeContext->frameReadback.Request(level); });
+}
+
+JNIEXPORT jobject JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_acquireBlurredSnapshot(
+        JNIEnv *env, jobject clazz, jlong context, jintArray jsize) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    GLsizei width = 0;
+    GLsizei height = 0;
+    const uint8_t *pixels = nullptr;
+    RunOnGlThread(nativeContext, [&] {
+        pixels = nativeContext->frameReadback.AcquireSnapshot(&width, &height);
+    });
+    if (!pixels) return nullptr;
+
+    const jint size[] = {width, height};
+    env->SetIntArrayRegion(jsize, 0, 2, size);
+    // The buffer is read-only for Kotlin - it points straight into the mapped PBO.
+    return env->NewDirectByteBuffer(const_cast<uint8_t *>(pixels),
+                                    static_cast<jlong>(width) * height * 4);
 }
 
 JNIEXPORT void JNICALL
-Java_com_lookaround_core_android_camera_OpenGLRenderer_closeContext(
+Java_com_lookaround_core_android_camera_OpenGLRenderer_releaseBlurredSnapshot(
         JNIEnv *env, jobject clazz, jlong context) {
     auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    RunOnGlThread(nativeContext, [&] { nativeContext->frameReadback.ReleaseSnapshot(); });
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_loadSpriteAtlas(
+        JNIEnv *env, jobject clazz, jlong context, jobjectArray jicons) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const jsize iconsCount = env->GetArrayLength(jicons);
+    std::vector<jobject> bitmaps;
+    std::vector<SpriteBatcher::Icon> icons;
+    bitmaps.reserve(iconsCount);
+    icons.reserve(iconsCount);
+
+    bool locked = true;
+    for (jsize i = 0; i < iconsCount; ++i) {
+        jobject bitmap = env->GetObjectArrayElement(jicons, i);
+        AndroidBitmapInfo info;
+        void *pixels = nullptr;
+        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+            info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+            AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Sprite icon %d is not a lockable ARGB_8888 bitmap.", i);
+            env->DeleteLocalRef(bitmap);
+            locked = false;
+            break;
+        }
+        bitmaps.push_back(bitmap);
+        icons.push_back({static_cast<const uint8_t *>(pixels),
+                         static_cast<GLsizei>(info.width),
+                         static_cast<GLsizei>(info.height),
+                         static_cast<GLsizei>(info.stride)});
+    }
+
+    bool loaded = false;
+    if (locked) {
+        RunOnGlThread(nativeContext, [&] {
+            loaded = nativeContext->spriteBatcher.LoadAtlas(icons);
+            nativeContext->outputDirty = true;
+        });
+    }
+    for (auto bitmap: bitmaps) {
+        AndroidBitmap_unlockPixels(env, bitmap);
+        env->DeleteLocalRef(bitmap);
+    }
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setSprites(
+        JNIEnv *env, jobject clazz, jlong context, jfloatArray jsprites, jint jspritesCount) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (jspritesCount <= 0) {
+        RunOnGlThread(nativeContext, [&] {
+            nativeContext->spriteBatcher.SetSprites(nullptr, 0);
+            nativeContext->outputDirty = true;
+        });
+        return;
+    }
+
+    GLfloat *sprites = env->GetFloatArrayElements(jsprites, nullptr);
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->spriteBatcher.SetSprites(sprites, static_cast<size_t>(jspritesCount));
+        nativeContext->outputDirty = true;
+    });
+    env->ReleaseFloatArrayElements(jsprites, sprites, JNI_ABORT);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_loadGlyphAtlas(
+        JNIEnv *env, jobject clazz, jlong context, jstring jcachePath, jfloat rasterSize) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const char *cachePath = env->GetStringUTFChars(jcachePath, nullptr);
+    SdfGlyphAtlas atlas;
+    bool loaded = atlas.Load(cachePath, rasterSize);
+    env->ReleaseStringUTFChars(jcachePath, cachePath);
+    if (loaded) {
+        RunOnGlThread(nativeContext, [&] {
+            loaded = nativeContext->textBatcher.LoadAtlas(std::move(atlas));
+            nativeContext->outputDirty = true;
+        });
+    }
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_buildGlyphAtlas(
+        JNIEnv *env, jobject clazz, jlong context, jstring jcachePath, jfloat rasterSize,
+        jintArray jcodepoints, jfloatArray jmetrics, jobjectArray jglyphs) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const jsize glyphsCount = env->GetArrayLength(jglyphs);
+    if (env->GetArrayLength(jcodepoints) != glyphsCount ||
+        env->GetArrayLength(jmetrics) != glyphsCount * 3) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Glyph arrays sizes do not match.");
+        return JNI_FALSE;
+    }
+
+    jint *codepoints = env->GetIntArrayElements(jcodepoints, nullptr);
+    GLfloat *metrics = env->GetFloatArrayElements(jmetrics, nullptr);
+    std::vector<jobject> bitmaps;
+    std::vector<SdfGlyphAtlas::GlyphBitmap> glyphs;
+    bitmaps.reserve(glyphsCount);
+    glyphs.reserve(glyphsCount);
+
+    bool locked = true;
+    for (jsize i = 0; i < glyphsCount; ++i) {
+        jobject bitmap = env->GetObjectArrayElement(jglyphs, i);
+        AndroidBitmapInfo info;
+        void *pixels = nullptr;
+        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+            info.format != ANDROID_BITMAP_FORMAT_A_8 ||
+            AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Glyph %d is not a lockable ALPHA_8 bitmap.", i);
+            env->DeleteLocalRef(bitmap);
+            locked = false;
+            break;
+        }
+        bitmaps.push_back(bitmap);
+        glyphs.push_back({static_cast<uint32_t>(codepoints[i]),
+                          static_cast<const uint8_t *>(pixels),
+                          static_cast<GLsizei>(info.width),
+                          static_cast<GLsizei>(info.height),
+                          static_cast<GLsizei>(info.stride),
+                          metrics[i * 3],
+                          metrics[i * 3 + 1],
+                          metrics[i * 3 + 2]});
+    }
+
+    SdfGlyphAtlas atlas;
+    bool built = locked && atlas.Build(glyphs, rasterSize);
+    for (auto bitmap: bitmaps) {
+        AndroidBitmap_unlockPixels(env, bitmap);
+        env->DeleteLocalRef(bitmap);
+    }
+    env->ReleaseIntArrayElements(jcodepoints, codepoints, JNI_ABORT);
+    env->ReleaseFloatArrayElements(jmetrics, metrics, JNI_ABORT);
+    if (!built) return JNI_FALSE;
+
+    const char *cachePath = env->GetStringUTFChars(jcachePath, nullptr);
+    atlas.Save(cachePath);
+    env->ReleaseStringUTFChars(jcachePath, cachePath);
+    bool loaded = false;
+    RunOnGlThread(nativeContext, [&] {
+        loaded = nativeContext->textBatcher.LoadAtlas(std::move(atlas));
+        nativeContext->outputDirty = true;
+    });
+    return loaded ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setLabelTexts(
+        JNIEnv *env, jobject clazz, jlong context, jobjectArray jtexts) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const jsize textsCount = env->GetArrayLength(jtexts);
+    std::vector<std::string> texts;
+    texts.reserve(textsCount);
+    for (jsize i = 0; i < textsCount; ++i) {
+        auto jtext = static_cast<jstring>(env->GetObjectArrayElement(jtexts, i));
+        // Modified UTF-8 only differs for codepoints outside of the BMP, which the atlas skips.
+        const char *text = env->GetStringUTFChars(jtext, nullptr);
+        texts.emplace_back(text);
+        env->ReleaseStringUTFChars(jtext, text);
+        env->DeleteLocalRef(jtext);
+    }
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->textBatcher.SetTexts(std::move(texts));
+        nativeContext->outputDirty = true;
+    });
+}
 
-    if (nativeContext->programVOES) {
-        CHECK_GL(glDeleteProgram(nativeContext->programVOES));
-        nativeContext->programVOES = 0;
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_setLabels(
+        JNIEnv *env, jobject clazz, jlong context, jfloatArray jlabels, jint jlabelsCount) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    if (jlabelsCount <= 0) {
+        RunOnGlThread(nativeContext, [&] {
+            nativeContext->textBatcher.SetLabels(nullptr, 0);
+            nativeContext->outputDirty = true;
+        });
+        return;
     }
 
-    if (nativeContext->programH) {
-        CHECK_GL(glDeleteProgram(nativeContext->programH));
-        nativeContext->programH = 0;
+    GLfloat *labels = env->GetFloatArrayElements(jlabels, nullptr);
+    RunOnGlThread(nativeContext, [&] {
+        nativeContext->textBatcher.SetLabels(labels, static_cast<size_t>(jlabelsCount));
+        nativeContext->outputDirty = true;
+    });
+    env->ReleaseFloatArrayElements(jlabels, labels, JNI_ABORT);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_startFrameTrace(
+        JNIEnv *env, jobject clazz, jlong context, jstring jpath, jlong maxBytes) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const char *path = env->GetStringUTFChars(jpath, nullptr);
+    bool started = false;
+    RunOnGlThread(nativeContext, [&] {
+        started = nativeContext->frameTrace.Open(path, static_cast<size_t>(maxBytes));
+        if (started) nativeContext->frameTrace.AppendState(nativeContext->GetTraceState());
+    });
+    if (!started) {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to start frame trace at %s.",
+                            path);
     }
+    env->ReleaseStringUTFChars(jpath, path);
+    return started ? JNI_TRUE : JNI_FALSE;
+}
 
-    if (nativeContext->programV2D) {
-        CHECK_GL(glDeleteProgram(nativeContext->programV2D));
-        nativeContext->programV2D = 0;
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_stopFrameTrace(
+        JNIEnv *env, jobject clazz, jlong context) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    RunOnGlThread(nativeContext, [&] {
+        if (nativeContext->frameTrace.DroppedRecords() > 0) {
+            __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                "Frame trace full, %zu records dropped.",
+                                nativeContext->frameTrace.DroppedRecords());
+        }
+        nativeContext->frameTrace.Close();
+    });
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_replayFrameTrace(
+        JNIEnv *env, jobject clazz, jlong context, jstring jtracePath, jstring joutputPath,
+        jlong maxOutputBytes, jboolean captureOutputs) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    const char *tracePath = env->GetStringUTFChars(jtracePath, nullptr);
+    const char *outputPath = env->GetStringUTFChars(joutputPath, nullptr);
+    FrameTraceReader trace;
+    FrameTraceWriter output;
+    int frames = -1;
+    if (trace.Open(tracePath) &&
+        output.Open(outputPath, static_cast<size_t>(maxOutputBytes))) {
+        RunOnGlThread(nativeContext, [&] {
+            frames = nativeContext->ReplayFrameTrace(trace, output, captureOutputs);
+        });
+    } else {
+        __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to replay frame trace %s to %s.",
+                            tracePath, outputPath);
     }
+    env->ReleaseStringUTFChars(joutputPath, outputPath);
+    env->ReleaseStringUTFChars(jtracePath, tracePath);
+    return frames;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_OpenGLRenderer_closeContext(
+        JNIEnv *env, jobject clazz, jlong context) {
+    auto *nativeContext = reinterpret_cast<NativeContext *>(context);
+    StopRenderLoop(env, nativeContext);
+    nativeContext->frameTrace.Close();
+
+    nativeContext->programsNoBlur.Release();
+    nativeContext->programsVOES.Release();
+    nativeContext->programsH.Release();
+    nativeContext->programsV2D.Release();
+    nativeContext->programsFused.Release();
+    nativeContext->blurGraph.Release();
+    nativeContext->satBlur.Release();
+
+    nativeContext->gpuTimer.Release();
+    nativeContext->colorExtractor.Release();
+    nativeContext->frameReadback.Release();
+    nativeContext->rectStencil.Release();
+    nativeContext->spriteBatcher.Release();
+    nativeContext->textBatcher.Release();
+    nativeContext->outputFanout.Release(nativeContext->display);
+    // Deletes the shared objects if this is the last renderer, while its context is current.
+    nativeContext->sharedResources.reset();
 
     DestroySurface(nativeContext);
     eglDestroySurface(nativeContext->display, nativeContext->bufferSurface);
     eglMakeCurrent(nativeContext->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
     eglDestroyContext(nativeContext->display, nativeContext->context);
+    // Reference counted by Android's EGL, other renderers keep the display initialized.
     eglTerminate(nativeContext->display);
 
     delete nativeContext;
@@ -0,0 +1,94 @@
+#include "poi_projector.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "simd_float4.h"
+
+namespace lookaround {
+    namespace {
+        // Same approximation as Math3D.
+        constexpr double METERS_IN_A_DEGREE = 111111.0;
+        constexpr size_t LANES = 4;
+
+        size_t PaddedCount(size_t count) { return (count + LANES - 1) / LANES * LANES; }
+    }  // namespace
+
+    void PoiProjector::SetPois(const double *latitudes,
+                               const double *longitudes,
+                               const double *altitudes,
+                               size_t newCount) {
+        count = newCount;
+        originLatitude = count ? latitudes[0] : 0.;
+        originLongitude = count ? longitudes[0] : 0.;
+        originAltitude = count ? altitudes[0] : 0.;
+
+        // Padding lanes sit at the origin, they are projected but never copied out.
+        const size_t padded = PaddedCount(count);
+        x.assign(padded, 0.f);
+        y.assign(padded, 0.f);
+        z.assign(padded, 0.f);
+        screenX.assign(padded, 0.f);
+        screenY.assign(padded, 0.f);
+        for (size_t i = 0; i < count; ++i) {
+            x[i] = static_cast<float>((longitudes[i] - originLongitude) * METERS_IN_A_DEGREE);
+            y[i] = static_cast<float>(altitudes[i] - originAltitude);
+            z[i] = static_cast<float>((latitudes[i] - originLatitude) * METERS_IN_A_DEGREE);
+        }
+    }
+
+    size_t PoiProjector::Project(const Pose &pose) {
+        if (count == 0) return 0;
+
+        // Camera relative to the origin, in double so it survives large offsets.
+        const Float4 cameraX = Splat4(
+                static_cast<float>((pose.longitude - originLongitude) * METERS_IN_A_DEGREE));
+        const Float4 cameraY = Splat4(static_cast<float>(pose.altitude - originAltitude));
+        const Float4 cameraZ = Splat4(
+                static_cast<float>((pose.latitude - originLatitude) * METERS_IN_A_DEGREE));
+        const Float4 xSin = Splat4(pose.xSin);
+        const Float4 xCos = Splat4(pose.xCos);
+        const Float4 ySin = Splat4(pose.ySin);
+        const Float4 yCos = Splat4(pose.yCos);
+        const Float4 rotationSin = Splat4(pose.screenRotationSin);
+        const Float4 rotationCos = Splat4(pose.screenRotationCos);
+        // Math3D uses a square screen ratio of the mean of both sides and a screen depth of 1.
+        const Float4 screenRatio = Splat4((pose.viewWidth + pose.viewHeight) / 2.f);
+        const Float4 halfWidth = Splat4(pose.viewWidth / 2.f);
+        const Float4 halfHeight = Splat4(pose.viewHeight / 2.f);
+        const Float4 minX = Splat4(-pose.viewWidth);
+        const Float4 maxX = Splat4(pose.viewWidth * 2.f);
+        const Float4 zero = Splat4(0.f);
+        const Float4 culled = Splat4(std::numeric_limits<float>::quiet_NaN());
+
+        for (size_t i = 0; i < x.size(); i += LANES) {
+            const Float4 relativeX = cameraX - Load4(&x[i]);
+            const Float4 relativeY = cameraY - Load4(&y[i]);
+            const Float4 relativeZ = cameraZ - Load4(&z[i]);
+
+            // Math3D.getRelativeRotation with a camera z angle of 0.
+            const Float4 rotatedX = yCos * relativeX - ySin * relativeZ;
+            const Float4 heading = yCos * relativeZ + ySin * relativeX;
+            const Float4 rotatedY = xSin * heading + xCos * relativeY;
+            const Float4 rotatedZ = xCos * heading - xSin * relativeY;
+
+            // Math3D.convert3dTo2d. Lanes behind the camera divide by <= 0 and are culled below.
+            const Float4 viewPortX = rotatedX * screenRatio / rotatedZ;
+            const Float4 viewPortY = rotatedY * screenRatio / rotatedZ;
+            const Float4 projectedX =
+                    halfWidth + viewPortX * rotationCos - viewPortY * rotationSin;
+            const Float4 projectedY =
+                    halfHeight + viewPortY * rotationCos + viewPortX * rotationSin;
+
+            const Float4 visible = And4(Greater4(rotatedZ, zero),
+                                        And4(GreaterEqual4(projectedX, minX),
+                                             LessEqual4(projectedX, maxX)));
+            Store4(&screenX[i], Select4(visible, projectedX, culled));
+            Store4(&screenY[i], Select4(visible, projectedY, culled));
+        }
+
+        return std::count_if(screenX.begin(), screenX.begin() + count,
+                             [](float value) { return !std::isnan(value); });
+    }
+}  // namespace lookaround
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace lookaround {
+    // Projects POIs to screen positions in batches. Positions are kept as float meters relative
+    // to an origin near the POIs (struct of arrays, padded to whole SIMD vectors), so each frame
+    // only needs a few vector multiply-adds per 4 POIs. Mirrors Math3D on the Kotlin side.
+    class PoiProjector {
+    public:
+        // Camera pose for one frame. Trigonometric values are those of Math3D.getCamRotation:
+        // pitch (x) and heading (y) of the camera and the screen rotation.
+        struct Pose {
+            double latitude;
+            double longitude;
+            double altitude;
+            float xSin, xCos;
+            float ySin, yCos;
+            float screenRotationSin, screenRotationCos;
+            float viewWidth;
+            float viewHeight;
+        };
+
+        void SetPois(const double *latitudes,
+                     const double *longitudes,
+                     const double *altitudes,
+                     size_t count);
+
+        [[nodiscard]] size_t Count() const { return count; }
+
+        // Updates ScreenX and ScreenY of each POI (top-left origin), NaN for POIs which are
+        // behind the camera or too far off screen. Returns the number of visible POIs.
+        size_t Project(const Pose &pose);
+
+        [[nodiscard]] const float *ScreenX() const { return screenX.data(); }
+
+        [[nodiscard]] const float *ScreenY() const { return screenY.data(); }
+
+    private:
+        size_t count = 0;
+        double originLatitude = 0.;
+        double originLongitude = 0.;
+        double originAltitude = 0.;
+        // Meters from the origin: east (x), altitude (y) and north (z).
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> screenX;
+        std::vector<float> screenY;
+    };
+}  // namespace lookaround
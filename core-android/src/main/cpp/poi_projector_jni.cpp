@@ -0,0 +1,51 @@
+#include <jni.h>
+
+#include "poi_projector.h"
+
+using namespace lookaround;
+
+extern "C" {
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_ar_math3d_PoiProjector_create(JNIEnv *env, jclass clazz) {
+    return reinterpret_cast<jlong>(new PoiProjector());
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_math3d_PoiProjector_destroy(
+        JNIEnv *env, jclass clazz, jlong projector) {
+    delete reinterpret_cast<PoiProjector *>(projector);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_math3d_PoiProjector_setPois(
+        JNIEnv *env, jclass clazz, jlong projector, jdoubleArray jlatitudes,
+        jdoubleArray jlongitudes, jdoubleArray jaltitudes) {
+    auto *poiProjector = reinterpret_cast<PoiProjector *>(projector);
+    const jsize count = env->GetArrayLength(jlatitudes);
+    jdouble *latitudes = env->GetDoubleArrayElements(jlatitudes, nullptr);
+    jdouble *longitudes = env->GetDoubleArrayElements(jlongitudes, nullptr);
+    jdouble *altitudes = env->GetDoubleArrayElements(jaltitudes, nullptr);
+    poiProjector->SetPois(latitudes, longitudes, altitudes, static_cast<size_t>(count));
+    env->ReleaseDoubleArrayElements(jaltitudes, altitudes, JNI_ABORT);
+    env->ReleaseDoubleArrayElements(jlongitudes, longitudes, JNI_ABORT);
+    env->ReleaseDoubleArrayElements(jlatitudes, latitudes, JNI_ABORT);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_ar_math3d_PoiProjector_project(
+        JNIEnv *env, jclass clazz, jlong projector, jdouble latitude, jdouble longitude,
+        jdouble altitude, jfloat xSin, jfloat xCos, jfloat ySin, jfloat yCos,
+        jfloat screenRotationSin, jfloat screenRotationCos, jfloat viewWidth, jfloat viewHeight,
+        jfloatArray jscreenX, jfloatArray jscreenY) {
+    auto *poiProjector = reinterpret_cast<PoiProjector *>(projector);
+    const PoiProjector::Pose pose{latitude, longitude, altitude,
+                                  xSin, xCos, ySin, yCos,
+                                  screenRotationSin, screenRotationCos,
+                                  viewWidth, viewHeight};
+    const size_t visibleCount = poiProjector->Project(pose);
+    const auto count = static_cast<jsize>(poiProjector->Count());
+    env->SetFloatArrayRegion(jscreenX, 0, count, poiProjector->ScreenX());
+    env->SetFloatArrayRegion(jscreenY, 0, count, poiProjector->ScreenY());
+    return static_cast<jint>(visibleCount);
+}
+}
@@ -0,0 +1,123 @@
+#include "rect_coalescer.h"
+
+#include <algorithm>
+
+namespace lookaround {
+    namespace {
+        void SortUnique(std::vector<GLfloat> &edges) {
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        }
+
+        // Whether the cell lies in one of the rect's corner squares, where the rounded corner
+        // may cut it. Cells never straddle square edges as those are split on.
+        bool InCorner(const RectCoalescer::Rect &rect, GLfloat left, GLfloat top,
+                      GLfloat right, GLfloat bottom) {
+            const GLfloat radius = rect.cornerRadius;
+            if (radius <= 0.f) return false;
+            const bool cornerRow = bottom <= rect.top + radius || top >= rect.bottom - radius;
+            const bool cornerColumn = right <= rect.left + radius || left >= rect.right - radius;
+            return cornerRow && cornerColumn;
+        }
+    }  // namespace
+
+    void RectCoalescer::EmitSolid(GLfloat left, GLfloat right, GLfloat top, GLfloat bottom) {
+        for (auto index: previousSolid) {
+            auto &region = regions[index];
+            if (region.left == left && region.right == right && region.bottom == top) {
+                region.bottom = bottom;
+                region.clip.bottom = bottom;
+                currentSolid.push_back(index);
+                return;
+            }
+        }
+        currentSolid.push_back(regions.size());
+        regions.push_back({left, top, right, bottom, {left, top, right, bottom, 0.f}});
+    }
+
+    bool RectCoalescer::Coalesce(const std::vector<Rect> &rects) {
+        if (rects.size() == lastRects.size() &&
+            std::equal(rects.begin(), rects.end(), lastRects.begin())) {
+            return false;
+        }
+        lastRects = rects;
+        regions.clear();
+        previousSolid.clear();
+
+        yEdges.clear();
+        for (const auto &rect: rects) {
+            yEdges.insert(yEdges.end(), {rect.top, rect.bottom,
+                                         rect.top + rect.cornerRadius,
+                                         rect.bottom - rect.cornerRadius});
+        }
+        SortUnique(yEdges);
+
+        for (size_t band = 0; band + 1 < yEdges.size(); ++band) {
+            const GLfloat top = yEdges[band];
+            const GLfloat bottom = yEdges[band + 1];
+            currentSolid.clear();
+
+            bandRects.clear();
+            xEdges.clear();
+            for (uint32_t i = 0; i < rects.size(); ++i) {
+                const auto &rect = rects[i];
+                if (rect.top > top || rect.bottom < bottom) continue;
+                bandRects.push_back(i);
+                xEdges.insert(xEdges.end(), {rect.left, rect.right,
+                                             rect.left + rect.cornerRadius,
+                                             rect.right - rect.cornerRadius});
+            }
+            SortUnique(xEdges);
+
+            // Adjacent solid cells of the band are merged into one region.
+            bool solidOpen = false;
+            GLfloat solidLeft = 0.f;
+            for (size_t cell = 0; cell + 1 < xEdges.size(); ++cell) {
+                const GLfloat left = xEdges[cell];
+                const GLfloat right = xEdges[cell + 1];
+                bool covered = false;
+                bool solid = false;
+                for (auto i: bandRects) {
+                    const auto &rect = rects[i];
+                    if (rect.left > left || rect.right < right) continue;
+                    covered = true;
+                    if (!InCorner(rect, left, top, right, bottom)) {
+                        solid = true;
+                        break;
+                    }
+                }
+
+                if (solid) {
+                    if (!solidOpen) solidLeft = left;
+                    solidOpen = true;
+                    continue;
+                }
+                if (solidOpen) EmitSolid(solidLeft, left, top, bottom);
+                solidOpen = false;
+                if (!covered) continue;
+
+                // Every rect covering the cell may round it off, test against each of them.
+                for (auto i: bandRects) {
+                    const auto &rect = rects[i];
+                    if (rect.left > left || rect.right < right) continue;
+                    regions.push_back({left, top, right, bottom, rect});
+                }
+            }
+            if (solidOpen) EmitSolid(solidLeft, xEdges.back(), top, bottom);
+            std::swap(previousSolid, currentSolid);
+        }
+
+        stats.rectsCount = rects.size();
+        stats.regionsCount = regions.size();
+        stats.rectsPixels = 0.;
+        for (const auto &rect: rects) {
+            stats.rectsPixels += (double) (rect.right - rect.left) * (rect.bottom - rect.top);
+        }
+        stats.regionsPixels = 0.;
+        for (const auto &region: regions) {
+            stats.regionsPixels +=
+                    (double) (region.right - region.left) * (region.bottom - region.top);
+        }
+        return true;
+    }
+}  // namespace lookaround
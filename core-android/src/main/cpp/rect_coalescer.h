@@ -0,0 +1,59 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lookaround {
+    // Turns overlapping rounded rects into regions which do not overlap (apart from corner cells
+    // shared by several rounded corners), so their union is shaded about once per pixel.
+    // Only regions in a rounded corner keep the rounded rect they have to be tested against.
+    class RectCoalescer {
+    public:
+        struct Rect {
+            GLfloat left, top, right, bottom; // window pixels, top-left origin
+            GLfloat cornerRadius;             // pixels
+
+            bool operator==(const Rect &other) const {
+                return left == other.left && top == other.top && right == other.right &&
+                       bottom == other.bottom && cornerRadius == other.cornerRadius;
+            }
+        };
+
+        struct Region {
+            GLfloat left, top, right, bottom;
+            // Rounded rect clipping the region, cornerRadius 0 if it is solid.
+            Rect clip;
+        };
+
+        struct Stats {
+            size_t rectsCount = 0;
+            size_t regionsCount = 0;
+            double rectsPixels = 0.;
+            double regionsPixels = 0.;
+        };
+
+        // Returns false (keeping the previous regions) if rects did not change.
+        bool Coalesce(const std::vector<Rect> &rects);
+
+        [[nodiscard]] const std::vector<Region> &Regions() const { return regions; }
+
+        [[nodiscard]] const Stats &LastStats() const { return stats; }
+
+    private:
+        void EmitSolid(GLfloat left, GLfloat right, GLfloat top, GLfloat bottom);
+
+        std::vector<Rect> lastRects;
+        std::vector<Region> regions;
+        Stats stats;
+
+        std::vector<GLfloat> yEdges;
+        std::vector<GLfloat> xEdges;
+        std::vector<uint32_t> bandRects;
+        // Solid regions of the previous band, which the current band may extend downwards.
+        std::vector<size_t> previousSolid;
+        std::vector<size_t> currentSolid;
+    };
+}  // namespace lookaround
@@ -0,0 +1,156 @@
+#include "rect_grid_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lookaround {
+    namespace {
+        // A rounded rect fully contains any rect inside it inset by this fraction of its
+        // corner radius (1 - 1 / sqrt(2)): that is where the corner arc crosses the diagonal.
+        // No inset is needed for rects rounded at least as much as the cover.
+        constexpr GLfloat CORNER_INSET = 0.2929f;
+
+        GLfloat ClampedRadius(GLfloat left, GLfloat top, GLfloat right, GLfloat bottom,
+                              GLfloat cornerRadius) {
+            return std::max(0.f, std::min({cornerRadius, (right - left) / 2.f,
+                                           (bottom - top) / 2.f}));
+        }
+    }  // namespace
+
+    RectGridIndex::CellRange RectGridIndex::CellsOf(const Rect &rect) {
+        return {static_cast<int32_t>(std::floor(rect.left / CELL_SIZE)),
+                static_cast<int32_t>(std::floor(rect.top / CELL_SIZE)),
+                static_cast<int32_t>(std::floor(rect.right / CELL_SIZE)),
+                static_cast<int32_t>(std::floor(rect.bottom / CELL_SIZE))};
+    }
+
+    uint64_t RectGridIndex::CellKey(int32_t x, int32_t y) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+               static_cast<uint32_t>(y);
+    }
+
+    void RectGridIndex::Insert(uint32_t index) {
+        const auto &range = cellRanges[index];
+        for (int32_t y = range.top; y <= range.bottom; ++y) {
+            for (int32_t x = range.left; x <= range.right; ++x) {
+                cells[CellKey(x, y)].push_back(index);
+            }
+        }
+    }
+
+    void RectGridIndex::Remove(uint32_t index) {
+        const auto &range = cellRanges[index];
+        for (int32_t y = range.top; y <= range.bottom; ++y) {
+            for (int32_t x = range.left; x <= range.right; ++x) {
+                auto &cell = cells[CellKey(x, y)];
+                cell.erase(std::remove(cell.begin(), cell.end(), index), cell.end());
+            }
+        }
+    }
+
+    void RectGridIndex::Update(const GLfloat *newRects, size_t count) {
+        for (size_t i = count; i < rects.size(); ++i) Remove(static_cast<uint32_t>(i));
+        const size_t previousCount = std::min(rects.size(), count);
+        rects.resize(count);
+        cellRanges.resize(count);
+        occluded.assign(count, false);
+
+        for (size_t i = 0; i < count; ++i) {
+            const GLfloat *coordinates = &newRects[i * RECT_COMPONENTS];
+            const GLfloat left = coordinates[0];
+            const GLfloat bottom = coordinates[1];
+            const GLfloat right = left + coordinates[2];
+            const GLfloat top = bottom - coordinates[3];
+            const Rect rect{left, top, right, bottom,
+                            ClampedRadius(left, top, right, bottom,
+                                          coordinates[4] / CORNER_RADIUS_SCALE)};
+            if (i < previousCount) {
+                if (rects[i] == rect) continue;
+                Remove(static_cast<uint32_t>(i));
+            }
+            rects[i] = rect;
+            cellRanges[i] = CellsOf(rect);
+            Insert(static_cast<uint32_t>(i));
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            occluded[i] = IsCoveredByLaterRect(static_cast<uint32_t>(i));
+        }
+    }
+
+    bool RectGridIndex::IsCoveredByLaterRect(uint32_t index) const {
+        const auto &rect = rects[index];
+        // A covering rect overlaps every cell of the covered one, checking one is enough.
+        const auto &range = cellRanges[index];
+        auto cell = cells.find(CellKey(range.left, range.top));
+        if (cell == cells.end()) return false;
+
+        for (uint32_t other: cell->second) {
+            if (other <= index) continue;
+            const auto &cover = rects[other];
+            const GLfloat inset =
+                    rect.cornerRadius >= cover.cornerRadius ? 0.f
+                                                            : cover.cornerRadius * CORNER_INSET;
+            if (rect.left >= cover.left + inset && rect.right <= cover.right - inset &&
+                rect.top >= cover.top + inset && rect.bottom <= cover.bottom - inset) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    int32_t RectGridIndex::HitTest(GLfloat x, GLfloat y) const {
+        auto cell = cells.find(CellKey(static_cast<int32_t>(std::floor(x / CELL_SIZE)),
+                                       static_cast<int32_t>(std::floor(y / CELL_SIZE))));
+        if (cell == cells.end()) return NO_RECT;
+
+        int32_t hit = NO_RECT;
+        for (uint32_t index: cell->second) {
+            if (static_cast<int32_t>(index) <= hit) continue;
+            const auto &rect = rects[index];
+            if (x < rect.left || x > rect.right || y < rect.top || y > rect.bottom) continue;
+
+            // Distance to the inner rect the corner arcs are centered on.
+            const GLfloat radius = rect.cornerRadius;
+            const GLfloat dx = std::max({rect.left + radius - x, 0.f, x - (rect.right - radius)});
+            const GLfloat dy = std::max({rect.top + radius - y, 0.f, y - (rect.bottom - radius)});
+            if (dx * dx + dy * dy <= radius * radius) hit = static_cast<int32_t>(index);
+        }
+        return hit;
+    }
+
+    void RectGridIndex::QueryVisible(GLfloat viewportWidth,
+                                     GLfloat viewportHeight,
+                                     std::vector<uint32_t> &out) const {
+        out.clear();
+        if (viewportWidth <= 0.f || viewportHeight <= 0.f) return;
+
+        // A rect spanning several cells is listed in each of them, the stamp reports it once.
+        if (queryStamps.size() != rects.size()) queryStamps.assign(rects.size(), 0);
+        if (++queryStamp == 0) {
+            std::fill(queryStamps.begin(), queryStamps.end(), 0);
+            queryStamp = 1;
+        }
+
+        const CellRange viewportCells = CellsOf({0.f, 0.f, viewportWidth, viewportHeight, 0.f});
+        for (int32_t y = viewportCells.top; y <= viewportCells.bottom; ++y) {
+            for (int32_t x = viewportCells.left; x <= viewportCells.right; ++x) {
+                auto cell = cells.find(CellKey(x, y));
+                if (cell == cells.end()) continue;
+
+                for (uint32_t index: cell->second) {
+                    if (queryStamps[index] == queryStamp) continue;
+                    queryStamps[index] = queryStamp;
+                    const auto &rect = rects[index];
+                    if (occluded[index] ||
+                        rect.right <= 0.f || rect.left >= viewportWidth ||
+                        rect.bottom <= 0.f || rect.top >= viewportHeight) {
+                        continue;
+                    }
+                    out.push_back(index);
+                }
+            }
+        }
+        std::sort(out.begin(), out.end());
+    }
+}  // namespace lookaround
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace lookaround {
+    // Uniform grid over rounded marker rects. Updates only re-bin rects which moved, so
+    // hit tests and visibility queries touch a few cells instead of every rect. Later rects are
+    // on top of earlier ones, like on the canvas.
+    class RectGridIndex {
+    public:
+        // Floats per rect, as passed to renderTexture: left, bottom (window pixels, top-left
+        // origin), width, height, corner radius.
+        static constexpr size_t RECT_COMPONENTS = 5;
+        // Corner radii are in the units of the no blur program's rounded box, which measures
+        // distances in half pixels.
+        static constexpr GLfloat CORNER_RADIUS_SCALE = 2.f;
+        static constexpr GLfloat CELL_SIZE = 128.f;
+        static constexpr int32_t NO_RECT = -1;
+
+        void Update(const GLfloat *rects, size_t count);
+
+        [[nodiscard]] size_t Count() const { return rects.size(); }
+
+        // Topmost rect containing the point (corners included), NO_RECT if there is none.
+        [[nodiscard]] int32_t HitTest(GLfloat x, GLfloat y) const;
+
+        // Whether the rect is entirely covered by a single rect on top of it.
+        [[nodiscard]] bool IsOccluded(size_t index) const { return occluded[index]; }
+
+        // Replaces out with indices of rects which intersect the viewport and are not occluded,
+        // in drawing order. Only walks the cells under the viewport, so rects far off screen
+        // cost nothing. Not thread safe, like the rest of the index.
+        void QueryVisible(GLfloat viewportWidth,
+                          GLfloat viewportHeight,
+                          std::vector<uint32_t> &out) const;
+
+    private:
+        struct Rect {
+            GLfloat left, top, right, bottom;
+            GLfloat cornerRadius;
+
+            bool operator==(const Rect &other) const {
+                return left == other.left && top == other.top && right == other.right &&
+                       bottom == other.bottom && cornerRadius == other.cornerRadius;
+            }
+        };
+
+        struct CellRange {
+            int32_t left, top, right, bottom;
+        };
+
+        static CellRange CellsOf(const Rect &rect);
+
+        static uint64_t CellKey(int32_t x, int32_t y);
+
+        void Insert(uint32_t index);
+
+        void Remove(uint32_t index);
+
+        [[nodiscard]] bool IsCoveredByLaterRect(uint32_t index) const;
+
+        std::vector<Rect> rects;
+        std::vector<CellRange> cellRanges;
+        std::vector<bool> occluded;
+        // Cells are never erased, so a steady set of rects stops allocating.
+        std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+        // Per rect stamp of the last visibility query which reported it.
+        mutable std::vector<uint32_t> queryStamps;
+        mutable uint32_t queryStamp = 0;
+    };
+}  // namespace lookaround
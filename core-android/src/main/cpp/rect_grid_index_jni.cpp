@@ -0,0 +1,60 @@
+#include <jni.h>
+
+#include <vector>
+
+#include "rect_grid_index.h"
+
+using namespace lookaround;
+
+namespace {
+    struct NativeRectIndex {
+        RectGridIndex index;
+        std::vector<uint32_t> visible;
+    };
+}  // namespace
+
+extern "C" {
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerRectIndex_create(JNIEnv *env, jclass clazz) {
+    return reinterpret_cast<jlong>(new NativeRectIndex());
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerRectIndex_destroy(
+        JNIEnv *env, jclass clazz, jlong index) {
+    delete reinterpret_cast<NativeRectIndex *>(index);
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerRectIndex_update(
+        JNIEnv *env, jclass clazz, jlong index, jfloatArray jrectsCoordinates, jint jrectsCount) {
+    auto *rectIndex = reinterpret_cast<NativeRectIndex *>(index);
+    if (jrectsCount <= 0) {
+        rectIndex->index.Update(nullptr, 0);
+        return;
+    }
+
+    GLfloat *rectsCoordinates = env->GetFloatArrayElements(jrectsCoordinates, nullptr);
+    rectIndex->index.Update(rectsCoordinates, static_cast<size_t>(jrectsCount));
+    env->ReleaseFloatArrayElements(jrectsCoordinates, rectsCoordinates, JNI_ABORT);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerRectIndex_hitTest(
+        JNIEnv *env, jclass clazz, jlong index, jfloat x, jfloat y) {
+    return reinterpret_cast<NativeRectIndex *>(index)->index.HitTest(x, y);
+}
+
+JNIEXPORT jint JNICALL
+Java_com_lookaround_core_android_ar_renderer_MarkerRectIndex_queryVisible(
+        JNIEnv *env, jclass clazz, jlong index, jfloat viewportWidth, jfloat viewportHeight,
+        jintArray jvisible) {
+    auto *rectIndex = reinterpret_cast<NativeRectIndex *>(index);
+    rectIndex->index.QueryVisible(viewportWidth, viewportHeight, rectIndex->visible);
+    const auto count = static_cast<jsize>(rectIndex->visible.size());
+    static_assert(sizeof(jint) == sizeof(uint32_t));
+    env->SetIntArrayRegion(jvisible, 0, count,
+                           reinterpret_cast<const jint *>(rectIndex->visible.data()));
+    return count;
+}
+}
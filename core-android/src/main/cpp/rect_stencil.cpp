@@ -0,0 +1,177 @@
+#include "rect_stencil.h"
+
+#include <android/log.h>
+
+#include "gl_check.h"
+#include "gl_program.h"
+
+namespace lookaround {
+    namespace {
+        constexpr char VERTEX_SHADER_SRC_RECT_STENCIL[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform vec2 viewportSize;
+
+in vec2 corner;
+in vec4 instanceRect;
+in vec4 instanceClip;
+in float instanceClipCornerRadius;
+
+out vec4 clip;
+out float clipCornerRadius;
+
+void main() {
+    vec2 position = mix(instanceRect.xy, instanceRect.zw, corner);
+    gl_Position = vec4(position / viewportSize * 2. - vec2(1.), 0., 1.);
+    clip = instanceClip;
+    clipCornerRadius = instanceClipCornerRadius;
+}
+)SRC";
+
+        // Same half pixel edge threshold as the rounded box of the no blur program.
+        constexpr char FRAGMENT_SHADER_SRC_RECT_STENCIL[] = R"SRC(#version 310 es
+precision highp float;
+precision mediump int;
+
+in vec4 clip;
+in float clipCornerRadius;
+out vec4 fragColor;
+
+void main() {
+    if (clipCornerRadius > 0.) {
+        vec2 q = max(abs(gl_FragCoord.xy - clip.xy) - clip.zw + clipCornerRadius, 0.);
+        if (length(q) - clipCornerRadius > .5) discard;
+    }
+    fragColor = vec4(0.);
+}
+)SRC";
+
+        constexpr GLfloat CORNERS[] = {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+
+#ifndef NDEBUG
+        constexpr size_t STATS_LOG_INTERVAL_DRAWS = 300;
+#endif
+    }  // namespace
+
+    bool RectStencil::Init(SharedGlResources &sharedResources) {
+        program = CreateGlProgram(VERTEX_SHADER_SRC_RECT_STENCIL, FRAGMENT_SHADER_SRC_RECT_STENCIL);
+        if (!program) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Rect coalescing disabled: creating GL program failed.");
+            return false;
+        }
+        viewportSizeHandle = CHECK_GL(glGetUniformLocation(program, "viewportSize"));
+        auto cornerHandle = CHECK_GL(glGetAttribLocation(program, "corner"));
+        auto rectHandle = CHECK_GL(glGetAttribLocation(program, "instanceRect"));
+        auto clipHandle = CHECK_GL(glGetAttribLocation(program, "instanceClip"));
+        auto radiusHandle = CHECK_GL(glGetAttribLocation(program, "instanceClipCornerRadius"));
+
+        CHECK_GL(glGenVertexArrays(1, &vaoId));
+        CHECK_GL(glBindVertexArray(vaoId));
+
+        cornersVboId = sharedResources.Buffer(SharedGlResources::QUAD_CORNERS_BUFFER, CORNERS,
+                                              sizeof(CORNERS));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, cornersVboId));
+        CHECK_GL(glVertexAttribPointer(cornerHandle, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+        CHECK_GL(glEnableVertexAttribArray(cornerHandle));
+
+        CHECK_GL(glGenBuffers(1, &instancesVboId));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        constexpr GLsizei stride = sizeof(Instance);
+        CHECK_GL(glVertexAttribPointer(rectHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(offsetof(Instance, left))));
+        CHECK_GL(glVertexAttribPointer(clipHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(
+                                               offsetof(Instance, clipCenterX))));
+        CHECK_GL(glVertexAttribPointer(radiusHandle, 1, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(
+                                               offsetof(Instance, clipCornerRadius))));
+        for (auto handle: {rectHandle, clipHandle, radiusHandle}) {
+            CHECK_GL(glEnableVertexAttribArray(handle));
+            CHECK_GL(glVertexAttribDivisor(handle, 1));
+        }
+
+        CHECK_GL(glBindVertexArray(0));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        initialized = true;
+        return true;
+    }
+
+    void RectStencil::Release() {
+        if (!initialized) return;
+
+        CHECK_GL(glDeleteBuffers(1, &instancesVboId));
+        CHECK_GL(glDeleteVertexArrays(1, &vaoId));
+        CHECK_GL(glDeleteProgram(program));
+        instancesVboCapacity = 0;
+        uploadedViewportHeight = 0;
+        coalescer = RectCoalescer();
+        instances.clear();
+        initialized = false;
+    }
+
+    void RectStencil::UploadInstances(GLsizei viewportHeight) {
+        instances.clear();
+        const auto height = (GLfloat) viewportHeight;
+        for (const auto &region: coalescer.Regions()) {
+            const auto &clip = region.clip;
+            instances.push_back({
+                    region.left, height - region.bottom, region.right, height - region.top,
+                    (clip.left + clip.right) / 2.f, height - (clip.top + clip.bottom) / 2.f,
+                    (clip.right - clip.left) / 2.f, (clip.bottom - clip.top) / 2.f,
+                    clip.cornerRadius});
+        }
+        uploadedViewportHeight = viewportHeight;
+        if (instances.empty()) return;
+
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        auto size = static_cast<GLsizeiptr>(instances.size() * sizeof(Instance));
+        if (size > instancesVboCapacity) {
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, size, instances.data(), GL_DYNAMIC_DRAW));
+            instancesVboCapacity = size;
+        } else {
+            // Orphan the previous storage so the upload never waits for last frame's draw.
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, instancesVboCapacity, nullptr,
+                                  GL_DYNAMIC_DRAW));
+            CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data()));
+        }
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+
+    void RectStencil::Draw(const std::vector<RectCoalescer::Rect> &rects,
+                           GLsizei viewportWidth,
+                           GLsizei viewportHeight) {
+        if (!initialized) return;
+
+        // Regions only change with the rects, a static scene is not re-uploaded.
+        if (coalescer.Coalesce(rects) || uploadedViewportHeight != viewportHeight) {
+            UploadInstances(viewportHeight);
+        }
+#ifndef NDEBUG
+        if (++drawsSinceStatsLog >= STATS_LOG_INTERVAL_DRAWS) {
+            drawsSinceStatsLog = 0;
+            const auto &stats = coalescer.LastStats();
+            __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                                "Rect stencil: %zu rects (%zu draws, %.0f px) -> "
+                                "%zu regions (1 draw, %.0f px).",
+                                stats.rectsCount, stats.rectsCount, stats.rectsPixels,
+                                stats.regionsCount, stats.regionsPixels);
+        }
+#endif
+        if (instances.empty()) return;
+
+        CHECK_GL(glViewport(0, 0, viewportWidth, viewportHeight));
+        CHECK_GL(glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE));
+
+        CHECK_GL(glUseProgram(program));
+        CHECK_GL(glUniform2f(viewportSizeHandle, (GLfloat) viewportWidth,
+                             (GLfloat) viewportHeight));
+        CHECK_GL(glBindVertexArray(vaoId));
+        CHECK_GL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                                       static_cast<GLsizei>(instances.size())));
+        CHECK_GL(glBindVertexArray(0));
+
+        CHECK_GL(glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE));
+    }
+}  // namespace lookaround
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "rect_coalescer.h"
+#include "shared_gl_resources.h"
+
+namespace lookaround {
+    // Writes the union of rounded rects into the stencil buffer with one instanced draw of
+    // coalesced regions. Only regions in rounded corners evaluate the corner in the shader.
+    class RectStencil {
+    public:
+        // Must be called with a current context.
+        bool Init(SharedGlResources &sharedResources);
+
+        void Release();
+
+        [[nodiscard]] bool IsInitialized() const { return initialized; }
+
+        // Expects stencil writes to be set up; color writes are masked while drawing. Clipped to
+        // the current scissor box.
+        void Draw(const std::vector<RectCoalescer::Rect> &rects,
+                  GLsizei viewportWidth,
+                  GLsizei viewportHeight);
+
+    private:
+        // Matches the instance attributes of the stencil program; bottom-left origin.
+        struct Instance {
+            GLfloat left, bottom, right, top;
+            GLfloat clipCenterX, clipCenterY, clipHalfWidth, clipHalfHeight;
+            GLfloat clipCornerRadius;
+        };
+
+        void UploadInstances(GLsizei viewportHeight);
+
+        bool initialized = false;
+        GLuint program = 0;
+        GLint viewportSizeHandle = -1;
+        GLuint vaoId = 0;
+        // Owned by SharedGlResources.
+        GLuint cornersVboId = 0;
+        GLuint instancesVboId = 0;
+        GLsizeiptr instancesVboCapacity = 0;
+        GLsizei uploadedViewportHeight = 0;
+
+        RectCoalescer coalescer;
+        std::vector<Instance> instances;
+#ifndef NDEBUG
+        size_t drawsSinceStatsLog = 0;
+#endif
+    };
+}  // namespace lookaround
@@ -0,0 +1,169 @@
+#include "reference_blur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "simd_float4.h"
+
+namespace lookaround {
+    namespace {
+        // Below that many rows a band is not worth a thread.
+        constexpr int MIN_BAND_ROWS = 16;
+
+        // As stored by an 8 bit target.
+        float Quantize(float value) {
+            return std::round(std::min(std::max(value, 0.f), 1.f) * 255.f) / 255.f;
+        }
+
+        Float4 Lerp(const float *a, const float *b, float fraction) {
+            const Float4 first = Load4(a);
+            return first + (Load4(b) - first) * Splat4(fraction);
+        }
+    }  // namespace
+
+    ReferenceBlur::ReferenceBlur(unsigned threadCount)
+            : workers(threadCount ? threadCount
+                                  : std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+    int ReferenceBlur::LevelSize(int size, int level) {
+        // The full level is the window, the camera and half levels are half size targets.
+        return size / (1 << level);
+    }
+
+    void ReferenceBlur::AxisTaps(int outputSize, int inputSize, float lod, bool blurred,
+                                 std::vector<Tap> &taps) {
+        const int radius = blurred ? KERNEL_RADIUS : 0;
+        std::array<float, KERNEL_RADIUS + 1> weights{};
+        float weightsSum = 0.f;
+        for (int i = 0; i <= radius; ++i) {
+            weights[i] = std::exp(-static_cast<float>(i * i) / (2.f * SIGMA * SIGMA));
+            weightsSum += i ? 2.f * weights[i] : weights[i];
+        }
+
+        // Texture coordinates of the GPU passes: texel centers of the output, offset by
+        // exp2(lod) of its texels and sampled at the same spot of the input.
+        const float step = std::exp2(lod) / static_cast<float>(outputSize);
+        taps.clear();
+        taps.reserve(static_cast<size_t>(outputSize) * (2 * radius + 1));
+        for (int texel = 0; texel < outputSize; ++texel) {
+            const float center = (static_cast<float>(texel) + .5f) / static_cast<float>(outputSize);
+            for (int i = -radius; i <= radius; ++i) {
+                const float position =
+                        (center + step * static_cast<float>(i)) * static_cast<float>(inputSize) -
+                        .5f;
+                const float floor = std::floor(position);
+                const int index = static_cast<int>(floor);
+                taps.push_back({std::min(std::max(index, 0), inputSize - 1),
+                                std::min(std::max(index + 1, 0), inputSize - 1),
+                                position - floor,
+                                weights[std::abs(i)] / weightsSum});
+            }
+        }
+    }
+
+    void ReferenceBlur::Pass(const Image &input, Image &output, bool vertical, float lod,
+                             bool blurred, const std::array<float, 4> *mix) {
+        output.pixels.resize(static_cast<size_t>(output.width) * output.height * 4);
+        std::vector<Tap> rowTaps;
+        std::vector<Tap> columnTaps;
+        AxisTaps(output.height, input.height, lod, blurred && vertical, rowTaps);
+        AxisTaps(output.width, input.width, lod, blurred && !vertical, columnTaps);
+        const size_t rowTapsPerRow = rowTaps.size() / output.height;
+        const size_t columnTapsPerColumn = columnTaps.size() / output.width;
+
+        // Bilinear taps are separable: the taps of a row are summed into a line at the input
+        // width first, then the taps of each column are read from the line.
+        const auto blurRows = [&](int rowBegin, int rowEnd) {
+            std::vector<float> line(static_cast<size_t>(input.width) * 4);
+            for (int y = rowBegin; y < rowEnd; ++y) {
+                const Tap *rowTap = &rowTaps[y * rowTapsPerRow];
+                for (int x = 0; x < input.width; ++x) {
+                    Float4 sum = Splat4(0.f);
+                    for (size_t tap = 0; tap < rowTapsPerRow; ++tap) {
+                        const Tap &row = rowTap[tap];
+                        const float *row0 = &input.pixels[(row.index0 * input.width + x) * 4];
+                        const float *row1 = &input.pixels[(row.index1 * input.width + x) * 4];
+                        sum = sum + Lerp(row0, row1, row.fraction) * Splat4(row.weight);
+                    }
+                    Store4(&line[x * 4], sum);
+                }
+
+                float *out = &output.pixels[static_cast<size_t>(y) * output.width * 4];
+                for (int x = 0; x < output.width; ++x) {
+                    const Tap *columnTap = &columnTaps[x * columnTapsPerColumn];
+                    Float4 sum = Splat4(0.f);
+                    for (size_t tap = 0; tap < columnTapsPerColumn; ++tap) {
+                        const Tap &column = columnTap[tap];
+                        sum = sum + Lerp(&line[column.index0 * 4], &line[column.index1 * 4],
+                                         column.fraction) * Splat4(column.weight);
+                    }
+                    if (mix) sum = sum + (Load4(mix->data()) - sum) * Splat4((*mix)[3]);
+                    Store4(&out[x * 4], sum);
+                    for (int channel = 0; channel < 3; ++channel) {
+                        out[x * 4 + channel] = Quantize(out[x * 4 + channel]);
+                    }
+                    // RGB targets, the alpha the next pass reads is 1.
+                    out[x * 4 + 3] = 1.f;
+                }
+            }
+        };
+
+        const int bands = std::max(1, std::min(static_cast<int>(workers.ThreadCount()),
+                                               output.height / MIN_BAND_ROWS));
+        workers.Run(bands, [&blurRows, &output, bands](int band) {
+            blurRows(output.height * band / bands, output.height * (band + 1) / bands);
+        });
+    }
+
+    bool ReferenceBlur::Blur(const uint8_t *pixels, int width, int height, int stride,
+                             const Params &params, int level, uint8_t *output,
+                             int outputStride) {
+        if (LevelSize(width, LEVEL_QUARTER) <= 0 || LevelSize(height, LEVEL_QUARTER) <= 0 ||
+            level < LEVEL_FULL || level > LEVEL_QUARTER) {
+            return false;
+        }
+
+        Image frame{width, height};
+        frame.pixels.resize(static_cast<size_t>(width) * height * 4);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width * 4; ++x) {
+                frame.pixels[y * width * 4 + x] = pixels[y * stride + x] / 255.f;
+            }
+        }
+
+        const bool blurred = params.lod > MIN_LOD;
+        const auto &color = params.contrastingColor;
+        const bool mixed = blurred && params.contrastingColorMix > 0.f &&
+                           (color[0] != -1.f || color[1] != -1.f || color[2] != -1.f);
+        // Mixed once by the factor compounded over the passes, like the GPU passes.
+        const std::array<float, 4> mix{
+                color[0], color[1], color[2],
+                1.f - std::pow(1.f - params.contrastingColorMix,
+                               static_cast<float>(SEPARABLE_PASS_COUNT))};
+
+        // camera V, camera H, then V and H of the quarter, half and full levels.
+        const int levelDivisors[] = {2, 4, 2, 1};
+        const int lastLevel = 3 - level;
+        Image source = std::move(frame);
+        Image vertical;
+        Image horizontal;
+        for (int pyramidLevel = 0; pyramidLevel <= lastLevel; ++pyramidLevel) {
+            const int divisor = levelDivisors[pyramidLevel];
+            vertical.width = horizontal.width = width / divisor;
+            vertical.height = horizontal.height = height / divisor;
+            Pass(source, vertical, true, params.lod, blurred, nullptr);
+            const bool last = pyramidLevel == 3;
+            Pass(vertical, horizontal, false, params.lod, blurred, last && mixed ? &mix : nullptr);
+            std::swap(source, horizontal);
+        }
+
+        for (int y = 0; y < source.height; ++y) {
+            for (int x = 0; x < source.width * 4; ++x) {
+                output[y * outputStride + x] = static_cast<uint8_t>(
+                        std::lround(source.pixels[y * source.width * 4 + x] * 255.f));
+            }
+        }
+        return true;
+    }
+}  // namespace lookaround
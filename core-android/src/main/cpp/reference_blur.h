@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "worker_pool.h"
+
+namespace lookaround {
+    // The separable blur pyramid of DrawBlur on the CPU: the camera frame blurred into half
+    // size, then the quarter, half and full size levels, each a vertical and a horizontal pass
+    // of the same kernel sampled through the same bilinear, clamped to edge taps, with the
+    // results quantized to 8 bits like the targets of the GPU passes. A fallback where no
+    // context can be created, and the ground truth GPU variants are compared against.
+    //
+    // Pixels are Float4 lanes of RGBA (NEON, SSE2 or scalar), the rows of each pass are split
+    // into bands blurred on a pool of threadCount threads, started with the blur. No GL or
+    // Android dependencies, so it also builds into the host tools.
+    class ReferenceBlur {
+    public:
+        // Those of the renderer.
+        static constexpr float MIN_LOD = -2.f;
+        static constexpr float MAX_LOD = 2.f;
+        static constexpr float SIGMA = 3.f;
+        // Taps on either side, all those under 2 sigma.
+        static constexpr int KERNEL_RADIUS = 5;
+        static constexpr int SEPARABLE_PASS_COUNT = 8;
+
+        // Levels of requestBlurredSnapshot, 1 << level times smaller than the frame.
+        static constexpr int LEVEL_FULL = 0;
+        static constexpr int LEVEL_HALF = 1;
+        static constexpr int LEVEL_QUARTER = 2;
+
+        struct Params {
+            // Tap spacing of exp2(lod) pixels, passes at MIN_LOD or below only scale.
+            float lod = MAX_LOD;
+            // Mixed into the full level by contrastingColorMix compounded over the passes,
+            // channels of -1 for none - as set on the renderer.
+            std::array<float, 3> contrastingColor{-1.f, -1.f, -1.f};
+            float contrastingColorMix = 0.f;
+        };
+
+        // 0 threads for one per core.
+        explicit ReferenceBlur(unsigned threadCount = 0);
+
+        // Size of level of a frame of size, as the render graph sizes its targets.
+        static int LevelSize(int size, int level);
+
+        // Blurs the RGBA rows of pixels, stride bytes apart, down to level, writing LevelSize
+        // rows of RGBA outputStride bytes apart to output. The pyramid is symmetric, so rows
+        // may be top-down or bottom-up as long as both are the same. Returns false if the
+        // frame is too small for the quarter size level. Blurs from several threads take turns.
+        bool Blur(const uint8_t *pixels, int width, int height, int stride, const Params &params,
+                  int level, uint8_t *output, int outputStride);
+
+    private:
+        // RGBA in [0, 1], 4 floats per pixel.
+        struct Image {
+            int width = 0;
+            int height = 0;
+            std::vector<float> pixels;
+        };
+
+        // One bilinear tap along an axis: texels index0 and index1 mixed by fraction.
+        struct Tap {
+            int index0;
+            int index1;
+            float fraction;
+            float weight;
+        };
+
+        // Taps of output texel i of an axis of outputSize, from an input of inputSize. Blurring
+        // passes spread 2 * KERNEL_RADIUS + 1 taps exp2(lod) output texels apart.
+        static void AxisTaps(int outputSize, int inputSize, float lod, bool blurred,
+                             std::vector<Tap> &taps);
+
+        void Pass(const Image &input, Image &output, bool vertical, float lod, bool blurred,
+                  const std::array<float, 4> *mix);
+
+        WorkerPool workers;
+    };
+}  // namespace lookaround
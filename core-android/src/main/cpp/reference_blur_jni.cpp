@@ -0,0 +1,54 @@
+#include <android/bitmap.h>
+#include <android/log.h>
+#include <jni.h>
+
+#include "gl_check.h"
+#include "reference_blur.h"
+
+using namespace lookaround;
+
+namespace {
+    uint8_t *LockBitmap(JNIEnv *env, jobject bitmap, AndroidBitmapInfo &info) {
+        void *pixels = nullptr;
+        if (AndroidBitmap_getInfo(env, bitmap, &info) != ANDROID_BITMAP_RESULT_SUCCESS ||
+            info.format != ANDROID_BITMAP_FORMAT_RGBA_8888 ||
+            AndroidBitmap_lockPixels(env, bitmap, &pixels) != ANDROID_BITMAP_RESULT_SUCCESS) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Reference blur bitmap is not a lockable ARGB_8888 bitmap.");
+            return nullptr;
+        }
+        return static_cast<uint8_t *>(pixels);
+    }
+}  // namespace
+
+extern "C" {
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_blur_ReferenceBlur_blur(
+        JNIEnv *env, jclass clazz, jobject jinput, jint level, jfloat lod, jobject joutput) {
+    AndroidBitmapInfo inputInfo;
+    AndroidBitmapInfo outputInfo;
+    const uint8_t *input = LockBitmap(env, jinput, inputInfo);
+    if (!input) return JNI_FALSE;
+    uint8_t *output = LockBitmap(env, joutput, outputInfo);
+    if (!output) {
+        AndroidBitmap_unlockPixels(env, jinput);
+        return JNI_FALSE;
+    }
+
+    const auto width = static_cast<int>(inputInfo.width);
+    const auto height = static_cast<int>(inputInfo.height);
+    bool blurred = false;
+    if (static_cast<int>(outputInfo.width) == ReferenceBlur::LevelSize(width, level) &&
+        static_cast<int>(outputInfo.height) == ReferenceBlur::LevelSize(height, level)) {
+        // Its worker threads are started once and kept for the life of the process.
+        static auto *referenceBlur = new ReferenceBlur();
+        ReferenceBlur::Params params;
+        params.lod = lod;
+        blurred = referenceBlur->Blur(input, width, height, static_cast<int>(inputInfo.stride),
+                                      params, level, output, static_cast<int>(outputInfo.stride));
+    }
+    AndroidBitmap_unlockPixels(env, joutput);
+    AndroidBitmap_unlockPixels(env, jinput);
+    return blurred ? JNI_TRUE : JNI_FALSE;
+}
+}
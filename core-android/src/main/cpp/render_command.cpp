@@ -0,0 +1,64 @@
+#include "render_command.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace lookaround {
+    namespace {
+        constexpr uint64_t CHANNEL_MAX = 0xffff;
+
+        uint64_t PackChannel(GLfloat channel) {
+            return static_cast<uint64_t>(
+                    std::lround(std::clamp(channel, 0.f, 1.f) * static_cast<float>(CHANNEL_MAX)));
+        }
+
+        GLfloat UnpackChannel(uint64_t value, int shift) {
+            return static_cast<GLfloat>((value >> shift) & CHANNEL_MAX) /
+                   static_cast<GLfloat>(CHANNEL_MAX);
+        }
+    }  // namespace
+
+    void RenderCommandQueue::Push(const RenderCommand &command) {
+        LatestValueSlot &slot = slots[static_cast<size_t>(command.type)];
+        // While the setter has a pending value, queueing would apply this one before it.
+        if (!slot.pending.load(std::memory_order_acquire) && queue.TryPush(command)) return;
+        slot.value.store(Pack(command), std::memory_order_relaxed);
+        slot.pending.store(true, std::memory_order_release);
+    }
+
+    bool RenderCommandQueue::TryPop(RenderCommand &command) {
+        if (queue.TryPop(command)) return true;
+        for (size_t type = 0; type < slots.size(); ++type) {
+            LatestValueSlot &slot = slots[type];
+            if (!slot.pending.load(std::memory_order_acquire)) continue;
+            // The value was kept because the queue filled up after it was found empty above.
+            // Seeing it pending makes the commands queued before it visible, they go first.
+            if (queue.TryPop(command)) return true;
+            if (!slot.pending.exchange(false, std::memory_order_acq_rel)) continue;
+            // A write racing with this one sets pending again, so it is taken with the next
+            // frame at the latest.
+            command = Unpack(static_cast<RenderCommand::Type>(type),
+                             slot.value.load(std::memory_order_relaxed));
+            return true;
+        }
+        return false;
+    }
+
+    uint64_t RenderCommandQueue::Pack(const RenderCommand &command) {
+        // 16 bits per color channel, more than the 8 bit colors set from the UI need.
+        return (command.enabled ? 1u : 0u) | (command.animated ? 2u : 0u) |
+               PackChannel(command.red) << 16 | PackChannel(command.green) << 32 |
+               PackChannel(command.blue) << 48;
+    }
+
+    RenderCommand RenderCommandQueue::Unpack(RenderCommand::Type type, uint64_t value) {
+        RenderCommand command;
+        command.type = type;
+        command.enabled = (value & 1u) != 0;
+        command.animated = (value & 2u) != 0;
+        command.red = UnpackChannel(value, 16);
+        command.green = UnpackChannel(value, 32);
+        command.blue = UnpackChannel(value, 48);
+        return command;
+    }
+}  // namespace lookaround
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "spsc_queue.h"
+
+namespace lookaround {
+    // State change posted by JNI setters and applied by the render thread at the start of
+    // the next frame, so a frame never sees half of an update.
+    struct RenderCommand {
+        enum class Type : uint8_t {
+            SET_BLUR_ENABLED,
+            SET_CONTRASTING_COLOR,
+            // Blurs with SatBlur instead of the separable passes, where supported.
+            SET_SAT_BLUR_ENABLED,
+        };
+        static constexpr size_t TYPES_COUNT = 3;
+
+        Type type = Type::SET_BLUR_ENABLED;
+        bool enabled = false;
+        bool animated = false;
+        GLfloat red = 0.f;
+        GLfloat green = 0.f;
+        GLfloat blue = 0.f;
+    };
+
+    // Setters arrive at UI event rate, a few per frame at most.
+    constexpr size_t RENDER_COMMAND_QUEUE_CAPACITY = 64;
+
+    // Wait-free channel from the JNI setters to the render thread that never drops a command.
+    // Commands go through a bounded queue, so they are all applied in order. One that does not
+    // fit is kept as the latest value of its setter instead, and so are that setter's later
+    // ones until the render thread took it, so each setter's last write always lands.
+    //
+    // There is one producer on purpose: OpenGLRenderer posts from the main thread only, which
+    // keeps pushing wait-free. Posting from several threads at once is not supported.
+    class RenderCommandQueue {
+    public:
+        // Producer only.
+        void Push(const RenderCommand &command);
+
+        // Consumer only. Returns queued commands first, then the latest values of setters whose
+        // commands did not fit. Returns false once there are none left.
+        bool TryPop(RenderCommand &command);
+
+    private:
+        struct LatestValueSlot {
+            // Packed, so the render thread never reads half of a write.
+            std::atomic<uint64_t> value{0};
+            std::atomic<bool> pending{false};
+        };
+
+        static uint64_t Pack(const RenderCommand &command);
+
+        static RenderCommand Unpack(RenderCommand::Type type, uint64_t value);
+
+        SpscQueue<RenderCommand, RENDER_COMMAND_QUEUE_CAPACITY> queue;
+        std::array<LatestValueSlot, RenderCommand::TYPES_COUNT> slots;
+    };
+}  // namespace lookaround
@@ -0,0 +1,260 @@
+#include "render_graph.h"
+
+#include <android/log.h>
+
+#include <utility>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    RenderGraph::RenderGraph(const GLfloat *triangleVertices)
+            : triangleVertices(triangleVertices) {
+        Clear();
+    }
+
+    void RenderGraph::Clear() {
+        resources.assign(1, Resource{});
+        resources[WINDOW].exported = true;
+        passes.clear();
+        schedule.clear();
+        compiled = false;
+    }
+
+    RenderGraph::ResourceId RenderGraph::ImportTexture(GLenum textureTarget, GLuint textureId) {
+        Resource resource;
+        resource.imported = true;
+        resource.textureTarget = textureTarget;
+        resource.textureId = textureId;
+        resources.push_back(resource);
+        compiled = false;
+        return resources.size() - 1;
+    }
+
+    RenderGraph::ResourceId RenderGraph::CreateTarget(GLsizei divisor) {
+        Resource resource;
+        resource.divisor = divisor;
+        resources.push_back(resource);
+        compiled = false;
+        return resources.size() - 1;
+    }
+
+    void RenderGraph::Export(ResourceId resource) {
+        if (resource >= resources.size()) return;
+        resources[resource].exported = true;
+        compiled = false;
+    }
+
+    void RenderGraph::AddPass(Pass pass) {
+        passes.push_back(std::move(pass));
+        compiled = false;
+    }
+
+    bool RenderGraph::Compile(GLsizei width, GLsizei height) {
+        if (compiled && width == this->width && height == this->height) return true;
+        this->width = width;
+        this->height = height;
+        schedule.clear();
+        if (!Validate()) return false;
+
+        // Walking back from the exported resources, a pass is live if something live reads
+        // what it draws.
+        std::vector<bool> needed(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) needed[i] = resources[i].exported;
+        std::vector<bool> live(passes.size());
+        for (size_t i = passes.size(); i-- > 0;) {
+            if (!needed[passes[i].output]) continue;
+            live[i] = true;
+            needed[passes[i].input] = true;
+        }
+
+        for (size_t i = 0; i < passes.size(); ++i) {
+            if (live[i]) schedule.push_back({i, {passes[i].name, passes[i].timerTag, true, true}});
+        }
+        for (size_t i = 1; i < schedule.size(); ++i) {
+            auto &previous = schedule[i - 1].event;
+            auto &current = schedule[i].event;
+            if (current.timerTag >= 0 && current.timerTag == previous.timerTag) {
+                previous.lastOfTag = false;
+                current.firstOfTag = false;
+            }
+        }
+
+        AllocateTargets();
+        compiled = true;
+#ifndef NDEBUG
+        size_t allocated = 0;
+        for (const auto &resource: resources) {
+            if (resource.target != NO_TARGET) ++allocated;
+        }
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                            "Render graph: %zu of %zu passes, %zu resources in %zu targets.",
+                            schedule.size(), passes.size(), allocated, targets.size());
+#endif
+        return true;
+    }
+
+    bool RenderGraph::Validate() const {
+        std::vector<bool> written(resources.size());
+        for (const auto &pass: passes) {
+            const bool valid =
+                    (pass.run ? pass.output != WINDOW : pass.programs != nullptr) &&
+                    pass.input < resources.size() &&
+                    pass.output < resources.size() && pass.input != WINDOW &&
+                    !resources[pass.output].imported && pass.input != pass.output &&
+                    (resources[pass.input].imported || written[pass.input]) &&
+                    (pass.output == WINDOW || !written[pass.output]);
+            if (!valid) {
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                    "Render graph: invalid pass %s.", pass.name);
+                return false;
+            }
+            written[pass.output] = true;
+        }
+        return true;
+    }
+
+    void RenderGraph::AllocateTargets() {
+        // Schedule index of the last read of each resource, the end for exported ones.
+        std::vector<size_t> lastRead(resources.size(), 0);
+        for (size_t i = 0; i < schedule.size(); ++i) {
+            lastRead[passes[schedule[i].pass].input] = i;
+        }
+        for (size_t i = 0; i < resources.size(); ++i) {
+            if (resources[i].exported) lastRead[i] = SIZE_MAX;
+            resources[i].target = NO_TARGET;
+        }
+
+        // A target is free for a resource written after the last read of its previous one.
+        std::vector<size_t> busyUntil(targets.size(), 0);
+        std::vector<bool> taken(targets.size());
+        for (size_t i = 0; i < schedule.size(); ++i) {
+            const ResourceId output = passes[schedule[i].pass].output;
+            auto &resource = resources[output];
+            if (output == WINDOW || resource.target != NO_TARGET) continue;
+
+            size_t target = NO_TARGET;
+            for (size_t t = 0; t < targets.size(); ++t) {
+                if (targets[t].divisor == resource.divisor && (!taken[t] || busyUntil[t] < i)) {
+                    target = t;
+                    break;
+                }
+            }
+            if (target == NO_TARGET) {
+                targets.push_back(Target{resource.divisor});
+                busyUntil.push_back(0);
+                taken.push_back(false);
+                target = targets.size() - 1;
+            }
+            resource.target = target;
+            taken[target] = true;
+            busyUntil[target] = lastRead[output];
+            SizeTarget(targets[target]);
+        }
+    }
+
+    void RenderGraph::SizeTarget(Target &target) const {
+        const GLsizei targetWidth = width / target.divisor;
+        const GLsizei targetHeight = height / target.divisor;
+        if (target.textureId && target.width == targetWidth && target.height == targetHeight) {
+            return;
+        }
+
+        if (!target.textureId) {
+            CHECK_GL(glGenTextures(1, &target.textureId));
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D, target.textureId));
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        } else {
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D, target.textureId));
+        }
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, targetWidth, targetHeight, 0, GL_RGB,
+                              GL_UNSIGNED_BYTE, nullptr));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        target.width = targetWidth;
+        target.height = targetHeight;
+
+        if (!target.fboId) {
+            CHECK_GL(glGenFramebuffers(1, &target.fboId));
+            CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, target.fboId));
+            CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                            target.textureId, 0));
+            CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+        }
+    }
+
+    void RenderGraph::Execute(const Hooks &hooks) const {
+        for (const auto &scheduled: schedule) {
+            const Pass &pass = passes[scheduled.pass];
+            if (hooks.onPassBegin) hooks.onPassBegin(scheduled.event);
+
+            if (pass.run) {
+                const Target &target = targets[resources[pass.output].target];
+                CHECK_GL(glDisable(GL_SCISSOR_TEST));
+                pass.run(InputTextureId(pass), target.fboId, target.width, target.height);
+                if (hooks.onPassEnd) hooks.onPassEnd(scheduled.event);
+                continue;
+            }
+
+            const auto *program = pass.programs->Get(pass.features ? pass.features() : 0);
+            if (program) {
+                GLsizei outputWidth = width;
+                GLsizei outputHeight = height;
+                if (pass.output == WINDOW) {
+                    CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+                    CHECK_GL(glEnable(GL_SCISSOR_TEST));
+                } else {
+                    const Target &target = targets[resources[pass.output].target];
+                    outputWidth = target.width;
+                    outputHeight = target.height;
+                    CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, target.fboId));
+                    CHECK_GL(glDisable(GL_SCISSOR_TEST));
+                    if (invalidateTargets) {
+                        static constexpr GLenum COLOR_ATTACHMENT[] = {GL_COLOR_ATTACHMENT0};
+                        CHECK_GL(glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, COLOR_ATTACHMENT));
+                    }
+                }
+                CHECK_GL(glViewport(0, 0, outputWidth, outputHeight));
+
+                CHECK_GL(glVertexAttribPointer(program->positionHandle, 2, GL_FLOAT, GL_FALSE, 0,
+                                               triangleVertices));
+                CHECK_GL(glEnableVertexAttribArray(program->positionHandle));
+                CHECK_GL(glUseProgram(program->id));
+                CHECK_GL(glBindTexture(resources[pass.input].textureTarget,
+                                       InputTextureId(pass)));
+                if (pass.setUniforms) pass.setUniforms(*program, outputWidth, outputHeight);
+                CHECK_GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+            }
+
+            if (hooks.onPassEnd) hooks.onPassEnd(scheduled.event);
+        }
+        CHECK_GL(glEnable(GL_SCISSOR_TEST));
+    }
+
+    GLuint RenderGraph::InputTextureId(const Pass &pass) const {
+        const auto &input = resources[pass.input];
+        return input.imported ? input.textureId : targets[input.target].textureId;
+    }
+
+    GLuint RenderGraph::TextureId(ResourceId resource) const {
+        if (resource >= resources.size()) return 0;
+        const auto &entry = resources[resource];
+        if (entry.imported) return entry.textureId;
+        return entry.target != NO_TARGET ? targets[entry.target].textureId : 0;
+    }
+
+    GLuint RenderGraph::FramebufferId(ResourceId resource) const {
+        if (resource >= resources.size()) return 0;
+        const auto &entry = resources[resource];
+        return !entry.imported && entry.target != NO_TARGET ? targets[entry.target].fboId : 0;
+    }
+
+    void RenderGraph::Release() {
+        for (auto &target: targets) {
+            if (target.fboId) CHECK_GL(glDeleteFramebuffers(1, &target.fboId));
+            if (target.textureId) CHECK_GL(glDeleteTextures(1, &target.textureId));
+        }
+        targets.clear();
+        Clear();
+    }
+}  // namespace lookaround
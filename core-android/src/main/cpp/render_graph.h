@@ -0,0 +1,144 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "shader_variants.h"
+
+namespace lookaround {
+    // Fullscreen passes declared by the resources they read and write, compiled into a schedule
+    // for a window size. Compiling culls passes which contribute to no exported resource and
+    // allocates the render targets, sharing one between resources of the same scale whose
+    // lifetimes do not overlap.
+    //
+    // Must be used with a current context.
+    class RenderGraph {
+    public:
+        using ResourceId = size_t;
+
+        // The default framebuffer, output only and always exported. Passes drawing to it are
+        // clipped to the caller's scissor box, offscreen targets are always drawn whole.
+        static constexpr ResourceId WINDOW = 0;
+
+        struct Pass {
+            const char *name = "";
+            ShaderVariants *programs = nullptr;
+            ResourceId input = WINDOW;
+            ResourceId output = WINDOW;
+            // Runs of passes sharing a tag are reported to Hooks, e.g. to be timed as a whole.
+            // -1 for none.
+            GLint timerTag = -1;
+            // Picks the program variant each time the pass runs.
+            std::function<uint32_t()> features;
+            // Sets the uniforms of the variant for an output of width x height; the input is
+            // bound to texture unit 0.
+            std::function<void(const ShaderVariants::Program &program,
+                               GLsizei width,
+                               GLsizei height)> setUniforms;
+            // Draws the whole offscreen output itself instead of a fullscreen triangle of
+            // programs, e.g. with compute passes in between. Must leave the default framebuffer
+            // bound.
+            std::function<void(GLuint inputTextureId,
+                               GLuint outputFramebuffer,
+                               GLsizei width,
+                               GLsizei height)> run;
+        };
+
+        struct PassEvent {
+            const char *name;
+            GLint timerTag;
+            // Ends of the run of passes sharing timerTag.
+            bool firstOfTag;
+            bool lastOfTag;
+        };
+
+        struct Hooks {
+            std::function<void(const PassEvent &)> onPassBegin;
+            std::function<void(const PassEvent &)> onPassEnd;
+        };
+
+        // triangleVertices cover the viewport, see NativeContext::VERTICES.
+        explicit RenderGraph(const GLfloat *triangleVertices);
+
+        // Drops the declared passes and resources. Allocated targets are kept for reuse.
+        void Clear();
+
+        // A texture owned elsewhere, e.g. the camera frame.
+        ResourceId ImportTexture(GLenum textureTarget, GLuint textureId);
+
+        // An RGB target of 1 / divisor of the window size.
+        ResourceId CreateTarget(GLsizei divisor);
+
+        // Keeps resource and the passes it is drawn by for reads after Execute.
+        void Export(ResourceId resource);
+
+        // Passes run in declaration order.
+        void AddPass(Pass pass);
+
+        // Returns false if a pass reads a target before it is written or writes one twice.
+        // Cheap while neither the declarations nor the size changed.
+        bool Compile(GLsizei width, GLsizei height);
+
+        // Whether offscreen targets are invalidated before each pass draws them whole, which
+        // spares tiled GPUs loading their previous contents. Needs ES 3.0.
+        void SetInvalidateTargets(bool invalidate) { invalidateTargets = invalidate; }
+
+        // Leaves the scissor test enabled.
+        void Execute(const Hooks &hooks) const;
+
+        // Of a resource allocated by the last Compile.
+        [[nodiscard]] GLuint TextureId(ResourceId resource) const;
+
+        [[nodiscard]] GLuint FramebufferId(ResourceId resource) const;
+
+        void Release();
+
+    private:
+        static constexpr size_t NO_TARGET = SIZE_MAX;
+
+        struct Resource {
+            bool imported = false;
+            GLenum textureTarget = GL_TEXTURE_2D;
+            GLuint textureId = 0;
+            GLsizei divisor = 1;
+            bool exported = false;
+            size_t target = NO_TARGET;
+        };
+
+        struct Target {
+            GLsizei divisor = 1;
+            GLsizei width = 0;
+            GLsizei height = 0;
+            GLuint textureId = 0;
+            GLuint fboId = 0;
+        };
+
+        struct ScheduledPass {
+            size_t pass;
+            PassEvent event;
+        };
+
+        bool Validate() const;
+
+        void AllocateTargets();
+
+        void SizeTarget(Target &target) const;
+
+        [[nodiscard]] GLuint InputTextureId(const Pass &pass) const;
+
+        const GLfloat *triangleVertices;
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+        std::vector<Target> targets;
+        std::vector<ScheduledPass> schedule;
+
+        bool invalidateTargets = false;
+        bool compiled = false;
+        GLsizei width = 0;
+        GLsizei height = 0;
+    };
+}  // namespace lookaround
@@ -0,0 +1,100 @@
+#include "render_loop.h"
+
+#include <utility>
+
+namespace lookaround {
+    RenderLoop::RenderLoop(FrameSource &source, const FrameClock &clock, Callbacks callbacks,
+                           int64_t frameIntervalNs)
+            : source(source),
+              scheduler(clock, frameIntervalNs),
+              callbacks(std::move(callbacks)) {}
+
+    RenderLoop::~RenderLoop() {
+        Stop();
+    }
+
+    void RenderLoop::Start() {
+        if (running) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopRequested = false;
+            pendingFrames = 0;
+        }
+        running = true;
+        thread = std::thread(&RenderLoop::Loop, this);
+    }
+
+    void RenderLoop::Stop() {
+        if (!running) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopRequested = true;
+        }
+        wakeUp.notify_one();
+        thread.join();
+        running = false;
+    }
+
+    void RenderLoop::OnFrameAvailable() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++pendingFrames;
+        }
+        wakeUp.notify_one();
+    }
+
+    void RenderLoop::RunSync(const std::function<void()> &work) {
+        if (!running || std::this_thread::get_id() == thread.get_id()) {
+            work();
+            return;
+        }
+
+        Task task{&work};
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks.push_back(&task);
+        wakeUp.notify_one();
+        taskDone.wait(lock, [&task] { return task.done; });
+    }
+
+    void RenderLoop::Loop() {
+        if (callbacks.onStart) callbacks.onStart();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait(lock, [this] {
+                return stopRequested || pendingFrames > 0 || !tasks.empty();
+            });
+
+            // Work of other threads goes first, it usually changes what the next frame shows.
+            while (!tasks.empty()) {
+                Task *task = tasks.front();
+                tasks.pop_front();
+                lock.unlock();
+                (*task->work)();
+                lock.lock();
+                task->done = true;
+                taskDone.notify_all();
+            }
+            if (stopRequested) break;
+
+            const uint32_t availableFrames = std::exchange(pendingFrames, 0);
+            if (availableFrames == 0) continue;
+            lock.unlock();
+            DrawNewestFrame(availableFrames);
+            lock.lock();
+        }
+        lock.unlock();
+
+        if (callbacks.onStop) callbacks.onStop();
+    }
+
+    void RenderLoop::DrawNewestFrame(uint32_t availableFrames) {
+        uint32_t latchedFrames = 0;
+        while (latchedFrames < availableFrames && source.Latch()) ++latchedFrames;
+        if (latchedFrames == 0) return;
+
+        const int64_t timestampNs = source.TimestampNs();
+        const auto decision = scheduler.Schedule(timestampNs, latchedFrames - 1);
+        if (decision.render) callbacks.onFrame(timestampNs, decision.presentationTimeNs);
+    }
+}  // namespace lookaround
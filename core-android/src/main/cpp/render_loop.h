@@ -0,0 +1,98 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "frame_scheduler.h"
+
+namespace lookaround {
+    // Stream of camera frames consumed by the render loop, e.g. a SurfaceTexture.
+    class FrameSource {
+    public:
+        virtual ~FrameSource() = default;
+
+        // Makes the next queued frame current, releasing the previous one. Returns false if
+        // nothing could be latched.
+        virtual bool Latch() = 0;
+
+        // Capture time of the current frame.
+        [[nodiscard]] virtual int64_t TimestampNs() const = 0;
+    };
+
+    // Renders camera frames on a dedicated thread. Frames which arrive while the previous one
+    // is being drawn are latched and dropped, only the newest is drawn and presented at the
+    // time picked by FrameScheduler. Other threads run work which needs the thread - like GL
+    // calls against a context it owns - through RunSync.
+    //
+    // Start, Stop and RunSync must be called from a single owner thread; OnFrameAvailable may
+    // be called from any thread.
+    class RenderLoop {
+    public:
+        struct Callbacks {
+            // Called on the loop thread before the first frame and after the last one.
+            std::function<void()> onStart;
+            std::function<void()> onStop;
+            // Draws the current frame of the source and presents it at presentationTimeNs.
+            std::function<void(int64_t timestampNs, int64_t presentationTimeNs)> onFrame;
+        };
+
+        RenderLoop(FrameSource &source, const FrameClock &clock, Callbacks callbacks,
+                   int64_t frameIntervalNs = FrameScheduler::DEFAULT_FRAME_INTERVAL_NS);
+
+        ~RenderLoop();
+
+        RenderLoop(const RenderLoop &) = delete;
+
+        RenderLoop &operator=(const RenderLoop &) = delete;
+
+        void Start();
+
+        // Runs work queued by RunSync, then stops and joins the loop thread.
+        void Stop();
+
+        [[nodiscard]] bool IsRunning() const { return running; }
+
+        // Signals a new frame queued in the source.
+        void OnFrameAvailable();
+
+        // Runs work on the loop thread between frames and waits for it to finish. Runs it
+        // inline when the loop is not running or when called from the loop thread itself.
+        void RunSync(const std::function<void()> &work);
+
+        // Loop thread only, e.g. through RunSync.
+        [[nodiscard]] const FrameScheduler::Stats &GetStats() const {
+            return scheduler.GetStats();
+        }
+
+        // Loop thread only. Call after switching to another frame source.
+        void ResetSchedule() { scheduler.Reset(); }
+
+    private:
+        struct Task {
+            const std::function<void()> *work = nullptr;
+            bool done = false;
+        };
+
+        void Loop();
+
+        void DrawNewestFrame(uint32_t availableFrames);
+
+        FrameSource &source;
+        FrameScheduler scheduler;
+        Callbacks callbacks;
+
+        bool running = false;
+        std::thread thread;
+
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable taskDone;
+        bool stopRequested = false;
+        uint32_t pendingFrames = 0;
+        std::deque<Task *> tasks;
+    };
+}  // namespace lookaround
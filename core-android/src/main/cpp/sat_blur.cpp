@@ -0,0 +1,220 @@
+#include "sat_blur.h"
+
+#include <android/log.h>
+
+#include <string>
+
+#include "gl_check.h"
+#include "gl_program.h"
+
+namespace lookaround {
+    namespace {
+        // Prefix sums of the lines of source, one work group per line: each invocation sums a
+        // chunk of the line, the chunk sums are scanned in shared memory in log2(group size)
+        // steps, then each invocation writes the prefix sums of its chunk from the offset of
+        // the chunks before. ROWS reads the input texture, centered around 0 so the sums of
+        // large tables keep their precision; COLUMNS reads the row sums.
+        constexpr char COMPUTE_SHADER_SRC_SCAN[] = R"SRC(
+precision highp float;
+precision highp int;
+
+#define GROUP_SIZE 128
+layout(local_size_x = GROUP_SIZE) in;
+
+#ifdef ROWS
+uniform highp sampler2D source;
+#else
+layout(rgba32f, binding = 0) readonly uniform highp image2D source;
+#endif
+layout(rgba32f, binding = 1) writeonly uniform highp image2D sums;
+
+shared vec4 chunkSums[GROUP_SIZE];
+
+#ifdef ROWS
+ivec2 Coord(int i, int line) { return ivec2(i, line); }
+int LineLength() { return textureSize(source, 0).x; }
+vec4 Load(ivec2 coord) { return texelFetch(source, coord, 0) - .5; }
+#else
+ivec2 Coord(int i, int line) { return ivec2(line, i); }
+int LineLength() { return imageSize(source).y; }
+vec4 Load(ivec2 coord) { return imageLoad(source, coord); }
+#endif
+
+void main() {
+    int line = int(gl_WorkGroupID.x);
+    int local = int(gl_LocalInvocationID.x);
+    int length = LineLength();
+    int chunk = (length + GROUP_SIZE - 1) / GROUP_SIZE;
+    int begin = min(local * chunk, length);
+    int end = min(begin + chunk, length);
+
+    vec4 sum = vec4(0.);
+    for (int i = begin; i < end; ++i) sum += Load(Coord(i, line));
+    chunkSums[local] = sum;
+    memoryBarrierShared();
+    barrier();
+
+    for (int offset = 1; offset < GROUP_SIZE; offset <<= 1) {
+        vec4 before = local >= offset ? chunkSums[local - offset] : vec4(0.);
+        memoryBarrierShared();
+        barrier();
+        chunkSums[local] += before;
+        memoryBarrierShared();
+        barrier();
+    }
+
+    vec4 prefix = local > 0 ? chunkSums[local - 1] : vec4(0.);
+    for (int i = begin; i < end; ++i) {
+        ivec2 coord = Coord(i, line);
+        prefix += Load(coord);
+        imageStore(sums, coord, prefix);
+    }
+}
+)SRC";
+
+        // Fullscreen triangle from gl_VertexID, no vertex attributes.
+        constexpr char VERTEX_SHADER_SRC_BOX[] = R"SRC(#version 310 es
+void main() {
+    gl_Position = vec4(vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2. - 1., 0., 1.);
+}
+)SRC";
+
+        // Mean of the box of radius around the pixel from the table, clamped to the image.
+        constexpr char FRAGMENT_SHADER_SRC_BOX[] = R"SRC(#version 310 es
+precision highp float;
+precision highp int;
+
+uniform highp sampler2D table;
+uniform int radius;
+
+out vec4 fragColor;
+
+vec4 Sum(ivec2 coord) {
+    return coord.x < 0 || coord.y < 0 ? vec4(0.) : texelFetch(table, coord, 0);
+}
+
+void main() {
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 low = max(coord - radius, ivec2(0)) - 1;
+    ivec2 high = min(coord + radius, textureSize(table, 0) - 1);
+    vec4 sum = Sum(high) - Sum(ivec2(low.x, high.y)) - Sum(ivec2(high.x, low.y)) + Sum(low);
+    vec2 size = vec2(high - low);
+    fragColor = sum / (size.x * size.y) + .5;
+}
+)SRC";
+
+        GLuint CreateScanProgram(const char *define) {
+            const std::string src = std::string("#version 310 es\n#define ") + define + "\n" +
+                                    COMPUTE_SHADER_SRC_SCAN;
+            return CreateGlComputeProgram(src.c_str());
+        }
+
+        void AllocateTexture(GLuint &textureId, GLenum format, GLsizei width, GLsizei height) {
+            if (textureId) CHECK_GL(glDeleteTextures(1, &textureId));
+            CHECK_GL(glGenTextures(1, &textureId));
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D, textureId));
+            // Float textures are not filterable, all reads are texelFetch anyway.
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+            CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+            CHECK_GL(glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height));
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        }
+    }  // namespace
+
+    bool SatBlur::Init() {
+        rowsProgram = CreateScanProgram("ROWS");
+        columnsProgram = CreateScanProgram("COLUMNS");
+        boxProgram = CreateGlProgram(VERTEX_SHADER_SRC_BOX, FRAGMENT_SHADER_SRC_BOX);
+        if (!rowsProgram || !columnsProgram || !boxProgram) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Summed-area table blur disabled: creating GL programs failed.");
+            initialized = true;
+            Release();
+            return false;
+        }
+        boxRadiusHandle = CHECK_GL(glGetUniformLocation(boxProgram, "radius"));
+        CHECK_GL(glUseProgram(boxProgram));
+        CHECK_GL(glUniform1i(glGetUniformLocation(boxProgram, "table"), 0));
+        CHECK_GL(glUseProgram(rowsProgram));
+        CHECK_GL(glUniform1i(glGetUniformLocation(rowsProgram, "source"), 0));
+        CHECK_GL(glUseProgram(0));
+        initialized = true;
+        return true;
+    }
+
+    void SatBlur::Release() {
+        if (!initialized) return;
+
+        for (GLuint program: {rowsProgram, columnsProgram, boxProgram}) {
+            if (program) CHECK_GL(glDeleteProgram(program));
+        }
+        for (GLuint *texture: {&rowSumsTextureId, &tableTextureId, &intermediateTextureId}) {
+            if (*texture) CHECK_GL(glDeleteTextures(1, texture));
+            *texture = 0;
+        }
+        if (intermediateFboId) CHECK_GL(glDeleteFramebuffers(1, &intermediateFboId));
+        rowsProgram = columnsProgram = boxProgram = 0;
+        intermediateFboId = 0;
+        width = height = 0;
+        initialized = false;
+    }
+
+    void SatBlur::Resize(GLsizei newWidth, GLsizei newHeight) {
+        if (newWidth == width && newHeight == height) return;
+        width = newWidth;
+        height = newHeight;
+        AllocateTexture(rowSumsTextureId, GL_RGBA32F, width, height);
+        AllocateTexture(tableTextureId, GL_RGBA32F, width, height);
+        AllocateTexture(intermediateTextureId, GL_RGBA8, width, height);
+        if (!intermediateFboId) CHECK_GL(glGenFramebuffers(1, &intermediateFboId));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, intermediateFboId));
+        CHECK_GL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                        intermediateTextureId, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+
+    void SatBlur::BuildTable(GLuint inputTextureId) {
+        CHECK_GL(glUseProgram(rowsProgram));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, inputTextureId));
+        CHECK_GL(glBindImageTexture(1, rowSumsTextureId, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                                    GL_RGBA32F));
+        CHECK_GL(glDispatchCompute(height, 1, 1));
+        CHECK_GL(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
+
+        CHECK_GL(glUseProgram(columnsProgram));
+        CHECK_GL(glBindImageTexture(0, rowSumsTextureId, 0, GL_FALSE, 0, GL_READ_ONLY,
+                                    GL_RGBA32F));
+        CHECK_GL(glBindImageTexture(1, tableTextureId, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                                    GL_RGBA32F));
+        CHECK_GL(glDispatchCompute(width, 1, 1));
+        CHECK_GL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT));
+    }
+
+    void SatBlur::Blur(GLuint inputTextureId, GLuint outputFramebuffer,
+                       GLsizei outputWidth, GLsizei outputHeight, GLfloat sigma) {
+        Resize(outputWidth, outputHeight);
+        CHECK_GL(glViewport(0, 0, width, height));
+
+        // Boxes of radius 0 copy their input, only the last one is needed then.
+        const auto radii = BoxRadii(sigma);
+        GLint first = 0;
+        while (first < BOX_PASS_COUNT - 1 && radii[first] == 0) ++first;
+
+        GLuint sourceTextureId = inputTextureId;
+        for (GLint pass = first; pass < BOX_PASS_COUNT; ++pass) {
+            BuildTable(sourceTextureId);
+
+            // The table holds all of the source, so the intermediate target can be both.
+            const bool last = pass == BOX_PASS_COUNT - 1;
+            CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER,
+                                       last ? outputFramebuffer : intermediateFboId));
+            CHECK_GL(glUseProgram(boxProgram));
+            CHECK_GL(glUniform1i(boxRadiusHandle, radii[pass]));
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D, tableTextureId));
+            CHECK_GL(glDrawArrays(GL_TRIANGLES, 0, 3));
+            sourceTextureId = intermediateTextureId;
+        }
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    }
+}  // namespace lookaround
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <GLES3/gl31.h>
+
+#include <array>
+
+namespace lookaround {
+    // Approximates a gaussian blur with BOX_PASS_COUNT box filters, each read from a summed-area
+    // table of its input in four fetches per pixel whatever its radius. The tables are built by
+    // a parallel prefix sum over the rows and then the columns in compute shaders, so the cost
+    // per pixel does not grow with the blur radius like the taps of the separable passes do.
+    // Needs ES 3.1.
+    class SatBlur {
+    public:
+        static constexpr GLint BOX_PASS_COUNT = 3;
+
+        // Must be called with a current context. Returns false if the programs failed to build.
+        bool Init();
+
+        void Release();
+
+        [[nodiscard]] bool IsInitialized() const { return initialized; }
+
+        // Radii of the boxes whose successive application approximates a gaussian of sigma, from
+        // "Fast Almost-Gaussian Filtering" by P. Kovesi. Needs no context: it lives in
+        // sat_blur_radii.cpp, apart from the GL code, so the host tests build it.
+        static std::array<GLint, BOX_PASS_COUNT> BoxRadii(GLfloat sigma);
+
+        // Blurs inputTextureId of width x height into the whole of outputFramebuffer of the
+        // same size, by sigma pixels. Leaves the default framebuffer bound.
+        void Blur(GLuint inputTextureId, GLuint outputFramebuffer,
+                  GLsizei width, GLsizei height, GLfloat sigma);
+
+    private:
+        // Invocations sharing the prefix sum of one row or column, the minimum maximum of ES 3.1.
+        static constexpr GLuint SCAN_GROUP_SIZE = 128;
+
+        void Resize(GLsizei width, GLsizei height);
+
+        void BuildTable(GLuint inputTextureId);
+
+        bool initialized = false;
+        GLuint rowsProgram = 0;
+        GLuint columnsProgram = 0;
+        GLuint boxProgram = 0;
+        GLint boxRadiusHandle = -1;
+
+        GLsizei width = 0;
+        GLsizei height = 0;
+        // RGBA32F prefix sums of the rows, then of the columns of those - the table.
+        GLuint rowSumsTextureId = 0;
+        GLuint tableTextureId = 0;
+        // Output of all but the last box pass.
+        GLuint intermediateTextureId = 0;
+        GLuint intermediateFboId = 0;
+    };
+}  // namespace lookaround
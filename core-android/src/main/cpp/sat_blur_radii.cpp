@@ -0,0 +1,21 @@
+#include "sat_blur.h"
+
+#include <cmath>
+
+namespace lookaround {
+    std::array<GLint, SatBlur::BOX_PASS_COUNT> SatBlur::BoxRadii(GLfloat sigma) {
+        constexpr GLfloat n = BOX_PASS_COUNT;
+        const GLfloat variance12 = 12.f * sigma * sigma;
+        // Widths are odd: wl up to the ideal width, wu above it, m passes of wl.
+        auto lower = static_cast<GLint>(std::floor(std::sqrt(variance12 / n + 1.f)));
+        if (lower % 2 == 0) --lower;
+        const GLint upper = lower + 2;
+        const auto m = static_cast<GLint>(std::round(
+                (variance12 - n * lower * lower - 4.f * n * lower - 3.f * n) /
+                (-4.f * lower - 4.f)));
+
+        std::array<GLint, BOX_PASS_COUNT> radii{};
+        for (GLint i = 0; i < BOX_PASS_COUNT; ++i) radii[i] = ((i < m ? lower : upper) - 1) / 2;
+        return radii;
+    }
+}  // namespace lookaround
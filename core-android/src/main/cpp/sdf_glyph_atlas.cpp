@@ -0,0 +1,212 @@
+#include "sdf_glyph_atlas.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "gl_check.h"
+#include "shelf_packer.h"
+
+namespace lookaround {
+    namespace {
+        constexpr float INF = 1e20f;
+
+        // Felzenszwalb & Huttenlocher squared distance transform of a sampled function in 1D.
+        void DistanceTransform1D(const float *f, int n, float *d, int *v, float *z) {
+            int k = 0;
+            v[0] = 0;
+            z[0] = -INF;
+            z[1] = INF;
+            for (int q = 1; q < n; ++q) {
+                float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.f * (q - v[k]));
+                while (s <= z[k]) {
+                    --k;
+                    s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.f * (q - v[k]));
+                }
+                ++k;
+                v[k] = q;
+                z[k] = s;
+                z[k + 1] = INF;
+            }
+            k = 0;
+            for (int q = 0; q < n; ++q) {
+                while (z[k + 1] < q) ++k;
+                d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+            }
+        }
+
+        // In place: grid holds 0 for feature pixels and INF elsewhere on input, squared
+        // distance to the nearest feature pixel on output.
+        void DistanceTransform2D(std::vector<float> &grid, int width, int height) {
+            const int n = std::max(width, height);
+            std::vector<float> f(n), d(n), z(n + 1);
+            std::vector<int> v(n);
+            for (int x = 0; x < width; ++x) {
+                for (int y = 0; y < height; ++y) f[y] = grid[y * width + x];
+                DistanceTransform1D(f.data(), height, d.data(), v.data(), z.data());
+                for (int y = 0; y < height; ++y) grid[y * width + x] = d[y];
+            }
+            for (int y = 0; y < height; ++y) {
+                float *row = &grid[y * width];
+                std::copy(row, row + width, f.begin());
+                DistanceTransform1D(f.data(), width, d.data(), v.data(), z.data());
+                std::copy(d.begin(), d.begin() + width, row);
+            }
+        }
+
+        // Writes the glyph's distance field (width + 2 * SPREAD wide) to out, 128 is the edge.
+        void GenerateDistanceField(const SdfGlyphAtlas::GlyphBitmap &bitmap,
+                                   uint8_t *out,
+                                   GLsizei outStride) {
+            constexpr int spread = SdfGlyphAtlas::SPREAD;
+            const int width = bitmap.width + 2 * spread;
+            const int height = bitmap.height + 2 * spread;
+            std::vector<float> outside(width * height);
+            std::vector<float> inside(width * height);
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const int bitmapX = x - spread;
+                    const int bitmapY = y - spread;
+                    const bool covered =
+                            bitmapX >= 0 && bitmapX < bitmap.width &&
+                            bitmapY >= 0 && bitmapY < bitmap.height &&
+                            bitmap.coverage[bitmapY * bitmap.stride + bitmapX] >= 128;
+                    outside[y * width + x] = covered ? 0.f : INF;
+                    inside[y * width + x] = covered ? INF : 0.f;
+                }
+            }
+            DistanceTransform2D(outside, width, height);
+            DistanceTransform2D(inside, width, height);
+
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    const float distance = std::sqrt(outside[y * width + x]) -
+                                           std::sqrt(inside[y * width + x]);
+                    const float value = 128.f - distance * (127.f / spread);
+                    out[y * outStride + x] =
+                            static_cast<uint8_t>(std::clamp(value, 0.f, 255.f));
+                }
+            }
+        }
+
+        struct CacheHeader {
+            uint32_t magic;
+            uint32_t version;
+            GLfloat rasterSize;
+            GLsizei spread;
+            GLsizei width;
+            GLsizei height;
+            uint32_t glyphsCount;
+        };
+    }  // namespace
+
+    bool SdfGlyphAtlas::Build(const std::vector<GlyphBitmap> &bitmaps, GLfloat size) {
+        std::vector<PackSize> sizes;
+        sizes.reserve(bitmaps.size());
+        for (const auto &bitmap: bitmaps) {
+            sizes.push_back({bitmap.width + 2 * SPREAD, bitmap.height + 2 * SPREAD});
+        }
+        std::vector<PackPosition> positions;
+        GLsizei atlasWidth = 0;
+        GLsizei atlasHeight = 0;
+        if (!PackAtlas(sizes, PADDING, MAX_ATLAS_SIZE, &atlasWidth, &atlasHeight, positions)) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "%zu glyphs do not fit into the SDF atlas.", bitmaps.size());
+            return false;
+        }
+
+        rasterSize = size;
+        width = atlasWidth;
+        height = atlasHeight;
+        pixels.assign(static_cast<size_t>(width) * height, 0);
+        glyphs.clear();
+        glyphs.reserve(bitmaps.size());
+        for (size_t i = 0; i < bitmaps.size(); ++i) {
+            const auto &bitmap = bitmaps[i];
+            const auto &position = positions[i];
+            GenerateDistanceField(bitmap, &pixels[position.y * width + position.x], width);
+            glyphs.push_back({
+                    bitmap.codepoint,
+                    bitmap.advance,
+                    bitmap.bearingX - SPREAD,
+                    bitmap.bearingY + SPREAD,
+                    (GLfloat) sizes[i].width,
+                    (GLfloat) sizes[i].height,
+                    (GLfloat) position.x / (GLfloat) width,
+                    (GLfloat) position.y / (GLfloat) height,
+                    (GLfloat) (position.x + sizes[i].width) / (GLfloat) width,
+                    (GLfloat) (position.y + sizes[i].height) / (GLfloat) height});
+        }
+        std::sort(glyphs.begin(), glyphs.end(), [](const Glyph &lhs, const Glyph &rhs) {
+            return lhs.codepoint < rhs.codepoint;
+        });
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "Generated %zu SDF glyphs in %dx%d atlas.",
+                            glyphs.size(), width, height);
+        return true;
+    }
+
+    bool SdfGlyphAtlas::Load(const char *path, GLfloat size) {
+        FILE *file = fopen(path, "rb");
+        if (!file) return false;
+
+        CacheHeader header{};
+        bool loaded = fread(&header, sizeof(header), 1, file) == 1 &&
+                      header.magic == CACHE_MAGIC &&
+                      header.version == CACHE_VERSION &&
+                      header.rasterSize == size &&
+                      header.spread == SPREAD &&
+                      header.width > 0 && header.width <= MAX_ATLAS_SIZE &&
+                      header.height > 0 && header.height <= MAX_ATLAS_SIZE;
+        if (loaded) {
+            std::vector<Glyph> cachedGlyphs(header.glyphsCount);
+            std::vector<uint8_t> cachedPixels(static_cast<size_t>(header.width) * header.height);
+            loaded = fread(cachedGlyphs.data(), sizeof(Glyph), cachedGlyphs.size(), file) ==
+                     cachedGlyphs.size() &&
+                     fread(cachedPixels.data(), 1, cachedPixels.size(), file) ==
+                     cachedPixels.size();
+            if (loaded) {
+                rasterSize = header.rasterSize;
+                width = header.width;
+                height = header.height;
+                glyphs = std::move(cachedGlyphs);
+                pixels = std::move(cachedPixels);
+            }
+        }
+        fclose(file);
+        return loaded;
+    }
+
+    bool SdfGlyphAtlas::Save(const char *path) const {
+        // Write to a temporary file first so a crash never leaves a truncated cache behind.
+        const std::string tmpPath = std::string(path) + ".tmp";
+        FILE *file = fopen(tmpPath.c_str(), "wb");
+        if (!file) return false;
+
+        const CacheHeader header{CACHE_MAGIC, CACHE_VERSION, rasterSize, SPREAD, width, height,
+                                 static_cast<uint32_t>(glyphs.size())};
+        bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                       fwrite(glyphs.data(), sizeof(Glyph), glyphs.size(), file) ==
+                       glyphs.size() &&
+                       fwrite(pixels.data(), 1, pixels.size(), file) == pixels.size();
+        written = fclose(file) == 0 && written;
+        if (!written || rename(tmpPath.c_str(), path) != 0) {
+            remove(tmpPath.c_str());
+            __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "Failed to cache SDF atlas at %s.",
+                                path);
+            return false;
+        }
+        return true;
+    }
+
+    const SdfGlyphAtlas::Glyph *SdfGlyphAtlas::Find(uint32_t codepoint) const {
+        auto found = std::lower_bound(
+                glyphs.begin(), glyphs.end(), codepoint,
+                [](const Glyph &glyph, uint32_t value) { return glyph.codepoint < value; });
+        return found != glyphs.end() && found->codepoint == codepoint ? &*found : nullptr;
+    }
+}  // namespace lookaround
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace lookaround {
+    // Signed distance field glyph atlas. Glyph coverage bitmaps are turned into distance fields
+    // (exact euclidean distance transform), packed into one single channel atlas and cached on
+    // disk, so the (slow) generation only happens once per font and cache version.
+    class SdfGlyphAtlas {
+    public:
+        // Distance (in raster pixels) covered by the field on each side of a glyph's edge.
+        static constexpr GLsizei SPREAD = 6;
+        static constexpr GLsizei PADDING = 1;
+        static constexpr GLsizei MAX_ATLAS_SIZE = 2048;
+        static constexpr uint32_t CACHE_MAGIC = 0x4644534c; // "LSDF"
+        static constexpr uint32_t CACHE_VERSION = 2;
+
+        struct GlyphBitmap {
+            uint32_t codepoint;
+            const uint8_t *coverage; // A_8
+            GLsizei width;
+            GLsizei height;
+            GLsizei stride;
+            GLfloat advance;
+            GLfloat bearingX; // pen position to the bitmap's left edge
+            GLfloat bearingY; // baseline up to the bitmap's top edge
+        };
+
+        // Metrics are in raster pixels and include the SPREAD border.
+        struct Glyph {
+            uint32_t codepoint;
+            GLfloat advance;
+            GLfloat left;
+            GLfloat top;
+            GLfloat width;
+            GLfloat height;
+            GLfloat u0, v0, u1, v1;
+        };
+
+        bool Build(const std::vector<GlyphBitmap> &bitmaps, GLfloat rasterSize);
+
+        // Returns false if there is no cache for the same rasterSize and version.
+        bool Load(const char *path, GLfloat rasterSize);
+
+        bool Save(const char *path) const;
+
+        [[nodiscard]] const Glyph *Find(uint32_t codepoint) const;
+
+        [[nodiscard]] bool IsEmpty() const { return glyphs.empty(); }
+
+        [[nodiscard]] GLfloat RasterSize() const { return rasterSize; }
+
+        [[nodiscard]] GLsizei Width() const { return width; }
+
+        [[nodiscard]] GLsizei Height() const { return height; }
+
+        [[nodiscard]] const uint8_t *Pixels() const { return pixels.data(); }
+
+    private:
+        GLfloat rasterSize = 0.f;
+        GLsizei width = 0;
+        GLsizei height = 0;
+        std::vector<Glyph> glyphs; // sorted by codepoint
+        std::vector<uint8_t> pixels;
+    };
+}  // namespace lookaround
@@ -0,0 +1,108 @@
+#include "shader_variants.h"
+
+#include <android/log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "gl_check.h"
+#include "gl_program.h"
+
+namespace lookaround {
+    ShaderVariants::ShaderVariants(const char *vertexShaderSrc,
+                                   const char *fragmentShaderSrc,
+                                   std::vector<const char *> featureDefines,
+                                   std::vector<const char *> uniformNames)
+            : vertexShaderSrc(vertexShaderSrc),
+              fragmentShaderSrc(fragmentShaderSrc),
+              featureDefines(std::move(featureDefines)),
+              uniformNames(std::move(uniformNames)),
+              variants(size_t{1} << this->featureDefines.size()) {}
+
+    const ShaderVariants::Program *ShaderVariants::Get(uint32_t features) {
+        if (features >= variants.size()) return nullptr;
+
+        auto &variant = variants[features];
+        if (!variant.built) {
+            variant.built = true;
+            const std::string vertexSrc = Specialize(vertexShaderSrc, features);
+            const std::string fragmentSrc = Specialize(fragmentShaderSrc, features);
+            variant.program.id = CreateGlProgram(vertexSrc.c_str(), fragmentSrc.c_str());
+            if (!variant.program.id) {
+                __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                    "Failed to build shader variant 0x%x.", features);
+                return nullptr;
+            }
+
+            variant.program.positionHandle =
+                    CHECK_GL(glGetAttribLocation(variant.program.id, "position"));
+            variant.program.uniformHandles = ReflectUniformHandles(variant.program.id, features);
+        }
+        return variant.program.id ? &variant.program : nullptr;
+    }
+
+    std::vector<GLint> ShaderVariants::ReflectUniformHandles(GLuint programId,
+                                                              uint32_t features) const {
+        // Only what the variant kept is active, compiled out uniforms stay at -1.
+        std::vector<GLint> handles(uniformNames.size(), -1);
+        GLint activeUniforms = 0;
+        CHECK_GL(glGetProgramiv(programId, GL_ACTIVE_UNIFORMS, &activeUniforms));
+        GLint maxNameLength = 0;
+        CHECK_GL(glGetProgramiv(programId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength));
+        std::string name(static_cast<size_t>(std::max(maxNameLength, 1)), '\0');
+        for (GLint i = 0; i < activeUniforms; ++i) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            CHECK_GL(glGetActiveUniform(programId, static_cast<GLuint>(i),
+                                        static_cast<GLsizei>(name.size()), &length, &size,
+                                        &type, name.data()));
+            std::string uniformName(name.data(), static_cast<size_t>(length));
+            // Arrays are reported by their first element.
+            const size_t arraySuffix = uniformName.rfind("[0]");
+            if (arraySuffix != std::string::npos && arraySuffix + 3 == uniformName.size()) {
+                uniformName.resize(arraySuffix);
+            }
+
+            const auto known = std::find_if(
+                    uniformNames.begin(), uniformNames.end(),
+                    [&uniformName](const char *knownName) { return uniformName == knownName; });
+            if (known == uniformNames.end()) {
+                // It would never be set.
+                __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                    "Shader variant 0x%x has unknown uniform %s.",
+                                    features, uniformName.c_str());
+                continue;
+            }
+            handles[static_cast<size_t>(known - uniformNames.begin())] =
+                    CHECK_GL(glGetUniformLocation(programId, uniformName.c_str()));
+        }
+        return handles;
+    }
+
+    void ShaderVariants::Release() {
+        for (auto &variant: variants) {
+            if (variant.program.id) CHECK_GL(glDeleteProgram(variant.program.id));
+            variant = Variant{};
+        }
+    }
+
+    std::string ShaderVariants::Specialize(const char *shaderSrc, uint32_t features) const {
+        // #version has to stay the first line.
+        const char *versionEnd = strchr(shaderSrc, '\n');
+        const size_t headerLength =
+                versionEnd ? static_cast<size_t>(versionEnd - shaderSrc) + 1 : strlen(shaderSrc);
+
+        std::string specialized(shaderSrc, headerLength);
+        for (size_t i = 0; i < featureDefines.size(); ++i) {
+            if (!(features & (1u << i))) continue;
+            specialized += "#define ";
+            specialized += featureDefines[i];
+            specialized += '\n';
+        }
+        specialized += shaderSrc + headerLength;
+        return specialized;
+    }
+}  // namespace lookaround
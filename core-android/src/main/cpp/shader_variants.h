@@ -0,0 +1,58 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lookaround {
+    // Programs specialized from one vertex and fragment shader pair for combinations of
+    // features. Each feature is a preprocessor define inserted after the #version line, so the
+    // shaders test it with #ifdef instead of branching on a uniform for every pixel. Variants
+    // are compiled when first used.
+    class ShaderVariants {
+    public:
+        struct Program {
+            GLuint id = 0;
+            GLint positionHandle = -1;
+            // Locations of the variant's active uniforms, reflected once it is built, in the
+            // order of the names passed to the constructor. -1 for those the variant compiled
+            // out - glUniform* ignores them.
+            std::vector<GLint> uniformHandles;
+        };
+
+        // Feature bit i of Get enables featureDefines[i]. Sources and names must outlive the
+        // variants.
+        ShaderVariants(const char *vertexShaderSrc,
+                       const char *fragmentShaderSrc,
+                       std::vector<const char *> featureDefines,
+                       std::vector<const char *> uniformNames);
+
+        // Must be called with a current context. Returns null if the variant failed to build,
+        // which is not retried.
+        const Program *Get(uint32_t features);
+
+        void Release();
+
+    private:
+        struct Variant {
+            bool built = false;
+            Program program;
+        };
+
+        [[nodiscard]] std::string Specialize(const char *shaderSrc, uint32_t features) const;
+
+        // Enumerates the active uniforms of a built variant into Program::uniformHandles.
+        [[nodiscard]] std::vector<GLint> ReflectUniformHandles(GLuint programId,
+                                                               uint32_t features) const;
+
+        const char *vertexShaderSrc;
+        const char *fragmentShaderSrc;
+        std::vector<const char *> featureDefines;
+        std::vector<const char *> uniformNames;
+        // Indexed by features.
+        std::vector<Variant> variants;
+    };
+}  // namespace lookaround
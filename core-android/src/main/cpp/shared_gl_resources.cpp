@@ -0,0 +1,85 @@
+#include "shared_gl_resources.h"
+
+#include <android/log.h>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    std::mutex SharedGlResources::registryMutex;
+    std::weak_ptr<SharedGlResources> SharedGlResources::registry;
+
+    std::shared_ptr<SharedGlResources> SharedGlResources::Acquire(EGLDisplay display,
+                                                                  EGLConfig config,
+                                                                  const EGLint *contextAttribs) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        if (auto resources = registry.lock()) {
+            if (resources->display == display) return resources;
+            // Renderers on another display keep their resources to themselves.
+        }
+
+        EGLContext rootContext = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                                                  contextAttribs);
+        if (rootContext == EGL_NO_CONTEXT) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to create shared GL resources root context.");
+            return nullptr;
+        }
+        std::shared_ptr<SharedGlResources> resources(
+                new SharedGlResources(display, rootContext));
+        registry = resources;
+        return resources;
+    }
+
+    SharedGlResources::SharedGlResources(EGLDisplay display, EGLContext rootContext)
+            : display(display), rootContext(rootContext) {}
+
+    SharedGlResources::~SharedGlResources() {
+        for (auto &[key, buffer]: buffers) CHECK_GL(glDeleteBuffers(1, &buffer));
+        // Only left if a renderer failed to release them.
+        for (auto &[key, shared]: textures) CHECK_GL(glDeleteTextures(1, &shared.texture));
+        // Never current, so destroyed right away. The objects live on in the group of the
+        // caller's context until it is destroyed as well.
+        eglDestroyContext(display, rootContext);
+    }
+
+    GLuint SharedGlResources::Buffer(const char *key, const void *data, GLsizeiptr size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = buffers.find(key);
+        if (found != buffers.end()) return found->second;
+
+        GLuint buffer = 0;
+        CHECK_GL(glGenBuffers(1, &buffer));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+        CHECK_GL(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        // Other contexts only see the contents once the commands creating them completed.
+        CHECK_GL(glFinish());
+        buffers.emplace(key, buffer);
+        return buffer;
+    }
+
+    GLuint SharedGlResources::AcquireTexture(const std::string &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = textures.find(key);
+        if (found == textures.end()) return 0;
+        ++found->second.references;
+        return found->second.texture;
+    }
+
+    GLuint SharedGlResources::PublishTexture(const std::string &key, GLuint texture) {
+        CHECK_GL(glFinish());
+        std::lock_guard<std::mutex> lock(mutex);
+        auto [found, published] = textures.emplace(key, SharedTexture{texture, 0});
+        if (!published) CHECK_GL(glDeleteTextures(1, &texture));
+        ++found->second.references;
+        return found->second.texture;
+    }
+
+    void SharedGlResources::ReleaseTexture(const std::string &key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = textures.find(key);
+        if (found == textures.end() || --found->second.references > 0) return;
+        CHECK_GL(glDeleteTextures(1, &found->second.texture));
+        textures.erase(found);
+    }
+}  // namespace lookaround
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace lookaround {
+    // GL objects created once per process and shared by every renderer. Renderer contexts are
+    // created in the share group of a root context held here, so textures and buffers created
+    // by one are usable by all. Reference counted by the renderers: the last one to release it
+    // deletes the objects, with its context current.
+    //
+    // Shared objects are immutable once published. Methods are thread safe, but must be called
+    // with a context of the share group current.
+    class SharedGlResources {
+    public:
+        // Unit quad corners (0, 0), (1, 0), (0, 1), (1, 1) as a triangle strip of vec2.
+        static constexpr const char *QUAD_CORNERS_BUFFER = "quadCorners";
+
+        // The resources of display, created with a root context from config and contextAttribs
+        // if no renderer holds them. Returns null if the root context could not be created.
+        static std::shared_ptr<SharedGlResources> Acquire(EGLDisplay display, EGLConfig config,
+                                                          const EGLint *contextAttribs);
+
+        ~SharedGlResources();
+
+        SharedGlResources(const SharedGlResources &) = delete;
+
+        SharedGlResources &operator=(const SharedGlResources &) = delete;
+
+        // To be passed as the share context of renderer contexts.
+        [[nodiscard]] EGLContext ShareContext() const { return rootContext; }
+
+        // A GL_STATIC_DRAW array buffer of data, created by the first call for key.
+        GLuint Buffer(const char *key, const void *data, GLsizeiptr size);
+
+        // The texture published under key, with a reference taken on it. 0 if there is none
+        // yet, without a reference then.
+        GLuint AcquireTexture(const std::string &key);
+
+        // Takes over texture, uploaded by the caller, and publishes it under key with a
+        // reference taken on it. Returns the texture to use instead: the one published first if
+        // another renderer raced the caller, which deletes texture.
+        GLuint PublishTexture(const std::string &key, GLuint texture);
+
+        // Drops a reference taken on the texture of key, deleting the texture with the last one:
+        // content keyed textures such as glyph atlases are not kept around once unused.
+        void ReleaseTexture(const std::string &key);
+
+    private:
+        SharedGlResources(EGLDisplay display, EGLContext rootContext);
+
+        static std::mutex registryMutex;
+        static std::weak_ptr<SharedGlResources> registry;
+
+        EGLDisplay display;
+        EGLContext rootContext;
+        std::mutex mutex;
+        struct SharedTexture {
+            GLuint texture;
+            GLint references;
+        };
+
+        std::map<std::string, GLuint> buffers;
+        std::map<std::string, SharedTexture> textures;
+    };
+}  // namespace lookaround
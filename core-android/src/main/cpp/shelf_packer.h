@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <vector>
+
+namespace lookaround {
+    struct PackSize {
+        GLsizei width;
+        GLsizei height;
+    };
+
+    struct PackPosition {
+        GLsizei x;
+        GLsizei y;
+    };
+
+    // Shelf packing of rects sorted by descending height into an atlas of the given width.
+    // Returns the used atlas height, or -1 if a rect is wider than the atlas.
+    inline GLsizei PackShelves(const std::vector<PackSize> &sizes,
+                               const std::vector<size_t> &order,
+                               GLsizei padding,
+                               GLsizei atlasWidth,
+                               std::vector<PackPosition> &positions) {
+        GLsizei shelfX = 0;
+        GLsizei shelfY = 0;
+        GLsizei shelfHeight = 0;
+        for (auto index: order) {
+            GLsizei paddedWidth = sizes[index].width + padding;
+            GLsizei paddedHeight = sizes[index].height + padding;
+            if (paddedWidth > atlasWidth) return -1;
+            if (shelfX + paddedWidth > atlasWidth) {
+                shelfY += shelfHeight;
+                shelfX = 0;
+                shelfHeight = 0;
+            }
+            positions[index] = {shelfX, shelfY};
+            shelfX += paddedWidth;
+            shelfHeight = std::max(shelfHeight, paddedHeight);
+        }
+        return shelfY + shelfHeight;
+    }
+
+    // Packs rects into the smallest power of two wide atlas (starting at 256) which is at least
+    // as wide as it is high. Returns false if they do not fit into maxSize x maxSize.
+    inline bool PackAtlas(const std::vector<PackSize> &sizes,
+                          GLsizei padding,
+                          GLsizei maxSize,
+                          GLsizei *atlasWidth,
+                          GLsizei *atlasHeight,
+                          std::vector<PackPosition> &positions) {
+        std::vector<size_t> order(sizes.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&sizes](size_t lhs, size_t rhs) {
+            return sizes[lhs].height > sizes[rhs].height;
+        });
+        positions.resize(sizes.size());
+
+        GLsizei width = 256;
+        GLsizei height = PackShelves(sizes, order, padding, width, positions);
+        while ((height < 0 || height > width) && width < maxSize) {
+            width *= 2;
+            height = PackShelves(sizes, order, padding, width, positions);
+        }
+        if (height < 0 || height > maxSize) return false;
+
+        *atlasWidth = width;
+        *atlasHeight = std::max(height, 1);
+        return true;
+    }
+}  // namespace lookaround
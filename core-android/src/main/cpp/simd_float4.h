@@ -0,0 +1,158 @@
+#pragma once
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LOOKAROUND_SIMD_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define LOOKAROUND_SIMD_SSE 1
+#endif
+
+namespace lookaround {
+    // Minimal 4-wide float vector over NEON (arm), SSE2 (x86) or plain arrays elsewhere.
+    // Masks have all bits of a lane set (true) or cleared (false); the scalar fallback uses
+    // 1 and 0 instead.
+#if defined(LOOKAROUND_SIMD_NEON)
+    struct Float4 {
+        float32x4_t v;
+    };
+
+    inline Float4 Load4(const float *p) { return {vld1q_f32(p)}; }
+
+    inline void Store4(float *p, Float4 a) { vst1q_f32(p, a.v); }
+
+    inline Float4 Splat4(float s) { return {vdupq_n_f32(s)}; }
+
+    inline Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+
+    inline Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+
+    inline Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+
+    inline Float4 operator/(Float4 a, Float4 b) {
+#if defined(__aarch64__)
+        return {vdivq_f32(a.v, b.v)};
+#else
+        // armv7 has no vector division: refine the reciprocal estimate twice.
+        float32x4_t reciprocal = vrecpeq_f32(b.v);
+        reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+        reciprocal = vmulq_f32(vrecpsq_f32(b.v, reciprocal), reciprocal);
+        return {vmulq_f32(a.v, reciprocal)};
+#endif
+    }
+
+    inline Float4 Greater4(Float4 a, Float4 b) {
+        return {vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v))};
+    }
+
+    inline Float4 GreaterEqual4(Float4 a, Float4 b) {
+        return {vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v))};
+    }
+
+    inline Float4 LessEqual4(Float4 a, Float4 b) {
+        return {vreinterpretq_f32_u32(vcleq_f32(a.v, b.v))};
+    }
+
+    inline Float4 And4(Float4 a, Float4 b) {
+        return {vreinterpretq_f32_u32(
+                vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v)))};
+    }
+
+    // Lanes of a where mask is set, of b elsewhere.
+    inline Float4 Select4(Float4 mask, Float4 a, Float4 b) {
+        return {vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v)};
+    }
+#elif defined(LOOKAROUND_SIMD_SSE)
+    struct Float4 {
+        __m128 v;
+    };
+
+    inline Float4 Load4(const float *p) { return {_mm_loadu_ps(p)}; }
+
+    inline void Store4(float *p, Float4 a) { _mm_storeu_ps(p, a.v); }
+
+    inline Float4 Splat4(float s) { return {_mm_set1_ps(s)}; }
+
+    inline Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+
+    inline Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+
+    inline Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+
+    inline Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    inline Float4 Greater4(Float4 a, Float4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+
+    inline Float4 GreaterEqual4(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+
+    inline Float4 LessEqual4(Float4 a, Float4 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+
+    inline Float4 And4(Float4 a, Float4 b) { return {_mm_and_ps(a.v, b.v)}; }
+
+    // Lanes of a where mask is set, of b elsewhere.
+    inline Float4 Select4(Float4 mask, Float4 a, Float4 b) {
+        return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))};
+    }
+#else
+    struct Float4 {
+        float v[4];
+    };
+
+    template<typename Op>
+    inline Float4 Map4(Float4 a, Float4 b, Op op) {
+        return {{op(a.v[0], b.v[0]), op(a.v[1], b.v[1]), op(a.v[2], b.v[2]), op(a.v[3], b.v[3])}};
+    }
+
+    inline Float4 Mask4(bool l0, bool l1, bool l2, bool l3) {
+        return {{l0 ? 1.f : 0.f, l1 ? 1.f : 0.f, l2 ? 1.f : 0.f, l3 ? 1.f : 0.f}};
+    }
+
+    inline bool IsSet(float lane) { return lane != 0.f; }
+
+    inline Float4 Load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+
+    inline void Store4(float *p, Float4 a) {
+        for (int i = 0; i < 4; ++i) p[i] = a.v[i];
+    }
+
+    inline Float4 Splat4(float s) { return {{s, s, s, s}}; }
+
+    inline Float4 operator+(Float4 a, Float4 b) {
+        return Map4(a, b, [](float x, float y) { return x + y; });
+    }
+
+    inline Float4 operator-(Float4 a, Float4 b) {
+        return Map4(a, b, [](float x, float y) { return x - y; });
+    }
+
+    inline Float4 operator*(Float4 a, Float4 b) {
+        return Map4(a, b, [](float x, float y) { return x * y; });
+    }
+
+    inline Float4 operator/(Float4 a, Float4 b) {
+        return Map4(a, b, [](float x, float y) { return x / y; });
+    }
+
+    inline Float4 Greater4(Float4 a, Float4 b) {
+        return Mask4(a.v[0] > b.v[0], a.v[1] > b.v[1], a.v[2] > b.v[2], a.v[3] > b.v[3]);
+    }
+
+    inline Float4 GreaterEqual4(Float4 a, Float4 b) {
+        return Mask4(a.v[0] >= b.v[0], a.v[1] >= b.v[1], a.v[2] >= b.v[2], a.v[3] >= b.v[3]);
+    }
+
+    inline Float4 LessEqual4(Float4 a, Float4 b) {
+        return Mask4(a.v[0] <= b.v[0], a.v[1] <= b.v[1], a.v[2] <= b.v[2], a.v[3] <= b.v[3]);
+    }
+
+    inline Float4 And4(Float4 a, Float4 b) {
+        return a * b;
+    }
+
+    // Lanes of a where mask is set, of b elsewhere.
+    inline Float4 Select4(Float4 mask, Float4 a, Float4 b) {
+        return {{IsSet(mask.v[0]) ? a.v[0] : b.v[0], IsSet(mask.v[1]) ? a.v[1] : b.v[1],
+                 IsSet(mask.v[2]) ? a.v[2] : b.v[2], IsSet(mask.v[3]) ? a.v[3] : b.v[3]}};
+    }
+#endif
+}  // namespace lookaround
@@ -0,0 +1,220 @@
+#include "sprite_batcher.h"
+
+#include <android/log.h>
+
+#include <cstring>
+
+#include "gl_check.h"
+#include "gl_program.h"
+#include "shelf_packer.h"
+
+namespace lookaround {
+    namespace {
+        constexpr char VERTEX_SHADER_SRC_SPRITE[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform vec2 viewportSize;
+
+in vec2 corner;
+in vec4 instanceRect;
+in vec4 instanceUv;
+in float instanceOpacity;
+
+out vec2 texCoord;
+out float opacity;
+
+void main() {
+    vec2 position = instanceRect.xy + (corner * 2. - vec2(1.)) * instanceRect.zw;
+    gl_Position = vec4(position / viewportSize * 2. - vec2(1.), 0., 1.);
+    // Atlas rows are stored top-down, so the top corner samples v0.
+    texCoord = mix(instanceUv.xy, instanceUv.zw, vec2(corner.x, 1. - corner.y));
+    opacity = instanceOpacity;
+}
+)SRC";
+
+        constexpr char FRAGMENT_SHADER_SRC_SPRITE[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform sampler2D atlas;
+
+in vec2 texCoord;
+in float opacity;
+out vec4 fragColor;
+
+void main() {
+    fragColor = texture(atlas, texCoord) * opacity;
+}
+)SRC";
+
+        constexpr GLfloat CORNERS[] = {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+    }  // namespace
+
+    bool SpriteBatcher::Init(SharedGlResources &sharedResources) {
+        program = CreateGlProgram(VERTEX_SHADER_SRC_SPRITE, FRAGMENT_SHADER_SRC_SPRITE);
+        if (!program) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Sprites disabled: creating GL program failed.");
+            return false;
+        }
+        viewportSizeHandle = CHECK_GL(glGetUniformLocation(program, "viewportSize"));
+        atlasHandle = CHECK_GL(glGetUniformLocation(program, "atlas"));
+        auto cornerHandle = CHECK_GL(glGetAttribLocation(program, "corner"));
+        auto rectHandle = CHECK_GL(glGetAttribLocation(program, "instanceRect"));
+        auto uvHandle = CHECK_GL(glGetAttribLocation(program, "instanceUv"));
+        auto opacityHandle = CHECK_GL(glGetAttribLocation(program, "instanceOpacity"));
+
+        CHECK_GL(glGenVertexArrays(1, &vaoId));
+        CHECK_GL(glBindVertexArray(vaoId));
+
+        cornersVboId = sharedResources.Buffer(SharedGlResources::QUAD_CORNERS_BUFFER, CORNERS,
+                                              sizeof(CORNERS));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, cornersVboId));
+        CHECK_GL(glVertexAttribPointer(cornerHandle, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+        CHECK_GL(glEnableVertexAttribArray(cornerHandle));
+
+        CHECK_GL(glGenBuffers(1, &instancesVboId));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        constexpr GLsizei stride = sizeof(Instance);
+        CHECK_GL(glVertexAttribPointer(rectHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(
+                                               offsetof(Instance, centerX))));
+        CHECK_GL(glVertexAttribPointer(uvHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(offsetof(Instance, u0))));
+        CHECK_GL(glVertexAttribPointer(opacityHandle, 1, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(
+                                               offsetof(Instance, opacity))));
+        for (auto handle: {rectHandle, uvHandle, opacityHandle}) {
+            CHECK_GL(glEnableVertexAttribArray(handle));
+            CHECK_GL(glVertexAttribDivisor(handle, 1));
+        }
+
+        CHECK_GL(glBindVertexArray(0));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        CHECK_GL(glGenTextures(1, &atlasTextureId));
+        initialized = true;
+        return true;
+    }
+
+    void SpriteBatcher::Release() {
+        if (!initialized) return;
+
+        CHECK_GL(glDeleteTextures(1, &atlasTextureId));
+        CHECK_GL(glDeleteBuffers(1, &instancesVboId));
+        CHECK_GL(glDeleteVertexArrays(1, &vaoId));
+        CHECK_GL(glDeleteProgram(program));
+        instancesVboCapacity = 0;
+        regions.clear();
+        spritesCount = 0;
+        initialized = false;
+    }
+
+    bool SpriteBatcher::LoadAtlas(const std::vector<Icon> &icons) {
+        if (!initialized) return false;
+
+        std::vector<PackSize> sizes;
+        sizes.reserve(icons.size());
+        for (const auto &icon: icons) sizes.push_back({icon.width, icon.height});
+        std::vector<PackPosition> placements;
+        GLsizei atlasWidth = 0;
+        GLsizei atlasHeight = 0;
+        if (!PackAtlas(sizes, ATLAS_PADDING, MAX_ATLAS_SIZE, &atlasWidth, &atlasHeight,
+                       placements)) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "%zu sprite icons do not fit into the atlas.", icons.size());
+            return false;
+        }
+
+        std::vector<uint8_t> atlasPixels(static_cast<size_t>(atlasWidth) * atlasHeight * 4);
+        regions.resize(icons.size());
+        for (size_t i = 0; i < icons.size(); ++i) {
+            const auto &icon = icons[i];
+            const auto &placement = placements[i];
+            for (GLsizei row = 0; row < icon.height; ++row) {
+                memcpy(&atlasPixels[(static_cast<size_t>(placement.y + row) * atlasWidth +
+                                     placement.x) * 4],
+                       icon.pixels + static_cast<size_t>(row) * icon.stride,
+                       static_cast<size_t>(icon.width) * 4);
+            }
+            regions[i] = {
+                    (GLfloat) placement.x / (GLfloat) atlasWidth,
+                    (GLfloat) placement.y / (GLfloat) atlasHeight,
+                    (GLfloat) (placement.x + icon.width) / (GLfloat) atlasWidth,
+                    (GLfloat) (placement.y + icon.height) / (GLfloat) atlasHeight,
+                    icon.width > 0 ? (GLfloat) icon.height / (GLfloat) icon.width : 1.f};
+        }
+
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, atlasTextureId));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA,
+                              GL_UNSIGNED_BYTE, atlasPixels.data()));
+        CHECK_GL(glGenerateMipmap(GL_TEXTURE_2D));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "Packed %zu sprite icons into %dx%d atlas.",
+                            icons.size(), atlasWidth, atlasHeight);
+        return true;
+    }
+
+    void SpriteBatcher::SetSprites(const float *newSprites, size_t count) {
+        sprites.assign(newSprites, newSprites + count * SPRITE_COMPONENTS);
+        spritesCount = count;
+    }
+
+    void SpriteBatcher::Draw(GLsizei viewportWidth, GLsizei viewportHeight) {
+        if (!initialized || spritesCount == 0 || regions.empty()) return;
+
+        instances.clear();
+        for (size_t i = 0; i < spritesCount; ++i) {
+            const float *sprite = &sprites[i * SPRITE_COMPONENTS];
+            auto icon = static_cast<size_t>(sprite[4]);
+            if (sprite[4] < 0.f || icon >= regions.size()) continue;
+
+            const auto &region = regions[icon];
+            const GLfloat halfWidth = sprite[2] / 2.f;
+            instances.push_back({
+                    sprite[0],
+                    (GLfloat) viewportHeight - sprite[1],
+                    halfWidth,
+                    halfWidth * region.aspectRatio,
+                    region.u0, region.v0, region.u1, region.v1,
+                    sprite[3]});
+        }
+        if (instances.empty()) return;
+
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        auto size = static_cast<GLsizeiptr>(instances.size() * sizeof(Instance));
+        if (size > instancesVboCapacity) {
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, size, instances.data(), GL_STREAM_DRAW));
+            instancesVboCapacity = size;
+        } else {
+            // Orphan the previous storage so the upload never waits for last frame's draw.
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, instancesVboCapacity, nullptr,
+                                  GL_STREAM_DRAW));
+            CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data()));
+        }
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        CHECK_GL(glDisable(GL_STENCIL_TEST));
+        CHECK_GL(glViewport(0, 0, viewportWidth, viewportHeight));
+        CHECK_GL(glEnable(GL_BLEND));
+        CHECK_GL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+        CHECK_GL(glUseProgram(program));
+        CHECK_GL(glUniform2f(viewportSizeHandle, (GLfloat) viewportWidth,
+                             (GLfloat) viewportHeight));
+        CHECK_GL(glUniform1i(atlasHandle, 0));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, atlasTextureId));
+        CHECK_GL(glBindVertexArray(vaoId));
+        CHECK_GL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                                       static_cast<GLsizei>(instances.size())));
+        CHECK_GL(glBindVertexArray(0));
+
+        CHECK_GL(glDisable(GL_BLEND));
+    }
+}  // namespace lookaround
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "shared_gl_resources.h"
+
+namespace lookaround {
+    // Draws marker icons from a single packed texture atlas with one instanced draw call per
+    // frame. Per-instance position, size, atlas region and opacity are uploaded into one buffer.
+    class SpriteBatcher {
+    public:
+        // Floats per sprite passed to SetSprites: centerX, centerY (window pixels, top-left
+        // origin - like marker rects), width (pixels), opacity, icon index.
+        static constexpr size_t SPRITE_COMPONENTS = 5;
+        static constexpr GLsizei MAX_ATLAS_SIZE = 2048;
+        static constexpr GLsizei ATLAS_PADDING = 2;
+
+        struct Icon {
+            const uint8_t *pixels; // premultiplied RGBA_8888
+            GLsizei width;
+            GLsizei height;
+            GLsizei stride;
+        };
+
+        // Must be called with a current context.
+        bool Init(SharedGlResources &sharedResources);
+
+        void Release();
+
+        // Packs icons into the atlas, replacing the previous one. Returns false if they do not
+        // fit into MAX_ATLAS_SIZE x MAX_ATLAS_SIZE.
+        bool LoadAtlas(const std::vector<Icon> &icons);
+
+        // Sprites with unknown icon indices are skipped.
+        void SetSprites(const float *sprites, size_t count);
+
+        // Draws all sprites on top of the currently bound framebuffer, within the current scissor
+        // box.
+        void Draw(GLsizei viewportWidth, GLsizei viewportHeight);
+
+    private:
+        struct AtlasRegion {
+            GLfloat u0, v0, u1, v1;
+            GLfloat aspectRatio; // height / width
+        };
+
+        // Matches the instance attributes of the sprite program.
+        struct Instance {
+            GLfloat centerX, centerY, halfWidth, halfHeight;
+            GLfloat u0, v0, u1, v1;
+            GLfloat opacity;
+        };
+
+        bool initialized = false;
+        GLuint program = 0;
+        GLint viewportSizeHandle = -1;
+        GLint atlasHandle = -1;
+        GLuint vaoId = 0;
+        // Owned by SharedGlResources.
+        GLuint cornersVboId = 0;
+        GLuint instancesVboId = 0;
+        GLsizeiptr instancesVboCapacity = 0;
+        GLuint atlasTextureId = 0;
+
+        std::vector<AtlasRegion> regions;
+        std::vector<float> sprites;
+        size_t spritesCount = 0;
+        std::vector<Instance> instances;
+    };
+}  // namespace lookaround
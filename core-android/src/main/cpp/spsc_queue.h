@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace lookaround {
+    // Wait-free bounded queue for exactly one producer thread and one consumer thread.
+    // CAPACITY must be a power of two.
+    template<typename T, size_t CAPACITY>
+    class SpscQueue {
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0,
+                      "CAPACITY must be a power of two.");
+
+    public:
+        // Producer only. Returns false if the queue is full.
+        bool TryPush(const T &item) {
+            const size_t tail = this->tail.load(std::memory_order_relaxed);
+            if (tail - head.load(std::memory_order_acquire) == CAPACITY) return false;
+            items[tail & (CAPACITY - 1)] = item;
+            this->tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer only. Returns false if the queue is empty.
+        bool TryPop(T &item) {
+            const size_t head = this->head.load(std::memory_order_relaxed);
+            if (head == tail.load(std::memory_order_acquire)) return false;
+            item = items[head & (CAPACITY - 1)];
+            this->head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        // Separate cache lines, so the two threads do not invalidate each other's index.
+        alignas(64) std::atomic<size_t> head{0};
+        alignas(64) std::atomic<size_t> tail{0};
+        std::array<T, CAPACITY> items{};
+    };
+}  // namespace lookaround
@@ -0,0 +1,100 @@
+#include "surface_fanout.h"
+
+#include <android/log.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+
+#include "gl_check.h"
+
+namespace lookaround {
+    int SurfaceFanout::Add(EGLDisplay display, EGLConfig config, ANativeWindow *window,
+                           int64_t minFrameIntervalNs) {
+        EGLSurface surface = eglCreateWindowSurface(display, config, window,
+                                                    /*attrib_list=*/nullptr);
+        if (surface == EGL_NO_SURFACE) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to create output surface with EGL error: %s",
+                                EGLErrorString(eglGetError()).c_str());
+            ANativeWindow_release(window);
+            return -1;
+        }
+        outputs.push_back({nextId, window, surface, minFrameIntervalNs, -1});
+        return nextId++;
+    }
+
+    bool SurfaceFanout::Remove(EGLDisplay display, int id) {
+        auto output = std::find_if(outputs.begin(), outputs.end(),
+                                   [id](const Output &output) { return output.id == id; });
+        if (output == outputs.end()) return false;
+
+        // Never left current, so destroyed right away.
+        eglDestroySurface(display, output->surface);
+        ANativeWindow_release(output->window);
+        outputs.erase(output);
+        return true;
+    }
+
+    void SurfaceFanout::Release(EGLDisplay display) {
+        for (auto &output: outputs) {
+            eglDestroySurface(display, output.surface);
+            ANativeWindow_release(output.window);
+        }
+        outputs.clear();
+    }
+
+    void SurfaceFanout::Present(EGLDisplay display, EGLContext context, EGLSurface source,
+                                GLsizei sourceWidth, GLsizei sourceHeight,
+                                int64_t presentationTimeNs) {
+        bool presented = false;
+        for (auto &output: outputs) {
+            // Encoders expect increasing timestamps, frames redrawn for moved rects repeat them.
+            if (output.lastPresentationTimeNs >= 0 &&
+                (presentationTimeNs <= output.lastPresentationTimeNs ||
+                 presentationTimeNs - output.lastPresentationTimeNs <
+                 output.minFrameIntervalNs)) {
+                continue;
+            }
+
+            // Reads of the default framebuffer come from source, draws go to the output.
+            if (eglMakeCurrent(display, output.surface, source, context) != EGL_TRUE) continue;
+            if (!presented) {
+                CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+                // The window redraw region would clip the blit.
+                CHECK_GL(glDisable(GL_SCISSOR_TEST));
+                CHECK_GL(glClearColor(0.f, 0.f, 0.f, 1.f));
+                presented = true;
+            }
+
+            const GLsizei width = ANativeWindow_getWidth(output.window);
+            const GLsizei height = ANativeWindow_getHeight(output.window);
+            const float scale = std::min(static_cast<float>(width) / sourceWidth,
+                                         static_cast<float>(height) / sourceHeight);
+            const auto fitWidth = static_cast<GLsizei>(sourceWidth * scale);
+            const auto fitHeight = static_cast<GLsizei>(sourceHeight * scale);
+            const GLint x = (width - fitWidth) / 2;
+            const GLint y = (height - fitHeight) / 2;
+            if (fitWidth != width || fitHeight != height) {
+                CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
+            }
+            CHECK_GL(glBlitFramebuffer(0, 0, sourceWidth, sourceHeight,
+                                       x, y, x + fitWidth, y + fitHeight,
+                                       GL_COLOR_BUFFER_BIT, GL_LINEAR));
+
+#ifdef EGL_EGLEXT_PROTOTYPES
+            eglPresentationTimeANDROID(display, output.surface, presentationTimeNs);
+#endif  // EGL_EGLEXT_PROTOTYPES
+            if (eglSwapBuffers(display, output.surface) != EGL_TRUE) {
+                // E.g. an encoder stopped before its output was removed.
+                __android_log_print(ANDROID_LOG_WARN, LOG_TAG,
+                                    "Failed to present output %d with EGL error: %s", output.id,
+                                    EGLErrorString(eglGetError()).c_str());
+            }
+            output.lastPresentationTimeNs = presentationTimeNs;
+        }
+
+        if (!presented) return;
+        eglMakeCurrent(display, source, source, context);
+        CHECK_GL(glEnable(GL_SCISSOR_TEST));
+    }
+}  // namespace lookaround
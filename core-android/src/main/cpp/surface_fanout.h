@@ -0,0 +1,46 @@
+#pragma once
+
+#include <android/native_window.h>
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace lookaround {
+    // Presents each frame drawn into the window surface to further surfaces - a video encoder
+    // input, a picture-in-picture view - without drawing it again: the window's back buffer is
+    // blitted into each of them, scaled to fit its size with the aspect ratio kept, before the
+    // window itself is presented. Each output is presented at most at its own rate.
+    class SurfaceFanout {
+    public:
+        // Takes over the reference to window. Returns the id of the output, -1 if its surface
+        // could not be created.
+        int Add(EGLDisplay display, EGLConfig config, ANativeWindow *window,
+                int64_t minFrameIntervalNs);
+
+        // Returns false if there is no output of id.
+        bool Remove(EGLDisplay display, int id);
+
+        void Release(EGLDisplay display);
+
+        [[nodiscard]] bool IsEmpty() const { return outputs.empty(); }
+
+        // Blits the drawn frame of source (current with context) into the outputs due at
+        // presentationTimeNs and presents them. Leaves source current again.
+        void Present(EGLDisplay display, EGLContext context, EGLSurface source,
+                     GLsizei sourceWidth, GLsizei sourceHeight, int64_t presentationTimeNs);
+
+    private:
+        struct Output {
+            int id;
+            ANativeWindow *window;
+            EGLSurface surface;
+            int64_t minFrameIntervalNs;
+            int64_t lastPresentationTimeNs;
+        };
+
+        std::vector<Output> outputs;
+        int nextId = 0;
+    };
+}  // namespace lookaround
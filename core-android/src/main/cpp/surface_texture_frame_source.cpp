@@ -0,0 +1,28 @@
+#include "surface_texture_frame_source.h"
+
+namespace lookaround {
+    SurfaceTextureFrameSource::~SurfaceTextureFrameSource() {
+        if (surfaceTexture) ASurfaceTexture_release(surfaceTexture);
+    }
+
+    void SurfaceTextureFrameSource::Reset(ASurfaceTexture *newSurfaceTexture) {
+        if (surfaceTexture) {
+            // Fails for a texture which never latched a frame, it is not attached yet then.
+            ASurfaceTexture_detachFromGLContext(surfaceTexture);
+            ASurfaceTexture_release(surfaceTexture);
+        }
+        surfaceTexture = newSurfaceTexture;
+    }
+
+    bool SurfaceTextureFrameSource::Latch() {
+        return surfaceTexture && ASurfaceTexture_updateTexImage(surfaceTexture) == 0;
+    }
+
+    int64_t SurfaceTextureFrameSource::TimestampNs() const {
+        return surfaceTexture ? ASurfaceTexture_getTimestamp(surfaceTexture) : 0;
+    }
+
+    void SurfaceTextureFrameSource::GetTransformMatrix(GLfloat *transform) const {
+        if (surfaceTexture) ASurfaceTexture_getTransformMatrix(surfaceTexture, transform);
+    }
+}  // namespace lookaround
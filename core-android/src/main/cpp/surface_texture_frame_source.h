@@ -0,0 +1,40 @@
+#pragma once
+
+#include <android/surface_texture.h>
+#include <GLES2/gl2.h>
+
+#include <cstdint>
+
+#include "render_loop.h"
+
+namespace lookaround {
+    // Camera frames of a SurfaceTexture, latched on the thread which owns the GL context the
+    // texture is attached to.
+    class SurfaceTextureFrameSource : public FrameSource {
+    public:
+        SurfaceTextureFrameSource() = default;
+
+        SurfaceTextureFrameSource(const SurfaceTextureFrameSource &) = delete;
+
+        SurfaceTextureFrameSource &operator=(const SurfaceTextureFrameSource &) = delete;
+
+        ~SurfaceTextureFrameSource() override;
+
+        // Takes ownership of newSurfaceTexture (may be null) after releasing the current one.
+        // Must be called with the GL context current.
+        void Reset(ASurfaceTexture *newSurfaceTexture);
+
+        // Detaches the current SurfaceTexture from the GL context (which must be current) and
+        // releases it.
+        void Release() { Reset(nullptr); }
+
+        bool Latch() override;
+
+        [[nodiscard]] int64_t TimestampNs() const override;
+
+        void GetTransformMatrix(GLfloat *transform) const;
+
+    private:
+        ASurfaceTexture *surfaceTexture = nullptr;
+    };
+}  // namespace lookaround
@@ -0,0 +1,45 @@
+#include "surface_transform.h"
+
+#include <cmath>
+
+namespace lookaround {
+    void CalculateSurfaceTransform(const GLfloat *texTransform,
+                                   GLfloat previewWidth,
+                                   GLfloat previewHeight,
+                                   GLfloat surfaceWidth,
+                                   GLfloat surfaceHeight,
+                                   GLint surfaceRotationDegrees,
+                                   GLfloat *vertTransform) {
+        // Preview size in the natural orientation - the texture transform applied to the
+        // height and width vectors of the buffer.
+        const GLfloat naturalPreviewWidth = std::abs(texTransform[4] * previewHeight) +
+                                            std::abs(texTransform[0] * previewWidth);
+        const GLfloat naturalPreviewHeight = std::abs(texTransform[5] * previewHeight) +
+                                             std::abs(texTransform[1] * previewWidth);
+
+        // Surface size in the natural orientation.
+        const auto angle = static_cast<GLfloat>(-surfaceRotationDegrees * M_PI / 180.);
+        const GLfloat sin = std::sin(angle);
+        const GLfloat cos = std::cos(angle);
+        const GLfloat naturalSurfaceWidth = std::abs(cos * surfaceWidth - sin * surfaceHeight);
+        const GLfloat naturalSurfaceHeight = std::abs(sin * surfaceWidth + cos * surfaceHeight);
+
+        // Center-crop scale, then the rotation, which is applied to the vertices first.
+        const GLfloat heightRatio = naturalPreviewHeight / naturalSurfaceHeight;
+        const GLfloat widthRatio = naturalPreviewWidth / naturalSurfaceWidth;
+        GLfloat scaleX = 1.f;
+        GLfloat scaleY = 1.f;
+        if (naturalPreviewWidth * naturalSurfaceHeight >
+            naturalPreviewHeight * naturalSurfaceWidth) {
+            scaleX = heightRatio / widthRatio;
+        } else {
+            scaleY = widthRatio / heightRatio;
+        }
+
+        for (int i = 0; i < 16; ++i) vertTransform[i] = i % 5 == 0 ? 1.f : 0.f;
+        vertTransform[0] = scaleX * cos;
+        vertTransform[1] = scaleY * sin;
+        vertTransform[4] = -scaleX * sin;
+        vertTransform[5] = scaleY * cos;
+    }
+}  // namespace lookaround
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <GLES2/gl2.h>
+
+namespace lookaround {
+    // Native counterpart of OpenGLRenderer.calculateSurfaceTransform, for frames drawn by the
+    // native render loop: the vertex transform which center-crops the preview, transformed
+    // to the device's natural orientation by texTransform, onto a surface rotated by
+    // surfaceRotationDegrees. Matrices are column-major 4x4.
+    void CalculateSurfaceTransform(const GLfloat *texTransform,
+                                   GLfloat previewWidth,
+                                   GLfloat previewHeight,
+                                   GLfloat surfaceWidth,
+                                   GLfloat surfaceHeight,
+                                   GLint surfaceRotationDegrees,
+                                   GLfloat *vertTransform);
+}  // namespace lookaround
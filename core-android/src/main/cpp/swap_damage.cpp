@@ -0,0 +1,143 @@
+#include "swap_damage.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "gl_check.h"
+#include "rect_grid_index.h"
+
+namespace lookaround {
+    namespace {
+        // Adds the bounds of a rect in the RectGridIndex layout to damage.
+        void AddRectBounds(const GLfloat *rect, GLsizei surfaceHeight, DamageRect &damage) {
+            const GLfloat left = rect[0];
+            const GLfloat right = rect[0] + rect[2];
+            const GLfloat bottom = static_cast<GLfloat>(surfaceHeight) - rect[1];
+            const GLfloat top = bottom + rect[3];
+
+            DamageRect bounds;
+            bounds.x = static_cast<GLint>(std::floor(left)) - 1;
+            bounds.y = static_cast<GLint>(std::floor(bottom)) - 1;
+            bounds.width = static_cast<GLint>(std::ceil(right)) + 1 - bounds.x;
+            bounds.height = static_cast<GLint>(std::ceil(top)) + 1 - bounds.y;
+            damage = damage.IsEmpty() ? bounds : damage.Union(bounds);
+        }
+    }  // namespace
+
+    DamageRect DamageRect::Union(const DamageRect &other) const {
+        if (other.IsEmpty()) return *this;
+        if (IsEmpty()) return other;
+
+        DamageRect result;
+        result.x = std::min(x, other.x);
+        result.y = std::min(y, other.y);
+        result.width = std::max(x + width, other.x + other.width) - result.x;
+        result.height = std::max(y + height, other.y + other.height) - result.y;
+        return result;
+    }
+
+    DamageRect RectsDamage(const GLfloat *previousRects, size_t previousCount,
+                           const GLfloat *rects, size_t count,
+                           GLsizei surfaceWidth, GLsizei surfaceHeight) {
+        constexpr size_t components = RectGridIndex::RECT_COMPONENTS;
+        DamageRect damage;
+        for (size_t i = 0; i < std::max(previousCount, count); ++i) {
+            const GLfloat *previous = i < previousCount ? previousRects + i * components : nullptr;
+            const GLfloat *current = i < count ? rects + i * components : nullptr;
+            if (previous && current && std::equal(previous, previous + components, current)) {
+                continue;
+            }
+            if (previous) AddRectBounds(previous, surfaceHeight, damage);
+            if (current) AddRectBounds(current, surfaceHeight, damage);
+        }
+        if (damage.IsEmpty()) return {};
+
+        const GLint left = std::max(damage.x, 0);
+        const GLint bottom = std::max(damage.y, 0);
+        const GLint right = std::min(damage.x + damage.width, surfaceWidth);
+        const GLint top = std::min(damage.y + damage.height, surfaceHeight);
+        if (right <= left || top <= bottom) return {};
+        return {left, bottom, right - left, top - bottom};
+    }
+
+    void SwapDamage::Init(const GpuCapabilities &capabilities) {
+        bufferAgeSupported = capabilities.bufferAge;
+        if (capabilities.partialUpdate) {
+            setDamageRegion = reinterpret_cast<PFNEGLSETDAMAGEREGIONKHRPROC>(
+                    eglGetProcAddress("eglSetDamageRegionKHR"));
+        }
+        // The EXT entry point has the same signature.
+        if (capabilities.swapBuffersWithDamageKhr) {
+            swapBuffersWithDamage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+                    eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+        } else if (capabilities.swapBuffersWithDamageExt) {
+            swapBuffersWithDamage = reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(
+                    eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+        }
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG,
+                            "Swap damage: buffer age %d, partial update %d, damaged swap %d.",
+                            bufferAgeSupported, setDamageRegion != nullptr,
+                            swapBuffersWithDamage != nullptr);
+    }
+
+    DamageRect SwapDamage::BeginFrame(EGLDisplay display, EGLSurface surface,
+                                      GLsizei width, GLsizei height,
+                                      const DamageRect *damage) {
+        if (width != surfaceWidth || height != surfaceHeight) {
+            Reset();
+            surfaceWidth = width;
+            surfaceHeight = height;
+        }
+
+        const DamageRect whole{0, 0, width, height};
+        pending = damage && !damage->IsEmpty() ? FrameDamage{false, *damage} : FrameDamage{};
+        if (pending.full || !bufferAgeSupported) return whole;
+
+        // Age 1 is the last presented frame, 0 means the contents are undefined. The frame the
+        // buffer holds has to be one presented through Swap.
+        EGLint bufferAge = 0;
+        if (!eglQuerySurface(display, surface, EGL_BUFFER_AGE_KHR, &bufferAge) ||
+            bufferAge <= 0 || static_cast<size_t>(bufferAge) > historySize) {
+            return whole;
+        }
+
+        DamageRect redraw = pending.rect;
+        for (size_t i = 0; i + 1 < static_cast<size_t>(bufferAge); ++i) {
+            if (history[i].full) return whole;
+            redraw = redraw.Union(history[i].rect);
+        }
+
+        if (setDamageRegion) {
+            EGLint rect[] = {redraw.x, redraw.y, redraw.width, redraw.height};
+            setDamageRegion(display, surface, rect, 1);
+        }
+        return redraw;
+    }
+
+    EGLBoolean SwapDamage::Swap(EGLDisplay display, EGLSurface surface) {
+        const FrameDamage presented = pending;
+        pending = FrameDamage{};
+
+        EGLBoolean swapped;
+        if (!presented.full && swapBuffersWithDamage) {
+            const EGLint rect[] = {presented.rect.x, presented.rect.y,
+                                   presented.rect.width, presented.rect.height};
+            swapped = swapBuffersWithDamage(display, surface, rect, 1);
+        } else {
+            swapped = eglSwapBuffers(display, surface);
+        }
+
+        if (swapped) {
+            Push(presented);
+        } else {
+            Reset();
+        }
+        return swapped;
+    }
+
+    void SwapDamage::Push(const FrameDamage &frameDamage) {
+        std::move_backward(history.begin(), history.end() - 1, history.end());
+        history[0] = frameDamage;
+        historySize = std::min(historySize + 1, HISTORY_SIZE);
+    }
+}  // namespace lookaround
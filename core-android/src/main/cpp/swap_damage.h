@@ -0,0 +1,77 @@
+#pragma once
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+
+#include <array>
+#include <cstddef>
+
+#include "gpu_capabilities.h"
+
+namespace lookaround {
+    // Window region in GL pixels (bottom left origin) - also the layout of EGL damage rects.
+    struct DamageRect {
+        GLint x = 0;
+        GLint y = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+
+        [[nodiscard]] bool IsEmpty() const { return width <= 0 || height <= 0; }
+
+        // Bounding box of both rects.
+        [[nodiscard]] DamageRect Union(const DamageRect &other) const;
+    };
+
+    // Window region which changes between two sets of marker rects (in the RectGridIndex layout,
+    // top left origin): the old and new bounds of every rect which moved, resized, appeared or
+    // disappeared, padded by a pixel for the antialiased edges and clipped to the surface.
+    DamageRect RectsDamage(const GLfloat *previousRects, size_t previousCount,
+                           const GLfloat *rects, size_t count,
+                           GLsizei surfaceWidth, GLsizei surfaceHeight);
+
+    // Redraws and presents only the part of the window surface which changed, with
+    // EGL_KHR_partial_update (or EGL_EXT_buffer_age) and EGL_KHR_swap_buffers_with_damage.
+    // The back buffer handed out by EGL may be a few frames old, so the region redrawn into it
+    // is the union of the damage of all frames presented since. Whenever that is unknown -
+    // missing extensions, a new surface, a buffer older than the kept history - the whole
+    // surface is redrawn and presented.
+    class SwapDamage {
+    public:
+        void Init(const GpuCapabilities &capabilities);
+
+        // Forgets the presented frames, e.g. after the window surface was replaced.
+        void Reset() { historySize = 0; }
+
+        // Starts a frame changing only damage of the surface (everything if null), before
+        // anything is drawn into it. Returns the region which has to be redrawn.
+        DamageRect BeginFrame(EGLDisplay display, EGLSurface surface,
+                              GLsizei width, GLsizei height,
+                              const DamageRect *damage);
+
+        // Presents the frame started last.
+        EGLBoolean Swap(EGLDisplay display, EGLSurface surface);
+
+    private:
+        // Covers the buffer ages of triple buffering with a frame to spare.
+        static constexpr size_t HISTORY_SIZE = 4;
+
+        struct FrameDamage {
+            bool full = true;
+            DamageRect rect;
+        };
+
+        void Push(const FrameDamage &frameDamage);
+
+        // Newest first.
+        std::array<FrameDamage, HISTORY_SIZE> history{};
+        size_t historySize = 0;
+        FrameDamage pending;
+        GLsizei surfaceWidth = 0;
+        GLsizei surfaceHeight = 0;
+
+        bool bufferAgeSupported = false;
+        PFNEGLSETDAMAGEREGIONKHRPROC setDamageRegion = nullptr;
+        PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swapBuffersWithDamage = nullptr;
+    };
+}  // namespace lookaround
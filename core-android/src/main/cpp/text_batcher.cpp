@@ -0,0 +1,298 @@
+#include "text_batcher.h"
+
+#include <android/log.h>
+
+#include <cinttypes>
+#include <cstdio>
+#include <utility>
+
+#include "gl_check.h"
+#include "gl_program.h"
+
+namespace lookaround {
+    namespace {
+        constexpr char VERTEX_SHADER_SRC_TEXT[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform vec2 viewportSize;
+
+in vec2 corner;
+in vec4 instanceRect;
+in vec4 instanceUv;
+in float instanceOpacity;
+
+out vec2 texCoord;
+out float opacity;
+
+void main() {
+    vec2 position = mix(instanceRect.xy, instanceRect.zw, corner);
+    gl_Position = vec4(position / viewportSize * 2. - vec2(1.), 0., 1.);
+    // Atlas rows are stored top-down, so the top corner samples v0.
+    texCoord = mix(instanceUv.xy, instanceUv.zw, vec2(corner.x, 1. - corner.y));
+    opacity = instanceOpacity;
+}
+)SRC";
+
+        // The field stores 0.5 at the glyph's edge; fwidth keeps edges about one pixel wide
+        // at every label size. The outline keeps white labels legible on bright backgrounds.
+        constexpr char FRAGMENT_SHADER_SRC_TEXT[] = R"SRC(#version 310 es
+precision mediump float;
+precision mediump int;
+
+uniform sampler2D atlas;
+
+in vec2 texCoord;
+in float opacity;
+out vec4 fragColor;
+
+const float EDGE = .5;
+const float OUTLINE_WIDTH = .12;
+const vec4 FILL_COLOR = vec4(1.);
+const vec4 OUTLINE_COLOR = vec4(vec3(.15) * .6, .6);
+
+void main() {
+    float distance = texture(atlas, texCoord).r;
+    float smoothing = fwidth(distance) * .75;
+    float fill = smoothstep(EDGE - smoothing, EDGE + smoothing, distance);
+    float outline = smoothstep(EDGE - OUTLINE_WIDTH - smoothing,
+                               EDGE - OUTLINE_WIDTH + smoothing,
+                               distance);
+    fragColor = mix(OUTLINE_COLOR * outline, FILL_COLOR, fill) * opacity;
+}
+)SRC";
+
+        constexpr GLfloat CORNERS[] = {0.f, 0.f, 1.f, 0.f, 0.f, 1.f, 1.f, 1.f};
+
+        // Decodes the next codepoint and advances it, invalid sequences decode to U+FFFD.
+        uint32_t NextCodepoint(const std::string &text, size_t &it) {
+            const auto lead = static_cast<uint8_t>(text[it++]);
+            size_t continuationBytes;
+            uint32_t codepoint;
+            if (lead < 0x80) {
+                return lead;
+            } else if ((lead & 0xe0) == 0xc0) {
+                continuationBytes = 1;
+                codepoint = lead & 0x1f;
+            } else if ((lead & 0xf0) == 0xe0) {
+                continuationBytes = 2;
+                codepoint = lead & 0x0f;
+            } else if ((lead & 0xf8) == 0xf0) {
+                continuationBytes = 3;
+                codepoint = lead & 0x07;
+            } else {
+                return 0xfffd;
+            }
+            for (size_t i = 0; i < continuationBytes; ++i) {
+                if (it >= text.size()) return 0xfffd;
+                const auto next = static_cast<uint8_t>(text[it]);
+                if ((next & 0xc0) != 0x80) return 0xfffd;
+                codepoint = (codepoint << 6) | (next & 0x3f);
+                ++it;
+            }
+            return codepoint;
+        }
+
+        // Identifies the atlas texture shared by renderers. Atlases are rebuilt in place when
+        // glyphs are added, so the key covers the pixels rather than the cache path.
+        std::string AtlasKey(const SdfGlyphAtlas &atlas) {
+            // FNV-1a.
+            uint64_t hash = 0xcbf29ce484222325;
+            const uint8_t *pixels = atlas.Pixels();
+            const size_t size = static_cast<size_t>(atlas.Width()) * atlas.Height();
+            for (size_t i = 0; i < size; ++i) hash = (hash ^ pixels[i]) * 0x100000001b3;
+            char key[64];
+            snprintf(key, sizeof(key), "glyphAtlas/%dx%d/%.1f/%016" PRIx64, atlas.Width(),
+                     atlas.Height(), atlas.RasterSize(), hash);
+            return key;
+        }
+    }  // namespace
+
+    bool TextBatcher::Init(SharedGlResources &sharedResources) {
+        program = CreateGlProgram(VERTEX_SHADER_SRC_TEXT, FRAGMENT_SHADER_SRC_TEXT);
+        if (!program) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Labels disabled: creating GL program failed.");
+            return false;
+        }
+        viewportSizeHandle = CHECK_GL(glGetUniformLocation(program, "viewportSize"));
+        atlasHandle = CHECK_GL(glGetUniformLocation(program, "atlas"));
+        auto cornerHandle = CHECK_GL(glGetAttribLocation(program, "corner"));
+        auto rectHandle = CHECK_GL(glGetAttribLocation(program, "instanceRect"));
+        auto uvHandle = CHECK_GL(glGetAttribLocation(program, "instanceUv"));
+        auto opacityHandle = CHECK_GL(glGetAttribLocation(program, "instanceOpacity"));
+
+        CHECK_GL(glGenVertexArrays(1, &vaoId));
+        CHECK_GL(glBindVertexArray(vaoId));
+
+        cornersVboId = sharedResources.Buffer(SharedGlResources::QUAD_CORNERS_BUFFER, CORNERS,
+                                              sizeof(CORNERS));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, cornersVboId));
+        CHECK_GL(glVertexAttribPointer(cornerHandle, 2, GL_FLOAT, GL_FALSE, 0, nullptr));
+        CHECK_GL(glEnableVertexAttribArray(cornerHandle));
+
+        CHECK_GL(glGenBuffers(1, &instancesVboId));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        constexpr GLsizei stride = sizeof(Instance);
+        CHECK_GL(glVertexAttribPointer(rectHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(offsetof(Instance, left))));
+        CHECK_GL(glVertexAttribPointer(uvHandle, 4, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(offsetof(Instance, u0))));
+        CHECK_GL(glVertexAttribPointer(opacityHandle, 1, GL_FLOAT, GL_FALSE, stride,
+                                       reinterpret_cast<const void *>(
+                                               offsetof(Instance, opacity))));
+        for (auto handle: {rectHandle, uvHandle, opacityHandle}) {
+            CHECK_GL(glEnableVertexAttribArray(handle));
+            CHECK_GL(glVertexAttribDivisor(handle, 1));
+        }
+
+        CHECK_GL(glBindVertexArray(0));
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        shared = &sharedResources;
+        initialized = true;
+        return true;
+    }
+
+    void TextBatcher::Release() {
+        if (!initialized) return;
+
+        ReleaseAtlasTexture();
+        shared = nullptr;
+        CHECK_GL(glDeleteBuffers(1, &instancesVboId));
+        CHECK_GL(glDeleteVertexArrays(1, &vaoId));
+        CHECK_GL(glDeleteProgram(program));
+        instancesVboCapacity = 0;
+        atlas = SdfGlyphAtlas();
+        placedGlyphs.clear();
+        runs.clear();
+        labelsCount = 0;
+        initialized = false;
+    }
+
+    bool TextBatcher::LoadAtlas(SdfGlyphAtlas &&newAtlas) {
+        if (!initialized || newAtlas.IsEmpty()) return false;
+
+        atlas = std::move(newAtlas);
+        // The previous atlas is released after, so reloading it keeps the same texture.
+        const std::string previousKey = std::move(atlasKey);
+        atlasKey = AtlasKey(atlas);
+        atlasTextureId = shared->AcquireTexture(atlasKey);
+        if (atlasTextureId) {
+            if (!previousKey.empty()) shared->ReleaseTexture(previousKey);
+            LayoutTexts();
+            return true;
+        }
+
+        CHECK_GL(glGenTextures(1, &atlasTextureId));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, atlasTextureId));
+        // No mipmaps: minified distance fields lose their edge, labels stay close to raster size.
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas.Width(), atlas.Height(), 0, GL_RED,
+                              GL_UNSIGNED_BYTE, atlas.Pixels()));
+        CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+        atlasTextureId = shared->PublishTexture(atlasKey, atlasTextureId);
+        if (!previousKey.empty()) shared->ReleaseTexture(previousKey);
+        LayoutTexts();
+        return true;
+    }
+
+    void TextBatcher::ReleaseAtlasTexture() {
+        if (!atlasKey.empty()) shared->ReleaseTexture(atlasKey);
+        atlasKey.clear();
+        atlasTextureId = 0;
+    }
+
+    void TextBatcher::SetTexts(std::vector<std::string> &&newTexts) {
+        texts = std::move(newTexts);
+        LayoutTexts();
+    }
+
+    void TextBatcher::LayoutTexts() {
+        placedGlyphs.clear();
+        runs.clear();
+        if (atlas.IsEmpty()) return;
+
+        runs.reserve(texts.size());
+        for (const auto &text: texts) {
+            const size_t firstGlyph = placedGlyphs.size();
+            GLfloat penX = 0.f;
+            for (size_t it = 0; it < text.size();) {
+                const auto *glyph = atlas.Find(NextCodepoint(text, it));
+                if (!glyph) continue;
+                placedGlyphs.push_back({glyph, penX});
+                penX += glyph->advance;
+            }
+            runs.push_back({firstGlyph, placedGlyphs.size() - firstGlyph});
+        }
+    }
+
+    void TextBatcher::SetLabels(const float *newLabels, size_t count) {
+        labels.assign(newLabels, newLabels + count * LABEL_COMPONENTS);
+        labelsCount = count;
+    }
+
+    void TextBatcher::Draw(GLsizei viewportWidth, GLsizei viewportHeight) {
+        if (!initialized || labelsCount == 0 || runs.empty()) return;
+
+        instances.clear();
+        for (size_t i = 0; i < labelsCount; ++i) {
+            const float *label = &labels[i * LABEL_COMPONENTS];
+            auto text = static_cast<size_t>(label[4]);
+            if (label[4] < 0.f || text >= runs.size()) continue;
+
+            const GLfloat scale = label[2] / atlas.RasterSize();
+            const GLfloat baseline = (GLfloat) viewportHeight - label[1];
+            const auto &run = runs[text];
+            for (size_t g = run.firstGlyph; g < run.firstGlyph + run.glyphsCount; ++g) {
+                const auto &placed = placedGlyphs[g];
+                const auto &glyph = *placed.glyph;
+                const GLfloat left = label[0] + (placed.penX + glyph.left) * scale;
+                const GLfloat top = baseline + glyph.top * scale;
+                instances.push_back({
+                        left,
+                        top - glyph.height * scale,
+                        left + glyph.width * scale,
+                        top,
+                        glyph.u0, glyph.v0, glyph.u1, glyph.v1,
+                        label[3]});
+            }
+        }
+        if (instances.empty()) return;
+
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, instancesVboId));
+        auto size = static_cast<GLsizeiptr>(instances.size() * sizeof(Instance));
+        if (size > instancesVboCapacity) {
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, size, instances.data(), GL_STREAM_DRAW));
+            instancesVboCapacity = size;
+        } else {
+            // Orphan the previous storage so the upload never waits for last frame's draw.
+            CHECK_GL(glBufferData(GL_ARRAY_BUFFER, instancesVboCapacity, nullptr,
+                                  GL_STREAM_DRAW));
+            CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data()));
+        }
+        CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        CHECK_GL(glDisable(GL_STENCIL_TEST));
+        CHECK_GL(glViewport(0, 0, viewportWidth, viewportHeight));
+        CHECK_GL(glEnable(GL_BLEND));
+        CHECK_GL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+        CHECK_GL(glUseProgram(program));
+        CHECK_GL(glUniform2f(viewportSizeHandle, (GLfloat) viewportWidth,
+                             (GLfloat) viewportHeight));
+        CHECK_GL(glUniform1i(atlasHandle, 0));
+        CHECK_GL(glBindTexture(GL_TEXTURE_2D, atlasTextureId));
+        CHECK_GL(glBindVertexArray(vaoId));
+        CHECK_GL(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4,
+                                       static_cast<GLsizei>(instances.size())));
+        CHECK_GL(glBindVertexArray(0));
+
+        CHECK_GL(glDisable(GL_BLEND));
+    }
+}  // namespace lookaround
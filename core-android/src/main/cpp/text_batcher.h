@@ -0,0 +1,89 @@
+#pragma once
+
+#include <GLES3/gl3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sdf_glyph_atlas.h"
+#include "shared_gl_resources.h"
+
+namespace lookaround {
+    // Draws marker labels from a signed distance field glyph atlas with one instanced draw call
+    // per frame. Label texts are laid out once when registered; per frame only their position,
+    // size and opacity change, so drawing does not allocate once the buffers have grown.
+    class TextBatcher {
+    public:
+        // Floats per label passed to SetLabels: left, baseline (window pixels, top-left origin),
+        // font size (pixels), opacity, text index.
+        static constexpr size_t LABEL_COMPONENTS = 5;
+
+        // Must be called with a current context.
+        bool Init(SharedGlResources &sharedResources);
+
+        void Release();
+
+        // Uploads the atlas, unless another renderer already did, and lays out registered texts
+        // again.
+        bool LoadAtlas(SdfGlyphAtlas &&newAtlas);
+
+        [[nodiscard]] bool HasAtlas() const { return !atlas.IsEmpty(); }
+
+        // UTF-8 texts referenced by index from SetLabels. Codepoints missing in the atlas are
+        // skipped.
+        void SetTexts(std::vector<std::string> &&newTexts);
+
+        // Labels with unknown text indices are skipped.
+        void SetLabels(const float *labels, size_t count);
+
+        // Draws all labels on top of the currently bound framebuffer, within the current scissor
+        // box.
+        void Draw(GLsizei viewportWidth, GLsizei viewportHeight);
+
+    private:
+        struct PlacedGlyph {
+            const SdfGlyphAtlas::Glyph *glyph;
+            GLfloat penX; // raster pixels from the text's origin
+        };
+
+        struct TextRun {
+            size_t firstGlyph;
+            size_t glyphsCount;
+        };
+
+        // Matches the instance attributes of the text program.
+        struct Instance {
+            GLfloat left, bottom, right, top;
+            GLfloat u0, v0, u1, v1;
+            GLfloat opacity;
+        };
+
+        void LayoutTexts();
+
+        void ReleaseAtlasTexture();
+
+        bool initialized = false;
+        GLuint program = 0;
+        GLint viewportSizeHandle = -1;
+        GLint atlasHandle = -1;
+        GLuint vaoId = 0;
+        // Owned by SharedGlResources.
+        GLuint cornersVboId = 0;
+        GLuint instancesVboId = 0;
+        GLsizeiptr instancesVboCapacity = 0;
+        SharedGlResources *shared = nullptr;
+        // Owned by SharedGlResources, referenced under atlasKey.
+        GLuint atlasTextureId = 0;
+        std::string atlasKey;
+
+        SdfGlyphAtlas atlas;
+        std::vector<std::string> texts;
+        std::vector<PlacedGlyph> placedGlyphs;
+        std::vector<TextRun> runs;
+        std::vector<float> labels;
+        size_t labelsCount = 0;
+        std::vector<Instance> instances;
+    };
+}  // namespace lookaround
@@ -0,0 +1,166 @@
+// Drives the BlurPassPlanner state machine the way the renderer does, with timer results made
+// up per mode. Run by ctest, exits with 1 on a failure.
+
+#include <cstdint>
+#include <cstdio>
+
+#include "blur_pass_planner.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::BlurPassPlanner;
+    using LevelMode = BlurPassPlanner::LevelMode;
+
+    // Quarter size level of a 1080 x 1920 window, eligible for fusing.
+    constexpr GLsizei SMALL_WIDTH = 270;
+    constexpr GLsizei SMALL_HEIGHT = 480;
+    // Its full size level, which is not.
+    constexpr GLsizei LARGE_WIDTH = 1080;
+    constexpr GLsizei LARGE_HEIGHT = 1920;
+
+    int failures = 0;
+
+    // Plans frames of level until it is decided, timing each mode at its cost. Returns the
+    // number of frames planned, or -1 if a measured frame planned a decided level.
+    int MeasureUntilDecided(BlurPassPlanner &planner, GLint level, uint64_t separableNs,
+                            uint64_t fusedNs) {
+        LevelMode decided;
+        int frames = 0;
+        while (!planner.IsDecided(level, decided) && frames < 1000) {
+            const auto plan = planner.Plan(level, SMALL_WIDTH, SMALL_HEIGHT, true);
+            ++frames;
+            if (!plan.measure) return -1;
+            planner.OnMeasurementIssued(level, plan.mode);
+            planner.OnTimerResult(BlurPassPlanner::TimerTag(level, plan.mode),
+                                  plan.mode == LevelMode::FUSED ? fusedNs : separableNs);
+        }
+        return frames;
+    }
+
+    void TestThresholdCoversSmallLevelsOnly() {
+        CHECK(SMALL_WIDTH * SMALL_HEIGHT <= BlurPassPlanner::FUSED_MAX_LEVEL_PIXELS);
+        CHECK(LARGE_WIDTH / 2 * LARGE_HEIGHT / 2 > BlurPassPlanner::FUSED_MAX_LEVEL_PIXELS);
+    }
+
+    void TestUnmeasurableLevelsAreSeparable() {
+        BlurPassPlanner planner;
+        LevelMode mode;
+
+        // Without timer queries, even small levels.
+        planner.Reset(false);
+        auto plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, true);
+        CHECK(plan.mode == LevelMode::SEPARABLE && !plan.measure);
+        CHECK(planner.IsDecided(0, mode) && mode == LevelMode::SEPARABLE);
+
+        // Large levels are never worth measuring.
+        planner.Reset(true);
+        plan = planner.Plan(1, LARGE_WIDTH, LARGE_HEIGHT, true);
+        CHECK(plan.mode == LevelMode::SEPARABLE && !plan.measure);
+        CHECK(planner.IsDecided(1, mode) && mode == LevelMode::SEPARABLE);
+
+        // Unrepresentative frames use the separable passes without deciding anything.
+        plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, false);
+        CHECK(plan.mode == LevelMode::SEPARABLE && !plan.measure);
+        CHECK(!planner.IsDecided(0, mode));
+
+        // Levels out of range too.
+        plan = planner.Plan(BlurPassPlanner::MAX_LEVELS, SMALL_WIDTH, SMALL_HEIGHT, true);
+        CHECK(plan.mode == LevelMode::SEPARABLE && !plan.measure);
+    }
+
+    void TestFasterModeIsKept() {
+        BlurPassPlanner planner;
+        planner.Reset(true);
+        LevelMode mode;
+
+        const int frames = MeasureUntilDecided(planner, 0, 300'000, 200'000);
+        CHECK(frames == 2 * BlurPassPlanner::SAMPLES_PER_MODE);
+        CHECK(planner.IsDecided(0, mode) && mode == LevelMode::FUSED);
+
+        CHECK(MeasureUntilDecided(planner, 2, 200'000, 300'000) > 0);
+        CHECK(planner.IsDecided(2, mode) && mode == LevelMode::SEPARABLE);
+
+        // Decisions hold until the next Reset, late results change nothing.
+        for (int i = 0; i < BlurPassPlanner::SAMPLES_PER_MODE * 2; ++i) {
+            planner.OnTimerResult(BlurPassPlanner::TimerTag(0, LevelMode::SEPARABLE), 1);
+        }
+        const auto plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, true);
+        CHECK(plan.mode == LevelMode::FUSED && !plan.measure);
+        planner.Reset(true);
+        CHECK(!planner.IsDecided(0, mode));
+    }
+
+    void TestModesAlternateWhileMeasuring() {
+        BlurPassPlanner planner;
+        planner.Reset(true);
+
+        LevelMode previous = LevelMode::FUSED;
+        for (int i = 0; i < 8; ++i) {
+            const auto plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, true);
+            CHECK(plan.measure && plan.mode != previous);
+            planner.OnMeasurementIssued(0, plan.mode);
+            previous = plan.mode;
+        }
+    }
+
+    void TestFailingQueriesFallBackToSeparable() {
+        BlurPassPlanner planner;
+        planner.Reset(true);
+        LevelMode mode;
+
+        // Queries which never began are not counted, the same mode is planned again.
+        for (int i = 0; i < BlurPassPlanner::MAX_ISSUED_PER_MODE * 4; ++i) {
+            const auto plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, true);
+            CHECK(plan.measure && plan.mode == LevelMode::SEPARABLE);
+        }
+        CHECK(!planner.IsDecided(0, mode));
+
+        // Queries which began but whose results are all discarded give up on measuring.
+        int frames = 0;
+        while (!planner.IsDecided(0, mode) && frames < 1000) {
+            const auto plan = planner.Plan(0, SMALL_WIDTH, SMALL_HEIGHT, true);
+            ++frames;
+            if (plan.measure) planner.OnMeasurementIssued(0, plan.mode);
+        }
+        CHECK(frames == 2 * BlurPassPlanner::MAX_ISSUED_PER_MODE + 1);
+        CHECK(planner.IsDecided(0, mode) && mode == LevelMode::SEPARABLE);
+    }
+
+    void TestSeededLevelsAreNotMeasured() {
+        BlurPassPlanner planner;
+        planner.Reset(true);
+        planner.Seed(1, LevelMode::FUSED);
+        LevelMode mode;
+        CHECK(planner.IsDecided(1, mode) && mode == LevelMode::FUSED);
+        const auto plan = planner.Plan(1, SMALL_WIDTH, SMALL_HEIGHT, true);
+        CHECK(plan.mode == LevelMode::FUSED && !plan.measure);
+
+        // Tags of other timers are ignored.
+        planner.OnTimerResult(BlurPassPlanner::TIMER_TAG_BASE - 1, 1);
+        planner.OnTimerResult(BlurPassPlanner::TIMER_TAG_BASE + BlurPassPlanner::TIMER_TAG_COUNT,
+                              1);
+        CHECK(!planner.IsDecided(0, mode));
+    }
+}  // namespace
+
+int main() {
+    TestThresholdCoversSmallLevelsOnly();
+    TestUnmeasurableLevelsAreSeparable();
+    TestFasterModeIsKept();
+    TestModesAlternateWhileMeasuring();
+    TestFailingQueriesFallBackToSeparable();
+    TestSeededLevelsAreNotMeasured();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,182 @@
+// Drives FrameScheduler and RenderLoop with a fake clock and frame source, checking the
+// scheduling rules the camera pipeline relies on. Run by ctest, exits with 1 on a failure.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+#include "frame_scheduler.h"
+#include "render_loop.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::FrameClock;
+    using lookaround::FrameScheduler;
+    using lookaround::FrameSource;
+    using lookaround::RenderLoop;
+
+    constexpr int64_t MS = 1'000'000;
+    constexpr int64_t INTERVAL_NS = FrameScheduler::DEFAULT_FRAME_INTERVAL_NS;
+
+    int failures = 0;
+
+    class FakeFrameClock : public FrameClock {
+    public:
+        [[nodiscard]] int64_t NowNs() const override { return nowNs; }
+
+        int64_t nowNs = 0;
+    };
+
+    // Frames queued by timestamp, latched in order like a SurfaceTexture's.
+    class FakeFrameSource : public FrameSource {
+    public:
+        bool Latch() override {
+            if (queued.empty()) return false;
+            currentTimestampNs = queued.front();
+            queued.pop_front();
+            return true;
+        }
+
+        [[nodiscard]] int64_t TimestampNs() const override { return currentTimestampNs; }
+
+        std::deque<int64_t> queued;
+        int64_t currentTimestampNs = 0;
+    };
+
+    void TestStaleFramesAreRejected() {
+        FakeFrameClock clock;
+        FrameScheduler scheduler(clock);
+
+        clock.nowNs = 1000 * MS;
+        CHECK(scheduler.Schedule(990 * MS, 0).render);
+        clock.nowNs = 1010 * MS;
+        // The same frame again, and one captured before it.
+        CHECK(!scheduler.Schedule(990 * MS, 0).render);
+        CHECK(!scheduler.Schedule(980 * MS, 0).render);
+        CHECK(scheduler.Schedule(1005 * MS, 0).render);
+        CHECK(scheduler.GetStats().stale == 2);
+        CHECK(scheduler.GetStats().rendered == 2);
+
+        // After a reset, e.g. for another camera stream, older timestamps are taken again.
+        scheduler.Reset();
+        CHECK(scheduler.Schedule(10 * MS, 0).render);
+    }
+
+    void TestOnlyNewestLateFrameIsDrawn() {
+        FakeFrameClock clock;
+        clock.nowNs = 1000 * MS;
+        FakeFrameSource source;
+        std::vector<int64_t> drawnTimestampsNs;
+        RenderLoop::Callbacks callbacks;
+        callbacks.onFrame = [&drawnTimestampsNs](int64_t timestampNs, int64_t) {
+            drawnTimestampsNs.push_back(timestampNs);
+        };
+        RenderLoop loop(source, clock, callbacks);
+        loop.Start();
+
+        // Three frames arrive while the loop thread is busy, as it runs this work.
+        loop.RunSync([&loop, &source] {
+            for (int64_t timestampNs : {960 * MS, 970 * MS, 980 * MS}) {
+                source.queued.push_back(timestampNs);
+                loop.OnFrameAvailable();
+            }
+        });
+        // Queued behind the frames, so they are drawn once this returns.
+        FrameScheduler::Stats stats;
+        loop.RunSync([&loop, &stats] { stats = loop.GetStats(); });
+        loop.Stop();
+
+        CHECK(drawnTimestampsNs.size() == 1);
+        CHECK(!drawnTimestampsNs.empty() && drawnTimestampsNs.back() == 980 * MS);
+        CHECK(stats.rendered == 1);
+        CHECK(stats.coalesced == 2);
+        CHECK(source.queued.empty());
+    }
+
+    void TestPresentationTimesNeverDecrease() {
+        FakeFrameClock clock;
+        FrameScheduler scheduler(clock);
+
+        // Frames every interval, drawn after an uneven latency, some in another time base.
+        uint32_t random = 1;
+        int64_t lastPresentationTimeNs = INT64_MIN;
+        int rendered = 0;
+        for (int frame = 0; frame < 1000; ++frame) {
+            random = random * 1664525u + 1013904223u;
+            const int64_t timestampNs = 1000 * MS + frame * INTERVAL_NS;
+            int64_t latencyNs = static_cast<int64_t>(random >> 16) % (3 * INTERVAL_NS);
+            if (frame % 97 == 0) latencyNs = FrameScheduler::MAX_TRUSTED_LATENCY_NS * 2;
+            if (frame % 89 == 0) latencyNs = -INTERVAL_NS;
+            clock.nowNs = std::max(clock.nowNs, timestampNs + latencyNs);
+
+            const auto decision = scheduler.Schedule(timestampNs, 0);
+            if (!decision.render) continue;
+            ++rendered;
+            CHECK(decision.presentationTimeNs > lastPresentationTimeNs);
+            CHECK(decision.presentationTimeNs >= clock.nowNs);
+            lastPresentationTimeNs = decision.presentationTimeNs;
+        }
+        CHECK(rendered == 1000);
+    }
+
+    void TestUntrustedLatencyFallsBackToNow() {
+        FakeFrameClock clock;
+        FrameScheduler scheduler(clock);
+
+        // A timestamp in another time base is presented right away.
+        clock.nowNs = 5000 * MS;
+        const int64_t untrustedTimestampNs =
+                clock.nowNs - FrameScheduler::MAX_TRUSTED_LATENCY_NS - MS;
+        auto decision = scheduler.Schedule(untrustedTimestampNs, 0);
+        CHECK(decision.render);
+        CHECK(decision.presentationTimeNs == clock.nowNs);
+
+        // So is one from the future.
+        scheduler.Reset();
+        decision = scheduler.Schedule(clock.nowNs + MS, 0);
+        CHECK(decision.render);
+        CHECK(decision.presentationTimeNs == clock.nowNs);
+
+        // A trusted latency is smoothed in and presented an interval later instead.
+        scheduler.Reset();
+        clock.nowNs = 6000 * MS;
+        decision = scheduler.Schedule(clock.nowNs - 10 * MS, 0);
+        CHECK(decision.render);
+        CHECK(decision.presentationTimeNs == clock.nowNs + INTERVAL_NS);
+
+        // The limit itself is still trusted.
+        scheduler.Reset();
+        clock.nowNs = 7000 * MS;
+        decision = scheduler.Schedule(clock.nowNs - FrameScheduler::MAX_TRUSTED_LATENCY_NS, 0);
+        CHECK(decision.render);
+        CHECK(decision.presentationTimeNs == clock.nowNs + INTERVAL_NS);
+
+        // An untrusted frame after a presented one still keeps half an interval to it.
+        const int64_t lastPresentationTimeNs = decision.presentationTimeNs;
+        decision = scheduler.Schedule(clock.nowNs + MS, 0);
+        CHECK(decision.render);
+        CHECK(decision.presentationTimeNs == lastPresentationTimeNs + INTERVAL_NS / 2);
+    }
+}  // namespace
+
+int main() {
+    TestStaleFramesAreRejected();
+    TestOnlyNewestLateFrameIsDrawn();
+    TestPresentationTimesNeverDecrease();
+    TestUntrustedLatencyFallsBackToNow();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
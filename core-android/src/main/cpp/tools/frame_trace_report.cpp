@@ -0,0 +1,94 @@
+// Prints the frames of a trace recorded by OpenGLRenderer.startFrameTrace with their timings,
+// side by side with those of a replay of it by OpenGLRenderer.replayFrameTrace if given:
+//
+//   frame_trace_report <trace> [<replayed trace>]
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "frame_trace.h"
+
+namespace {
+    using lookaround::FrameTraceFrame;
+    using lookaround::FrameTraceReader;
+    using lookaround::FrameTraceRecordType;
+
+    const char *const FRAME_RESULTS[] = {"drawn", "unchanged", "failed"};
+
+    bool ReadFrames(const char *path, std::vector<FrameTraceFrame> &frames, size_t &commands) {
+        FrameTraceReader reader;
+        if (!reader.Open(path)) {
+            fprintf(stderr, "%s is not a frame trace.\n", path);
+            return false;
+        }
+        FrameTraceReader::Record record{};
+        commands = 0;
+        while (reader.Next(record)) {
+            if (record.type == FrameTraceRecordType::FRAME) frames.push_back(record.frame);
+            if (record.type == FrameTraceRecordType::COMMAND) ++commands;
+        }
+        return true;
+    }
+
+    double Ms(int64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+    // Percentiles of the drawn frames, the others return early.
+    void PrintSummary(const char *name, const std::vector<FrameTraceFrame> &frames,
+                      int64_t FrameTraceFrame::*time) {
+        std::vector<int64_t> times;
+        for (const auto &frame: frames) {
+            if (frame.result == 0 && frame.*time > 0) times.push_back(frame.*time);
+        }
+        if (times.empty()) return;
+        std::sort(times.begin(), times.end());
+        const auto percentile = [&times](double p) {
+            return Ms(times[static_cast<size_t>(p * static_cast<double>(times.size() - 1))]);
+        };
+        printf("%-16s drawn %zu  p50 %.3f  p90 %.3f  p99 %.3f  max %.3f ms\n", name,
+               times.size(), percentile(.5), percentile(.9), percentile(.99), Ms(times.back()));
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace> [<replayed trace>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<FrameTraceFrame> recorded;
+    std::vector<FrameTraceFrame> replayed;
+    size_t recordedCommands = 0;
+    size_t replayedCommands = 0;
+    if (!ReadFrames(argv[1], recorded, recordedCommands)) return 1;
+    if (argc == 3 && !ReadFrames(argv[2], replayed, replayedCommands)) return 1;
+
+    printf("frame  interval_ms  size       rects  result     render_ms");
+    if (argc == 3) printf("  replay_result  replay_render_ms  replay_finish_ms");
+    printf("\n");
+    for (size_t i = 0; i < recorded.size(); ++i) {
+        const auto &frame = recorded[i];
+        const double interval = i ? Ms(frame.timestampNs - recorded[i - 1].timestampNs) : 0.;
+        printf("%5zu  %11.3f  %4dx%-4d  %5u  %-9s  %9.3f", i, interval, frame.width,
+               frame.height, frame.allRectsCount, FRAME_RESULTS[std::min(frame.result, 2u)],
+               Ms(frame.renderNs));
+        if (i < replayed.size()) {
+            const auto &replay = replayed[i];
+            printf("  %-13s  %16.3f  %16.3f", FRAME_RESULTS[std::min(replay.result, 2u)],
+                   Ms(replay.renderNs), Ms(replay.finishNs));
+        }
+        printf("\n");
+    }
+
+    printf("\n%zu frames, %zu commands\n", recorded.size(), recordedCommands);
+    PrintSummary("recorded render", recorded, &FrameTraceFrame::renderNs);
+    if (argc == 3) {
+        if (replayed.size() != recorded.size() || replayedCommands != recordedCommands) {
+            printf("Replay has %zu frames and %zu commands.\n", replayed.size(),
+                   replayedCommands);
+        }
+        PrintSummary("replay render", replayed, &FrameTraceFrame::renderNs);
+        PrintSummary("replay finish", replayed, &FrameTraceFrame::finishNs);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Compares replays of the golden scenes by pipeline variants against a golden replay, frame by
+// frame, by their drawn pixels and timings:
+//
+//   golden_diff [--ssim <min mean>] [--delta-e <max p99>] <golden replay> <variant replay>...
+//
+// Workflow, with the traces of golden_scenes pushed to the device:
+//   1. Replay each scene by OpenGLRenderer.replayFrameTrace with captureFrames on the
+//      baseline pipeline, these are the golden replays.
+//   2. Replay it again on each variant, e.g. after setSatBlurEnabled(true) or on a build with
+//      the optimization.
+//   3. Pull the replays and diff each variant against the golden replay of its scene.
+// A variant fails if a frame's mean SSIM is below the minimum or its 99th percentile color
+// difference above the maximum, the exit status is 1 then.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "frame_trace.h"
+#include "image_diff.h"
+
+namespace {
+    using lookaround::FrameTraceFrame;
+    using lookaround::FrameTraceImage;
+    using lookaround::FrameTraceImageRole;
+    using lookaround::FrameTraceReader;
+    using lookaround::FrameTraceRecordType;
+    using lookaround::ImageDiff;
+
+    // Mean SSIM a variant may not drop below, and 99th percentile CIEDE2000 difference it may
+    // not exceed, a just noticeable one.
+    constexpr double DEFAULT_MIN_SSIM = .99;
+    constexpr double DEFAULT_MAX_DELTA_E = 2.3;
+
+    // Frames and drawn pixels of a replay, the pixels pointing into its mapped file.
+    struct Replay {
+        const char *path = nullptr;
+        FrameTraceReader reader;
+        std::vector<FrameTraceFrame> frames;
+        std::map<uint32_t, std::pair<FrameTraceImage, const uint8_t *>> outputs;
+    };
+
+    bool ReadReplay(const char *path, Replay &replay) {
+        replay.path = path;
+        if (!replay.reader.Open(path)) {
+            fprintf(stderr, "%s is not a frame trace.\n", path);
+            return false;
+        }
+        FrameTraceReader::Record record{};
+        while (replay.reader.Next(record)) {
+            if (record.type == FrameTraceRecordType::FRAME) replay.frames.push_back(record.frame);
+            if (record.type == FrameTraceRecordType::IMAGE &&
+                record.image.role == FrameTraceImageRole::OUTPUT) {
+                replay.outputs[record.image.frameIndex] = {record.image, record.pixels};
+            }
+        }
+        if (replay.outputs.empty()) {
+            fprintf(stderr, "%s has no drawn frames, replay it with captureFrames.\n", path);
+            return false;
+        }
+        return true;
+    }
+
+    double Ms(int64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+    double Percentile(std::vector<int64_t> times, double p) {
+        if (times.empty()) return 0.;
+        std::sort(times.begin(), times.end());
+        return Ms(times[static_cast<size_t>(p * static_cast<double>(times.size() - 1))]);
+    }
+
+    // Timings of the frames both replays drew, so both percentiles are over the same frames.
+    void PrintTimings(const char *name, const Replay &golden, const Replay &variant,
+                      const std::vector<uint32_t> &frameIndices,
+                      int64_t FrameTraceFrame::*time) {
+        std::vector<int64_t> goldenTimes;
+        std::vector<int64_t> variantTimes;
+        for (auto index: frameIndices) {
+            goldenTimes.push_back(golden.frames[index].*time);
+            variantTimes.push_back(variant.frames[index].*time);
+        }
+        printf("  %-6s p50 %.3f -> %.3f  p90 %.3f -> %.3f ms\n", name,
+               Percentile(goldenTimes, .5), Percentile(variantTimes, .5),
+               Percentile(goldenTimes, .9), Percentile(variantTimes, .9));
+    }
+
+    bool DiffVariant(const Replay &golden, const Replay &variant, double minSsim,
+                     double maxDeltaE) {
+        printf("%s\n", variant.path);
+        printf("frame  ssim      min_ssim  delta_e   p99_de    max_de    "
+               "finish_ms  golden_finish_ms\n");
+        ImageDiff worst;
+        std::vector<uint32_t> frameIndices;
+        bool passed = true;
+        for (const auto &[index, goldenOutput]: golden.outputs) {
+            const auto found = variant.outputs.find(index);
+            const auto &goldenImage = goldenOutput.first;
+            if (found == variant.outputs.end() || index >= variant.frames.size() ||
+                index >= golden.frames.size()) {
+                printf("%5u  not drawn\n", index);
+                passed = false;
+                continue;
+            }
+            const auto &image = found->second.first;
+            if (image.width != goldenImage.width || image.height != goldenImage.height) {
+                printf("%5u  %dx%d instead of %dx%d\n", index, image.width, image.height,
+                       goldenImage.width, goldenImage.height);
+                passed = false;
+                continue;
+            }
+            const ImageDiff diff = lookaround::DiffImages(goldenOutput.second, found->second.second,
+                                                          image.width, image.height);
+            const bool framePassed = diff.meanSsim >= minSsim && diff.p99DeltaE <= maxDeltaE;
+            printf("%5u  %.6f  %.6f  %8.3f  %8.3f  %8.3f  %9.3f  %16.3f%s\n", index,
+                   diff.meanSsim, diff.minSsim, diff.meanDeltaE, diff.p99DeltaE, diff.maxDeltaE,
+                   Ms(variant.frames[index].finishNs), Ms(golden.frames[index].finishNs),
+                   framePassed ? "" : "  FAILED");
+            passed = passed && framePassed;
+            frameIndices.push_back(index);
+
+            worst.meanSsim = std::min(worst.meanSsim, diff.meanSsim);
+            worst.minSsim = std::min(worst.minSsim, diff.minSsim);
+            worst.meanDeltaE = std::max(worst.meanDeltaE, diff.meanDeltaE);
+            worst.p99DeltaE = std::max(worst.p99DeltaE, diff.p99DeltaE);
+            worst.maxDeltaE = std::max(worst.maxDeltaE, diff.maxDeltaE);
+        }
+
+        printf("\n%s: %zu of %zu frames compared\n", passed ? "PASSED" : "FAILED",
+               frameIndices.size(), golden.outputs.size());
+        printf("  worst  ssim %.6f  min_ssim %.6f  delta_e %.3f  p99_de %.3f  max_de %.3f\n",
+               worst.meanSsim, worst.minSsim, worst.meanDeltaE, worst.p99DeltaE,
+               worst.maxDeltaE);
+        PrintTimings("render", golden, variant, frameIndices, &FrameTraceFrame::renderNs);
+        PrintTimings("finish", golden, variant, frameIndices, &FrameTraceFrame::finishNs);
+        printf("\n");
+        return passed;
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    double minSsim = DEFAULT_MIN_SSIM;
+    double maxDeltaE = DEFAULT_MAX_DELTA_E;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (!strcmp(argv[arg], "--ssim")) {
+            minSsim = atof(argv[arg + 1]);
+        } else if (!strcmp(argv[arg], "--delta-e")) {
+            maxDeltaE = atof(argv[arg + 1]);
+        } else {
+            break;
+        }
+    }
+    if (argc - arg < 2) {
+        fprintf(stderr,
+                "Usage: %s [--ssim <min mean>] [--delta-e <max p99>] <golden replay> "
+                "<variant replay>...\n", argv[0]);
+        return 2;
+    }
+
+    Replay golden;
+    if (!ReadReplay(argv[arg], golden)) return 2;
+    bool passed = true;
+    for (++arg; arg < argc; ++arg) {
+        // Each maps its file, only one variant at a time.
+        Replay variant;
+        if (!ReadReplay(argv[arg], variant)) return 2;
+        passed = DiffVariant(golden, variant, minSsim, maxDeltaE) && passed;
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Writes the frame traces of the golden scenes, each drawing a synthetic camera frame stored in
+// the trace, so replays are deterministic and differ only by the pipeline drawing them:
+//
+//   golden_scenes <output dir> [<width> <height>]
+//
+// Scenes are blur_animation.trace, dense_rects.trace and contrasting_color.trace, sized like a
+// 1080x2340 screen by default. See golden_diff for comparing their replays.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "frame_trace.h"
+
+namespace {
+    using lookaround::FrameTraceCommand;
+    using lookaround::FrameTraceFrame;
+    using lookaround::FrameTraceImage;
+    using lookaround::FrameTraceImageRole;
+    using lookaround::FrameTraceState;
+    using lookaround::FrameTraceWriter;
+
+    // Values of RenderCommand::Type, whose header depends on GL.
+    constexpr uint32_t SET_BLUR_ENABLED = 0;
+    constexpr uint32_t SET_CONTRASTING_COLOR = 1;
+
+    // Those of the renderer, blur disabled at MIN_LOD with the contrasting color fully mixed.
+    constexpr float MIN_LOD = -2.f;
+    constexpr float MAX_LOD = 2.f;
+    constexpr float MAX_CONTRASTING_COLOR_MIX = 1.f;
+
+    constexpr int64_t FRAME_INTERVAL_NS = 1'000'000'000 / 60;
+    // Longer than the 300 ms of the blur and color animations, to end on their targets.
+    constexpr int ANIMATION_FRAMES = 24;
+    constexpr int DENSE_RECTS_FRAMES = 10;
+    constexpr int DENSE_RECTS_COUNT = 150;
+
+    constexpr FrameTraceState NO_BLUR{0, MIN_LOD, MAX_CONTRASTING_COLOR_MIX, {-1.f, -1.f, -1.f}};
+
+    // Gradients, stripes, a checkerboard and disks: smooth areas show banding, edges show how
+    // far the blur spreads and the disks its color shifts.
+    std::vector<uint8_t> CameraImage(int width, int height) {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+        const struct {
+            float x, y, radius;
+            uint8_t color[3];
+        } disks[] = {{.3f, .2f, .12f, {230, 40, 40}},
+                     {.7f, .45f, .18f, {40, 200, 60}},
+                     {.4f, .75f, .15f, {50, 80, 230}}};
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                uint8_t *pixel = pixels.data() + (static_cast<size_t>(y) * width + x) * 4;
+                const float u = static_cast<float>(x) / static_cast<float>(width);
+                const float v = static_cast<float>(y) / static_cast<float>(height);
+                if (v < .5f) {
+                    pixel[0] = static_cast<uint8_t>(255.f * u);
+                    pixel[1] = static_cast<uint8_t>(255.f * v * 2.f);
+                    pixel[2] = static_cast<uint8_t>(255.f * (1.f - u));
+                } else if (u < .5f) {
+                    pixel[0] = pixel[1] = pixel[2] = (x / 8) % 2 ? 235 : 20;
+                } else {
+                    pixel[0] = pixel[1] = pixel[2] = (x / 32 + y / 32) % 2 ? 200 : 60;
+                }
+                pixel[3] = 255;
+                for (const auto &disk: disks) {
+                    const float dx = (u - disk.x) * static_cast<float>(width);
+                    const float dy = (v - disk.y) * static_cast<float>(height);
+                    if (std::hypot(dx, dy) > disk.radius * static_cast<float>(width)) continue;
+                    pixel[0] = disk.color[0];
+                    pixel[1] = disk.color[1];
+                    pixel[2] = disk.color[2];
+                }
+            }
+        }
+        return pixels;
+    }
+
+    class Scene {
+    public:
+        Scene(int width, int height) : width(width), height(height) {}
+
+        // Stores the camera image after state, the replay draws it instead of the camera.
+        bool Open(const std::string &path, const FrameTraceState &state,
+                  const std::vector<uint8_t> &camera) {
+            const size_t imageBytes = static_cast<size_t>(width) * height * 4;
+            if (!writer.Open(path.c_str(), imageBytes + (1 << 20))) {
+                fprintf(stderr, "Could not create %s.\n", path.c_str());
+                return false;
+            }
+            writer.AppendState(state);
+            writer.AppendImage({FrameTraceImageRole::CAMERA, 0, width, height}, camera.data());
+            return true;
+        }
+
+        void Command(uint32_t type, bool enabled, bool animated, const float *color = nullptr) {
+            FrameTraceCommand command{timestampNs, type, enabled, animated, {0.f, 0.f, 0.f}};
+            if (color) std::copy_n(color, 3, command.color);
+            writer.AppendCommand(command);
+        }
+
+        // Rects are left, bottom, width, height and corner radius in top-down pixels, the last
+        // otherRectsCount of them not markers - as filled in by OpenGLRenderer.
+        void Frame(const std::vector<float> &rects = {}, uint32_t otherRectsCount = 0) {
+            FrameTraceFrame frame{};
+            frame.timestampNs = timestampNs;
+            frame.width = width;
+            frame.height = height;
+            // Column major, the texture transform flips rows like a SurfaceTexture's does.
+            const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+            const float flip[16] = {1, 0, 0, 0, 0, -1, 0, 0, 0, 0, 1, 0, 0, 1, 0, 1};
+            std::copy_n(identity, 16, frame.vertTransform);
+            std::copy_n(flip, 16, frame.texTransform);
+            frame.allRectsCount =
+                    static_cast<uint32_t>(rects.size() / lookaround::FRAME_TRACE_RECT_COMPONENTS);
+            frame.otherRectsCount = otherRectsCount;
+            writer.AppendFrame(frame, rects.empty() ? nullptr : rects.data());
+            timestampNs += FRAME_INTERVAL_NS;
+        }
+
+        bool Close() {
+            const bool complete = writer.DroppedRecords() == 0;
+            writer.Close();
+            return complete;
+        }
+
+        const int width;
+        const int height;
+
+    private:
+        FrameTraceWriter writer;
+        // Any start works, replays draw at the recorded timestamps.
+        int64_t timestampNs = 1'000'000'000;
+    };
+
+    // Blur fading in, drawing the mid states of the animation.
+    bool BlurAnimation(Scene &scene, const std::string &path,
+                       const std::vector<uint8_t> &camera) {
+        if (!scene.Open(path, NO_BLUR, camera)) return false;
+        scene.Frame();
+        scene.Command(SET_BLUR_ENABLED, true, true);
+        for (int i = 0; i < ANIMATION_FRAMES; ++i) scene.Frame();
+        return scene.Close();
+    }
+
+    // Overlapping rounded rects of markers moving over the blurred frame.
+    bool DenseRects(Scene &scene, const std::string &path, const std::vector<uint8_t> &camera) {
+        const FrameTraceState blurred{1, MAX_LOD, 0.f, {-1.f, -1.f, -1.f}};
+        if (!scene.Open(path, blurred, camera)) return false;
+        const auto width = static_cast<float>(scene.width);
+        const auto height = static_cast<float>(scene.height);
+        const float rectWidth = width * .3f;
+        const float rectHeight = height * .06f;
+        std::vector<float> rects;
+        for (int frame = 0; frame < DENSE_RECTS_FRAMES; ++frame) {
+            rects.clear();
+            for (int i = 0; i < DENSE_RECTS_COUNT; ++i) {
+                // Spread like markers of places at various bearings, drifting between frames.
+                const float phase = static_cast<float>(i) * 2.39996f;
+                const float left = (width - rectWidth) *
+                                   (.5f + .5f * std::sin(phase + static_cast<float>(frame) * .05f));
+                const float bottom = rectHeight + (height - rectHeight) *
+                                                  static_cast<float>(i) /
+                                                  static_cast<float>(DENSE_RECTS_COUNT);
+                rects.insert(rects.end(), {left, bottom, rectWidth, rectHeight, rectHeight * .3f});
+            }
+            scene.Frame(rects, DENSE_RECTS_COUNT / 10);
+        }
+        return scene.Close();
+    }
+
+    // Contrasting color changing while the blur is disabled, fully mixed into the rects.
+    bool ContrastingColor(Scene &scene, const std::string &path,
+                          const std::vector<uint8_t> &camera) {
+        FrameTraceState state = NO_BLUR;
+        state.contrastingColor[0] = state.contrastingColor[1] = state.contrastingColor[2] = .1f;
+        if (!scene.Open(path, state, camera)) return false;
+        const auto width = static_cast<float>(scene.width);
+        const auto height = static_cast<float>(scene.height);
+        const std::vector<float> rects{width * .1f, height * .6f, width * .8f, height * .1f,
+                                       width * .05f,
+                                       width * .1f, height * .3f, width * .8f, height * .1f,
+                                       0.f};
+        scene.Frame(rects);
+        const float light[3] = {.9f, .85f, .6f};
+        scene.Command(SET_CONTRASTING_COLOR, false, true, light);
+        for (int i = 0; i < ANIMATION_FRAMES; ++i) scene.Frame(rects);
+        return scene.Close();
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 2 && argc != 4) {
+        fprintf(stderr, "Usage: %s <output dir> [<width> <height>]\n", argv[0]);
+        return 2;
+    }
+    const int width = argc == 4 ? atoi(argv[2]) : 1080;
+    const int height = argc == 4 ? atoi(argv[3]) : 2340;
+    if (width < 16 || height < 16) {
+        fprintf(stderr, "Scenes need at least 16x16 pixels.\n");
+        return 2;
+    }
+
+    const std::string dir = argv[1];
+    const auto camera = CameraImage(width, height);
+    const struct {
+        const char *name;
+        bool (*write)(Scene &, const std::string &, const std::vector<uint8_t> &);
+    } scenes[] = {{"blur_animation", BlurAnimation},
+                  {"dense_rects", DenseRects},
+                  {"contrasting_color", ContrastingColor}};
+    for (const auto &scene: scenes) {
+        Scene writer(width, height);
+        const std::string path = dir + "/" + scene.name + ".trace";
+        if (!scene.write(writer, path, camera)) return 1;
+        printf("%s\n", path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Host stand-in for the NDK's logcat API, so renderer sources which log build into the host
+// tests. Messages of INFO and above go to stderr.
+
+#include <cstdarg>
+#include <cstdio>
+
+enum {
+    ANDROID_LOG_UNKNOWN = 0,
+    ANDROID_LOG_DEFAULT,
+    ANDROID_LOG_VERBOSE,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR,
+    ANDROID_LOG_FATAL,
+    ANDROID_LOG_SILENT,
+};
+
+inline int __android_log_print(int priority, const char *tag, const char *format, ...)
+        __attribute__((format(printf, 3, 4)));
+
+inline int __android_log_print(int priority, const char *tag, const char *format, ...) {
+    if (priority < ANDROID_LOG_INFO) return 0;
+    va_list arguments;
+    va_start(arguments, format);
+    fprintf(stderr, "%s: ", tag);
+    const int written = vfprintf(stderr, format, arguments);
+    fputc('\n', stderr);
+    va_end(arguments);
+    return written;
+}
@@ -0,0 +1,172 @@
+// Checks ImageDiff against reference values: the CIEDE2000 test data of Sharma, Wu and Dalal,
+// well known sRGB to CIELAB conversions and closed form SSIMs. Run by ctest, exits with 1 on
+// a failure.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "image_diff.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::DeltaE2000;
+    using lookaround::DiffImages;
+    using lookaround::Lab;
+    using lookaround::SrgbToLab;
+
+    // Stabilizing constants of the SSIM paper for 8 bit values.
+    constexpr double SSIM_C1 = (.01 * 255.) * (.01 * 255.);
+    constexpr double SSIM_C2 = (.03 * 255.) * (.03 * 255.);
+
+    int failures = 0;
+
+    bool Near(double value, double expected, double tolerance) {
+        return std::fabs(value - expected) <= tolerance;
+    }
+
+    std::vector<uint8_t> Gray(int width, int height, uint8_t value) {
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4, value);
+        for (size_t i = 3; i < pixels.size(); i += 4) pixels[i] = 255;
+        return pixels;
+    }
+
+    void TestDeltaE2000MatchesSharmaTestData() {
+        struct Pair {
+            Lab first, second;
+            double deltaE;
+        };
+        // Pairs of table 1 of the paper, covering the hue wraparound, neutral and dark colors.
+        const Pair pairs[] = {
+                {{50., 2.6772, -79.7751}, {50., 0., -82.7485}, 2.0425},
+                {{50., 3.1571, -77.2803}, {50., 0., -82.7485}, 2.8615},
+                {{50., 2.8361, -74.0200}, {50., 0., -82.7485}, 3.4412},
+                {{50., -1.3802, -84.2814}, {50., 0., -82.7485}, 1.0000},
+                {{50., 0., 0.}, {50., -1., 2.}, 2.3669},
+                {{50., -1., 2.}, {50., 0., 0.}, 2.3669},
+                {{50., 2.49, -.001}, {50., -2.49, .0009}, 7.1792},
+                {{50., 2.49, -.001}, {50., -2.49, .0011}, 7.2195},
+                {{50., -.001, 2.49}, {50., .0009, -2.49}, 4.8045},
+                {{50., 2.5, 0.}, {73., 25., -18.}, 27.1492},
+                {{50., 2.5, 0.}, {61., -5., 29.}, 22.8977},
+                {{50., 2.5, 0.}, {56., -27., -3.}, 31.9030},
+                {{50., 2.5, 0.}, {58., 24., 15.}, 19.4535},
+                {{50., 2.5, 0.}, {50., 3.1736, .5854}, 1.0000},
+                {{60.2574, -34.0099, 36.2677}, {60.4626, -34.1751, 39.4387}, 1.2644},
+                {{63.0109, -31.0961, -5.8663}, {62.8187, -29.7946, -4.0864}, 1.2630},
+                {{61.2901, 3.7196, -5.3901}, {61.4292, 2.2480, -4.9620}, 1.8731},
+                {{35.0831, -44.1164, 3.7933}, {35.0232, -40.0716, 1.5901}, 1.8645},
+                {{22.7233, 20.0904, -46.6940}, {23.0331, 14.9730, -42.5619}, 2.0373},
+                {{36.4612, 47.8580, 18.3852}, {36.2715, 50.5065, 21.2231}, 1.4146},
+                {{90.8027, -2.0831, 1.4410}, {91.1528, -1.6435, .0447}, 1.4441},
+                {{90.9257, -.5406, -.9208}, {88.6381, -.8985, -.7239}, 1.5381},
+                {{6.7747, -.2908, -2.4247}, {5.8714, -.0985, -2.2286}, .6377},
+                {{2.0776, .0795, -1.1350}, {.9033, -.0636, -.5514}, .9082},
+        };
+        for (const auto &pair: pairs) {
+            const double deltaE = DeltaE2000(pair.first, pair.second);
+            if (!Near(deltaE, pair.deltaE, 1e-4)) {
+                fprintf(stderr, "Expected a CIEDE2000 of %.4f, got %.4f.\n", pair.deltaE,
+                        deltaE);
+                ++failures;
+            }
+        }
+    }
+
+    void TestSrgbToLab() {
+        const uint8_t white[] = {255, 255, 255};
+        const uint8_t black[] = {0, 0, 0};
+        const uint8_t red[] = {255, 0, 0};
+        const Lab whiteLab = SrgbToLab(white);
+        CHECK(Near(whiteLab.l, 100., 1e-3));
+        CHECK(Near(whiteLab.a, 0., 1e-3) && Near(whiteLab.b, 0., 1e-3));
+        const Lab blackLab = SrgbToLab(black);
+        CHECK(Near(blackLab.l, 0., 1e-9));
+        const Lab redLab = SrgbToLab(red);
+        CHECK(Near(redLab.l, 53.2408, 1e-3));
+        CHECK(Near(redLab.a, 80.0925, 1e-3));
+        CHECK(Near(redLab.b, 67.2032, 1e-3));
+    }
+
+    void TestIdenticalImages() {
+        const auto pixels = Gray(32, 24, 90);
+        const auto diff = DiffImages(pixels.data(), pixels.data(), 32, 24);
+        CHECK(diff.meanSsim == 1. && diff.minSsim == 1.);
+        CHECK(diff.meanDeltaE == 0. && diff.p99DeltaE == 0. && diff.maxDeltaE == 0.);
+    }
+
+    void TestSsimOfFlatAndInvertedImages() {
+        // Flat windows: only the luminance term is left.
+        const auto darker = Gray(32, 32, 100);
+        const auto lighter = Gray(32, 32, 110);
+        auto diff = DiffImages(darker.data(), lighter.data(), 32, 32);
+        const double flatSsim =
+                (2. * 100. * 110. + SSIM_C1) / (100. * 100. + 110. * 110. + SSIM_C1);
+        CHECK(Near(diff.meanSsim, flatSsim, 1e-9));
+        CHECK(Near(diff.minSsim, flatSsim, 1e-9));
+
+        // A checkerboard and its inverse: equal means, opposite structure.
+        auto board = Gray(32, 32, 0);
+        auto inverse = Gray(32, 32, 255);
+        for (int y = 0; y < 32; ++y) {
+            for (int x = 0; x < 32; ++x) {
+                if ((x + y) % 2 == 0) continue;
+                const size_t i = (static_cast<size_t>(y) * 32 + x) * 4;
+                for (int c = 0; c < 3; ++c) {
+                    board[i + c] = 255;
+                    inverse[i + c] = 0;
+                }
+            }
+        }
+        diff = DiffImages(board.data(), inverse.data(), 32, 32);
+        const double variance = 127.5 * 127.5;
+        const double invertedSsim = (SSIM_C2 - 2. * variance) / (2. * variance + SSIM_C2);
+        CHECK(Near(diff.meanSsim, invertedSsim, 1e-6));
+        CHECK(Near(diff.minSsim, invertedSsim, 1e-6));
+    }
+
+    void TestDeltaEStatistics() {
+        // 2 of 200 pixels changed: both are above the 99th percentile, which stays at 0.
+        constexpr int width = 20, height = 10;
+        const auto first = Gray(width, height, 128);
+        auto second = first;
+        second[0] = 138;
+        second[4 * 57 + 1] = 120;
+        auto diff = DiffImages(first.data(), second.data(), width, height);
+        const uint8_t gray[] = {128, 128, 128};
+        const uint8_t reddish[] = {138, 128, 128};
+        const uint8_t purplish[] = {128, 120, 128};
+        const double reddishDeltaE = DeltaE2000(SrgbToLab(gray), SrgbToLab(reddish));
+        const double purplishDeltaE = DeltaE2000(SrgbToLab(gray), SrgbToLab(purplish));
+        CHECK(Near(diff.maxDeltaE, std::fmax(reddishDeltaE, purplishDeltaE), 1e-9));
+        CHECK(Near(diff.meanDeltaE, (reddishDeltaE + purplishDeltaE) / (width * height), 1e-9));
+        CHECK(diff.p99DeltaE == 0.);
+
+        // With 3, the largest two are above it and the third one is the 99th percentile.
+        second[4 * 120 + 2] = 255;
+        diff = DiffImages(first.data(), second.data(), width, height);
+        CHECK(Near(diff.p99DeltaE, std::fmin(reddishDeltaE, purplishDeltaE), 1e-6));
+    }
+}  // namespace
+
+int main() {
+    TestDeltaE2000MatchesSharmaTestData();
+    TestSrgbToLab();
+    TestIdenticalImages();
+    TestSsimOfFlatAndInvertedImages();
+    TestDeltaEStatistics();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
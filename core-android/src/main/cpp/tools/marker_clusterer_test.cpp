@@ -0,0 +1,137 @@
+// Clusters markers moving across cell edges and into each other's cards, checking the
+// hysteresis which keeps clusters from flickering and that no drawn cards intersect. Run by
+// ctest, exits with 1 on a failure.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "marker_clusterer.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::MarkerClusterer;
+
+    constexpr GLfloat CARD_WIDTH = 100.f;
+    constexpr GLfloat CARD_HEIGHT = 50.f;
+    constexpr GLfloat VIEW_SIZE = 1000.f;
+
+    int failures = 0;
+
+    struct Markers {
+        std::vector<int64_t> ids;
+        std::vector<GLfloat> x, y;
+
+        size_t ClusterWith(MarkerClusterer &clusterer) const {
+            return clusterer.Cluster(ids.data(), x.data(), y.data(), ids.size(), VIEW_SIZE,
+                                     VIEW_SIZE);
+        }
+    };
+
+    MarkerClusterer CardClusterer() {
+        MarkerClusterer clusterer;
+        clusterer.SetCardSize(CARD_WIDTH, CARD_HEIGHT, 0.f);
+        return clusterer;
+    }
+
+    void TestMarkersKeepTheirCellPastItsEdge() {
+        auto clusterer = CardClusterer();
+        Markers markers{{1, 2}, {5.f, 95.f}, {25.f, 25.f}};
+        CHECK(markers.ClusterWith(clusterer) == 1);
+
+        // Past the edge of the cell, but not HYSTERESIS of a cell past it, and too far from the
+        // other marker for their cards to intersect.
+        markers.x[1] = 120.f;
+        CHECK(markers.ClusterWith(clusterer) == 1);
+        CHECK(clusterer.MemberCounts()[0] == 2);
+
+        markers.x[1] = 130.f;
+        CHECK(markers.ClusterWith(clusterer) == 2);
+
+        // Now held by its new cell, it merges again only once the cards intersect.
+        markers.x[1] = 105.f;
+        CHECK(markers.ClusterWith(clusterer) == 2);
+        markers.x[1] = 95.f;
+        CHECK(markers.ClusterWith(clusterer) == 1);
+    }
+
+    void TestIntersectingCardsMerge() {
+        auto clusterer = CardClusterer();
+        Markers markers{{1, 2}, {90.f, 110.f}, {25.f, 25.f}};
+        CHECK(markers.ClusterWith(clusterer) == 1);
+        CHECK(clusterer.MemberCounts()[0] == 2);
+        CHECK(clusterer.MarkerClusters()[0] == 0 && clusterer.MarkerClusters()[1] == 0);
+        // Centered on the mean of both markers.
+        const auto &rects = clusterer.Rects();
+        CHECK(rects[0] == 50.f && rects[1] == 50.f);
+        CHECK(rects[2] == CARD_WIDTH && rects[3] == CARD_HEIGHT);
+
+        // Merged cards stay merged until they are HYSTERESIS of a card apart.
+        markers.x[1] = 200.f;
+        CHECK(markers.ClusterWith(clusterer) == 1);
+        markers.x[1] = 220.f;
+        CHECK(markers.ClusterWith(clusterer) == 2);
+        CHECK(clusterer.MarkerClusters()[0] == 0 && clusterer.MarkerClusters()[1] == 1);
+    }
+
+    void TestHiddenMarkersAreNotDrawn() {
+        auto clusterer = CardClusterer();
+        Markers markers{{1, 2, 3}, {-200.f, NAN, 500.f}, {25.f, 25.f, 25.f}};
+        CHECK(markers.ClusterWith(clusterer) == 1);
+        CHECK(clusterer.MarkerClusters()[0] == MarkerClusterer::NO_CLUSTER);
+        CHECK(clusterer.MarkerClusters()[1] == MarkerClusterer::NO_CLUSTER);
+        CHECK(clusterer.MarkerClusters()[2] == 0);
+    }
+
+    void TestDrawnCardsNeverIntersect() {
+        auto clusterer = CardClusterer();
+        Markers markers;
+        uint32_t random = 1;
+        for (int64_t id = 0; id < 2000; ++id) {
+            random = random * 1664525u + 1013904223u;
+            markers.ids.push_back(id);
+            markers.x.push_back(static_cast<GLfloat>(random >> 8 & 0xffff) / 65536.f * VIEW_SIZE);
+            markers.y.push_back(static_cast<GLfloat>(random >> 20) / 4096.f * VIEW_SIZE);
+        }
+        const size_t clusters = markers.ClusterWith(clusterer);
+        CHECK(clusters > 0);
+        // At most one card per card sized cell of the view, with some past its edges.
+        CHECK(clusters <= static_cast<size_t>((VIEW_SIZE / CARD_WIDTH + 1.f) *
+                                              (VIEW_SIZE / CARD_HEIGHT + 1.f)));
+
+        const auto &rects = clusterer.Rects();
+        constexpr size_t COMPONENTS = MarkerClusterer::RECT_COMPONENTS;
+        int32_t members = 0;
+        for (size_t i = 0; i < clusters; ++i) {
+            members += clusterer.MemberCounts()[i];
+            for (size_t j = i + 1; j < clusters; ++j) {
+                const GLfloat dx = rects[i * COMPONENTS] - rects[j * COMPONENTS];
+                const GLfloat dy = rects[i * COMPONENTS + 1] - rects[j * COMPONENTS + 1];
+                CHECK(std::fabs(dx) >= CARD_WIDTH || std::fabs(dy) >= CARD_HEIGHT);
+            }
+        }
+        // All markers are in the view and none of their cards is entirely outside of it.
+        CHECK(members == 2000);
+    }
+}  // namespace
+
+int main() {
+    TestMarkersKeepTheirCellPastItsEdge();
+    TestIntersectingCardsMerge();
+    TestHiddenMarkersAreNotDrawn();
+    TestDrawnCardsNeverIntersect();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
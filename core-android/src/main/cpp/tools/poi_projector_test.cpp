@@ -0,0 +1,168 @@
+// Compares PoiProjector against a double precision port of Math3D, the Kotlin projection it
+// replaces. Run by ctest, exits with 1 on a failure.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "poi_projector.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::PoiProjector;
+
+    constexpr double METERS_IN_A_DEGREE = 111111.0;
+    constexpr float VIEW_WIDTH = 1080.f;
+    constexpr float VIEW_HEIGHT = 2200.f;
+
+    int failures = 0;
+
+    struct Projection {
+        bool visible;
+        // Distance in front of the camera, in meters.
+        double depth;
+        double x, y;
+    };
+
+    // Math3D.getRelativeTranslationInMeters, getRelativeRotation and convert3dTo2d with the
+    // camera z angle of 0 getCamRotation sets.
+    Projection ProjectReference(const PoiProjector::Pose &pose, double latitude,
+                                double longitude, double altitude) {
+        const double relativeZ = (pose.latitude - latitude) * METERS_IN_A_DEGREE;
+        const double relativeY = pose.altitude - altitude;
+        const double relativeX = (pose.longitude - longitude) *
+                                 std::cos(pose.latitude - latitude) * METERS_IN_A_DEGREE;
+
+        const double heading = pose.yCos * relativeZ + pose.ySin * relativeX;
+        const double rotatedX = pose.yCos * relativeX - pose.ySin * relativeZ;
+        const double rotatedY = pose.xSin * heading + pose.xCos * relativeY;
+        const double rotatedZ = pose.xCos * heading - pose.xSin * relativeY;
+        if (rotatedZ <= 0.) return {false, rotatedZ, 0., 0.};
+
+        const double screenRatio = (pose.viewWidth + pose.viewHeight) / 2.;
+        const double viewPortX = rotatedX * screenRatio / rotatedZ;
+        const double viewPortY = rotatedY * screenRatio / rotatedZ;
+        const double x = pose.viewWidth / 2. + viewPortX * pose.screenRotationCos -
+                         viewPortY * pose.screenRotationSin;
+        const double y = pose.viewHeight / 2. + viewPortY * pose.screenRotationCos +
+                         viewPortX * pose.screenRotationSin;
+        return {x >= -pose.viewWidth && x <= pose.viewWidth * 2., rotatedZ, x, y};
+    }
+
+    PoiProjector::Pose MakePose(double latitude, double longitude, double altitude,
+                                double pitch, double azimuth, double roll) {
+        // Math3D.getCamRotation for Surface.ROTATION_0.
+        const double xAngle = -pitch;
+        const double yAngle = azimuth + M_PI;
+        const double screenRotation = -roll;
+        return {latitude,
+                longitude,
+                altitude,
+                static_cast<float>(std::sin(xAngle)),
+                static_cast<float>(std::cos(xAngle)),
+                static_cast<float>(std::sin(yAngle)),
+                static_cast<float>(std::cos(yAngle)),
+                static_cast<float>(std::sin(screenRotation)),
+                static_cast<float>(std::cos(screenRotation)),
+                VIEW_WIDTH,
+                VIEW_HEIGHT};
+    }
+
+    void TestPoiAheadIsCentered() {
+        // Due north of a camera looking north, level and upright.
+        const double latitudes[] = {52.2310, 52.2290};
+        const double longitudes[] = {21.0100, 21.0100};
+        const double altitudes[] = {100., 100.};
+        PoiProjector projector;
+        projector.SetPois(latitudes, longitudes, altitudes, 2);
+
+        const auto pose = MakePose(52.2300, 21.0100, 100., 0., 0., 0.);
+        CHECK(projector.Project(pose) == 1);
+        CHECK(std::fabs(projector.ScreenX()[0] - VIEW_WIDTH / 2.f) < .01f);
+        CHECK(std::fabs(projector.ScreenY()[0] - VIEW_HEIGHT / 2.f) < .01f);
+        // The one behind the camera is culled.
+        CHECK(std::isnan(projector.ScreenX()[1]) && std::isnan(projector.ScreenY()[1]));
+    }
+
+    void TestEmptyProjector() {
+        PoiProjector projector;
+        projector.SetPois(nullptr, nullptr, nullptr, 0);
+        CHECK(projector.Count() == 0);
+        CHECK(projector.Project(MakePose(52.23, 21.01, 100., 0., 0., 0.)) == 0);
+    }
+
+    void TestMatchesMath3D() {
+        uint32_t random = 11;
+        auto next = [&random] {
+            random = random * 1664525u + 1013904223u;
+            return static_cast<double>(random >> 8) / static_cast<double>(1u << 24);
+        };
+
+        PoiProjector projector;
+        size_t comparedCount = 0;
+        for (int round = 0; round < 50; ++round) {
+            // Counts which are not whole SIMD vectors too, POIs within a few kilometers.
+            const size_t count = 1 + static_cast<size_t>(next() * 37.);
+            std::vector<double> latitudes, longitudes, altitudes;
+            for (size_t i = 0; i < count; ++i) {
+                latitudes.push_back(52.2300 + (next() - .5) * .04);
+                longitudes.push_back(21.0100 + (next() - .5) * .06);
+                altitudes.push_back(80. + next() * 60.);
+            }
+            projector.SetPois(latitudes.data(), longitudes.data(), altitudes.data(), count);
+            CHECK(projector.Count() == count);
+
+            const auto pose = MakePose(52.2300 + (next() - .5) * .01,
+                                       21.0100 + (next() - .5) * .01, 100. + next() * 20.,
+                                       (next() - .5) * M_PI / 2., next() * 2. * M_PI,
+                                       (next() - .5) * M_PI / 4.);
+            const size_t visible = projector.Project(pose);
+            size_t expectedVisible = 0;
+            size_t ambiguous = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const auto expected =
+                        ProjectReference(pose, latitudes[i], longitudes[i], altitudes[i]);
+                const float x = projector.ScreenX()[i];
+                const float y = projector.ScreenY()[i];
+                // Right at the camera plane or a culling edge float rounding may go either way.
+                if (std::fabs(expected.depth) < 1. ||
+                    std::fabs(expected.x + VIEW_WIDTH) < 1. ||
+                    std::fabs(expected.x - VIEW_WIDTH * 2.) < 1.) {
+                    ++ambiguous;
+                    continue;
+                }
+                CHECK(expected.visible == !std::isnan(x));
+                if (!expected.visible) continue;
+                ++expectedVisible;
+                ++comparedCount;
+                const double tolerance = .5 + 1e-3 * std::fmax(std::fabs(expected.x),
+                                                               std::fabs(expected.y));
+                CHECK(std::fabs(x - expected.x) <= tolerance);
+                CHECK(std::fabs(y - expected.y) <= tolerance);
+            }
+            CHECK(visible >= expectedVisible && visible <= expectedVisible + ambiguous);
+        }
+        // Enough poses face the POIs for the positions to be compared at all.
+        CHECK(comparedCount > 100);
+    }
+}  // namespace
+
+int main() {
+    TestPoiAheadIsCentered();
+    TestEmptyProjector();
+    TestMatchesMath3D();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
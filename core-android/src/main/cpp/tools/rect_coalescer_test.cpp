@@ -0,0 +1,133 @@
+// Rasterizes RectCoalescer regions at pixel centers and checks they shade exactly the union of
+// the rounded rects, solid ones at most once. Run by ctest, exits with 1 on a failure.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "rect_coalescer.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::RectCoalescer;
+
+    constexpr int CANVAS_SIZE = 256;
+
+    int failures = 0;
+
+    bool Contains(GLfloat left, GLfloat top, GLfloat right, GLfloat bottom, GLfloat x,
+                  GLfloat y) {
+        return x >= left && x < right && y >= top && y < bottom;
+    }
+
+    // Same rounded box test as the no blur program.
+    bool InsideRounded(const RectCoalescer::Rect &rect, GLfloat x, GLfloat y) {
+        if (!Contains(rect.left, rect.top, rect.right, rect.bottom, x, y)) return false;
+        const GLfloat radius = rect.cornerRadius;
+        const GLfloat dx = std::max({rect.left + radius - x, 0.f, x - (rect.right - radius)});
+        const GLfloat dy = std::max({rect.top + radius - y, 0.f, y - (rect.bottom - radius)});
+        return dx * dx + dy * dy <= radius * radius;
+    }
+
+    // Checks every pixel of the canvas, returns the number of wrongly shaded ones.
+    int CountWrongPixels(const std::vector<RectCoalescer::Rect> &rects,
+                         const RectCoalescer &coalescer) {
+        int wrong = 0;
+        for (int py = 0; py < CANVAS_SIZE; ++py) {
+            for (int px = 0; px < CANVAS_SIZE; ++px) {
+                const GLfloat x = px + .5f, y = py + .5f;
+                const bool expected = std::any_of(
+                        rects.begin(), rects.end(),
+                        [x, y](const auto &rect) { return InsideRounded(rect, x, y); });
+
+                bool shaded = false;
+                int solidCount = 0;
+                for (const auto &region: coalescer.Regions()) {
+                    if (!Contains(region.left, region.top, region.right, region.bottom, x, y)) {
+                        continue;
+                    }
+                    // Like the stencil program, solid regions skip the clip test.
+                    const bool solid = region.clip.cornerRadius <= 0.f;
+                    if (solid) ++solidCount;
+                    if (solid || InsideRounded(region.clip, x, y)) shaded = true;
+                }
+                if (shaded != expected || solidCount > 1) ++wrong;
+            }
+        }
+        return wrong;
+    }
+
+    void TestSingleRectStaysOneSolidRegion() {
+        RectCoalescer coalescer;
+        CHECK(coalescer.Coalesce({{10.f, 20.f, 110.f, 60.f, 0.f}}));
+        CHECK(coalescer.Regions().size() == 1);
+        CHECK(coalescer.LastStats().regionsPixels == coalescer.LastStats().rectsPixels);
+    }
+
+    void TestUnchangedRectsAreSkipped() {
+        const std::vector<RectCoalescer::Rect> rects{{10.f, 10.f, 90.f, 50.f, 8.f},
+                                                     {40.f, 30.f, 120.f, 80.f, 8.f}};
+        RectCoalescer coalescer;
+        CHECK(coalescer.Coalesce(rects));
+        const auto regionsCount = coalescer.Regions().size();
+        CHECK(!coalescer.Coalesce(rects));
+        CHECK(coalescer.Regions().size() == regionsCount);
+    }
+
+    void TestOverlapIsShadedOnce() {
+        // A stack of cards, like markers of nearby places.
+        std::vector<RectCoalescer::Rect> rects;
+        for (int i = 0; i < 5; ++i) {
+            const auto offset = static_cast<GLfloat>(i * 12);
+            rects.push_back({20.f + offset, 30.f + offset, 180.f + offset, 90.f + offset, 10.f});
+        }
+        RectCoalescer coalescer;
+        coalescer.Coalesce(rects);
+        CHECK(CountWrongPixels(rects, coalescer) == 0);
+        CHECK(coalescer.LastStats().regionsPixels < coalescer.LastStats().rectsPixels);
+    }
+
+    void TestRandomRectsMatchUnion() {
+        uint32_t random = 3;
+        auto next = [&random](uint32_t bound) {
+            random = random * 1664525u + 1013904223u;
+            return static_cast<GLfloat>((random >> 8) % bound);
+        };
+
+        RectCoalescer coalescer;
+        for (int round = 0; round < 20; ++round) {
+            std::vector<RectCoalescer::Rect> rects;
+            const int count = 1 + static_cast<int>(next(8));
+            for (int i = 0; i < count; ++i) {
+                const GLfloat left = next(CANVAS_SIZE - 40), top = next(CANVAS_SIZE - 40);
+                const GLfloat width = 20.f + next(CANVAS_SIZE - 20 - left);
+                const GLfloat height = 20.f + next(CANVAS_SIZE - 20 - top);
+                const GLfloat radius = next(static_cast<uint32_t>(std::min(width, height) / 2));
+                rects.push_back({left, top, left + width, top + height, radius});
+            }
+            coalescer.Coalesce(rects);
+            CHECK(CountWrongPixels(rects, coalescer) == 0);
+        }
+    }
+}  // namespace
+
+int main() {
+    TestSingleRectStaysOneSolidRegion();
+    TestUnchangedRectsAreSkipped();
+    TestOverlapIsShadedOnce();
+    TestRandomRectsMatchUnion();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
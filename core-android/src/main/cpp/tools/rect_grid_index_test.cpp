@@ -0,0 +1,152 @@
+// Checks RectGridIndex hit tests, occlusion and visibility queries against a brute force
+// reference. Run by ctest, exits with 1 on a failure.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "rect_grid_index.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::RectGridIndex;
+
+    constexpr GLfloat VIEWPORT_WIDTH = 1080.f;
+    constexpr GLfloat VIEWPORT_HEIGHT = 2200.f;
+
+    int failures = 0;
+
+    // Appends a rect given by its top-left corner, in the layout renderTexture takes.
+    void AddRect(std::vector<GLfloat> &rects, GLfloat left, GLfloat top, GLfloat width,
+                 GLfloat height, GLfloat cornerRadius) {
+        rects.insert(rects.end(), {left, top + height, width, height,
+                                   cornerRadius * RectGridIndex::CORNER_RADIUS_SCALE});
+    }
+
+    size_t CountOf(const std::vector<GLfloat> &rects) {
+        return rects.size() / RectGridIndex::RECT_COMPONENTS;
+    }
+
+    std::vector<uint32_t> BruteForceVisible(const RectGridIndex &index,
+                                            const std::vector<GLfloat> &rects) {
+        std::vector<uint32_t> visible;
+        for (uint32_t i = 0; i < CountOf(rects); ++i) {
+            const GLfloat *rect = &rects[i * RectGridIndex::RECT_COMPONENTS];
+            const GLfloat left = rect[0], right = rect[0] + rect[2];
+            const GLfloat bottom = rect[1], top = rect[1] - rect[3];
+            if (index.IsOccluded(i) || right <= 0.f || left >= VIEWPORT_WIDTH ||
+                bottom <= 0.f || top >= VIEWPORT_HEIGHT) {
+                continue;
+            }
+            visible.push_back(i);
+        }
+        return visible;
+    }
+
+    void TestHitTestPicksTopmostAndSkipsCorners() {
+        std::vector<GLfloat> rects;
+        AddRect(rects, 100.f, 100.f, 300.f, 100.f, 20.f);
+        AddRect(rects, 200.f, 150.f, 300.f, 100.f, 0.f);
+        RectGridIndex index;
+        index.Update(rects.data(), CountOf(rects));
+
+        CHECK(index.HitTest(150.f, 120.f) == 0);
+        CHECK(index.HitTest(250.f, 175.f) == 1);
+        CHECK(index.HitTest(450.f, 240.f) == 1);
+        // Inside the bounds of the first rect, but outside its rounded corner.
+        CHECK(index.HitTest(101.f, 101.f) == RectGridIndex::NO_RECT);
+        CHECK(index.HitTest(50.f, 50.f) == RectGridIndex::NO_RECT);
+    }
+
+    void TestOcclusion() {
+        std::vector<GLfloat> rects;
+        AddRect(rects, 110.f, 110.f, 80.f, 40.f, 0.f);
+        AddRect(rects, 100.f, 100.f, 100.f, 60.f, 0.f);
+        // Square corners under a rounded cover poke out of it.
+        AddRect(rects, 401.f, 101.f, 98.f, 58.f, 0.f);
+        AddRect(rects, 400.f, 100.f, 100.f, 60.f, 20.f);
+        RectGridIndex index;
+        index.Update(rects.data(), CountOf(rects));
+
+        CHECK(index.IsOccluded(0));
+        CHECK(!index.IsOccluded(1));
+        CHECK(!index.IsOccluded(2));
+        CHECK(!index.IsOccluded(3));
+    }
+
+    void TestQueryVisibleReportsEachRectOnceInOrder() {
+        std::vector<GLfloat> rects;
+        // Spans many cells.
+        AddRect(rects, -50.f, -50.f, 900.f, 700.f, 10.f);
+        // Off screen on every side.
+        AddRect(rects, -400.f, 300.f, 200.f, 100.f, 0.f);
+        AddRect(rects, VIEWPORT_WIDTH, 300.f, 200.f, 100.f, 0.f);
+        AddRect(rects, 300.f, -300.f, 200.f, 100.f, 0.f);
+        AddRect(rects, 300.f, VIEWPORT_HEIGHT + 10.f, 200.f, 100.f, 0.f);
+        // Partly on screen, across a cell boundary.
+        AddRect(rects, VIEWPORT_WIDTH - 20.f, 1000.f, 200.f, 100.f, 0.f);
+        AddRect(rects, 600.f, 1200.f, 100.f, 100.f, 0.f);
+        RectGridIndex index;
+        index.Update(rects.data(), CountOf(rects));
+
+        std::vector<uint32_t> visible;
+        index.QueryVisible(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, visible);
+        CHECK((visible == std::vector<uint32_t>{0, 5, 6}));
+        // Stamps from the previous query must not hide anything from the next one.
+        index.QueryVisible(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, visible);
+        CHECK((visible == std::vector<uint32_t>{0, 5, 6}));
+        index.QueryVisible(0.f, VIEWPORT_HEIGHT, visible);
+        CHECK(visible.empty());
+    }
+
+    void TestUpdatesMatchBruteForce() {
+        uint32_t random = 7;
+        auto next = [&random](uint32_t bound) {
+            random = random * 1664525u + 1013904223u;
+            return static_cast<GLfloat>((random >> 8) % bound);
+        };
+
+        RectGridIndex index;
+        std::vector<GLfloat> rects;
+        std::vector<uint32_t> visible;
+        for (int frame = 0; frame < 200; ++frame) {
+            // Markers come and go and move around, partly off screen.
+            const size_t count = 1 + static_cast<size_t>(next(60));
+            rects.resize(count * RectGridIndex::RECT_COMPONENTS);
+            for (size_t i = 0; i < count; ++i) {
+                if (frame > 0 && next(4) != 0) continue;
+                rects[i * RectGridIndex::RECT_COMPONENTS] = next(1600) - 300.f;
+                rects[i * RectGridIndex::RECT_COMPONENTS + 1] = next(2800) - 300.f;
+                rects[i * RectGridIndex::RECT_COMPONENTS + 2] = 50.f + next(400);
+                rects[i * RectGridIndex::RECT_COMPONENTS + 3] = 50.f + next(200);
+                rects[i * RectGridIndex::RECT_COMPONENTS + 4] = next(40);
+            }
+            index.Update(rects.data(), count);
+            CHECK(index.Count() == count);
+
+            index.QueryVisible(VIEWPORT_WIDTH, VIEWPORT_HEIGHT, visible);
+            CHECK(visible == BruteForceVisible(index, rects));
+        }
+    }
+}  // namespace
+
+int main() {
+    TestHitTestPicksTopmostAndSkipsCorners();
+    TestOcclusion();
+    TestQueryVisibleReportsEachRectOnceInOrder();
+    TestUpdatesMatchBruteForce();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
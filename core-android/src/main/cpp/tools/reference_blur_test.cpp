@@ -0,0 +1,182 @@
+// Blurs a synthetic camera frame with ReferenceBlur and compares the quarter size level with
+// the golden in goldens/, checking also that the result does not depend on the number of
+// threads. Run by ctest, exits with 1 on a failure:
+//
+//   reference_blur_test <golden ppm> [--update]
+//
+// --update rewrites the golden after an intended change of the blur.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "reference_blur.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::ReferenceBlur;
+
+    constexpr int WIDTH = 128;
+    constexpr int HEIGHT = 96;
+    // Of a channel, for SIMD and scalar rounding to differ by.
+    constexpr int MAX_GOLDEN_DIFFERENCE = 1;
+
+    int failures = 0;
+
+    // A gradient, a checkerboard and a disk, so the golden shows how far edges spread.
+    std::vector<uint8_t> CameraFrame() {
+        std::vector<uint8_t> pixels(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+        for (int y = 0; y < HEIGHT; ++y) {
+            for (int x = 0; x < WIDTH; ++x) {
+                uint8_t *pixel = &pixels[(static_cast<size_t>(y) * WIDTH + x) * 4];
+                const int dx = x - WIDTH * 3 / 4;
+                const int dy = y - HEIGHT / 2;
+                if (dx * dx + dy * dy < 20 * 20) {
+                    pixel[0] = 230;
+                    pixel[1] = 40;
+                    pixel[2] = 40;
+                } else if (x < WIDTH / 2 && y >= HEIGHT / 2) {
+                    const uint8_t value = (x / 8 + y / 8) % 2 ? 240 : 20;
+                    pixel[0] = pixel[1] = pixel[2] = value;
+                } else {
+                    pixel[0] = static_cast<uint8_t>(x * 255 / (WIDTH - 1));
+                    pixel[1] = static_cast<uint8_t>(y * 255 / (HEIGHT - 1));
+                    pixel[2] = 128;
+                }
+                pixel[3] = 255;
+            }
+        }
+        return pixels;
+    }
+
+    std::vector<uint8_t> Blurred(ReferenceBlur &blur, const std::vector<uint8_t> &frame,
+                                 const ReferenceBlur::Params &params, int level) {
+        const int width = ReferenceBlur::LevelSize(WIDTH, level);
+        const int height = ReferenceBlur::LevelSize(HEIGHT, level);
+        std::vector<uint8_t> output(static_cast<size_t>(width) * height * 4);
+        CHECK(blur.Blur(frame.data(), WIDTH, HEIGHT, WIDTH * 4, params, level, output.data(),
+                        width * 4));
+        return output;
+    }
+
+    // Plain PPM, RGB of the RGBA pixels.
+    bool WriteGolden(const char *path, const std::vector<uint8_t> &pixels, int width,
+                     int height) {
+        FILE *file = fopen(path, "w");
+        if (!file) return false;
+        fprintf(file, "P3\n%d %d\n255\n", width, height);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const uint8_t *pixel = &pixels[(static_cast<size_t>(y) * width + x) * 4];
+                fprintf(file, x + 1 < width ? "%d %d %d " : "%d %d %d\n", pixel[0], pixel[1],
+                        pixel[2]);
+            }
+        }
+        return fclose(file) == 0;
+    }
+
+    bool ReadGolden(const char *path, std::vector<uint8_t> &pixels, int width, int height) {
+        FILE *file = fopen(path, "r");
+        if (!file) return false;
+        int fileWidth = 0;
+        int fileHeight = 0;
+        int maxValue = 0;
+        bool read = fscanf(file, "P3 %d %d %d", &fileWidth, &fileHeight, &maxValue) == 3 &&
+                    fileWidth == width && fileHeight == height && maxValue == 255;
+        pixels.assign(static_cast<size_t>(width) * height * 4, 255);
+        for (size_t i = 0; read && i < pixels.size(); ++i) {
+            if (i % 4 == 3) continue;
+            int value = 0;
+            read = fscanf(file, "%d", &value) == 1;
+            pixels[i] = static_cast<uint8_t>(value);
+        }
+        fclose(file);
+        return read;
+    }
+
+    void TestMatchesGolden(const char *goldenPath, bool update) {
+        ReferenceBlur blur;
+        ReferenceBlur::Params params;
+        const int level = ReferenceBlur::LEVEL_QUARTER;
+        const auto blurred = Blurred(blur, CameraFrame(), params, level);
+        const int width = ReferenceBlur::LevelSize(WIDTH, level);
+        const int height = ReferenceBlur::LevelSize(HEIGHT, level);
+        if (update) {
+            CHECK(WriteGolden(goldenPath, blurred, width, height));
+            return;
+        }
+
+        std::vector<uint8_t> golden;
+        CHECK(ReadGolden(goldenPath, golden, width, height));
+        if (golden.size() != blurred.size()) return;
+        int maxDifference = 0;
+        for (size_t i = 0; i < golden.size(); ++i) {
+            maxDifference = std::max(maxDifference, std::abs(golden[i] - blurred[i]));
+        }
+        CHECK(maxDifference <= MAX_GOLDEN_DIFFERENCE);
+    }
+
+    void TestThreadCountDoesNotMatter() {
+        ReferenceBlur::Params params;
+        params.contrastingColor = {.1f, .8f, .3f};
+        params.contrastingColorMix = .05f;
+        const auto frame = CameraFrame();
+        ReferenceBlur singleThreaded(1);
+        ReferenceBlur multiThreaded(4);
+        const auto expected = Blurred(singleThreaded, frame, params, ReferenceBlur::LEVEL_FULL);
+        // Blurs in a row reuse the pool, they must not pick up each other's bands.
+        for (int i = 0; i < 3; ++i) {
+            CHECK(Blurred(multiThreaded, frame, params, ReferenceBlur::LEVEL_FULL) == expected);
+        }
+    }
+
+    void TestUniformFrameStaysUniform() {
+        std::vector<uint8_t> frame(static_cast<size_t>(WIDTH) * HEIGHT * 4);
+        for (size_t i = 0; i < frame.size(); ++i) frame[i] = i % 4 == 3 ? 255 : 77;
+        ReferenceBlur blur(2);
+        const int width = ReferenceBlur::LevelSize(WIDTH, ReferenceBlur::LEVEL_FULL);
+        std::vector<uint8_t> output(static_cast<size_t>(width) * HEIGHT * 4);
+        CHECK(blur.Blur(frame.data(), WIDTH, HEIGHT, WIDTH * 4, ReferenceBlur::Params(),
+                        ReferenceBlur::LEVEL_FULL, output.data(), width * 4));
+        int maxDifference = 0;
+        for (size_t i = 0; i < output.size(); ++i) {
+            if (i % 4 != 3) maxDifference = std::max(maxDifference, std::abs(output[i] - 77));
+        }
+        CHECK(maxDifference <= 1);
+    }
+
+    void TestTooSmallFramesAreRejected() {
+        ReferenceBlur blur(2);
+        const uint8_t frame[3 * 3 * 4] = {};
+        uint8_t output[3 * 3 * 4];
+        CHECK(!blur.Blur(frame, 3, 3, 3 * 4, ReferenceBlur::Params(), ReferenceBlur::LEVEL_FULL,
+                         output, 3 * 4));
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <golden ppm> [--update]\n", argv[0]);
+        return 1;
+    }
+    TestMatchesGolden(argv[1], argc > 2 && strcmp(argv[2], "--update") == 0);
+    TestThreadCountDoesNotMatter();
+    TestUniformFrameStaysUniform();
+    TestTooSmallFramesAreRejected();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+// Checks that RenderCommandQueue keeps commands in order, never drops one and always lands
+// each setter's latest value, also with the render thread draining it concurrently. Run by
+// ctest, exits with 1 on a failure.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "render_command.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::RENDER_COMMAND_QUEUE_CAPACITY;
+    using lookaround::RenderCommand;
+    using lookaround::RenderCommandQueue;
+
+    // Colors carry a sequence number in the red channel, exact in the 16 bit packing.
+    constexpr int32_t SEQUENCE_MAX = 0xffff;
+
+    int failures = 0;
+
+    RenderCommand Color(int32_t sequence) {
+        RenderCommand command;
+        command.type = RenderCommand::Type::SET_CONTRASTING_COLOR;
+        command.red = static_cast<GLfloat>(sequence) / SEQUENCE_MAX;
+        command.green = .5f;
+        command.animated = sequence % 2 == 0;
+        return command;
+    }
+
+    int32_t SequenceOf(const RenderCommand &command) {
+        return static_cast<int32_t>(std::lround(command.red * SEQUENCE_MAX));
+    }
+
+    RenderCommand BlurEnabled(bool enabled) {
+        RenderCommand command;
+        command.type = RenderCommand::Type::SET_BLUR_ENABLED;
+        command.enabled = enabled;
+        return command;
+    }
+
+    std::vector<RenderCommand> Drain(RenderCommandQueue &queue) {
+        std::vector<RenderCommand> commands;
+        RenderCommand command;
+        while (queue.TryPop(command)) commands.push_back(command);
+        return commands;
+    }
+
+    void TestCommandsArriveInOrder() {
+        RenderCommandQueue queue;
+        queue.Push(BlurEnabled(true));
+        queue.Push(Color(1));
+        queue.Push(BlurEnabled(false));
+
+        const auto commands = Drain(queue);
+        CHECK(commands.size() == 3);
+        if (commands.size() != 3) return;
+        CHECK(commands[0].type == RenderCommand::Type::SET_BLUR_ENABLED && commands[0].enabled);
+        CHECK(commands[1].type == RenderCommand::Type::SET_CONTRASTING_COLOR);
+        CHECK(SequenceOf(commands[1]) == 1 && commands[1].green == .5f);
+        CHECK(commands[2].type == RenderCommand::Type::SET_BLUR_ENABLED && !commands[2].enabled);
+    }
+
+    void TestOverflowKeepsLatestValues() {
+        RenderCommandQueue queue;
+        int32_t sequence = 0;
+        for (size_t i = 0; i < RENDER_COMMAND_QUEUE_CAPACITY; ++i) queue.Push(Color(++sequence));
+        // None of these fit, only the last of each setter has to land.
+        for (int i = 0; i < 10; ++i) queue.Push(Color(++sequence));
+        queue.Push(BlurEnabled(true));
+        queue.Push(BlurEnabled(false));
+
+        // The render thread takes one, making room while the color is pending.
+        RenderCommand command;
+        CHECK(queue.TryPop(command) && SequenceOf(command) == 1);
+        // Must not overtake the pending color through the free queue slot.
+        queue.Push(Color(++sequence));
+
+        const auto commands = Drain(queue);
+        CHECK(commands.size() == RENDER_COMMAND_QUEUE_CAPACITY - 1 + 2);
+        int32_t lastSequence = 1;
+        bool blurEnabled = true;
+        for (const auto &drained: commands) {
+            if (drained.type == RenderCommand::Type::SET_BLUR_ENABLED) {
+                blurEnabled = drained.enabled;
+                continue;
+            }
+            CHECK(SequenceOf(drained) > lastSequence);
+            lastSequence = SequenceOf(drained);
+            CHECK(drained.animated == (lastSequence % 2 == 0));
+        }
+        CHECK(lastSequence == sequence);
+        CHECK(!blurEnabled);
+
+        // Once the latest values are taken, commands are queued again.
+        queue.Push(Color(++sequence));
+        queue.Push(Color(++sequence));
+        const auto queued = Drain(queue);
+        CHECK(queued.size() == 2);
+    }
+
+    void TestConcurrentLatestValueOrdering() {
+        RenderCommandQueue queue;
+        std::atomic<bool> producerDone{false};
+        std::thread producer([&queue, &producerDone] {
+            for (int32_t sequence = 1; sequence <= SEQUENCE_MAX; ++sequence) {
+                queue.Push(Color(sequence));
+                if (sequence % 7 == 0) queue.Push(BlurEnabled(sequence % 2 == 0));
+            }
+            producerDone.store(true, std::memory_order_release);
+        });
+
+        // Applies commands like the render thread, checking a setter never goes back in time.
+        int32_t lastSequence = 0;
+        bool ordered = true;
+        RenderCommand command;
+        for (;;) {
+            const bool finished = producerDone.load(std::memory_order_acquire);
+            while (queue.TryPop(command)) {
+                if (command.type != RenderCommand::Type::SET_CONTRASTING_COLOR) continue;
+                if (SequenceOf(command) < lastSequence) ordered = false;
+                lastSequence = SequenceOf(command);
+            }
+            if (finished) break;
+        }
+        producer.join();
+
+        CHECK(ordered);
+        CHECK(lastSequence == SEQUENCE_MAX);
+    }
+}  // namespace
+
+int main() {
+    TestCommandsArriveInOrder();
+    TestOverflowKeepsLatestValues();
+    TestConcurrentLatestValueOrdering();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Checks the Kovesi box radii SatBlur approximates a gaussian with. Run by ctest, exits with 1
+// on a failure.
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+#include "sat_blur.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::SatBlur;
+
+    int failures = 0;
+
+    // Successive boxes add up their variances, (w^2 - 1) / 12 for a box of odd width w.
+    double Variance(const std::array<GLint, SatBlur::BOX_PASS_COUNT> &radii) {
+        double variance = 0.;
+        for (GLint radius: radii) {
+            const double width = 2. * radius + 1.;
+            variance += (width * width - 1.) / 12.;
+        }
+        return variance;
+    }
+
+    void TestKnownRadii() {
+        // Worked out by hand from the paper's wl, wu and m.
+        CHECK((SatBlur::BoxRadii(1.f) == std::array<GLint, 3>{0, 0, 1}));
+        CHECK((SatBlur::BoxRadii(3.f) == std::array<GLint, 3>{2, 2, 3}));
+        CHECK((SatBlur::BoxRadii(10.f) == std::array<GLint, 3>{9, 9, 10}));
+        CHECK((SatBlur::BoxRadii(.1f) == std::array<GLint, 3>{0, 0, 0}));
+    }
+
+    void TestRadiiApproximateSigma() {
+        for (int step = 4; step <= 400; ++step) {
+            const float sigma = static_cast<float>(step) / 4.f;
+            const auto radii = SatBlur::BoxRadii(sigma);
+
+            // The m smaller boxes first, then boxes one radius larger.
+            bool shaped = radii[0] >= 0;
+            for (int i = 1; i < SatBlur::BOX_PASS_COUNT; ++i) {
+                shaped = shaped && (radii[i] == radii[i - 1] || radii[i] == radii[i - 1] + 1);
+            }
+            CHECK(shaped);
+
+            // Rounding m misses the variance by at most half of what one larger box adds.
+            const double lowerWidth = 2. * radii[0] + 1.;
+            const double error = std::fabs(Variance(radii) - static_cast<double>(sigma) * sigma);
+            CHECK(error <= (lowerWidth + 1.) / 6. + 1e-3);
+        }
+    }
+}  // namespace
+
+int main() {
+    TestKnownRadii();
+    TestRadiiApproximateSigma();
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
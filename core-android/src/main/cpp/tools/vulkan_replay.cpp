@@ -0,0 +1,216 @@
+// Replays a frame trace on the Vulkan renderer without a window or a GPU, e.g. on lavapipe,
+// recording its frames with their timings and drawn pixels like OpenGLRenderer.replayFrameTrace
+// with captureFrames does:
+//
+//   VK_ICD_FILENAMES=<lvp_icd.json> vulkan_replay [--shaders <dir>] [--max-mib <size>]
+//       <trace> <replay>
+//
+// The trace must store its camera frame, as those of golden_scenes do. The replay diffs
+// against a GL replay of the same trace with golden_diff, which keeps both backends drawing
+// the same frames. Exits with EXIT_NO_DEVICE without a Vulkan 1.1 device, which ctest takes
+// as a skipped test.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "frame_trace.h"
+#include "render_command.h"
+#include "vulkan_renderer.h"
+
+namespace {
+    using lookaround::FrameTraceFrame;
+    using lookaround::FrameTraceImageRole;
+    using lookaround::FrameTraceReader;
+    using lookaround::FrameTraceRecordType;
+    using lookaround::FrameTraceWriter;
+    using lookaround::RenderCommand;
+    using lookaround::VulkanContext;
+    using lookaround::VulkanRenderer;
+
+    constexpr size_t DEFAULT_MAX_OUTPUT_MIB = 512;
+    constexpr int EXIT_NO_DEVICE = 77;
+
+    int64_t NowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    std::vector<uint32_t> LoadShader(const std::string &dir, const char *name) {
+        std::ifstream file(dir + "/" + name, std::ios::binary | std::ios::ate);
+        if (!file) return {};
+        const auto length = static_cast<size_t>(file.tellg());
+        std::vector<uint32_t> code(length / sizeof(uint32_t));
+        file.seekg(0);
+        const bool read = length % sizeof(uint32_t) == 0 &&
+                          file.read(reinterpret_cast<char *>(code.data()),
+                                    static_cast<std::streamsize>(length));
+        if (!read) code.clear();
+        return code;
+    }
+
+    // Size of the first frame, that of the offscreen target.
+    bool FindTargetSize(FrameTraceReader &trace, int32_t &width, int32_t &height) {
+        FrameTraceReader::Record record{};
+        while (trace.Next(record)) {
+            if (record.type != FrameTraceRecordType::FRAME) continue;
+            width = record.frame.width;
+            height = record.frame.height;
+            break;
+        }
+        trace.Rewind();
+        return width > 0 && height > 0;
+    }
+
+    // Returns the number of frames replayed, -1 if one could not be read back.
+    int Replay(VulkanRenderer &renderer, FrameTraceReader &trace, FrameTraceWriter &output) {
+        const auto width = static_cast<int32_t>(renderer.TargetWidth());
+        const auto height = static_cast<int32_t>(renderer.TargetHeight());
+        std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+        bool hasCamera = false;
+        int frames = 0;
+        FrameTraceReader::Record record{};
+        while (trace.Next(record)) {
+            switch (record.type) {
+                case FrameTraceRecordType::STATE:
+                    renderer.JumpToState(record.state.blurEnabled != 0, record.state.lod,
+                                         record.state.contrastingColorMix,
+                                         record.state.contrastingColor);
+                    output.AppendState(record.state);
+                    break;
+                case FrameTraceRecordType::COMMAND: {
+                    RenderCommand command;
+                    command.type = static_cast<RenderCommand::Type>(record.command.type);
+                    command.enabled = record.command.enabled != 0;
+                    command.animated = record.command.animated != 0;
+                    command.red = record.command.color[0];
+                    command.green = record.command.color[1];
+                    command.blue = record.command.color[2];
+                    renderer.ApplyCommand(command, record.command.timestampNs);
+                    output.AppendCommand(record.command);
+                    break;
+                }
+                case FrameTraceRecordType::FRAME: {
+                    FrameTraceFrame frame = record.frame;
+                    if (!hasCamera) {
+                        fprintf(stderr, "Frame %d comes before a camera frame, skipped.\n",
+                                frames++);
+                        break;
+                    }
+                    const int64_t startNs = NowNs();
+                    const auto result = renderer.DrawFrame(
+                            frame.timestampNs, frame.vertTransform, frame.texTransform,
+                            frame.allRectsCount ? record.rects : nullptr,
+                            frame.allRectsCount, frame.otherRectsCount);
+                    frame.renderNs = NowNs() - startNs;
+                    // ReadOutput waits for the frame, unchanged frames are not read back.
+                    const bool drawn = result == VulkanRenderer::FrameResult::DRAWN;
+                    if (drawn && !renderer.ReadOutput(pixels.data())) return -1;
+                    frame.finishNs = NowNs() - startNs;
+                    frame.result = static_cast<uint32_t>(result);
+                    frame.width = width;
+                    frame.height = height;
+                    output.AppendFrame(frame, record.rects);
+                    if (drawn) {
+                        output.AppendImage({FrameTraceImageRole::OUTPUT,
+                                            static_cast<uint32_t>(frames), width, height},
+                                           pixels.data());
+                    }
+                    ++frames;
+                    break;
+                }
+                case FrameTraceRecordType::IMAGE:
+                    if (record.image.role != FrameTraceImageRole::CAMERA) break;
+                    if (!renderer.SetCameraPixels(
+                            record.pixels, static_cast<uint32_t>(record.image.width),
+                            static_cast<uint32_t>(record.image.height))) {
+                        fprintf(stderr, "Replaying with the last camera frame, the stored one "
+                                        "could not be uploaded.\n");
+                        break;
+                    }
+                    hasCamera = true;
+                    output.AppendImage(record.image, record.pixels);
+                    break;
+            }
+        }
+        return frames;
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    std::string shadersDir = VULKAN_REPLAY_SHADERS_DIR;
+    size_t maxOutputMib = DEFAULT_MAX_OUTPUT_MIB;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (!strcmp(argv[arg], "--shaders")) {
+            shadersDir = argv[arg + 1];
+        } else if (!strcmp(argv[arg], "--max-mib")) {
+            maxOutputMib = strtoul(argv[arg + 1], nullptr, 10);
+        } else {
+            break;
+        }
+    }
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: %s [--shaders <dir>] [--max-mib <size>] <trace> <replay>\n",
+                argv[0]);
+        return 2;
+    }
+
+    FrameTraceReader trace;
+    if (!trace.Open(argv[arg])) {
+        fprintf(stderr, "%s is not a frame trace.\n", argv[arg]);
+        return 2;
+    }
+    int32_t width = 0;
+    int32_t height = 0;
+    if (!FindTargetSize(trace, width, height)) {
+        fprintf(stderr, "%s has no frames.\n", argv[arg]);
+        return 2;
+    }
+
+    // Headless: no surface extensions and no swapchain.
+    VulkanContext::Options options;
+    options.validation = getenv("VULKAN_REPLAY_VALIDATION") != nullptr;
+    VulkanRenderer renderer;
+    bool shaderMissing = false;
+    const auto loadShader = [&shadersDir, &shaderMissing](const char *name) {
+        auto code = LoadShader(shadersDir, name);
+        if (code.empty()) shaderMissing = true;
+        return code;
+    };
+    if (!renderer.Init(options, loadShader)) {
+        if (shaderMissing) {
+            fprintf(stderr, "Shaders missing from %s.\n", shadersDir.c_str());
+            return 1;
+        }
+        fprintf(stderr, "No Vulkan 1.1 device.\n");
+        return EXIT_NO_DEVICE;
+    }
+    if (!renderer.SetOffscreenTarget(static_cast<uint32_t>(width),
+                                     static_cast<uint32_t>(height))) {
+        fprintf(stderr, "Could not create a %dx%d target.\n", width, height);
+        return 1;
+    }
+
+    FrameTraceWriter output;
+    if (!output.Open(argv[arg + 1], maxOutputMib << 20)) {
+        fprintf(stderr, "Could not create %s.\n", argv[arg + 1]);
+        return 1;
+    }
+    const int frames = Replay(renderer, trace, output);
+    if (output.DroppedRecords() > 0) {
+        fprintf(stderr, "Replay full, %zu records dropped, raise --max-mib.\n",
+                output.DroppedRecords());
+    }
+    output.Close();
+    if (frames < 0) {
+        fprintf(stderr, "Could not read a frame back.\n");
+        return 1;
+    }
+    printf("%s: %d frames\n", argv[arg + 1], frames);
+    return 0;
+}
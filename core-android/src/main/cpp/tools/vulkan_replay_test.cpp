@@ -0,0 +1,123 @@
+// Checks a vulkan_replay of the blur_animation scene of golden_scenes against the CPU blur: its
+// first frame, drawn before the blur fades in, must show the camera frame, and its last, fully
+// blurred, the ReferenceBlur of it. Run by ctest after vulkan_replay, exits with 1 on a failure
+// and with 77, taken as skipped, if there is no replay because there is no Vulkan device:
+//
+//   vulkan_replay_test <replay>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "frame_trace.h"
+#include "image_diff.h"
+#include "reference_blur.h"
+
+#define CHECK(condition)                                                              \
+    do {                                                                              \
+        if (!(condition)) {                                                           \
+            fprintf(stderr, "%s:%d: %s failed.\n", __FILE__, __LINE__, #condition);  \
+            ++failures;                                                               \
+        }                                                                             \
+    } while (false)
+
+namespace {
+    using lookaround::DiffImages;
+    using lookaround::FrameTraceImageRole;
+    using lookaround::FrameTraceReader;
+    using lookaround::FrameTraceRecordType;
+    using lookaround::ImageDiff;
+    using lookaround::ReferenceBlur;
+
+    constexpr int EXIT_SKIPPED = 77;
+    // Those of golden_diff, for GPU and CPU rounding to differ by.
+    constexpr double MIN_SSIM = .99;
+    constexpr double MAX_DELTA_E = 2.3;
+    // The unblurred frame samples texel centers, it differs by rounding at most.
+    constexpr double MAX_UNBLURRED_DELTA_E = 1.;
+
+    int failures = 0;
+
+    std::vector<uint8_t> FlippedRows(const uint8_t *pixels, int width, int height) {
+        const size_t rowBytes = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> flipped(rowBytes * height);
+        for (int y = 0; y < height; ++y) {
+            memcpy(&flipped[(height - 1 - y) * rowBytes], pixels + y * rowBytes, rowBytes);
+        }
+        return flipped;
+    }
+
+    void Print(const char *name, const ImageDiff &diff) {
+        printf("%s: SSIM mean %.4f min %.4f, dE mean %.2f p99 %.2f max %.2f\n", name,
+               diff.meanSsim, diff.minSsim, diff.meanDeltaE, diff.p99DeltaE, diff.maxDeltaE);
+    }
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <replay>\n", argv[0]);
+        return 2;
+    }
+    FrameTraceReader replay;
+    if (!replay.Open(argv[1])) {
+        fprintf(stderr, "No replay at %s, skipped.\n", argv[1]);
+        return EXIT_SKIPPED;
+    }
+
+    // Pixels point into the mapped replay.
+    FrameTraceReader::Record record{};
+    const uint8_t *camera = nullptr;
+    const uint8_t *firstOutput = nullptr;
+    const uint8_t *lastOutput = nullptr;
+    int width = 0;
+    int height = 0;
+    bool sizesMatch = true;
+    while (replay.Next(record)) {
+        if (record.type != FrameTraceRecordType::IMAGE) continue;
+        if (width == 0) {
+            width = record.image.width;
+            height = record.image.height;
+        }
+        sizesMatch = sizesMatch && record.image.width == width && record.image.height == height;
+        if (record.image.role == FrameTraceImageRole::CAMERA) {
+            if (!camera) camera = record.pixels;
+        } else {
+            if (!firstOutput) firstOutput = record.pixels;
+            lastOutput = record.pixels;
+        }
+    }
+    CHECK(camera && firstOutput && lastOutput != firstOutput);
+    CHECK(sizesMatch);
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+
+    // The camera frame is sampled through a transform flipping its rows, the first frame tells
+    // which way up the replay drew it.
+    const auto flippedCamera = FlippedRows(camera, width, height);
+    const ImageDiff unblurred = DiffImages(firstOutput, camera, width, height);
+    const ImageDiff unblurredFlipped = DiffImages(firstOutput, flippedCamera.data(), width, height);
+    const bool flipped = unblurredFlipped.meanDeltaE < unblurred.meanDeltaE;
+    const ImageDiff &unblurredDiff = flipped ? unblurredFlipped : unblurred;
+    Print("unblurred", unblurredDiff);
+    CHECK(unblurredDiff.maxDeltaE <= MAX_UNBLURRED_DELTA_E);
+
+    ReferenceBlur blur;
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+    CHECK(blur.Blur(flipped ? flippedCamera.data() : camera, width, height, width * 4,
+                    ReferenceBlur::Params(), ReferenceBlur::LEVEL_FULL, expected.data(),
+                    width * 4));
+    const ImageDiff blurredDiff = DiffImages(lastOutput, expected.data(), width, height);
+    Print("blurred", blurredDiff);
+    CHECK(blurredDiff.meanSsim >= MIN_SSIM);
+    CHECK(blurredDiff.p99DeltaE <= MAX_DELTA_E);
+
+    if (failures > 0) {
+        fprintf(stderr, "%d checks failed.\n", failures);
+        return 1;
+    }
+    printf("All checks passed.\n");
+    return 0;
+}
@@ -0,0 +1,38 @@
+#include "vk_check.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+namespace lookaround {
+    namespace {
+#ifdef __ANDROID__
+        // The GL renderer's, both backends log as the same renderer.
+        auto constexpr VK_LOG_TAG = "OpenGLRendererJni";
+#endif
+
+        void LogVulkanErrorV(const char *format, va_list args) {
+#ifdef __ANDROID__
+            __android_log_vprint(ANDROID_LOG_ERROR, VK_LOG_TAG, format, args);
+#else
+            vfprintf(stderr, format, args);
+            fputc('\n', stderr);
+#endif
+        }
+    }  // namespace
+
+    void LogVulkanError(const char *format, ...) {
+        va_list args;
+        va_start(args, format);
+        LogVulkanErrorV(format, args);
+        va_end(args);
+    }
+
+    void ReportVkError(VkResult result, const char *call, const char *file, unsigned int line) {
+        LogVulkanError("Vulkan Error: %s (%d) at %s [%s:%u]",
+                       VkResultName(result), static_cast<int>(result), call, file, line);
+    }
+}  // namespace lookaround
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+namespace lookaround {
+    inline const char *VkResultName(VkResult result) {
+        switch (result) {
+            case VK_SUCCESS:
+                return "VK_SUCCESS";
+            case VK_NOT_READY:
+                return "VK_NOT_READY";
+            case VK_TIMEOUT:
+                return "VK_TIMEOUT";
+            case VK_INCOMPLETE:
+                return "VK_INCOMPLETE";
+            case VK_SUBOPTIMAL_KHR:
+                return "VK_SUBOPTIMAL_KHR";
+            case VK_ERROR_OUT_OF_HOST_MEMORY:
+                return "VK_ERROR_OUT_OF_HOST_MEMORY";
+            case VK_ERROR_OUT_OF_DEVICE_MEMORY:
+                return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+            case VK_ERROR_INITIALIZATION_FAILED:
+                return "VK_ERROR_INITIALIZATION_FAILED";
+            case VK_ERROR_DEVICE_LOST:
+                return "VK_ERROR_DEVICE_LOST";
+            case VK_ERROR_LAYER_NOT_PRESENT:
+                return "VK_ERROR_LAYER_NOT_PRESENT";
+            case VK_ERROR_EXTENSION_NOT_PRESENT:
+                return "VK_ERROR_EXTENSION_NOT_PRESENT";
+            case VK_ERROR_FEATURE_NOT_PRESENT:
+                return "VK_ERROR_FEATURE_NOT_PRESENT";
+            case VK_ERROR_INCOMPATIBLE_DRIVER:
+                return "VK_ERROR_INCOMPATIBLE_DRIVER";
+            case VK_ERROR_FORMAT_NOT_SUPPORTED:
+                return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+            case VK_ERROR_SURFACE_LOST_KHR:
+                return "VK_ERROR_SURFACE_LOST_KHR";
+            case VK_ERROR_OUT_OF_DATE_KHR:
+                return "VK_ERROR_OUT_OF_DATE_KHR";
+            case VK_ERROR_INVALID_EXTERNAL_HANDLE:
+                return "VK_ERROR_INVALID_EXTERNAL_HANDLE";
+            default:
+                return "<Unknown VkResult>";
+        }
+    }
+
+    // Logs the failed call with its result. Errors go to logcat on Android and to stderr in the
+    // host tools, which build the Vulkan renderer without Android.
+    void ReportVkError(VkResult result, const char *call, const char *file, unsigned int line);
+
+    // printf style, to the same log as ReportVkError.
+    void LogVulkanError(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+    inline bool CheckVk(VkResult result, const char *call, const char *file, unsigned int line) {
+        if (result == VK_SUCCESS) return true;
+        ReportVkError(result, call, file, line);
+        return false;
+    }
+}  // namespace lookaround
+
+// Evaluates a call returning VkResult, true if it succeeded. Unlike CHECK_GL errors are returned
+// by every call, so the check is always on and the callers bail out on failure.
+#define CHECK_VK(vk_call) ::lookaround::CheckVk((vk_call), #vk_call, __FILE__, __LINE__)
@@ -0,0 +1,313 @@
+#include "vulkan_context.h"
+
+#include <cstring>
+
+#include "vk_check.h"
+
+namespace lookaround {
+    namespace {
+        constexpr const char *VALIDATION_LAYER = "VK_LAYER_KHRONOS_validation";
+
+        bool HasLayer(const char *name) {
+            uint32_t count = 0;
+            vkEnumerateInstanceLayerProperties(&count, nullptr);
+            std::vector<VkLayerProperties> layers(count);
+            vkEnumerateInstanceLayerProperties(&count, layers.data());
+            for (const auto &layer: layers) {
+                if (strcmp(layer.layerName, name) == 0) return true;
+            }
+            return false;
+        }
+
+        bool HasDeviceExtension(VkPhysicalDevice physicalDevice, const char *name) {
+            uint32_t count = 0;
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count, nullptr);
+            std::vector<VkExtensionProperties> extensions(count);
+            vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &count,
+                                                 extensions.data());
+            for (const auto &extension: extensions) {
+                if (strcmp(extension.extensionName, name) == 0) return true;
+            }
+            return false;
+        }
+    }  // namespace
+
+    bool VulkanContext::Init(const Options &options) {
+        VkApplicationInfo applicationInfo{VK_STRUCTURE_TYPE_APPLICATION_INFO};
+        applicationInfo.pApplicationName = "LookARound";
+        applicationInfo.pEngineName = "lookaround";
+        applicationInfo.apiVersion = VK_API_VERSION_1_1;
+
+        std::vector<const char *> layers;
+        if (options.validation && HasLayer(VALIDATION_LAYER)) layers.push_back(VALIDATION_LAYER);
+
+        VkInstanceCreateInfo instanceInfo{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
+        instanceInfo.pApplicationInfo = &applicationInfo;
+        instanceInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+        instanceInfo.ppEnabledLayerNames = layers.data();
+        instanceInfo.enabledExtensionCount =
+                static_cast<uint32_t>(options.instanceExtensions.size());
+        instanceInfo.ppEnabledExtensionNames = options.instanceExtensions.data();
+        if (!CHECK_VK(vkCreateInstance(&instanceInfo, nullptr, &instance))) {
+            instance = VK_NULL_HANDLE;
+            return false;
+        }
+
+        if (!PickPhysicalDevice() || !CreateDevice(options.presentation)) {
+            Release();
+            return false;
+        }
+        vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+        VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolInfo.queueFamilyIndex = queueFamily;
+        if (!CHECK_VK(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool))) {
+            commandPool = VK_NULL_HANDLE;
+            Release();
+            return false;
+        }
+        return true;
+    }
+
+    bool VulkanContext::PickPhysicalDevice() {
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(instance, &count, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(count);
+        vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+
+        for (auto candidate: physicalDevices) {
+            VkPhysicalDeviceProperties properties;
+            vkGetPhysicalDeviceProperties(candidate, &properties);
+            if (properties.apiVersion < VK_API_VERSION_1_1) continue;
+
+            uint32_t familyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> families(familyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+            for (uint32_t family = 0; family < familyCount; ++family) {
+                // Every graphics queue of Android devices can present.
+                if (!(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)) continue;
+                physicalDevice = candidate;
+                queueFamily = family;
+                vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+                return true;
+            }
+        }
+        LogVulkanError("Vulkan Error: no Vulkan 1.1 device with a graphics queue.");
+        return false;
+    }
+
+    bool VulkanContext::CreateDevice(bool presentation) {
+        std::vector<const char *> extensions;
+        if (presentation) extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+        VkPhysicalDeviceSamplerYcbcrConversionFeatures ycbcrFeatures{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES};
+        VkPhysicalDeviceFeatures2 features{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        features.pNext = &ycbcrFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+#ifdef __ANDROID__
+        // Camera frames are YUV buffers of an implementation defined format, only sampled
+        // through a Ycbcr conversion of their external format.
+        constexpr const char *hardwareBufferExtension =
+                VK_ANDROID_EXTERNAL_MEMORY_ANDROID_HARDWARE_BUFFER_EXTENSION_NAME;
+        hardwareBufferImport =
+                ycbcrFeatures.samplerYcbcrConversion &&
+                HasDeviceExtension(physicalDevice, hardwareBufferExtension) &&
+                HasDeviceExtension(physicalDevice, VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME);
+        if (hardwareBufferImport) {
+            extensions.push_back(hardwareBufferExtension);
+            extensions.push_back(VK_EXT_QUEUE_FAMILY_FOREIGN_EXTENSION_NAME);
+        }
+#endif
+        for (const char *extension: extensions) {
+            if (!HasDeviceExtension(physicalDevice, extension)) {
+                LogVulkanError("Vulkan Error: device extension %s is missing.", extension);
+                return false;
+            }
+        }
+
+        // Only what the renderer uses.
+        VkPhysicalDeviceSamplerYcbcrConversionFeatures enabledYcbcrFeatures{
+                VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES};
+        enabledYcbcrFeatures.samplerYcbcrConversion = ycbcrFeatures.samplerYcbcrConversion;
+        VkPhysicalDeviceFeatures2 enabledFeatures{VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+        enabledFeatures.pNext = &enabledYcbcrFeatures;
+
+        const float priority = 1.f;
+        VkDeviceQueueCreateInfo queueInfo{VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+        queueInfo.queueFamilyIndex = queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+
+        VkDeviceCreateInfo deviceInfo{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+        deviceInfo.pNext = &enabledFeatures;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        deviceInfo.ppEnabledExtensionNames = extensions.data();
+        if (!CHECK_VK(vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device))) {
+            device = VK_NULL_HANDLE;
+            return false;
+        }
+        return true;
+    }
+
+    void VulkanContext::Release() {
+        if (device != VK_NULL_HANDLE) {
+            vkDeviceWaitIdle(device);
+            if (commandPool != VK_NULL_HANDLE) vkDestroyCommandPool(device, commandPool, nullptr);
+            vkDestroyDevice(device, nullptr);
+        }
+        if (instance != VK_NULL_HANDLE) vkDestroyInstance(instance, nullptr);
+        commandPool = VK_NULL_HANDLE;
+        device = VK_NULL_HANDLE;
+        queue = VK_NULL_HANDLE;
+        physicalDevice = VK_NULL_HANDLE;
+        instance = VK_NULL_HANDLE;
+        hardwareBufferImport = false;
+    }
+
+    uint32_t VulkanContext::FindMemoryType(uint32_t typeBits,
+                                           VkMemoryPropertyFlags properties) const {
+        for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type) {
+            if ((typeBits & (1u << type)) &&
+                (memoryProperties.memoryTypes[type].propertyFlags & properties) == properties) {
+                return type;
+            }
+        }
+        return UINT32_MAX;
+    }
+
+    bool VulkanContext::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+                                     bool hostVisible, VulkanBuffer &buffer) {
+        VkBufferCreateInfo bufferInfo{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (!CHECK_VK(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer))) {
+            buffer.buffer = VK_NULL_HANDLE;
+            return false;
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, buffer.buffer, &requirements);
+        const VkMemoryPropertyFlags properties =
+                hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                            : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+        VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+        if (allocateInfo.memoryTypeIndex == UINT32_MAX ||
+            !CHECK_VK(vkAllocateMemory(device, &allocateInfo, nullptr, &buffer.memory)) ||
+            !CHECK_VK(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0)) ||
+            (hostVisible &&
+             !CHECK_VK(vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped)))) {
+            DestroyBuffer(buffer);
+            return false;
+        }
+        buffer.size = size;
+        return true;
+    }
+
+    void VulkanContext::DestroyBuffer(VulkanBuffer &buffer) {
+        if (buffer.buffer != VK_NULL_HANDLE) vkDestroyBuffer(device, buffer.buffer, nullptr);
+        // Unmapped along with the memory.
+        if (buffer.memory != VK_NULL_HANDLE) vkFreeMemory(device, buffer.memory, nullptr);
+        buffer = {};
+    }
+
+    bool VulkanContext::CreateImage(uint32_t width, uint32_t height, VkFormat format,
+                                    VkImageUsageFlags usage, VulkanImage &image) {
+        VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = {width, height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (!CHECK_VK(vkCreateImage(device, &imageInfo, nullptr, &image.image))) {
+            image.image = VK_NULL_HANDLE;
+            return false;
+        }
+
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, image.image, &requirements);
+        // Transient attachments only live in tile memory where there is lazily allocated
+        // memory.
+        const bool transient = usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex =
+                transient ? FindMemoryType(requirements.memoryTypeBits,
+                                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                           VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+                          : UINT32_MAX;
+        if (allocateInfo.memoryTypeIndex == UINT32_MAX) {
+            allocateInfo.memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits,
+                                                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewInfo.image = image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (allocateInfo.memoryTypeIndex == UINT32_MAX ||
+            !CHECK_VK(vkAllocateMemory(device, &allocateInfo, nullptr, &image.memory)) ||
+            !CHECK_VK(vkBindImageMemory(device, image.image, image.memory, 0)) ||
+            !CHECK_VK(vkCreateImageView(device, &viewInfo, nullptr, &image.view))) {
+            image.view = VK_NULL_HANDLE;
+            DestroyImage(image);
+            return false;
+        }
+        image.format = format;
+        image.width = width;
+        image.height = height;
+        return true;
+    }
+
+    void VulkanContext::DestroyImage(VulkanImage &image) {
+        if (image.view != VK_NULL_HANDLE) vkDestroyImageView(device, image.view, nullptr);
+        if (image.image != VK_NULL_HANDLE) vkDestroyImage(device, image.image, nullptr);
+        if (image.memory != VK_NULL_HANDLE) vkFreeMemory(device, image.memory, nullptr);
+        image = {};
+    }
+
+    VkCommandBuffer VulkanContext::BeginOnce() {
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool = commandPool;
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        if (!CHECK_VK(vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer))) {
+            return VK_NULL_HANDLE;
+        }
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (!CHECK_VK(vkBeginCommandBuffer(commandBuffer, &beginInfo))) {
+            vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+            return VK_NULL_HANDLE;
+        }
+        return commandBuffer;
+    }
+
+    bool VulkanContext::EndOnce(VkCommandBuffer commandBuffer) {
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        const bool submitted =
+                CHECK_VK(vkEndCommandBuffer(commandBuffer)) &&
+                CHECK_VK(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE)) &&
+                CHECK_VK(vkQueueWaitIdle(queue));
+        vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+        return submitted;
+    }
+}  // namespace lookaround
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace lookaround {
+    struct VulkanBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        // Host visible buffers stay mapped for their lifetime.
+        void *mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+    struct VulkanImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // The instance, device and the single graphics queue of the Vulkan renderer, along with
+    // the allocation helpers of its buffers and images. Each resource gets its own memory
+    // allocation, the renderer only creates a few dozen of them when the surface changes.
+    //
+    // Vulkan 1.1, for sampler Ycbcr conversions and external memory in core. Camera frames are
+    // imported from AHardwareBuffers on Android; the host tools upload them, so the renderer
+    // runs headless on a CPU implementation such as lavapipe.
+    class VulkanContext {
+    public:
+        struct Options {
+            // Of the platform surface, e.g. VK_KHR_android_surface. None for headless use.
+            std::vector<const char *> instanceExtensions;
+            // Enables VK_KHR_swapchain on the device.
+            bool presentation = false;
+            // Enables the Khronos validation layer when it is installed.
+            bool validation = false;
+        };
+
+        VulkanContext() = default;
+
+        ~VulkanContext() { Release(); }
+
+        VulkanContext(const VulkanContext &) = delete;
+
+        VulkanContext &operator=(const VulkanContext &) = delete;
+
+        // Returns false if there is no Vulkan 1.1 device with a graphics queue.
+        bool Init(const Options &options);
+
+        // Waits for the device to be idle first.
+        void Release();
+
+        [[nodiscard]] bool IsInitialized() const { return device != VK_NULL_HANDLE; }
+
+        [[nodiscard]] VkInstance Instance() const { return instance; }
+
+        [[nodiscard]] VkPhysicalDevice PhysicalDevice() const { return physicalDevice; }
+
+        [[nodiscard]] VkDevice Device() const { return device; }
+
+        [[nodiscard]] VkQueue Queue() const { return queue; }
+
+        [[nodiscard]] uint32_t QueueFamily() const { return queueFamily; }
+
+        [[nodiscard]] VkCommandPool CommandPool() const { return commandPool; }
+
+        // Whether camera frames can be imported from AHardwareBuffers, YUV ones included.
+        [[nodiscard]] bool HasHardwareBufferImport() const { return hardwareBufferImport; }
+
+        // Returns UINT32_MAX if no memory type of typeBits has properties.
+        [[nodiscard]] uint32_t FindMemoryType(uint32_t typeBits,
+                                              VkMemoryPropertyFlags properties) const;
+
+        // Host visible buffers are coherent and mapped, the others device local.
+        bool CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible,
+                          VulkanBuffer &buffer);
+
+        void DestroyBuffer(VulkanBuffer &buffer);
+
+        // A device local 2D image with optimal tiling and a view of its color aspect.
+        bool CreateImage(uint32_t width, uint32_t height, VkFormat format,
+                         VkImageUsageFlags usage, VulkanImage &image);
+
+        void DestroyImage(VulkanImage &image);
+
+        // Records commands into a transient command buffer, submits it and waits until the
+        // queue is done with it. For uploads and layout changes outside of the frames.
+        template<typename Record>
+        bool SubmitOnce(Record &&record) {
+            VkCommandBuffer commandBuffer = BeginOnce();
+            if (commandBuffer == VK_NULL_HANDLE) return false;
+            record(commandBuffer);
+            return EndOnce(commandBuffer);
+        }
+
+    private:
+        VkCommandBuffer BeginOnce();
+
+        bool EndOnce(VkCommandBuffer commandBuffer);
+
+        bool PickPhysicalDevice();
+
+        bool CreateDevice(bool presentation);
+
+        VkInstance instance = VK_NULL_HANDLE;
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        VkDevice device = VK_NULL_HANDLE;
+        uint32_t queueFamily = 0;
+        VkQueue queue = VK_NULL_HANDLE;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        bool hardwareBufferImport = false;
+    };
+}  // namespace lookaround
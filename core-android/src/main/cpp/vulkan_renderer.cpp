@@ -0,0 +1,1502 @@
+#include "vulkan_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "vk_check.h"
+
+namespace lookaround {
+    namespace {
+        // Of the blur targets and of the offscreen output, like the GL renderer's textures.
+        constexpr VkFormat TARGET_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+        constexpr VkFormat MASK_FORMAT = VK_FORMAT_R8_UNORM;
+
+        // PassConstants::flags.
+        constexpr uint32_t PASS_VERTICAL = 1u << 0;
+        constexpr uint32_t PASS_BLURRED_BACKGROUND = 1u << 1;
+        constexpr VkShaderStageFlags PASS_CONSTANT_STAGES =
+                VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        constexpr uint32_t PASS_CONSTANTS_SIZE = 16;
+
+        VkShaderModule CreateShaderModule(VkDevice device, const std::vector<uint32_t> &code) {
+            VkShaderModuleCreateInfo moduleInfo{VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+            moduleInfo.codeSize = code.size() * sizeof(uint32_t);
+            moduleInfo.pCode = code.data();
+            VkShaderModule module = VK_NULL_HANDLE;
+            if (!CHECK_VK(vkCreateShaderModule(device, &moduleInfo, nullptr, &module))) {
+                return VK_NULL_HANDLE;
+            }
+            return module;
+        }
+
+        VkPipelineLayout CreatePipelineLayout(VkDevice device,
+                                              const std::vector<VkDescriptorSetLayout> &sets) {
+            // Every pipeline takes the same constants, so they stay bound across pipelines.
+            VkPushConstantRange constants{PASS_CONSTANT_STAGES, 0, PASS_CONSTANTS_SIZE};
+            VkPipelineLayoutCreateInfo layoutInfo{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+            layoutInfo.setLayoutCount = static_cast<uint32_t>(sets.size());
+            layoutInfo.pSetLayouts = sets.data();
+            layoutInfo.pushConstantRangeCount = 1;
+            layoutInfo.pPushConstantRanges = &constants;
+            VkPipelineLayout layout = VK_NULL_HANDLE;
+            if (!CHECK_VK(vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout))) {
+                return VK_NULL_HANDLE;
+            }
+            return layout;
+        }
+
+        VkDescriptorSetLayout CreateSetLayout(
+                VkDevice device, const std::vector<VkDescriptorSetLayoutBinding> &bindings) {
+            VkDescriptorSetLayoutCreateInfo layoutInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+            layoutInfo.pBindings = bindings.data();
+            VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+            if (!CHECK_VK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &layout))) {
+                return VK_NULL_HANDLE;
+            }
+            return layout;
+        }
+
+        VkDescriptorSet AllocateSet(VkDevice device, VkDescriptorPool pool,
+                                    VkDescriptorSetLayout layout) {
+            VkDescriptorSetAllocateInfo allocateInfo{
+                    VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+            allocateInfo.descriptorPool = pool;
+            allocateInfo.descriptorSetCount = 1;
+            allocateInfo.pSetLayouts = &layout;
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            if (!CHECK_VK(vkAllocateDescriptorSets(device, &allocateInfo, &set))) {
+                return VK_NULL_HANDLE;
+            }
+            return set;
+        }
+
+        void WriteImage(VkDevice device, VkDescriptorSet set, uint32_t binding,
+                        VkDescriptorType type, VkSampler sampler, VkImageView view) {
+            VkDescriptorImageInfo imageInfo{sampler, view,
+                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+            VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+            write.dstSet = set;
+            write.dstBinding = binding;
+            write.descriptorCount = 1;
+            write.descriptorType = type;
+            write.pImageInfo = &imageInfo;
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+
+        void WriteBuffer(VkDevice device, VkDescriptorSet set, uint32_t binding,
+                         VkDescriptorType type, const VulkanBuffer &buffer) {
+            VkDescriptorBufferInfo bufferInfo{buffer.buffer, 0, buffer.size};
+            VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+            write.dstSet = set;
+            write.dstBinding = binding;
+            write.descriptorCount = 1;
+            write.descriptorType = type;
+            write.pBufferInfo = &bufferInfo;
+            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        }
+
+        void SetViewport(VkCommandBuffer commandBuffer, uint32_t width, uint32_t height) {
+            VkViewport viewport{0.f, 0.f, static_cast<float>(width), static_cast<float>(height),
+                                0.f, 1.f};
+            VkRect2D scissor{{0, 0}, {width, height}};
+            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        }
+
+#ifdef __ANDROID__
+        bool IsYcbcrFormat(VkFormat format) {
+            return format >= VK_FORMAT_G8B8G8R8_422_UNORM &&
+                   format <= VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM;
+        }
+#endif
+    }  // namespace
+
+    bool VulkanRenderer::Init(const VulkanContext::Options &options,
+                              const ShaderLoader &loadShader) {
+        if (!context.Init(options)) return false;
+#ifdef __ANDROID__
+        if (context.HasHardwareBufferImport()) {
+            getHardwareBufferProperties =
+                    reinterpret_cast<PFN_vkGetAndroidHardwareBufferPropertiesANDROID>(
+                            vkGetDeviceProcAddr(context.Device(),
+                                                "vkGetAndroidHardwareBufferPropertiesANDROID"));
+        }
+#endif
+        // Until the first camera frame tells otherwise.
+        if (!CreateShaderModules(loadShader) || !CreateStaticResources() ||
+            !CreateCameraLayout(VK_FORMAT_R8G8B8A8_UNORM, 0, nullptr)) {
+            Release();
+            return false;
+        }
+        return true;
+    }
+
+    bool VulkanRenderer::CreateShaderModules(const ShaderLoader &loadShader) {
+        const std::pair<const char *, VkShaderModule *> modules[] = {
+                {"fullscreen.vert.spv", &fullscreenVertex},
+                {"blur.frag.spv", &blurFragment},
+                {"blur_camera.frag.spv", &blurCameraFragment},
+                {"mask.vert.spv", &maskVertex},
+                {"mask.frag.spv", &maskFragment},
+                {"composite.frag.spv", &compositeFragment},
+        };
+        for (const auto &[name, module]: modules) {
+            const std::vector<uint32_t> code = loadShader(name);
+            if (code.empty()) {
+                LogVulkanError("Vulkan Error: shader %s is missing.", name);
+                return false;
+            }
+            *module = CreateShaderModule(context.Device(), code);
+            if (*module == VK_NULL_HANDLE) return false;
+        }
+        return true;
+    }
+
+    bool VulkanRenderer::CreateStaticResources() {
+        static_assert(sizeof(PassConstants) == PASS_CONSTANTS_SIZE);
+        VkDevice device = context.Device();
+
+        VkSamplerCreateInfo samplerInfo{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        if (!CHECK_VK(vkCreateSampler(device, &samplerInfo, nullptr, &linearSampler))) {
+            linearSampler = VK_NULL_HANDLE;
+            return false;
+        }
+
+        constexpr VkShaderStageFlags fragment = VK_SHADER_STAGE_FRAGMENT_BIT;
+        frameSetLayout = CreateSetLayout(
+                device, {{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+                          VK_SHADER_STAGE_VERTEX_BIT | fragment, nullptr},
+                         {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT,
+                          nullptr}});
+        textureSetLayout = CreateSetLayout(
+                device, {{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, fragment, nullptr}});
+        compositeSetLayout = CreateSetLayout(
+                device, {{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, fragment, nullptr},
+                         {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, fragment, nullptr},
+                         {2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1, fragment, nullptr}});
+        if (frameSetLayout == VK_NULL_HANDLE || textureSetLayout == VK_NULL_HANDLE ||
+            compositeSetLayout == VK_NULL_HANDLE) {
+            return false;
+        }
+        blurPipelineLayout = CreatePipelineLayout(device, {frameSetLayout, textureSetLayout});
+        if (blurPipelineLayout == VK_NULL_HANDLE) return false;
+
+        // The previous pass wrote the input, a pass of the previous frame may still read the
+        // target.
+        VkAttachmentDescription target{};
+        target.format = TARGET_FORMAT;
+        target.samples = VK_SAMPLE_COUNT_1_BIT;
+        target.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        target.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        target.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        target.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        target.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        target.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        VkAttachmentReference targetReference{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &targetReference;
+        const VkSubpassDependency dependencies[] = {
+                {VK_SUBPASS_EXTERNAL, 0,
+                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT, 0},
+                {0, VK_SUBPASS_EXTERNAL,
+                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 0},
+        };
+        VkRenderPassCreateInfo renderPassInfo{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+        renderPassInfo.attachmentCount = 1;
+        renderPassInfo.pAttachments = &target;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 2;
+        renderPassInfo.pDependencies = dependencies;
+        if (!CHECK_VK(vkCreateRenderPass(device, &renderPassInfo, nullptr, &blurRenderPass))) {
+            blurRenderPass = VK_NULL_HANDLE;
+            return false;
+        }
+
+        blurPipeline = CreatePipeline(fullscreenVertex, blurFragment, blurPipelineLayout,
+                                      blurRenderPass, 0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+                                      false);
+        if (blurPipeline == VK_NULL_HANDLE) return false;
+
+        VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        VkFenceCreateInfo fenceInfo{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+            if (!CHECK_VK(vkCreateSemaphore(device, &semaphoreInfo, nullptr,
+                                            &imageAcquired[frame])) ||
+                !CHECK_VK(vkCreateFence(device, &fenceInfo, nullptr, &frameFences[frame]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    VkPipeline VulkanRenderer::CreatePipeline(VkShaderModule vertex, VkShaderModule fragment,
+                                              VkPipelineLayout layout, VkRenderPass renderPass,
+                                              uint32_t subpass, VkPrimitiveTopology topology,
+                                              bool flipY) {
+        const VkBool32 flipYConstant = flipY ? VK_TRUE : VK_FALSE;
+        VkSpecializationMapEntry flipYEntry{0, 0, sizeof(VkBool32)};
+        VkSpecializationInfo specialization{1, &flipYEntry, sizeof(VkBool32), &flipYConstant};
+        VkPipelineShaderStageCreateInfo stages[2]{};
+        stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[0].module = vertex;
+        stages[0].pName = "main";
+        stages[0].pSpecializationInfo = &specialization;
+        stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[1].module = fragment;
+        stages[1].pName = "main";
+
+        // Vertices come from their index.
+        VkPipelineVertexInputStateCreateInfo vertexInput{
+                VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{
+                VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+        inputAssembly.topology = topology;
+        VkPipelineViewportStateCreateInfo viewport{
+                VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+        viewport.viewportCount = 1;
+        viewport.scissorCount = 1;
+        VkPipelineRasterizationStateCreateInfo rasterization{
+                VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+        rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterization.cullMode = VK_CULL_MODE_NONE;
+        rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterization.lineWidth = 1.f;
+        VkPipelineMultisampleStateCreateInfo multisample{
+                VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+        multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkPipelineColorBlendAttachmentState blendAttachment{};
+        blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                         VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        VkPipelineColorBlendStateCreateInfo blend{
+                VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+        blend.attachmentCount = 1;
+        blend.pAttachments = &blendAttachment;
+        // Targets of the same pipeline differ in size.
+        const VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+                                                VK_DYNAMIC_STATE_SCISSOR};
+        VkPipelineDynamicStateCreateInfo dynamic{
+                VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+        dynamic.dynamicStateCount = 2;
+        dynamic.pDynamicStates = dynamicStates;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{
+                VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = stages;
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewport;
+        pipelineInfo.pRasterizationState = &rasterization;
+        pipelineInfo.pMultisampleState = &multisample;
+        pipelineInfo.pColorBlendState = &blend;
+        pipelineInfo.pDynamicState = &dynamic;
+        pipelineInfo.layout = layout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = subpass;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (!CHECK_VK(vkCreateGraphicsPipelines(context.Device(), VK_NULL_HANDLE, 1,
+                                                &pipelineInfo, nullptr, &pipeline))) {
+            return VK_NULL_HANDLE;
+        }
+        return pipeline;
+    }
+
+    bool VulkanRenderer::CreateCameraLayout(
+            VkFormat format, uint64_t externalFormat,
+            const VkSamplerYcbcrConversionCreateInfo *conversionInfo) {
+        // Sets of the camera slots are recorded into the command buffers.
+        InvalidateCommandBuffers(NO_CAMERA_SLOT);
+        for (uint32_t slot = 0; slot < CAMERA_SLOT_COUNT; ++slot) ReleaseCameraSlot(slot);
+        DestroyCameraLayout();
+        VkDevice device = context.Device();
+
+        VkSamplerCreateInfo samplerInfo{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        VkSamplerYcbcrConversionInfo samplerConversion{
+                VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO};
+        if (conversionInfo) {
+            if (!CHECK_VK(vkCreateSamplerYcbcrConversion(device, conversionInfo, nullptr,
+                                                         &cameraConversion))) {
+                cameraConversion = VK_NULL_HANDLE;
+                return false;
+            }
+            samplerConversion.conversion = cameraConversion;
+            samplerInfo.pNext = &samplerConversion;
+            // Without a separate reconstruction filter both must be the chroma filter.
+            samplerInfo.magFilter = conversionInfo->chromaFilter;
+            samplerInfo.minFilter = conversionInfo->chromaFilter;
+        }
+        if (!CHECK_VK(vkCreateSampler(device, &samplerInfo, nullptr, &cameraSampler))) {
+            cameraSampler = VK_NULL_HANDLE;
+            return false;
+        }
+
+        // Samplers with a Ycbcr conversion are immutable.
+        cameraSetLayout = CreateSetLayout(
+                device, {{0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1,
+                          VK_SHADER_STAGE_FRAGMENT_BIT, &cameraSampler}});
+        if (cameraSetLayout == VK_NULL_HANDLE) return false;
+
+        // Multi-planar formats take up to a descriptor per plane.
+        VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                      CAMERA_SLOT_COUNT * 3};
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.maxSets = CAMERA_SLOT_COUNT;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        if (!CHECK_VK(vkCreateDescriptorPool(device, &poolInfo, nullptr,
+                                             &cameraDescriptorPool))) {
+            cameraDescriptorPool = VK_NULL_HANDLE;
+            return false;
+        }
+        for (auto &slot: cameraSlots) {
+            slot.set = AllocateSet(device, cameraDescriptorPool, cameraSetLayout);
+            if (slot.set == VK_NULL_HANDLE) return false;
+        }
+
+        cameraBlurPipelineLayout = CreatePipelineLayout(device, {frameSetLayout, cameraSetLayout});
+        compositePipelineLayout =
+                CreatePipelineLayout(device, {frameSetLayout, compositeSetLayout, cameraSetLayout});
+        if (cameraBlurPipelineLayout == VK_NULL_HANDLE ||
+            compositePipelineLayout == VK_NULL_HANDLE) {
+            return false;
+        }
+        cameraFormat = format;
+        cameraExternalFormat = externalFormat;
+        return CreateCameraPipelines();
+    }
+
+    bool VulkanRenderer::CreateCameraPipelines() {
+        VkDevice device = context.Device();
+        vkDestroyPipeline(device, cameraBlurPipeline, nullptr);
+        vkDestroyPipeline(device, compositePipeline, nullptr);
+        cameraBlurPipeline = CreatePipeline(fullscreenVertex, blurCameraFragment,
+                                            cameraBlurPipelineLayout, blurRenderPass, 0,
+                                            VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false);
+        // Built along with the target otherwise.
+        compositePipeline = compositeRenderPass == VK_NULL_HANDLE
+                            ? VK_NULL_HANDLE
+                            : CreatePipeline(fullscreenVertex, compositeFragment,
+                                             compositePipelineLayout, compositeRenderPass, 1,
+                                             VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true);
+        return cameraBlurPipeline != VK_NULL_HANDLE &&
+               (compositeRenderPass == VK_NULL_HANDLE || compositePipeline != VK_NULL_HANDLE);
+    }
+
+    void VulkanRenderer::DestroyCameraLayout() {
+        VkDevice device = context.Device();
+        vkDestroyPipeline(device, cameraBlurPipeline, nullptr);
+        vkDestroyPipeline(device, compositePipeline, nullptr);
+        vkDestroyPipelineLayout(device, cameraBlurPipelineLayout, nullptr);
+        vkDestroyPipelineLayout(device, compositePipelineLayout, nullptr);
+        // Frees the sets of the slots.
+        vkDestroyDescriptorPool(device, cameraDescriptorPool, nullptr);
+        vkDestroyDescriptorSetLayout(device, cameraSetLayout, nullptr);
+        vkDestroySampler(device, cameraSampler, nullptr);
+        vkDestroySamplerYcbcrConversion(device, cameraConversion, nullptr);
+        cameraBlurPipeline = VK_NULL_HANDLE;
+        compositePipeline = VK_NULL_HANDLE;
+        cameraBlurPipelineLayout = VK_NULL_HANDLE;
+        compositePipelineLayout = VK_NULL_HANDLE;
+        cameraDescriptorPool = VK_NULL_HANDLE;
+        cameraSetLayout = VK_NULL_HANDLE;
+        cameraSampler = VK_NULL_HANDLE;
+        cameraConversion = VK_NULL_HANDLE;
+        for (auto &slot: cameraSlots) slot.set = VK_NULL_HANDLE;
+        cameraFormat = VK_FORMAT_UNDEFINED;
+        cameraExternalFormat = 0;
+    }
+
+    void VulkanRenderer::ReleaseCameraSlot(uint32_t slot) {
+        auto &cameraSlot = cameraSlots[slot];
+        context.DestroyImage(cameraSlot.image);
+#ifdef __ANDROID__
+        if (cameraSlot.hardwareBuffer) {
+            AHardwareBuffer_release(static_cast<AHardwareBuffer *>(cameraSlot.hardwareBuffer));
+        }
+#endif
+        cameraSlot.hardwareBuffer = nullptr;
+        cameraSlot.lastUsedFrame = 0;
+        if (currentCameraSlot == slot) currentCameraSlot = NO_CAMERA_SLOT;
+    }
+
+    bool VulkanRenderer::WriteCameraSet(uint32_t slot) {
+        const auto &cameraSlot = cameraSlots[slot];
+        if (cameraSlot.set == VK_NULL_HANDLE) return false;
+        WriteImage(context.Device(), cameraSlot.set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                   cameraSampler, cameraSlot.image.view);
+        return true;
+    }
+
+    bool VulkanRenderer::SetCameraPixels(const uint8_t *pixels, uint32_t width, uint32_t height) {
+        if (!IsInitialized() || width == 0 || height == 0) return false;
+        if (cameraFormat != VK_FORMAT_R8G8B8A8_UNORM || cameraExternalFormat != 0) {
+            if (!CreateCameraLayout(VK_FORMAT_R8G8B8A8_UNORM, 0, nullptr)) return false;
+        }
+
+        // Uploads always go to the first slot.
+        constexpr uint32_t slot = 0;
+        auto &cameraSlot = cameraSlots[slot];
+        if (cameraSlot.hardwareBuffer || cameraSlot.image.width != width ||
+            cameraSlot.image.height != height) {
+            InvalidateCommandBuffers(slot);
+            ReleaseCameraSlot(slot);
+            if (!context.CreateImage(width, height, VK_FORMAT_R8G8B8A8_UNORM,
+                                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                     cameraSlot.image) ||
+                !WriteCameraSet(slot)) {
+                return false;
+            }
+        }
+
+        const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+        if (cameraStaging.size < size) {
+            context.DestroyBuffer(cameraStaging);
+            if (!context.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, true,
+                                      cameraStaging)) {
+                return false;
+            }
+        }
+        memcpy(cameraStaging.mapped, pixels, size);
+
+        const VkImage image = cameraSlot.image.image;
+        const bool uploaded = context.SubmitOnce([&](VkCommandBuffer commandBuffer) {
+            // After the frames still sampling the previous camera frame.
+            VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+                                 1, &barrier);
+
+            VkBufferImageCopy region{};
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent = {width, height, 1};
+            vkCmdCopyBufferToImage(commandBuffer, cameraStaging.buffer, image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                                 nullptr, 1, &barrier);
+        });
+        if (!uploaded) return false;
+        currentCameraSlot = slot;
+        outputDirty = true;
+        return true;
+    }
+
+#ifdef __ANDROID__
+    bool VulkanRenderer::SetCameraHardwareBuffer(AHardwareBuffer *buffer) {
+        if (!getHardwareBufferProperties || !buffer) return false;
+        for (uint32_t slot = 0; slot < CAMERA_SLOT_COUNT; ++slot) {
+            if (cameraSlots[slot].hardwareBuffer == buffer) {
+                currentCameraSlot = slot;
+                outputDirty = true;
+                return true;
+            }
+        }
+
+        VkDevice device = context.Device();
+        VkAndroidHardwareBufferFormatPropertiesANDROID formatProperties{
+                VK_STRUCTURE_TYPE_ANDROID_HARDWARE_BUFFER_FORMAT_PROPERTIES_ANDROID};
+        VkAndroidHardwareBufferPropertiesANDROID properties{
+                VK_STRUCTURE_TYPE_ANDROID_HARDWARE_BUFFER_PROPERTIES_ANDROID};
+        properties.pNext = &formatProperties;
+        if (!CHECK_VK(getHardwareBufferProperties(device, buffer, &properties))) return false;
+
+        // Camera buffers are usually of a YUV format only known to the driver.
+        const bool externalFormat = formatProperties.format == VK_FORMAT_UNDEFINED;
+        VkExternalFormatANDROID externalFormatInfo{VK_STRUCTURE_TYPE_EXTERNAL_FORMAT_ANDROID};
+        externalFormatInfo.externalFormat = externalFormat ? formatProperties.externalFormat : 0;
+        if (formatProperties.format != cameraFormat ||
+            externalFormatInfo.externalFormat != cameraExternalFormat) {
+            VkSamplerYcbcrConversionCreateInfo conversionInfo{
+                    VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO};
+            conversionInfo.pNext = &externalFormatInfo;
+            conversionInfo.format = formatProperties.format;
+            conversionInfo.ycbcrModel = formatProperties.suggestedYcbcrModel;
+            conversionInfo.ycbcrRange = formatProperties.suggestedYcbcrRange;
+            conversionInfo.components = formatProperties.samplerYcbcrConversionComponents;
+            conversionInfo.xChromaOffset = formatProperties.suggestedXChromaOffset;
+            conversionInfo.yChromaOffset = formatProperties.suggestedYChromaOffset;
+            conversionInfo.chromaFilter =
+                    formatProperties.formatFeatures &
+                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT
+                    ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+            const bool converted = externalFormat || IsYcbcrFormat(formatProperties.format);
+            if (!CreateCameraLayout(formatProperties.format, externalFormatInfo.externalFormat,
+                                    converted ? &conversionInfo : nullptr)) {
+                return false;
+            }
+        }
+
+        // A free slot, or the least recently drawn one.
+        uint32_t slot = 0;
+        for (uint32_t candidate = 0; candidate < CAMERA_SLOT_COUNT; ++candidate) {
+            if (cameraSlots[candidate].image.image == VK_NULL_HANDLE) {
+                slot = candidate;
+                break;
+            }
+            if (cameraSlots[candidate].lastUsedFrame < cameraSlots[slot].lastUsedFrame) {
+                slot = candidate;
+            }
+        }
+        if (cameraSlots[slot].image.image != VK_NULL_HANDLE) {
+            InvalidateCommandBuffers(slot);
+            ReleaseCameraSlot(slot);
+        }
+        auto &cameraSlot = cameraSlots[slot];
+
+        AHardwareBuffer_Desc desc{};
+        AHardwareBuffer_describe(buffer, &desc);
+        VkExternalMemoryImageCreateInfo externalImageInfo{
+                VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO};
+        externalImageInfo.pNext = &externalFormatInfo;
+        externalImageInfo.handleTypes =
+                VK_EXTERNAL_MEMORY_HANDLE_TYPE_ANDROID_HARDWARE_BUFFER_BIT_ANDROID;
+        VkImageCreateInfo imageInfo{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+        imageInfo.pNext = &externalImageInfo;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = formatProperties.format;
+        imageInfo.extent = {desc.width, desc.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (!CHECK_VK(vkCreateImage(device, &imageInfo, nullptr, &cameraSlot.image.image))) {
+            cameraSlot.image.image = VK_NULL_HANDLE;
+            return false;
+        }
+
+        VkImportAndroidHardwareBufferInfoANDROID importInfo{
+                VK_STRUCTURE_TYPE_IMPORT_ANDROID_HARDWARE_BUFFER_INFO_ANDROID};
+        importInfo.buffer = buffer;
+        VkMemoryDedicatedAllocateInfo dedicatedInfo{
+                VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO};
+        dedicatedInfo.pNext = &importInfo;
+        dedicatedInfo.image = cameraSlot.image.image;
+        VkMemoryAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+        allocateInfo.pNext = &dedicatedInfo;
+        allocateInfo.allocationSize = properties.allocationSize;
+        allocateInfo.memoryTypeIndex = context.FindMemoryType(properties.memoryTypeBits, 0);
+
+        VkSamplerYcbcrConversionInfo viewConversion{
+                VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO};
+        viewConversion.conversion = cameraConversion;
+        VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+        viewInfo.pNext = cameraConversion != VK_NULL_HANDLE ? &viewConversion : nullptr;
+        viewInfo.image = cameraSlot.image.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = formatProperties.format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (allocateInfo.memoryTypeIndex == UINT32_MAX ||
+            !CHECK_VK(vkAllocateMemory(device, &allocateInfo, nullptr,
+                                       &cameraSlot.image.memory)) ||
+            !CHECK_VK(vkBindImageMemory(device, cameraSlot.image.image, cameraSlot.image.memory,
+                                        0)) ||
+            !CHECK_VK(vkCreateImageView(device, &viewInfo, nullptr, &cameraSlot.image.view))) {
+            cameraSlot.image.view = VK_NULL_HANDLE;
+            ReleaseCameraSlot(slot);
+            return false;
+        }
+        cameraSlot.image.format = formatProperties.format;
+        cameraSlot.image.width = desc.width;
+        cameraSlot.image.height = desc.height;
+        AHardwareBuffer_acquire(buffer);
+        cameraSlot.hardwareBuffer = buffer;
+        cameraSlot.lastUsedFrame = frameNumber;
+        if (!WriteCameraSet(slot)) {
+            ReleaseCameraSlot(slot);
+            return false;
+        }
+        currentCameraSlot = slot;
+        outputDirty = true;
+        return true;
+    }
+#endif
+
+    bool VulkanRenderer::SetSurface(VkSurfaceKHR newSurface, uint32_t width, uint32_t height) {
+        if (!IsInitialized()) return false;
+        DestroyTarget();
+        vkDestroySurfaceKHR(context.Instance(), surface, nullptr);
+        surface = newSurface;
+        surfaceWidthHint = width;
+        surfaceHeightHint = height;
+        if (surface == VK_NULL_HANDLE) return true;
+        if (!CreateSwapchain()) {
+            DestroyTarget();
+            return false;
+        }
+        return true;
+    }
+
+    bool VulkanRenderer::CreateSwapchain() {
+        VkPhysicalDevice physicalDevice = context.PhysicalDevice();
+        VkDevice device = context.Device();
+        VkBool32 supported = VK_FALSE;
+        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, context.QueueFamily(), surface,
+                                             &supported);
+        VkSurfaceCapabilitiesKHR capabilities;
+        if (!supported ||
+            !CHECK_VK(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface,
+                                                                &capabilities))) {
+            return false;
+        }
+        VkExtent2D extent = capabilities.currentExtent;
+        if (extent.width == UINT32_MAX) {
+            extent.width = std::clamp(surfaceWidthHint, capabilities.minImageExtent.width,
+                                      capabilities.maxImageExtent.width);
+            extent.height = std::clamp(surfaceHeightHint, capabilities.minImageExtent.height,
+                                       capabilities.maxImageExtent.height);
+        }
+        if (extent.width == 0 || extent.height == 0) return false;
+
+        uint32_t formatCount = 0;
+        vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, nullptr);
+        std::vector<VkSurfaceFormatKHR> formats(formatCount);
+        vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount,
+                                             formats.data());
+        if (formats.empty()) return false;
+        // The GL renderer's window surfaces are RGBA8 without sRGB encoding.
+        VkSurfaceFormatKHR format = formats[0];
+        for (const auto &candidate: formats) {
+            if (candidate.format == VK_FORMAT_R8G8B8A8_UNORM ||
+                candidate.format == VK_FORMAT_B8G8R8A8_UNORM) {
+                format = candidate;
+                if (candidate.format == VK_FORMAT_R8G8B8A8_UNORM) break;
+            }
+        }
+
+        uint32_t imageCount = capabilities.minImageCount + 1;
+        if (capabilities.maxImageCount > 0) {
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+        }
+        VkCompositeAlphaFlagBitsKHR compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+        for (auto candidate: {VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+                              VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR,
+                              VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR,
+                              VK_COMPOSITE_ALPHA_POST_MULTIPLIED_BIT_KHR}) {
+            if (capabilities.supportedCompositeAlpha & candidate) {
+                compositeAlpha = candidate;
+                break;
+            }
+        }
+
+        VkSwapchainCreateInfoKHR swapchainInfo{VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
+        swapchainInfo.surface = surface;
+        swapchainInfo.minImageCount = imageCount;
+        swapchainInfo.imageFormat = format.format;
+        swapchainInfo.imageColorSpace = format.colorSpace;
+        swapchainInfo.imageExtent = extent;
+        swapchainInfo.imageArrayLayers = 1;
+        swapchainInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        // Frames are drawn in the orientation of the window like with EGL, the compositor
+        // rotates them.
+        swapchainInfo.preTransform =
+                capabilities.supportedTransforms & VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR
+                ? VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR : capabilities.currentTransform;
+        swapchainInfo.compositeAlpha = compositeAlpha;
+        swapchainInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+        swapchainInfo.clipped = VK_TRUE;
+        if (!CHECK_VK(vkCreateSwapchainKHR(device, &swapchainInfo, nullptr, &swapchain))) {
+            swapchain = VK_NULL_HANDLE;
+            return false;
+        }
+
+        vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
+        std::vector<VkImage> images(imageCount);
+        vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data());
+        outputs.resize(imageCount);
+        for (uint32_t index = 0; index < imageCount; ++index) {
+            auto &output = outputs[index];
+            output.image = images[index];
+            VkImageViewCreateInfo viewInfo{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+            viewInfo.image = output.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = format.format;
+            viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+            if (!CHECK_VK(vkCreateImageView(device, &viewInfo, nullptr, &output.view))) {
+                output.view = VK_NULL_HANDLE;
+                return false;
+            }
+        }
+        targetWidth = extent.width;
+        targetHeight = extent.height;
+        return CreateTargetResources(format.format, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    }
+
+    bool VulkanRenderer::SetOffscreenTarget(uint32_t width, uint32_t height) {
+        if (!IsInitialized() || width == 0 || height == 0) return false;
+        DestroyTarget();
+        vkDestroySurfaceKHR(context.Instance(), surface, nullptr);
+        surface = VK_NULL_HANDLE;
+
+        if (!context.CreateImage(width, height, TARGET_FORMAT,
+                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                 VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                 offscreenImage) ||
+            !context.CreateBuffer(static_cast<VkDeviceSize>(width) * height * 4,
+                                  VK_BUFFER_USAGE_TRANSFER_DST_BIT, true, readbackBuffer)) {
+            DestroyTarget();
+            return false;
+        }
+        outputs.resize(1);
+        outputs[0].image = offscreenImage.image;
+        outputs[0].view = offscreenImage.view;
+        targetWidth = width;
+        targetHeight = height;
+        if (!CreateTargetResources(TARGET_FORMAT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)) {
+            DestroyTarget();
+            return false;
+        }
+        return true;
+    }
+
+    bool VulkanRenderer::CreateTargetResources(VkFormat outputFormat,
+                                               VkImageLayout outputFinalLayout) {
+        VkDevice device = context.Device();
+
+        // The mask only lives during the render pass.
+        VkAttachmentDescription attachments[2]{};
+        attachments[0].format = MASK_FORMAT;
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        // The composite covers every pixel of the output.
+        attachments[1].format = outputFormat;
+        attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[1].finalLayout = outputFinalLayout;
+
+        VkAttachmentReference maskOutput{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkAttachmentReference maskInput{0, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        VkAttachmentReference output{1, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+        VkSubpassDescription subpasses[2]{};
+        subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[0].colorAttachmentCount = 1;
+        subpasses[0].pColorAttachments = &maskOutput;
+        subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpasses[1].inputAttachmentCount = 1;
+        subpasses[1].pInputAttachments = &maskInput;
+        subpasses[1].colorAttachmentCount = 1;
+        subpasses[1].pColorAttachments = &output;
+
+        constexpr VkPipelineStageFlags colorOutput = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        constexpr VkPipelineStageFlags fragmentShader = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        const VkSubpassDependency dependencies[] = {
+                // The mask of the previous frame.
+                {VK_SUBPASS_EXTERNAL, 0, colorOutput | fragmentShader, colorOutput,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0},
+                // The pyramids, and the acquired swapchain image waited for at color output.
+                {VK_SUBPASS_EXTERNAL, 1, colorOutput, colorOutput | fragmentShader,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT, 0},
+                {0, 1, colorOutput, fragmentShader,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT,
+                 VK_DEPENDENCY_BY_REGION_BIT},
+                // Read back offscreen.
+                {1, VK_SUBPASS_EXTERNAL, colorOutput, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0},
+        };
+        VkRenderPassCreateInfo renderPassInfo{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
+        renderPassInfo.attachmentCount = 2;
+        renderPassInfo.pAttachments = attachments;
+        renderPassInfo.subpassCount = 2;
+        renderPassInfo.pSubpasses = subpasses;
+        renderPassInfo.dependencyCount = 4;
+        renderPassInfo.pDependencies = dependencies;
+        if (!CHECK_VK(vkCreateRenderPass(device, &renderPassInfo, nullptr,
+                                         &compositeRenderPass))) {
+            compositeRenderPass = VK_NULL_HANDLE;
+            return false;
+        }
+
+        if (!context.CreateImage(targetWidth, targetHeight, MASK_FORMAT,
+                                 VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                 VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT |
+                                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                                 maskImage)) {
+            return false;
+        }
+        for (auto &output: outputs) {
+            const VkImageView views[] = {maskImage.view, output.view};
+            VkFramebufferCreateInfo framebufferInfo{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+            framebufferInfo.renderPass = compositeRenderPass;
+            framebufferInfo.attachmentCount = 2;
+            framebufferInfo.pAttachments = views;
+            framebufferInfo.width = targetWidth;
+            framebufferInfo.height = targetHeight;
+            framebufferInfo.layers = 1;
+            if (!CHECK_VK(vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                                              &output.framebuffer))) {
+                output.framebuffer = VK_NULL_HANDLE;
+                return false;
+            }
+        }
+
+        for (uint32_t pyramid = 0; pyramid < PYRAMID_COUNT; ++pyramid) {
+            for (uint32_t pass = 0; pass < PYRAMID_PASS_COUNT; ++pass) {
+                auto &image = pyramidImages[pyramid][pass];
+                const uint32_t divisor = PYRAMID_PASS_DIVISORS[pass];
+                if (!context.CreateImage(std::max(targetWidth / divisor, 1u),
+                                         std::max(targetHeight / divisor, 1u), TARGET_FORMAT,
+                                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                         VK_IMAGE_USAGE_SAMPLED_BIT,
+                                         image)) {
+                    return false;
+                }
+                VkFramebufferCreateInfo framebufferInfo{
+                        VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
+                framebufferInfo.renderPass = blurRenderPass;
+                framebufferInfo.attachmentCount = 1;
+                framebufferInfo.pAttachments = &image.view;
+                framebufferInfo.width = image.width;
+                framebufferInfo.height = image.height;
+                framebufferInfo.layers = 1;
+                if (!CHECK_VK(vkCreateFramebuffer(device, &framebufferInfo, nullptr,
+                                                  &pyramidFramebuffers[pyramid][pass]))) {
+                    pyramidFramebuffers[pyramid][pass] = VK_NULL_HANDLE;
+                    return false;
+                }
+            }
+        }
+
+        const auto outputCount = static_cast<uint32_t>(outputs.size());
+        const VkDescriptorPoolSize poolSizes[] = {
+                {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, outputCount},
+                {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, outputCount},
+                {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                 PYRAMID_COUNT * PYRAMID_PASS_COUNT + PYRAMID_COUNT},
+                {VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1},
+        };
+        VkDescriptorPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolInfo.maxSets = outputCount + PYRAMID_COUNT * PYRAMID_PASS_COUNT + 1;
+        poolInfo.poolSizeCount = 4;
+        poolInfo.pPoolSizes = poolSizes;
+        if (!CHECK_VK(vkCreateDescriptorPool(device, &poolInfo, nullptr,
+                                             &targetDescriptorPool))) {
+            targetDescriptorPool = VK_NULL_HANDLE;
+            return false;
+        }
+        for (uint32_t pyramid = 0; pyramid < PYRAMID_COUNT; ++pyramid) {
+            for (uint32_t pass = 1; pass < PYRAMID_PASS_COUNT; ++pass) {
+                auto &set = pyramidInputSets[pyramid][pass];
+                set = AllocateSet(device, targetDescriptorPool, textureSetLayout);
+                if (set == VK_NULL_HANDLE) return false;
+                WriteImage(device, set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                           linearSampler, pyramidImages[pyramid][pass - 1].view);
+            }
+        }
+        compositeSet = AllocateSet(device, targetDescriptorPool, compositeSetLayout);
+        if (compositeSet == VK_NULL_HANDLE) return false;
+        constexpr uint32_t fullV = PYRAMID_PASS_COUNT - 1;
+        WriteImage(device, compositeSet, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                   linearSampler, pyramidImages[PYRAMID_BACKGROUND][fullV].view);
+        WriteImage(device, compositeSet, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                   linearSampler, pyramidImages[PYRAMID_RECTS][fullV].view);
+        WriteImage(device, compositeSet, 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT,
+                   VK_NULL_HANDLE, maskImage.view);
+
+        VkSemaphoreCreateInfo semaphoreInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        for (auto &output: outputs) {
+            if (!context.CreateBuffer(sizeof(FrameUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                      true, output.uniforms) ||
+                !context.CreateBuffer(sizeof(RectInstance) * MAX_RECTS,
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true, output.rects) ||
+                !context.CreateBuffer(sizeof(VkDrawIndirectCommand),
+                                      VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, true,
+                                      output.indirect) ||
+                !CHECK_VK(vkCreateSemaphore(device, &semaphoreInfo, nullptr,
+                                            &output.renderDone))) {
+                return false;
+            }
+            output.frameSet = AllocateSet(device, targetDescriptorPool, frameSetLayout);
+            if (output.frameSet == VK_NULL_HANDLE) return false;
+            WriteBuffer(device, output.frameSet, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                        output.uniforms);
+            WriteBuffer(device, output.frameSet, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        output.rects);
+        }
+
+        maskPipeline = CreatePipeline(maskVertex, maskFragment, blurPipelineLayout,
+                                      compositeRenderPass, 0,
+                                      VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, false);
+        if (maskPipeline == VK_NULL_HANDLE || !CreateCameraPipelines()) return false;
+
+        // The composite samples both pyramids in every variant, drawn or not.
+        const bool transitioned = context.SubmitOnce([this](VkCommandBuffer commandBuffer) {
+            std::vector<VkImageMemoryBarrier> barriers;
+            for (const auto &pyramid: pyramidImages) {
+                for (const auto &image: pyramid) {
+                    VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+                    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                    barrier.image = image.image;
+                    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+                    barriers.push_back(barrier);
+                }
+            }
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                                 nullptr, static_cast<uint32_t>(barriers.size()),
+                                 barriers.data());
+        });
+        if (!transitioned) return false;
+
+        commandBuffers.assign(outputs.size() * CAMERA_SLOT_COUNT * VARIANT_COUNT,
+                              VK_NULL_HANDLE);
+        outputDirty = true;
+        return true;
+    }
+
+    void VulkanRenderer::DestroyTarget() {
+        VkDevice device = context.Device();
+        vkDeviceWaitIdle(device);
+        InvalidateCommandBuffers(NO_CAMERA_SLOT);
+        commandBuffers.clear();
+
+        vkDestroyPipeline(device, compositePipeline, nullptr);
+        compositePipeline = VK_NULL_HANDLE;
+        vkDestroyPipeline(device, maskPipeline, nullptr);
+        maskPipeline = VK_NULL_HANDLE;
+        for (auto &output: outputs) {
+            vkDestroyFramebuffer(device, output.framebuffer, nullptr);
+            // The offscreen view goes with its image.
+            if (swapchain != VK_NULL_HANDLE) vkDestroyImageView(device, output.view, nullptr);
+            context.DestroyBuffer(output.uniforms);
+            context.DestroyBuffer(output.rects);
+            context.DestroyBuffer(output.indirect);
+            vkDestroySemaphore(device, output.renderDone, nullptr);
+        }
+        outputs.clear();
+        for (uint32_t pyramid = 0; pyramid < PYRAMID_COUNT; ++pyramid) {
+            for (uint32_t pass = 0; pass < PYRAMID_PASS_COUNT; ++pass) {
+                vkDestroyFramebuffer(device, pyramidFramebuffers[pyramid][pass], nullptr);
+                pyramidFramebuffers[pyramid][pass] = VK_NULL_HANDLE;
+                context.DestroyImage(pyramidImages[pyramid][pass]);
+                pyramidInputSets[pyramid][pass] = VK_NULL_HANDLE;
+            }
+        }
+        context.DestroyImage(maskImage);
+        // Frees the sets.
+        vkDestroyDescriptorPool(device, targetDescriptorPool, nullptr);
+        targetDescriptorPool = VK_NULL_HANDLE;
+        compositeSet = VK_NULL_HANDLE;
+        vkDestroyRenderPass(device, compositeRenderPass, nullptr);
+        compositeRenderPass = VK_NULL_HANDLE;
+
+        vkDestroySwapchainKHR(device, swapchain, nullptr);
+        swapchain = VK_NULL_HANDLE;
+        context.DestroyImage(offscreenImage);
+        context.DestroyBuffer(readbackBuffer);
+        targetWidth = 0;
+        targetHeight = 0;
+        lastOutput = 0;
+    }
+
+    void VulkanRenderer::InvalidateCommandBuffers(uint32_t slot) {
+        if (commandBuffers.empty()) return;
+        // Frames in flight may still execute them.
+        vkDeviceWaitIdle(context.Device());
+        for (size_t index = 0; index < commandBuffers.size(); ++index) {
+            const auto commandBufferSlot =
+                    static_cast<uint32_t>(index / VARIANT_COUNT % CAMERA_SLOT_COUNT);
+            if (slot != NO_CAMERA_SLOT && commandBufferSlot != slot) continue;
+            if (commandBuffers[index] == VK_NULL_HANDLE) continue;
+            vkFreeCommandBuffers(context.Device(), context.CommandPool(), 1,
+                                 &commandBuffers[index]);
+            commandBuffers[index] = VK_NULL_HANDLE;
+        }
+    }
+
+    VkCommandBuffer VulkanRenderer::CommandBufferFor(uint32_t output, uint32_t slot,
+                                                     uint32_t variant) {
+        auto &commandBuffer =
+                commandBuffers[(output * CAMERA_SLOT_COUNT + slot) * VARIANT_COUNT + variant];
+        if (commandBuffer != VK_NULL_HANDLE) return commandBuffer;
+
+        VkCommandBufferAllocateInfo allocateInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocateInfo.commandPool = context.CommandPool();
+        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocateInfo.commandBufferCount = 1;
+        if (!CHECK_VK(vkAllocateCommandBuffers(context.Device(), &allocateInfo,
+                                               &commandBuffer))) {
+            commandBuffer = VK_NULL_HANDLE;
+            return VK_NULL_HANDLE;
+        }
+        if (!RecordFrame(commandBuffer, output, slot, variant)) {
+            vkFreeCommandBuffers(context.Device(), context.CommandPool(), 1, &commandBuffer);
+            commandBuffer = VK_NULL_HANDLE;
+        }
+        return commandBuffer;
+    }
+
+    bool VulkanRenderer::RecordFrame(VkCommandBuffer commandBuffer, uint32_t output,
+                                     uint32_t slot, uint32_t variant) {
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        if (!CHECK_VK(vkBeginCommandBuffer(commandBuffer, &beginInfo))) return false;
+
+        const auto &cameraSlot = cameraSlots[slot];
+        const Output &frameOutput = outputs[output];
+        // Buffers from the camera are owned by a foreign queue between frames, in the layout
+        // it wrote them in.
+        const bool foreign = cameraSlot.hardwareBuffer != nullptr;
+        VkImageMemoryBarrier cameraBarrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        cameraBarrier.image = cameraSlot.image.image;
+        cameraBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        if (foreign) {
+            cameraBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            cameraBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            cameraBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            cameraBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT;
+            cameraBarrier.dstQueueFamilyIndex = context.QueueFamily();
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+                                 nullptr, 1, &cameraBarrier);
+        }
+
+        if (variant & VARIANT_BLURRED_BACKGROUND) {
+            RecordPyramid(commandBuffer, output, slot, PYRAMID_BACKGROUND);
+        }
+        if (variant & VARIANT_RECTS) RecordPyramid(commandBuffer, output, slot, PYRAMID_RECTS);
+
+        VkClearValue clearValues[2]{};
+        VkRenderPassBeginInfo renderPassBegin{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+        renderPassBegin.renderPass = compositeRenderPass;
+        renderPassBegin.framebuffer = frameOutput.framebuffer;
+        renderPassBegin.renderArea = {{0, 0}, {targetWidth, targetHeight}};
+        renderPassBegin.clearValueCount = 2;
+        renderPassBegin.pClearValues = clearValues;
+        vkCmdBeginRenderPass(commandBuffer, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+        SetViewport(commandBuffer, targetWidth, targetHeight);
+        const PassConstants maskConstants{static_cast<float>(targetWidth),
+                                          static_cast<float>(targetHeight), 0, 0};
+        if (variant & VARIANT_RECTS) {
+            // As many instances as the frame wrote rects.
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, maskPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    blurPipelineLayout, 0, 1, &frameOutput.frameSet, 0,
+                                    nullptr);
+            vkCmdPushConstants(commandBuffer, blurPipelineLayout, PASS_CONSTANT_STAGES, 0,
+                               sizeof(PassConstants), &maskConstants);
+            vkCmdDrawIndirect(commandBuffer, frameOutput.indirect.buffer, 0, 1,
+                              sizeof(VkDrawIndirectCommand));
+        }
+        vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+
+        const VkDescriptorSet compositeSets[] = {frameOutput.frameSet, compositeSet,
+                                                 cameraSlot.set};
+        const PassConstants compositeConstants{
+                static_cast<float>(targetWidth), static_cast<float>(targetHeight), 0,
+                variant & VARIANT_BLURRED_BACKGROUND ? PASS_BLURRED_BACKGROUND : 0};
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, compositePipeline);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                compositePipelineLayout, 0, 3, compositeSets, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, compositePipelineLayout, PASS_CONSTANT_STAGES, 0,
+                           sizeof(PassConstants), &compositeConstants);
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        vkCmdEndRenderPass(commandBuffer);
+
+        if (foreign) {
+            cameraBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            cameraBarrier.dstAccessMask = 0;
+            cameraBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            cameraBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            cameraBarrier.srcQueueFamilyIndex = context.QueueFamily();
+            cameraBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_FOREIGN_EXT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                                 nullptr, 1, &cameraBarrier);
+        }
+        return CHECK_VK(vkEndCommandBuffer(commandBuffer));
+    }
+
+    void VulkanRenderer::RecordPyramid(VkCommandBuffer commandBuffer, uint32_t output,
+                                       uint32_t slot, uint32_t pyramid) {
+        const VkDescriptorSet frameSet = outputs[output].frameSet;
+        for (uint32_t pass = 0; pass < PYRAMID_PASS_COUNT; ++pass) {
+            const auto &target = pyramidImages[pyramid][pass];
+            VkRenderPassBeginInfo renderPassBegin{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
+            renderPassBegin.renderPass = blurRenderPass;
+            renderPassBegin.framebuffer = pyramidFramebuffers[pyramid][pass];
+            renderPassBegin.renderArea = {{0, 0}, {target.width, target.height}};
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBegin, VK_SUBPASS_CONTENTS_INLINE);
+            SetViewport(commandBuffer, target.width, target.height);
+
+            // The first pass samples the camera frame, the others the previous pass.
+            const bool fromCamera = pass == 0;
+            const VkPipelineLayout layout =
+                    fromCamera ? cameraBlurPipelineLayout : blurPipelineLayout;
+            const VkDescriptorSet sets[] = {
+                    frameSet, fromCamera ? cameraSlots[slot].set : pyramidInputSets[pyramid][pass]};
+            const PassConstants constants{static_cast<float>(target.width),
+                                          static_cast<float>(target.height), pyramid,
+                                          pass % 2 == 0 ? PASS_VERTICAL : 0};
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                              fromCamera ? cameraBlurPipeline : blurPipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0,
+                                    2, sets, 0, nullptr);
+            vkCmdPushConstants(commandBuffer, layout, PASS_CONSTANT_STAGES, 0,
+                               sizeof(PassConstants), &constants);
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+            vkCmdEndRenderPass(commandBuffer);
+        }
+    }
+
+    void VulkanRenderer::ApplyCommand(const RenderCommand &command, int64_t timestampNs) {
+        switch (command.type) {
+            case RenderCommand::Type::SET_BLUR_ENABLED:
+                SetBlurEnabled(command.enabled, command.animated, timestampNs);
+                break;
+            case RenderCommand::Type::SET_CONTRASTING_COLOR:
+                SetContrastingColor(command.red, command.green, command.blue, timestampNs);
+                break;
+            case RenderCommand::Type::SET_SAT_BLUR_ENABLED:
+                // Always the separable passes.
+                break;
+        }
+        outputDirty = true;
+    }
+
+    void VulkanRenderer::SetBlurEnabled(bool enabled, bool animated, int64_t timestampNs) {
+        if (blurEnabled == enabled) return;
+
+        blurEnabled = enabled;
+        const Animation<2>::Values target =
+                enabled ? Animation<2>::Values{MAX_LOD, MIN_CONTRASTING_COLOR_MIX}
+                        : Animation<2>::Values{MIN_LOD, MAX_CONTRASTING_COLOR_MIX};
+        if (!animated) {
+            blurAnimation.Jump(target);
+            return;
+        }
+        // Turning around midway takes as long as it took to get there.
+        const float distance = std::abs(target[0] - blurAnimation.Get()[0]) / (MAX_LOD - MIN_LOD);
+        blurAnimation.Start(target, timestampNs,
+                            static_cast<int64_t>(
+                                    static_cast<double>(BLUR_ANIMATION_DURATION_NS) * distance),
+                            Easing::EASE_IN_OUT_CUBIC);
+    }
+
+    void VulkanRenderer::SetContrastingColor(float red, float green, float blue,
+                                             int64_t timestampNs) {
+        const auto &color = contrastingColorAnimation.Get();
+        if (color[0] == -1.f && color[1] == -1.f && color[2] == -1.f) {
+            contrastingColorAnimation.Jump({red, green, blue});
+        } else {
+            contrastingColorAnimation.Start({red, green, blue}, timestampNs,
+                                            CONTRASTING_COLOR_ANIMATION_DURATION_NS,
+                                            Easing::EASE_OUT_CUBIC);
+        }
+    }
+
+    void VulkanRenderer::JumpToState(bool enabled, float stateLod, float stateMix,
+                                     const float stateColor[3]) {
+        blurEnabled = enabled;
+        blurAnimation.Jump({stateLod, stateMix});
+        contrastingColorAnimation.Jump({stateColor[0], stateColor[1], stateColor[2]});
+        outputDirty = true;
+    }
+
+    bool VulkanRenderer::Animate(int64_t timestampNs) {
+        bool changed = blurAnimation.Update(timestampNs);
+        changed = contrastingColorAnimation.Update(timestampNs) || changed;
+
+        lod = blurAnimation.Get()[0];
+        contrastingColorMix = blurAnimation.Get()[1];
+        contrastingColor = contrastingColorAnimation.Get();
+        return changed;
+    }
+
+    bool VulkanRenderer::TrackFrameInputs(int64_t timestampNs,
+                                          const float *vertTransform,
+                                          const float *texTransform,
+                                          const float *rectsCoordinates,
+                                          uint32_t allRectsCount,
+                                          uint32_t otherRectsCount) {
+        const size_t rectsSize =
+                rectsCoordinates ? allRectsCount * RectGridIndex::RECT_COMPONENTS : 0;
+        const bool unchanged =
+                timestampNs == lastFrameTimestampNs &&
+                std::equal(lastVertTransform.begin(), lastVertTransform.end(), vertTransform) &&
+                std::equal(lastTexTransform.begin(), lastTexTransform.end(), texTransform) &&
+                allRectsCount == lastAllRectsCount && otherRectsCount == lastOtherRectsCount &&
+                std::equal(lastRects.begin(), lastRects.end(),
+                           rectsCoordinates, rectsCoordinates + rectsSize);
+        if (unchanged) return false;
+
+        lastFrameTimestampNs = timestampNs;
+        std::copy_n(vertTransform, 16, lastVertTransform.begin());
+        std::copy_n(texTransform, 16, lastTexTransform.begin());
+        lastRects.assign(rectsCoordinates, rectsCoordinates + rectsSize);
+        lastAllRectsCount = allRectsCount;
+        lastOtherRectsCount = otherRectsCount;
+        return true;
+    }
+
+    uint32_t VulkanRenderer::WriteFrameBuffers(const Output &output,
+                                               const float *vertTransform,
+                                               const float *texTransform,
+                                               const float *rectsCoordinates,
+                                               uint32_t rectsCount) {
+        FrameUniforms uniforms{};
+        std::copy_n(vertTransform, 16, uniforms.vertTransform);
+        std::copy_n(texTransform, 16, uniforms.texTransform);
+        const bool hasContrastingColor = contrastingColor[0] != -1.f ||
+                                         contrastingColor[1] != -1.f ||
+                                         contrastingColor[2] != -1.f;
+        // Mixed once by the factor compounded over the separable passes, like the GL renderer.
+        const float finalMix =
+                hasContrastingColor && contrastingColorMix > 0.f
+                ? 1.f - std::pow(1.f - contrastingColorMix,
+                                 static_cast<float>(SEPARABLE_BLUR_PASS_COUNT))
+                : 0.f;
+        uniforms.contrastingColor[0] = contrastingColor[0];
+        uniforms.contrastingColor[1] = contrastingColor[1];
+        uniforms.contrastingColor[2] = contrastingColor[2];
+        uniforms.contrastingColor[3] = finalMix;
+        uniforms.lods[0] = lod;
+        uniforms.lods[1] = MAX_LOD;
+        memcpy(output.uniforms.mapped, &uniforms, sizeof(uniforms));
+
+        // Off screen rects and rects under another one add nothing to the mask.
+        visibleRectIndices.clear();
+        if (rectsCoordinates && rectsCount > 0) {
+            rectGridIndex.Update(rectsCoordinates, rectsCount);
+            rectGridIndex.QueryVisible(static_cast<float>(targetWidth),
+                                       static_cast<float>(targetHeight), visibleRectIndices);
+        }
+        const auto count =
+                std::min(static_cast<uint32_t>(visibleRectIndices.size()), MAX_RECTS);
+        auto *instances = static_cast<RectInstance *>(output.rects.mapped);
+        for (uint32_t i = 0; i < count; ++i) {
+            const float *rect =
+                    rectsCoordinates + visibleRectIndices[i] * RectGridIndex::RECT_COMPONENTS;
+            instances[i] = {{rect[0], rect[1] - rect[3], rect[0] + rect[2], rect[1]},
+                            {rect[4], 0.f, 0.f, 0.f}};
+        }
+        const VkDrawIndirectCommand draw{4, count, 0, 0};
+        memcpy(output.indirect.mapped, &draw, sizeof(draw));
+        return count;
+    }
+
+    VulkanRenderer::FrameResult VulkanRenderer::DrawFrame(int64_t timestampNs,
+                                                          const float *vertTransform,
+                                                          const float *texTransform,
+                                                          const float *rectsCoordinates,
+                                                          uint32_t allRectsCount,
+                                                          uint32_t otherRectsCount) {
+        if (!HasTarget() && surface != VK_NULL_HANDLE) {
+            // The swapchain went out of date without a new one.
+            if (!CreateSwapchain()) {
+                DestroyTarget();
+                return FrameResult::FAILED;
+            }
+        }
+        if (!HasTarget() || currentCameraSlot == NO_CAMERA_SLOT ||
+            compositePipeline == VK_NULL_HANDLE) {
+            return FrameResult::FAILED;
+        }
+
+        const bool animated = Animate(timestampNs);
+        const bool changed = TrackFrameInputs(timestampNs, vertTransform, texTransform,
+                                              rectsCoordinates, allRectsCount, otherRectsCount);
+        if (!outputDirty && !animated && !changed) return FrameResult::UNCHANGED;
+        // Until the frame is drawn.
+        outputDirty = true;
+
+        VkDevice device = context.Device();
+        VkFence fence = frameFences[frameSlot];
+        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+        uint32_t outputIndex = 0;
+        if (swapchain != VK_NULL_HANDLE) {
+            const VkResult acquired =
+                    vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAcquired[frameSlot],
+                                          VK_NULL_HANDLE, &outputIndex);
+            if (acquired == VK_ERROR_OUT_OF_DATE_KHR) {
+                DestroyTarget();
+                return FrameResult::FAILED;
+            }
+            if (acquired != VK_SUBOPTIMAL_KHR && !CHECK_VK(acquired)) return FrameResult::FAILED;
+        }
+        Output &output = outputs[outputIndex];
+        // Another frame in flight may have drawn into the output last.
+        if (output.fence != VK_NULL_HANDLE && output.fence != fence) {
+            vkWaitForFences(device, 1, &output.fence, VK_TRUE, UINT64_MAX);
+        }
+        output.fence = fence;
+
+        // Every rect while the blur animates or is off, the other rects only once it is on.
+        const uint32_t rectsCount = !blurEnabled || blurAnimation.IsRunning()
+                                    ? allRectsCount : otherRectsCount;
+        const uint32_t drawnRects = WriteFrameBuffers(output, vertTransform, texTransform,
+                                                      rectsCoordinates, rectsCount);
+        const uint32_t variant =
+                (blurEnabled || blurAnimation.IsRunning() ? VARIANT_BLURRED_BACKGROUND : 0) |
+                (drawnRects > 0 ? VARIANT_RECTS : 0);
+        VkCommandBuffer commandBuffer = CommandBufferFor(outputIndex, currentCameraSlot, variant);
+        if (commandBuffer == VK_NULL_HANDLE) return FrameResult::FAILED;
+        cameraSlots[currentCameraSlot].lastUsedFrame = frameNumber;
+
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        if (swapchain != VK_NULL_HANDLE) {
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &imageAcquired[frameSlot];
+            submitInfo.pWaitDstStageMask = &waitStage;
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &output.renderDone;
+        }
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        vkResetFences(device, 1, &fence);
+        if (!CHECK_VK(vkQueueSubmit(context.Queue(), 1, &submitInfo, fence))) {
+            return FrameResult::FAILED;
+        }
+        lastOutput = outputIndex;
+        frameSlot = (frameSlot + 1) % MAX_FRAMES_IN_FLIGHT;
+        ++frameNumber;
+
+        if (swapchain != VK_NULL_HANDLE) {
+            VkPresentInfoKHR presentInfo{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
+            presentInfo.waitSemaphoreCount = 1;
+            presentInfo.pWaitSemaphores = &output.renderDone;
+            presentInfo.swapchainCount = 1;
+            presentInfo.pSwapchains = &swapchain;
+            presentInfo.pImageIndices = &outputIndex;
+            const VkResult presented = vkQueuePresentKHR(context.Queue(), &presentInfo);
+            if (presented == VK_ERROR_OUT_OF_DATE_KHR || presented == VK_SUBOPTIMAL_KHR) {
+                // Recreated for the next frame, which is drawn whatever its inputs.
+                DestroyTarget();
+                if (presented == VK_ERROR_OUT_OF_DATE_KHR) return FrameResult::FAILED;
+                return FrameResult::DRAWN;
+            }
+            if (!CHECK_VK(presented)) return FrameResult::FAILED;
+        }
+        outputDirty = false;
+        return FrameResult::DRAWN;
+    }
+
+    bool VulkanRenderer::ReadOutput(uint8_t *pixels) {
+        if (offscreenImage.image == VK_NULL_HANDLE || frameNumber == 0) return false;
+        vkQueueWaitIdle(context.Queue());
+        const bool copied = context.SubmitOnce([this](VkCommandBuffer commandBuffer) {
+            VkBufferImageCopy region{};
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            region.imageExtent = {targetWidth, targetHeight, 1};
+            vkCmdCopyImageToBuffer(commandBuffer, offscreenImage.image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.buffer,
+                                   1, &region);
+            VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0,
+                                 nullptr);
+        });
+        if (!copied) return false;
+        // The composite wrote the rows top-down.
+        memcpy(pixels, readbackBuffer.mapped, static_cast<size_t>(targetWidth) * targetHeight * 4);
+        return true;
+    }
+
+    void VulkanRenderer::Release() {
+        if (!context.IsInitialized()) return;
+        VkDevice device = context.Device();
+        DestroyTarget();
+        vkDestroySurfaceKHR(context.Instance(), surface, nullptr);
+        surface = VK_NULL_HANDLE;
+
+        for (uint32_t slot = 0; slot < CAMERA_SLOT_COUNT; ++slot) ReleaseCameraSlot(slot);
+        DestroyCameraLayout();
+        context.DestroyBuffer(cameraStaging);
+
+        vkDestroyPipeline(device, blurPipeline, nullptr);
+        vkDestroyRenderPass(device, blurRenderPass, nullptr);
+        vkDestroyPipelineLayout(device, blurPipelineLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, frameSetLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, textureSetLayout, nullptr);
+        vkDestroyDescriptorSetLayout(device, compositeSetLayout, nullptr);
+        vkDestroySampler(device, linearSampler, nullptr);
+        for (VkShaderModule module: {fullscreenVertex, blurFragment, blurCameraFragment,
+                                     maskVertex, maskFragment, compositeFragment}) {
+            vkDestroyShaderModule(device, module, nullptr);
+        }
+        for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+            vkDestroySemaphore(device, imageAcquired[frame], nullptr);
+            vkDestroyFence(device, frameFences[frame], nullptr);
+        }
+        blurPipeline = VK_NULL_HANDLE;
+        blurRenderPass = VK_NULL_HANDLE;
+        blurPipelineLayout = VK_NULL_HANDLE;
+        frameSetLayout = VK_NULL_HANDLE;
+        textureSetLayout = VK_NULL_HANDLE;
+        compositeSetLayout = VK_NULL_HANDLE;
+        linearSampler = VK_NULL_HANDLE;
+        fullscreenVertex = VK_NULL_HANDLE;
+        blurFragment = VK_NULL_HANDLE;
+        blurCameraFragment = VK_NULL_HANDLE;
+        maskVertex = VK_NULL_HANDLE;
+        maskFragment = VK_NULL_HANDLE;
+        compositeFragment = VK_NULL_HANDLE;
+        imageAcquired = {};
+        frameFences = {};
+        frameSlot = 0;
+        frameNumber = 0;
+#ifdef __ANDROID__
+        getHardwareBufferProperties = nullptr;
+#endif
+        context.Release();
+    }
+}  // namespace lookaround
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#ifdef __ANDROID__
+#include <android/hardware_buffer.h>
+#endif
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "animation.h"
+#include "rect_grid_index.h"
+#include "render_command.h"
+#include "vulkan_context.h"
+
+namespace lookaround {
+    // The camera post-processing of the GL renderer on Vulkan: the separable blur pyramid of
+    // the background and of the marker rects, the rounded rect mask and the contrasting color,
+    // with the same animations. Sprites, labels, snapshots, mirrors and SAT blur are GL only.
+    //
+    // Command buffers are recorded once per output image, camera slot and variant (background
+    // blurred or not, rects or not) and resubmitted every frame; what changes between frames
+    // is in the per image uniform, rects and indirect draw buffers. Each blur pass is a render
+    // pass of its own, since its taps read neighbouring texels of the previous pass. The last
+    // render pass has two subpasses: the rect mask into a transient attachment, read back by
+    // subpassLoad in the composite, which blurs the full size level of both pyramids
+    // horizontally straight into the output - the tile based GPUs of phones keep the mask in
+    // tile memory.
+    //
+    // Frames go to a swapchain, or to an offscreen image read back by ReadOutput for headless
+    // use on the host. Not thread safe, all calls must come from one thread.
+    class VulkanRenderer {
+    public:
+        // Returns the SPIR-V of the shader name, e.g. "blur.frag.spv", empty if it is missing.
+        using ShaderLoader = std::function<std::vector<uint32_t>(const char *name)>;
+
+        enum class FrameResult {
+            DRAWN,
+            // Nothing changed since the last drawn frame, which is still on screen.
+            UNCHANGED,
+            FAILED,
+        };
+
+        // Those of the GL renderer.
+        static constexpr float MAX_LOD = 2.f;
+        static constexpr float MIN_LOD = -2.f;
+        static constexpr int64_t BLUR_ANIMATION_DURATION_NS = 300'000'000;
+        static constexpr int64_t CONTRASTING_COLOR_ANIMATION_DURATION_NS = 1'000'000'000;
+        static constexpr float MAX_CONTRASTING_COLOR_MIX = .05f;
+        static constexpr float MIN_CONTRASTING_COLOR_MIX = 0.f;
+        static constexpr int SEPARABLE_BLUR_PASS_COUNT = 8;
+
+        // Camera buffers imported at once, at least the maxImages of the ImageReader.
+        static constexpr uint32_t CAMERA_SLOT_COUNT = 8;
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+        // Visible rects drawn per frame, the others are dropped.
+        static constexpr uint32_t MAX_RECTS = 256;
+
+        VulkanRenderer() = default;
+
+        ~VulkanRenderer() { Release(); }
+
+        VulkanRenderer(const VulkanRenderer &) = delete;
+
+        VulkanRenderer &operator=(const VulkanRenderer &) = delete;
+
+        // Returns false if there is no suitable device or a shader is missing.
+        bool Init(const VulkanContext::Options &options, const ShaderLoader &loadShader);
+
+        void Release();
+
+        [[nodiscard]] bool IsInitialized() const { return context.IsInitialized(); }
+
+        // Instance and device, e.g. for creating the surface.
+        VulkanContext &Context() { return context; }
+
+        // Takes ownership of surface, presenting frames on it until the next call. Releases the
+        // current one if surface is null. width and height are only used when the surface
+        // does not define its size.
+        bool SetSurface(VkSurfaceKHR surface, uint32_t width, uint32_t height);
+
+        // Draws into an image instead of a surface, for ReadOutput.
+        bool SetOffscreenTarget(uint32_t width, uint32_t height);
+
+        [[nodiscard]] bool HasTarget() const { return !outputs.empty(); }
+
+        [[nodiscard]] uint32_t TargetWidth() const { return targetWidth; }
+
+        [[nodiscard]] uint32_t TargetHeight() const { return targetHeight; }
+
+        // Uploads a camera frame of top-down RGBA rows, drawn by the following frames.
+        bool SetCameraPixels(const uint8_t *pixels, uint32_t width, uint32_t height);
+
+#ifdef __ANDROID__
+        // Samples the camera frame in buffer from the following frames, which must stay unchanged
+        // until MAX_FRAMES_IN_FLIGHT more frames were drawn. Buffers are imported once and kept
+        // acquired in one of the camera slots, ImageReader cycles through the same few.
+        bool SetCameraHardwareBuffer(AHardwareBuffer *buffer);
+#endif
+
+        void ApplyCommand(const RenderCommand &command, int64_t timestampNs);
+
+        void SetBlurEnabled(bool enabled, bool animated, int64_t timestampNs);
+
+        void SetContrastingColor(float red, float green, float blue, int64_t timestampNs);
+
+        // Sets the state of a trace at once, without animations.
+        void JumpToState(bool enabled, float lod, float contrastingColorMix,
+                         const float contrastingColor[3]);
+
+        // rectsCoordinates are the GL renderer's, RectGridIndex::RECT_COMPONENTS per rect.
+        FrameResult DrawFrame(int64_t timestampNs,
+                              const float *vertTransform,
+                              const float *texTransform,
+                              const float *rectsCoordinates,
+                              uint32_t allRectsCount,
+                              uint32_t otherRectsCount);
+
+        // Copies the last frame drawn offscreen into pixels, top-down RGBA rows of the target
+        // size. Waits for the frame to finish.
+        bool ReadOutput(uint8_t *pixels);
+
+    private:
+        static constexpr uint32_t PYRAMID_BACKGROUND = 0;
+        static constexpr uint32_t PYRAMID_RECTS = 1;
+        static constexpr uint32_t PYRAMID_COUNT = 2;
+        // Camera V and H at half size, quarter V and H, half V and H, full V. The full H pass
+        // is part of the composite.
+        static constexpr uint32_t PYRAMID_PASS_COUNT = 7;
+        static constexpr std::array<uint32_t, PYRAMID_PASS_COUNT> PYRAMID_PASS_DIVISORS{
+                2, 2, 4, 4, 2, 2, 1};
+
+        static constexpr uint32_t VARIANT_BLURRED_BACKGROUND = 1u << 0;
+        static constexpr uint32_t VARIANT_RECTS = 1u << 1;
+        static constexpr uint32_t VARIANT_COUNT = 4;
+
+        static constexpr uint32_t NO_CAMERA_SLOT = UINT32_MAX;
+
+        // Layouts of the shaders' blocks.
+        struct FrameUniforms {
+            float vertTransform[16];
+            float texTransform[16];
+            float contrastingColor[4];
+            float lods[4];
+        };
+
+        struct RectInstance {
+            float bounds[4];
+            float cornerRadius[4];
+        };
+
+        struct PassConstants {
+            float outputWidth;
+            float outputHeight;
+            uint32_t pyramid;
+            uint32_t flags;
+        };
+
+        // A swapchain image or the offscreen image, with what its frames write.
+        struct Output {
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkFramebuffer framebuffer = VK_NULL_HANDLE;
+            VulkanBuffer uniforms;
+            VulkanBuffer rects;
+            VulkanBuffer indirect;
+            VkDescriptorSet frameSet = VK_NULL_HANDLE;
+            VkSemaphore renderDone = VK_NULL_HANDLE;
+            // One of frameFences, signaled by the last frame drawn into it.
+            VkFence fence = VK_NULL_HANDLE;
+        };
+
+        struct CameraSlot {
+            VulkanImage image;
+            VkDescriptorSet set = VK_NULL_HANDLE;
+            // Acquired while imported, null for uploaded pixels.
+            void *hardwareBuffer = nullptr;
+            uint64_t lastUsedFrame = 0;
+        };
+
+        bool CreateStaticResources();
+
+        bool CreateShaderModules(const ShaderLoader &loadShader);
+
+        // The camera sampler, its set layout and the pipelines sampling it, for frames of
+        // format or externalFormat. conversionInfo is null for RGBA frames.
+        bool CreateCameraLayout(VkFormat format, uint64_t externalFormat,
+                                const VkSamplerYcbcrConversionCreateInfo *conversionInfo);
+
+        void DestroyCameraLayout();
+
+        bool CreateCameraPipelines();
+
+        // Sizes everything drawn into by the passes after the outputs, which must be set.
+        bool CreateTargetResources(VkFormat outputFormat, VkImageLayout outputFinalLayout);
+
+        void DestroyTarget();
+
+        bool CreateSwapchain();
+
+        VkPipeline CreatePipeline(VkShaderModule vertex, VkShaderModule fragment,
+                                  VkPipelineLayout layout, VkRenderPass renderPass,
+                                  uint32_t subpass, VkPrimitiveTopology topology, bool flipY);
+
+        VkCommandBuffer CommandBufferFor(uint32_t output, uint32_t slot, uint32_t variant);
+
+        bool RecordFrame(VkCommandBuffer commandBuffer, uint32_t output, uint32_t slot,
+                         uint32_t variant);
+
+        void RecordPyramid(VkCommandBuffer commandBuffer, uint32_t output, uint32_t slot,
+                           uint32_t pyramid);
+
+        // Waits for the frames in flight and frees the command buffers recorded for slot, all
+        // of them for NO_CAMERA_SLOT.
+        void InvalidateCommandBuffers(uint32_t slot);
+
+        void ReleaseCameraSlot(uint32_t slot);
+
+        bool WriteCameraSet(uint32_t slot);
+
+        // Evaluates the animations at the frame timestamp. Returns whether any animated value
+        // changed since the previous frame.
+        bool Animate(int64_t timestampNs);
+
+        // Returns whether the frame differs from the last drawn one.
+        bool TrackFrameInputs(int64_t timestampNs,
+                              const float *vertTransform,
+                              const float *texTransform,
+                              const float *rectsCoordinates,
+                              uint32_t allRectsCount,
+                              uint32_t otherRectsCount);
+
+        // Fills the buffers of output for the frame. Returns the number of rects to draw.
+        uint32_t WriteFrameBuffers(const Output &output,
+                                   const float *vertTransform,
+                                   const float *texTransform,
+                                   const float *rectsCoordinates,
+                                   uint32_t rectsCount);
+
+        VulkanContext context;
+#ifdef __ANDROID__
+        PFN_vkGetAndroidHardwareBufferPropertiesANDROID getHardwareBufferProperties = nullptr;
+#endif
+
+        VkShaderModule fullscreenVertex = VK_NULL_HANDLE;
+        VkShaderModule blurFragment = VK_NULL_HANDLE;
+        VkShaderModule blurCameraFragment = VK_NULL_HANDLE;
+        VkShaderModule maskVertex = VK_NULL_HANDLE;
+        VkShaderModule maskFragment = VK_NULL_HANDLE;
+        VkShaderModule compositeFragment = VK_NULL_HANDLE;
+
+        VkSampler linearSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout frameSetLayout = VK_NULL_HANDLE;
+        VkDescriptorSetLayout textureSetLayout = VK_NULL_HANDLE;
+        VkDescriptorSetLayout compositeSetLayout = VK_NULL_HANDLE;
+        VkPipelineLayout blurPipelineLayout = VK_NULL_HANDLE;
+        VkRenderPass blurRenderPass = VK_NULL_HANDLE;
+        VkPipeline blurPipeline = VK_NULL_HANDLE;
+
+        // Follow the format of the camera frames.
+        VkFormat cameraFormat = VK_FORMAT_UNDEFINED;
+        uint64_t cameraExternalFormat = 0;
+        VkSamplerYcbcrConversion cameraConversion = VK_NULL_HANDLE;
+        VkSampler cameraSampler = VK_NULL_HANDLE;
+        VkDescriptorSetLayout cameraSetLayout = VK_NULL_HANDLE;
+        VkDescriptorPool cameraDescriptorPool = VK_NULL_HANDLE;
+        VkPipelineLayout cameraBlurPipelineLayout = VK_NULL_HANDLE;
+        VkPipelineLayout compositePipelineLayout = VK_NULL_HANDLE;
+        VkPipeline cameraBlurPipeline = VK_NULL_HANDLE;
+        VkPipeline compositePipeline = VK_NULL_HANDLE;
+        std::array<CameraSlot, CAMERA_SLOT_COUNT> cameraSlots{};
+        uint32_t currentCameraSlot = NO_CAMERA_SLOT;
+        // Staging of uploaded camera frames, reused while the size stays.
+        VulkanBuffer cameraStaging;
+
+        // Follow the target.
+        VkSurfaceKHR surface = VK_NULL_HANDLE;
+        VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+        uint32_t surfaceWidthHint = 0;
+        uint32_t surfaceHeightHint = 0;
+        VulkanImage offscreenImage;
+        VulkanBuffer readbackBuffer;
+        uint32_t targetWidth = 0;
+        uint32_t targetHeight = 0;
+        std::vector<Output> outputs;
+        VkRenderPass compositeRenderPass = VK_NULL_HANDLE;
+        VkPipeline maskPipeline = VK_NULL_HANDLE;
+        VulkanImage maskImage;
+        std::array<std::array<VulkanImage, PYRAMID_PASS_COUNT>, PYRAMID_COUNT> pyramidImages{};
+        std::array<std::array<VkFramebuffer, PYRAMID_PASS_COUNT>, PYRAMID_COUNT>
+                pyramidFramebuffers{};
+        VkDescriptorPool targetDescriptorPool = VK_NULL_HANDLE;
+        // Input of each pass but the first, which samples the camera.
+        std::array<std::array<VkDescriptorSet, PYRAMID_PASS_COUNT>, PYRAMID_COUNT>
+                pyramidInputSets{};
+        VkDescriptorSet compositeSet = VK_NULL_HANDLE;
+        // Indexed by (output * CAMERA_SLOT_COUNT + slot) * VARIANT_COUNT + variant, recorded
+        // when first used.
+        std::vector<VkCommandBuffer> commandBuffers;
+        std::array<VkSemaphore, MAX_FRAMES_IN_FLIGHT> imageAcquired{};
+        std::array<VkFence, MAX_FRAMES_IN_FLIGHT> frameFences{};
+        uint32_t frameSlot = 0;
+        uint64_t frameNumber = 0;
+        // Output of the last drawn frame.
+        uint32_t lastOutput = 0;
+
+        bool blurEnabled = false;
+        Animation<2> blurAnimation{{MIN_LOD, MAX_CONTRASTING_COLOR_MIX}};
+        Animation<3> contrastingColorAnimation{{-1.f, -1.f, -1.f}};
+        float lod = MIN_LOD;
+        float contrastingColorMix = MAX_CONTRASTING_COLOR_MIX;
+        std::array<float, 3> contrastingColor{-1.f, -1.f, -1.f};
+
+        // Draws the next frame even if its inputs did not change.
+        bool outputDirty = true;
+        int64_t lastFrameTimestampNs = 0;
+        std::array<float, 16> lastVertTransform{};
+        std::array<float, 16> lastTexTransform{};
+        std::vector<float> lastRects;
+        uint32_t lastAllRectsCount = 0;
+        uint32_t lastOtherRectsCount = 0;
+
+        RectGridIndex rectGridIndex;
+        std::vector<uint32_t> visibleRectIndices;
+    };
+}  // namespace lookaround
@@ -0,0 +1,165 @@
+#include <android/asset_manager.h>
+#include <android/asset_manager_jni.h>
+#include <android/hardware_buffer.h>
+#include <android/hardware_buffer_jni.h>
+#include <android/log.h>
+#include <android/native_window.h>
+#include <android/native_window_jni.h>
+#include <jni.h>
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render_command.h"
+#include "vulkan_renderer.h"
+
+using namespace lookaround;
+
+namespace {
+    auto constexpr LOG_TAG = "VulkanRendererJni";
+
+    // Compiled by the shaders build feature into the shaders directory of the assets.
+    auto constexpr SHADERS_ASSETS_DIR = "shaders/";
+
+    struct VulkanRendererContext {
+        VulkanRenderer renderer;
+        std::shared_ptr<RenderCommandQueue> commandQueue;
+    };
+
+    VulkanContext::Options SurfaceOptions() {
+        VulkanContext::Options options;
+        options.instanceExtensions = {VK_KHR_SURFACE_EXTENSION_NAME,
+                                      VK_KHR_ANDROID_SURFACE_EXTENSION_NAME};
+        options.presentation = true;
+#ifndef NDEBUG
+        options.validation = true;
+#endif
+        return options;
+    }
+
+    std::vector<uint32_t> LoadShaderAsset(AAssetManager *assetManager, const char *name) {
+        const std::string path = std::string(SHADERS_ASSETS_DIR) + name;
+        AAsset *asset = AAssetManager_open(assetManager, path.c_str(), AASSET_MODE_BUFFER);
+        if (asset == nullptr) return {};
+        const auto length = static_cast<size_t>(AAsset_getLength(asset));
+        std::vector<uint32_t> code(length / sizeof(uint32_t));
+        const bool read = length % sizeof(uint32_t) == 0 &&
+                          AAsset_read(asset, code.data(), length) == static_cast<int>(length);
+        AAsset_close(asset);
+        if (!read) code.clear();
+        return code;
+    }
+
+    void ApplyCommands(VulkanRendererContext *rendererContext, int64_t timestampNs) {
+        RenderCommand command;
+        while (rendererContext->commandQueue->TryPop(command)) {
+            rendererContext->renderer.ApplyCommand(command, timestampNs);
+        }
+    }
+}  // namespace
+
+extern "C" {
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_VulkanRenderer_probe(JNIEnv *env, jclass clazz) {
+    // Camera frames only reach the renderer as AHardwareBuffers.
+    VulkanContext context;
+    VulkanContext::Options options = SurfaceOptions();
+    options.validation = false;
+    return context.Init(options) && context.HasHardwareBufferImport() ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jlong JNICALL
+Java_com_lookaround_core_android_camera_VulkanRenderer_create(
+        JNIEnv *env, jclass clazz, jlong commandQueue, jobject jassetManager) {
+    AAssetManager *assetManager = AAssetManager_fromJava(env, jassetManager);
+    auto *rendererContext = new VulkanRendererContext();
+    const bool initialized = rendererContext->renderer.Init(
+            SurfaceOptions(),
+            [assetManager](const char *name) { return LoadShaderAsset(assetManager, name); });
+    if (!initialized || !rendererContext->renderer.Context().HasHardwareBufferImport()) {
+        __android_log_print(ANDROID_LOG_WARN, LOG_TAG, "Vulkan renderer is unavailable.");
+        delete rendererContext;
+        return 0;
+    }
+    rendererContext->commandQueue =
+            *reinterpret_cast<std::shared_ptr<RenderCommandQueue> *>(commandQueue);
+    return reinterpret_cast<jlong>(rendererContext);
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_VulkanRenderer_setWindowSurface(
+        JNIEnv *env, jclass clazz, jlong nativeRenderer, jobject jsurface,
+        jint width, jint height) {
+    auto *rendererContext = reinterpret_cast<VulkanRendererContext *>(nativeRenderer);
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+    if (jsurface) {
+        ANativeWindow *nativeWindow = ANativeWindow_fromSurface(env, jsurface);
+        if (nativeWindow == nullptr) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, "Failed to set window surface: "
+                                                            "Unable to acquire native window.");
+            rendererContext->renderer.SetSurface(VK_NULL_HANDLE, 0, 0);
+            return JNI_FALSE;
+        }
+        VkAndroidSurfaceCreateInfoKHR surfaceInfo{
+                VK_STRUCTURE_TYPE_ANDROID_SURFACE_CREATE_INFO_KHR};
+        surfaceInfo.window = nativeWindow;
+        const VkResult created =
+                vkCreateAndroidSurfaceKHR(rendererContext->renderer.Context().Instance(),
+                                          &surfaceInfo, nullptr, &surface);
+        // The surface holds its own reference to the window.
+        ANativeWindow_release(nativeWindow);
+        if (created != VK_SUCCESS) {
+            __android_log_print(ANDROID_LOG_ERROR, LOG_TAG,
+                                "Failed to set window surface: vkCreateAndroidSurfaceKHR (%d).",
+                                static_cast<int>(created));
+            rendererContext->renderer.SetSurface(VK_NULL_HANDLE, 0, 0);
+            return JNI_FALSE;
+        }
+    }
+    const bool attached = rendererContext->renderer.SetSurface(
+            surface, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+    return attached && surface != VK_NULL_HANDLE ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_lookaround_core_android_camera_VulkanRenderer_renderHardwareBuffer(
+        JNIEnv *env, jclass clazz, jlong nativeRenderer, jobject jhardwareBuffer, jlong timestampNs,
+        jfloatArray jvertTransformArray, jfloatArray jtexTransformArray,
+        jfloatArray jrectsCoordinates, jint jallRectsCount, jint jotherRectsCount) {
+    auto *rendererContext = reinterpret_cast<VulkanRendererContext *>(nativeRenderer);
+    ApplyCommands(rendererContext, timestampNs);
+
+    AHardwareBuffer *hardwareBuffer = AHardwareBuffer_fromHardwareBuffer(env, jhardwareBuffer);
+    if (hardwareBuffer == nullptr ||
+        !rendererContext->renderer.SetCameraHardwareBuffer(hardwareBuffer)) {
+        return JNI_FALSE;
+    }
+
+    jfloat *vertTransformArray = env->GetFloatArrayElements(jvertTransformArray, nullptr);
+    jfloat *texTransformArray = env->GetFloatArrayElements(jtexTransformArray, nullptr);
+    jfloat *rectsCoordinates =
+            jallRectsCount == 0
+            ? nullptr
+            : env->GetFloatArrayElements(jrectsCoordinates, nullptr);
+
+    const auto result = rendererContext->renderer.DrawFrame(
+            timestampNs, vertTransformArray, texTransformArray, rectsCoordinates,
+            static_cast<uint32_t>(jallRectsCount), static_cast<uint32_t>(jotherRectsCount));
+
+    if (rectsCoordinates != nullptr) {
+        env->ReleaseFloatArrayElements(jrectsCoordinates, rectsCoordinates, JNI_ABORT);
+    }
+    env->ReleaseFloatArrayElements(jvertTransformArray, vertTransformArray, JNI_ABORT);
+    env->ReleaseFloatArrayElements(jtexTransformArray, texTransformArray, JNI_ABORT);
+    return result == VulkanRenderer::FrameResult::DRAWN ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_lookaround_core_android_camera_VulkanRenderer_destroy(
+        JNIEnv *env, jclass clazz, jlong nativeRenderer) {
+    // Waits for the frames in flight and releases the imported camera buffers.
+    delete reinterpret_cast<VulkanRendererContext *>(nativeRenderer);
+}
+}// extern "C"
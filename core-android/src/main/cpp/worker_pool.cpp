@@ -0,0 +1,52 @@
+#include "worker_pool.h"
+
+namespace lookaround {
+    WorkerPool::WorkerPool(unsigned threadCount) {
+        for (unsigned i = 1; i < threadCount; ++i) workers.emplace_back(&WorkerPool::Work, this);
+    }
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (auto &worker: workers) worker.join();
+    }
+
+    void WorkerPool::Run(int bands, const std::function<void(int)> &band) {
+        if (bands <= 0) return;
+        std::lock_guard<std::mutex> runLock(runMutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &band;
+        bandCount = bands;
+        nextBand = 0;
+        unfinishedBands = bands;
+        if (bands > 1) wakeUp.notify_all();
+        RunBands(lock);
+        bandsDone.wait(lock, [this] { return unfinishedBands == 0; });
+        job = nullptr;
+        bandCount = 0;
+        nextBand = 0;
+    }
+
+    void WorkerPool::Work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeUp.wait(lock, [this] { return stopping || nextBand < bandCount; });
+            if (stopping) return;
+            RunBands(lock);
+        }
+    }
+
+    void WorkerPool::RunBands(std::unique_lock<std::mutex> &lock) {
+        while (nextBand < bandCount) {
+            const int band = nextBand++;
+            const auto &current = *job;
+            lock.unlock();
+            current(band);
+            lock.lock();
+            if (--unfinishedBands == 0) bandsDone.notify_all();
+        }
+    }
+}  // namespace lookaround
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lookaround {
+    // Threads started once and kept waiting for work, for CPU passes which would otherwise
+    // start and join threads on every pass. Run splits work into bands, taken in turn by the
+    // workers and the calling thread.
+    //
+    // Run may be called from any thread, runs from different threads take turns.
+    class WorkerPool {
+    public:
+        // Runs bands on threadCount - 1 workers and the calling thread.
+        explicit WorkerPool(unsigned threadCount);
+
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool &) = delete;
+
+        WorkerPool &operator=(const WorkerPool &) = delete;
+
+        [[nodiscard]] unsigned ThreadCount() const {
+            return static_cast<unsigned>(workers.size()) + 1;
+        }
+
+        // Calls band with each index in [0, bands), returning once all calls did.
+        void Run(int bands, const std::function<void(int)> &band);
+
+    private:
+        void Work();
+
+        // Takes bands of the current run until none are left, with lock held in between.
+        void RunBands(std::unique_lock<std::mutex> &lock);
+
+        std::vector<std::thread> workers;
+        std::mutex runMutex;
+        std::mutex mutex;
+        std::condition_variable wakeUp;
+        std::condition_variable bandsDone;
+        const std::function<void(int)> *job = nullptr;
+        int bandCount = 0;
+        int nextBand = 0;
+        int unfinishedBands = 0;
+        bool stopping = false;
+    };
+}  // namespace lookaround
@@ -0,0 +1,105 @@
+package com.lookaround.core.android.ar.math3d
+
+import android.location.Location
+import java.io.Closeable
+
+/**
+ * Projects POI locations to screen positions natively, 4 POIs per SIMD operation, with the same
+ * math as [Math3D] but without allocating per POI.
+ */
+class PoiProjector : Closeable {
+    private var nativeProjector: Long = create()
+
+    var poisCount: Int = 0
+        private set
+
+    /** Screen x of each POI after [project], NaN if the POI is not drawn. */
+    var screenX: FloatArray = FloatArray(0)
+        private set
+
+    /** Screen y of each POI after [project], NaN if the POI is not drawn. */
+    var screenY: FloatArray = FloatArray(0)
+        private set
+
+    fun setPois(locations: List<Location>) {
+        check(nativeProjector != 0L) { "PoiProjector is closed." }
+        poisCount = locations.size
+        screenX = FloatArray(poisCount)
+        screenY = FloatArray(poisCount)
+        setPois(
+            nativeProjector,
+            DoubleArray(poisCount) { locations[it].latitude },
+            DoubleArray(poisCount) { locations[it].longitude },
+            DoubleArray(poisCount) { locations[it].altitude }
+        )
+    }
+
+    /** @return number of POIs drawn on screen. */
+    fun project(
+        location: Location,
+        camTrig: Trig3,
+        screenRotTrig: Trig1,
+        screenWidth: Float,
+        screenHeight: Float
+    ): Int {
+        check(nativeProjector != 0L) { "PoiProjector is closed." }
+        return project(
+            nativeProjector,
+            location.latitude,
+            location.longitude,
+            location.altitude,
+            camTrig.xSin.toFloat(),
+            camTrig.xCos.toFloat(),
+            camTrig.ySin.toFloat(),
+            camTrig.yCos.toFloat(),
+            screenRotTrig.sin.toFloat(),
+            screenRotTrig.cos.toFloat(),
+            screenWidth,
+            screenHeight,
+            screenX,
+            screenY
+        )
+    }
+
+    override fun close() {
+        if (nativeProjector == 0L) return
+        destroy(nativeProjector)
+        nativeProjector = 0L
+    }
+
+    companion object {
+        init {
+            System.loadLibrary("opengl_renderer_jni")
+        }
+
+        @JvmStatic private external fun create(): Long
+
+        @JvmStatic private external fun destroy(nativeProjector: Long)
+
+        @JvmStatic
+        private external fun setPois(
+            nativeProjector: Long,
+            latitudes: DoubleArray,
+            longitudes: DoubleArray,
+            altitudes: DoubleArray
+        )
+
+        @JvmStatic
+        private external fun project(
+            nativeProjector: Long,
+            latitude: Double,
+            longitude: Double,
+            altitude: Double,
+            xSin: Float,
+            xCos: Float,
+            ySin: Float,
+            yCos: Float,
+            screenRotationSin: Float,
+            screenRotationCos: Float,
+            screenWidth: Float,
+            screenHeight: Float,
+            screenX: FloatArray,
+            screenY: FloatArray
+        ): Int
+    }
+}
@@ -0,0 +1,127 @@
+package com.lookaround.core.android.ar.renderer
+
+import android.graphics.RectF
+import com.lookaround.core.android.ar.marker.ARMarker
+import java.io.Closeable
+
+/**
+ * Native screen space clustering of markers into cards on a uniform grid of card sized cells, so
+ * the number of drawn cards is bounded by the size of the view rather than by the number of
+ * POIs. Markers keep their cluster until they move well past its cell, so clusters do not
+ * flicker when markers jitter around a cell edge.
+ */
+class MarkerClusterer : Closeable {
+    private var nativeClusterer: Long = create()
+    private var ids = LongArray(0)
+    private var x = FloatArray(0)
+    private var y = FloatArray(0)
+    private var rectsCoordinates = FloatArray(0)
+    private var memberCounts = IntArray(0)
+
+    /** Cluster of each marker of the last [cluster] call, [NO_CLUSTER] if it is not drawn. */
+    var markerClusters = IntArray(0)
+        private set
+
+    var clustersCount: Int = 0
+        private set
+
+    fun setCardSize(width: Float, height: Float, cornerRadius: Float) {
+        check(nativeClusterer != 0L) { "MarkerClusterer is closed." }
+        setCardSize(nativeClusterer, width, height, cornerRadius)
+    }
+
+    /**
+     * Clusters [markers] at their screen positions, skipping those which are not drawn.
+     *
+     * @return number of clusters on screen.
+     */
+    fun cluster(markers: List<ARMarker>, viewWidth: Float, viewHeight: Float): Int {
+        check(nativeClusterer != 0L) { "MarkerClusterer is closed." }
+        val count = markers.size
+        if (ids.size < count) {
+            ids = LongArray(count)
+            x = FloatArray(count)
+            y = FloatArray(count)
+            rectsCoordinates = FloatArray(count * COORDINATES_PER_RECT)
+            memberCounts = IntArray(count)
+            markerClusters = IntArray(count)
+        }
+        markers.forEachIndexed { index, marker ->
+            val id = marker.wrapped.id
+            ids[index] = id.mostSignificantBits xor id.leastSignificantBits
+            x[index] = if (marker.isDrawn) marker.x else Float.NaN
+            y[index] = if (marker.isDrawn) marker.y else Float.NaN
+        }
+        clustersCount =
+            cluster(
+                nativeClusterer,
+                ids,
+                x,
+                y,
+                count,
+                viewWidth,
+                viewHeight,
+                rectsCoordinates,
+                memberCounts,
+                markerClusters
+            )
+        return clustersCount
+    }
+
+    /** Card of [cluster], in the coordinates of the view. */
+    fun rectOf(cluster: Int, rect: RectF = RectF()): RectF {
+        val index = cluster * COORDINATES_PER_RECT
+        val left = rectsCoordinates[index]
+        val bottom = rectsCoordinates[index + 1]
+        rect.set(
+            left,
+            bottom - rectsCoordinates[index + 3],
+            left + rectsCoordinates[index + 2],
+            bottom
+        )
+        return rect
+    }
+
+    fun memberCountOf(cluster: Int): Int = memberCounts[cluster]
+
+    override fun close() {
+        if (nativeClusterer == 0L) return
+        destroy(nativeClusterer)
+        nativeClusterer = 0L
+    }
+
+    companion object {
+        init {
+            System.loadLibrary("opengl_renderer_jni")
+        }
+
+        const val NO_CLUSTER = -1
+        private const val COORDINATES_PER_RECT = 5
+
+        @JvmStatic private external fun create(): Long
+
+        @JvmStatic private external fun destroy(nativeClusterer: Long)
+
+        @JvmStatic
+        private external fun setCardSize(
+            nativeClusterer: Long,
+            width: Float,
+            height: Float,
+            cornerRadius: Float
+        )
+
+        @JvmStatic
+        private external fun cluster(
+            nativeClusterer: Long,
+            ids: LongArray,
+            x: FloatArray,
+            y: FloatArray,
+            count: Int,
+            viewWidth: Float,
+            viewHeight: Float,
+            rectsCoordinates: FloatArray,
+            memberCounts: IntArray,
+            markerClusters: IntArray
+        ): Int
+    }
+}
@@ -0,0 +1,83 @@
+package com.lookaround.core.android.ar.renderer
+
+import android.graphics.RectF
+import java.io.Closeable
+
+/**
+ * Native uniform grid over rounded marker rects for hit testing and visibility queries without
+ * scanning every rect. Rects later in the list are on top of earlier ones.
+ */
+class MarkerRectIndex : Closeable {
+    private var nativeIndex: Long = create()
+    private var rectsCoordinates = FloatArray(0)
+
+    var rectsCount: Int = 0
+        private set
+
+    fun setRects(rects: List<RectF>, cornerRadius: Float) {
+        check(nativeIndex != 0L) { "MarkerRectIndex is closed." }
+        if (rectsCoordinates.size < rects.size * COORDINATES_PER_RECT) {
+            rectsCoordinates = FloatArray(rects.size * COORDINATES_PER_RECT)
+        }
+        var index = 0
+        for (rect in rects) {
+            rectsCoordinates[index++] = rect.left
+            rectsCoordinates[index++] = rect.bottom
+            rectsCoordinates[index++] = rect.width()
+            rectsCoordinates[index++] = rect.height()
+            rectsCoordinates[index++] = cornerRadius
+        }
+        rectsCount = rects.size
+        update(nativeIndex, rectsCoordinates, rectsCount)
+    }
+
+    /** @return index of the topmost rect containing the point or [NO_RECT]. */
+    fun hitTest(x: Float, y: Float): Int {
+        check(nativeIndex != 0L) { "MarkerRectIndex is closed." }
+        return hitTest(nativeIndex, x, y)
+    }
+
+    /**
+     * Fills [out] (at least [rectsCount] long) with indices of rects which are on screen and not
+     * fully covered by another rect on top.
+     *
+     * @return number of visible rects.
+     */
+    fun queryVisible(viewportWidth: Float, viewportHeight: Float, out: IntArray): Int {
+        check(nativeIndex != 0L) { "MarkerRectIndex is closed." }
+        require(out.size >= rectsCount)
+        return queryVisible(nativeIndex, viewportWidth, viewportHeight, out)
+    }
+
+    override fun close() {
+        if (nativeIndex == 0L) return
+        destroy(nativeIndex)
+        nativeIndex = 0L
+    }
+
+    companion object {
+        init {
+            System.loadLibrary("opengl_renderer_jni")
+        }
+
+        const val NO_RECT = -1
+        private const val COORDINATES_PER_RECT = 5
+
+        @JvmStatic private external fun create(): Long
+
+        @JvmStatic private external fun destroy(nativeIndex: Long)
+
+        @JvmStatic
+        private external fun update(nativeIndex: Long, rectsCoordinates: FloatArray, rectsCount: Int)
+
+        @JvmStatic private external fun hitTest(nativeIndex: Long, x: Float, y: Float): Int
+
+        @JvmStatic
+        private external fun queryVisible(
+            nativeIndex: Long,
+            viewportWidth: Float,
+            viewportHeight: Float,
+            visible: IntArray
+        ): Int
+    }
+}
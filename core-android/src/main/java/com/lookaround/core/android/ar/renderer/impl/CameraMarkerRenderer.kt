@@ -5,25 +5,35 @@ import android.content.res.Configuration
 import android.graphics.*
 import android.location.Location
 import android.os.Bundle
+import android.text.Layout
+import android.text.StaticLayout
 import android.text.TextPaint
 import android.text.TextUtils
 import androidx.annotation.MainThread
 import androidx.core.os.bundleOf
 import com.lookaround.core.android.ar.marker.ARMarker
 import com.lookaround.core.android.ar.orientation.Orientation
+import com.lookaround.core.android.ar.renderer.MarkerClusterer
 import com.lookaround.core.android.ar.renderer.MarkerRenderer
+import com.lookaround.core.android.camera.OpenGLRenderer
 import com.lookaround.core.android.ext.*
+import com.lookaround.core.android.model.placeType
+import com.lookaround.core.android.model.placeTypeDrawables
+import java.io.Closeable
 import java.util.*
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.MutableStateFlow
 
-class CameraMarkerRenderer(context: Context) : MarkerRenderer {
+class CameraMarkerRenderer(context: Context) : MarkerRenderer, Closeable {
     private val screenOrientation: Int = context.resources.configuration.orientation
 
     private val markerPaddingPx: Float = context.dpToPx(MARKER_PADDING_DP)
     private val markerTitleTextSizePx: Float = context.spToPx(MARKER_TITLE_TEXT_SIZE_SP)
     private val markerDistanceTextSizePx: Float = context.spToPx(MARKER_DISTANCE_TEXT_SIZE_SP)
 
+    /** Size of the category icons drawn on markers, which their atlas is scaled to. */
+    val markerIconSizePx: Float = context.dpToPx(MARKER_ICON_SIZE_DP)
+
     override val markerHeightPx: Float
     override val markerWidthPx: Float
 
@@ -71,9 +81,56 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
     private val drawnRectsStateFlow = MutableStateFlow<List<RectF>>(emptyList())
     val drawnRectsFlow: Flow<List<RectF>>
         get() = drawnRectsStateFlow
+    internal val drawnRects: List<RectF>
+        get() = drawnRectsStateFlow.value
+
+    /** Markers drawn in the last frame, in the same order as [drawnRects]. */
+    internal var drawnMarkers: List<ARMarker> = emptyList()
+        private set
 
     var disabled: Boolean = false
-        @MainThread set
+        @MainThread
+        set(value) {
+            field = value
+            if (value) clearLayers()
+        }
+
+    /**
+     * Draws the category icons of markers as sprites on top of the preview, from an atlas packed
+     * in the order of [placeTypeDrawables], and their texts as labels once its glyphs are loaded.
+     */
+    var openGLRenderer: OpenGLRenderer? = null
+        @MainThread
+        set(value) {
+            if (value == null) clearLayers()
+            field = value
+        }
+    private val markerIconIndices = HashMap<UUID, Int>()
+    private val sprites = LayerFloats(OpenGLRenderer.SPRITE_COMPONENTS)
+    private val labels = LayerFloats(OpenGLRenderer.LABEL_COMPONENTS)
+    private var labelsEnabled = false
+    // Texts are only ever appended between marker updates, as labels refer to them by index.
+    private val labelTexts = ArrayList<String>()
+    private val labelTextIndices = HashMap<String, Int>()
+    private var pushedLabelTextsCount = 0
+    private val titleLabelLines = HashMap<TitleLabelKey, List<TitleLabelLine>>()
+
+    /**
+     * Whether markers are drawn at their projected positions, merging those close on screen into
+     * cluster cards titled after their nearest marker, instead of paged into rows. Keeps the
+     * number of drawn rects bounded by the size of the view however dense the markers are. On
+     * once the cards of drawn markers would cover the view [CLUSTERING_ENABLE_COVERAGE] times,
+     * off again below [CLUSTERING_DISABLE_COVERAGE], so it does not flip as markers come and go.
+     */
+    private var clusteringEnabled: Boolean = false
+        set(value) {
+            field = value
+            if (!value) {
+                markerClusterer?.close()
+                markerClusterer = null
+            }
+        }
+    private var markerClusterer: MarkerClusterer? = null
 
     private val pagedMarkers = HashMap<UUID, PagedMarker>()
     private val pagedMarkerPositions = TreeMap<Float, MutableSet<PagedPosition>>()
@@ -121,9 +178,16 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
 
     override fun draw(markers: List<ARMarker>, canvas: Canvas, orientation: Orientation) {
         if (disabled) return
+        beginLayers()
+        updateClusteringEnabled(markers, canvas)
+        if (clusteringEnabled) {
+            drawClustered(markers, canvas)
+            return
+        }
 
         pagedMarkerPositions.clear()
         val drawnRects = mutableListOf<RectF>()
+        val drawnMarkers = mutableListOf<ARMarker>()
         val drawnMarkerIds = HashSet<UUID>()
         var maxPageThisFrame = 0
         var currentPageAfterScreenRotation = Int.MAX_VALUE
@@ -155,10 +219,10 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
             val canvasRect = RectF(0f, 0f, canvas.width.toFloat(), canvas.height.toFloat())
             if (!RectF.intersects(canvasRect, markerRect)) return
 
-            canvas.drawTitleText(marker, markerRect)
-            canvas.drawDistanceText(marker, markerRect)
+            canvas.drawCard(marker, marker.wrapped.name, markerRect)
 
             drawnRects.add(markerRect)
+            drawnMarkers.add(marker)
         }
 
         val (lastDrawnMarkers, newlyAppearedMarkers) =
@@ -168,6 +232,7 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
             }
         lastDrawnMarkers.forEach { drawMarker(it, lastDrawn = true) }
         newlyAppearedMarkers.forEach { drawMarker(it, lastDrawn = false) }
+        pushLayers()
 
         maxPage = maxPageThisFrame
         if (firstFrame) currentPage = currentPageAfterScreenRotation
@@ -176,9 +241,78 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
         lastDrawnMarkerIds = drawnMarkerIds
         markersDrawnStateFlow.value = MarkersDrawn(currentPage, maxPage)
         drawnRectsStateFlow.value = drawnRects
+        this.drawnMarkers = drawnMarkers
         firstFrame = false
     }
 
+    private fun updateClusteringEnabled(markers: List<ARMarker>, canvas: Canvas) {
+        val viewArea = canvas.width.toFloat() * canvas.height.toFloat()
+        if (viewArea <= 0f) return
+        val coverage = markers.count(ARMarker::isDrawn) * markerWidthPx * markerHeightPx / viewArea
+        if (!clusteringEnabled && coverage > CLUSTERING_ENABLE_COVERAGE) {
+            clusteringEnabled = true
+        } else if (clusteringEnabled && coverage < CLUSTERING_DISABLE_COVERAGE) {
+            clusteringEnabled = false
+            // Pages the markers anew, showing the page of those drawn while clustered.
+            firstFrame = true
+        }
+    }
+
+    private fun drawClustered(markers: List<ARMarker>, canvas: Canvas) {
+        val clusterer =
+            markerClusterer
+                ?: MarkerClusterer().also {
+                    it.setCardSize(
+                        markerWidthPx,
+                        markerHeightPx,
+                        OpenGLRenderer.MARKER_RECT_CORNER_RADIUS
+                    )
+                    markerClusterer = it
+                }
+        val clustersCount =
+            clusterer.cluster(markers, canvas.width.toFloat(), canvas.height.toFloat())
+
+        // The nearest marker of a cluster stands for it, on its card and when pressed.
+        val nearestMarkers = arrayOfNulls<ARMarker>(clustersCount)
+        markers.forEachIndexed { index, marker ->
+            val cluster = clusterer.markerClusters[index]
+            if (cluster == MarkerClusterer.NO_CLUSTER) return@forEachIndexed
+            val nearest = nearestMarkers[cluster]
+            if (nearest == null || marker.distance < nearest.distance) {
+                nearestMarkers[cluster] = marker
+            }
+        }
+
+        val drawnRects = ArrayList<RectF>(clustersCount)
+        val drawnMarkers = ArrayList<ARMarker>(clustersCount)
+        for (cluster in 0 until clustersCount) {
+            val marker = nearestMarkers[cluster] ?: continue
+            val rect = clusterer.rectOf(cluster)
+            val othersCount = clusterer.memberCountOf(cluster) - 1
+            canvas.drawCard(
+                marker,
+                if (othersCount > 0) "${marker.wrapped.name} +$othersCount"
+                else marker.wrapped.name,
+                rect
+            )
+            drawnRects.add(rect)
+            drawnMarkers.add(marker)
+        }
+        pushLayers()
+
+        currentPage = 0
+        maxPage = 0
+        lastDrawnMarkerIds = drawnMarkers.mapTo(HashSet()) { it.wrapped.id }
+        markersDrawnStateFlow.value = MarkersDrawn(currentPage, maxPage)
+        drawnRectsStateFlow.value = drawnRects
+        this.drawnMarkers = drawnMarkers
+    }
+
+    override fun close() {
+        markerClusterer?.close()
+        markerClusterer = null
+    }
+
     override fun onSaveInstanceState(): Bundle =
         bundleOf(SavedStateKeys.LAST_DRAWN_MARKER_IDS.name to lastDrawnMarkerIds)
 
@@ -197,13 +331,15 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
             return
         }
         pagedMarkers.clear()
+        markerIconIndices.clear()
+        labelTexts.clear()
+        labelTextIndices.clear()
+        pushedLabelTextsCount = -1
+        titleLabelLines.clear()
         markers.forEach { marker -> pagedMarkers[marker.wrapped.id] = PagedMarker(marker) }
         currentPage = 0
     }
 
-    internal fun isOnCurrentPage(marker: ARMarker): Boolean =
-        pagedMarkers[marker.wrapped.id]?.pagedPosition?.page == currentPage
-
     private fun pagedPositionOf(
         pagedMarker: PagedMarker,
         requireAlreadyCalculated: Boolean
@@ -250,36 +386,196 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
             ?: run { pagedMarkerPositions[marker.wrapped.x] = mutableSetOf(pagedPosition) }
     }
 
-    private fun Canvas.drawTitleText(marker: ARMarker, rect: RectF) {
+    private val ARMarker.iconIndex: Int
+        get() =
+            markerIconIndices.getOrPut(wrapped.id) {
+                wrapped.placeType?.let(PLACE_TYPE_ICON_INDICES::get) ?: NO_ICON
+            }
+
+    private fun Canvas.drawCard(marker: ARMarker, title: String, rect: RectF) {
+        val withIcon = addIconSprite(marker, rect)
+        if (labelsEnabled) {
+            addTitleLabels(title, rect, withIcon)
+            addDistanceLabel(marker, rect)
+        } else {
+            drawTitleText(title, rect, withIcon)
+            drawDistanceText(marker, rect)
+        }
+    }
+
+    private fun beginLayers() {
+        sprites.clear()
+        labels.clear()
+        labelsEnabled = openGLRenderer?.labelGlyphsLoaded == true
+    }
+
+    private fun pushLayers() {
+        val renderer = openGLRenderer ?: return
+        sprites.pushIfChanged(renderer::setSprites)
+        // Texts go first, the renderer applies both in order.
+        if (labelTexts.size != pushedLabelTextsCount) {
+            renderer.setLabelTexts(labelTexts.toList())
+            pushedLabelTextsCount = labelTexts.size
+        }
+        labels.pushIfChanged(renderer::setLabels)
+    }
+
+    private fun clearLayers() {
+        beginLayers()
+        pushLayers()
+    }
+
+    // Icons go in the top right corner of the cards, next to their titles.
+    private fun addIconSprite(marker: ARMarker, rect: RectF): Boolean {
+        if (openGLRenderer == null) return false
+        val iconIndex = marker.iconIndex
+        if (iconIndex == NO_ICON) return false
+        val offset = sprites.add()
+        with(sprites.floats) {
+            set(offset, rect.right - markerPaddingPx - markerIconSizePx / 2)
+            set(offset + 1, rect.top + markerPaddingPx + markerIconSizePx / 2)
+            set(offset + 2, markerIconSizePx)
+            set(offset + 3, 1f)
+            set(offset + 4, iconIndex.toFloat())
+        }
+        return true
+    }
+
+    private fun addTitleLabels(title: String, rect: RectF, withIcon: Boolean) {
+        val width = titleWidth(rect, withIcon)
+        titleLabelLines
+            .getOrPut(TitleLabelKey(title, width)) { titleLabelLinesOf(title, width) }
+            .forEach { line ->
+                addLabel(
+                    textIndex = line.textIndex,
+                    left = rect.left + markerPaddingPx + line.left,
+                    baseline = rect.top + markerPaddingPx + line.baseline,
+                    textSize = titleTextPaint.textSize
+                )
+            }
+    }
+
+    // Breaks and ellipsizes titles the same way drawMultilineText does.
+    private fun titleLabelLinesOf(title: String, width: Int): List<TitleLabelLine> {
+        val layout =
+            StaticLayout.Builder.obtain(title, 0, title.length, titleTextPaint, width)
+                .setEllipsize(TextUtils.TruncateAt.END)
+                .setMaxLines(2)
+                .setBreakStrategy(Layout.BREAK_STRATEGY_SIMPLE)
+                .setHyphenationFrequency(Layout.HYPHENATION_FREQUENCY_NONE)
+                .build()
+        return (0 until layout.lineCount).map { line ->
+            val start = layout.getLineStart(line)
+            val text =
+                if (layout.getEllipsisCount(line) > 0) {
+                    title.substring(start, start + layout.getEllipsisStart(line)).trimEnd() +
+                        ELLIPSIS
+                } else {
+                    title.substring(start, layout.getLineEnd(line)).trimEnd()
+                }
+            TitleLabelLine(
+                textIndex = labelTextIndexOf(text),
+                left = layout.getLineLeft(line),
+                baseline = layout.getLineBaseline(line).toFloat()
+            )
+        }
+    }
+
+    private fun addDistanceLabel(marker: ARMarker, rect: RectF) {
+        addLabel(
+            textIndex = labelTextIndexOf(ellipsizedDistanceOf(marker, rect).toString()),
+            left = rect.left + markerPaddingPx,
+            baseline = rect.bottom - markerPaddingPx,
+            textSize = distanceTextPaint.textSize
+        )
+    }
+
+    private fun addLabel(textIndex: Int, left: Float, baseline: Float, textSize: Float) {
+        val offset = labels.add()
+        with(labels.floats) {
+            set(offset, left)
+            set(offset + 1, baseline)
+            set(offset + 2, textSize)
+            set(offset + 3, 1f)
+            set(offset + 4, textIndex.toFloat())
+        }
+    }
+
+    private fun labelTextIndexOf(text: String): Int =
+        labelTextIndices.getOrPut(text) {
+            labelTexts.add(text)
+            labelTexts.lastIndex
+        }
+
+    private fun titleWidth(rect: RectF, withIcon: Boolean): Int {
+        val iconWidth = if (withIcon) markerIconSizePx + markerPaddingPx else 0f
+        return (rect.width() - MARKER_PADDING_DP * 2 - ELLIPSIS_WIDTH_PX - iconWidth).toInt()
+    }
+
+    private fun Canvas.drawTitleText(title: String, rect: RectF, withIcon: Boolean) {
         drawMultilineText(
-            text = marker.wrapped.name,
+            text = title,
             textPaint = titleTextPaint,
-            width = (rect.width() - MARKER_PADDING_DP * 2 - ELLIPSIS_WIDTH_PX).toInt(),
-            x = marker.x - markerWidthPx / 2 + markerPaddingPx,
-            y = marker.y - markerHeightPx / 2 + markerPaddingPx,
+            width = titleWidth(rect, withIcon),
+            x = rect.left + markerPaddingPx,
+            y = rect.top + markerPaddingPx,
             ellipsize = TextUtils.TruncateAt.END,
             maxLines = 2,
         )
     }
 
+    private fun ellipsizedDistanceOf(marker: ARMarker, rect: RectF): CharSequence =
+        TextUtils.ellipsize(
+            marker.distance.preciseFormattedDistance,
+            distanceTextPaint,
+            rect.width() - MARKER_PADDING_DP * 2 - ELLIPSIS_WIDTH_PX,
+            TextUtils.TruncateAt.END
+        )
+
     private fun Canvas.drawDistanceText(marker: ARMarker, rect: RectF) {
-        val distance =
-            TextUtils.ellipsize(
-                marker.distance.preciseFormattedDistance,
-                distanceTextPaint,
-                rect.width() - MARKER_PADDING_DP * 2 - ELLIPSIS_WIDTH_PX,
-                TextUtils.TruncateAt.END
-            )
+        val distance = ellipsizedDistanceOf(marker, rect)
         drawText(
             distance,
             0,
             distance.length,
-            marker.x - markerWidthPx / 2 + markerPaddingPx,
-            marker.y + markerHeightPx / 2 - markerPaddingPx,
+            rect.left + markerPaddingPx,
+            rect.bottom - markerPaddingPx,
             distanceTextPaint
         )
     }
 
+    // Floats of a GL layer, pushed only when they changed as every update draws the output again.
+    private class LayerFloats(private val components: Int) {
+        var floats = FloatArray(0)
+            private set
+        private var count = 0
+        private var pushed = FloatArray(0)
+
+        fun clear() {
+            count = 0
+        }
+
+        /** Grows [floats] by one element and returns its offset. */
+        fun add(): Int {
+            val offset = count++ * components
+            if (floats.size < offset + components) {
+                floats = floats.copyOf(maxOf(floats.size * 2, offset + components))
+            }
+            return offset
+        }
+
+        fun pushIfChanged(push: (FloatArray, Int) -> Unit) {
+            val size = count * components
+            if (pushed.size == size && (0 until size).all { pushed[it] == floats[it] }) return
+            pushed = floats.copyOf(size)
+            push(pushed, count)
+        }
+    }
+
+    private data class TitleLabelKey(val title: String, val width: Int)
+
+    private class TitleLabelLine(val textIndex: Int, val left: Float, val baseline: Float)
+
     private class PagedMarker(
         val wrapped: ARMarker,
         var pagedPosition: PagedPosition? = null,
@@ -309,5 +605,13 @@ class CameraMarkerRenderer(context: Context) : MarkerRenderer {
         private const val ELLIPSIS_WIDTH_PX = 10f
         private const val MARKER_TITLE_TEXT_SIZE_SP = 16f
         private const val MARKER_DISTANCE_TEXT_SIZE_SP = 14f
+        private const val MARKER_ICON_SIZE_DP = 24f
+        private const val CLUSTERING_ENABLE_COVERAGE = 1f
+        private const val CLUSTERING_DISABLE_COVERAGE = .5f
+
+        private const val NO_ICON = -1
+        private const val ELLIPSIS = "\u2026"
+        private val PLACE_TYPE_ICON_INDICES =
+            placeTypeDrawables.keys.withIndex().associate { (index, type) -> type to index }
     }
 }
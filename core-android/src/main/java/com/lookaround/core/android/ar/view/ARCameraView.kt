@@ -9,19 +9,20 @@ import android.view.MotionEvent
 import androidx.annotation.MainThread
 import com.lookaround.core.android.ar.marker.ARMarker
 import com.lookaround.core.android.ar.math3d.*
+import com.lookaround.core.android.ar.renderer.MarkerRectIndex
 import com.lookaround.core.android.ar.renderer.impl.CameraMarkerRenderer
-import kotlin.math.abs
-import kotlin.math.pow
-import kotlin.math.sqrt
+import com.lookaround.core.android.camera.OpenGLRenderer
 
 class ARCameraView : ARView<CameraMarkerRenderer> {
     private val camTrig = Trig3()
-    private val camPos = Vector3()
-    private val screenRatio = Vector3()
     private val screenSize = Vector2()
     private val screenRot = Vector1()
     private val screenRotTrig = Trig1()
 
+    private var poiProjector: PoiProjector? = null
+    private var projectedMarkers: List<ARMarker>? = null
+    private var markerRectIndex: MarkerRectIndex? = null
+
     override var povLocation: Location?
         get() = super.povLocation
         @MainThread
@@ -46,14 +47,7 @@ class ARCameraView : ARView<CameraMarkerRenderer> {
         defStyle: Int
     ) : super(context, attrs, defStyle)
 
-    init {
-        screenRatio.z = SCREEN_DEPTH.toDouble()
-    }
-
     override fun preDraw(canvas: Canvas, location: Location) {
-        // For the moment we set a square as ratio. Size is arithmetic mean of width and height
-        screenRatio.y = ((width + height).toFloat() / 2).toDouble()
-        screenRatio.x = ((width + height).toFloat() / 2).toDouble()
         // Get the current size of the window
         screenSize.y = height.toDouble()
         screenSize.x = width.toDouble()
@@ -61,45 +55,54 @@ class ARCameraView : ARView<CameraMarkerRenderer> {
         // and rotation
         val camRot = Vector3()
         Math3D.getCamRotation(orientation, phoneRotation, camRot, camTrig, screenRot, screenRotTrig)
-        // Transform current camera location into a position object;
-        Math3D.convertLocationToPosition(location, camPos)
     }
 
-    override fun calculateMarkerScreenPosition(marker: ARMarker, location: Location) {
-        val markerPos = Vector3()
-        // Transform marker Location into a Position object
-        Math3D.convertLocationToPosition(marker.wrapped.location, markerPos)
-        // Calculate relative position to the camera. Transforms angles of latitude and longitude
-        // into meters of distance.
-        val relativePos = Vector3()
-        Math3D.getRelativeTranslationInMeters(markerPos, camPos, relativePos)
-        // Rotates the marker around the camera in order to set the camera rotation to <0,0,0>
-        val relativeRotPos = Vector3()
-        Math3D.getRelativeRotation(relativePos, camTrig, relativeRotPos)
-        // Converts a 3d position into a 2d position on screen
-        val screenPos = Vector2()
-        val drawn =
-            Math3D.convert3dTo2d(relativeRotPos, screenSize, screenRatio, screenRotTrig, screenPos)
-        // If drawn is false, the marker is behind us, so no need to paint
-        if (drawn) {
-            marker.x = screenPos.x.toFloat()
-            marker.y = screenPos.y.toFloat()
+    override fun calculateMarkerScreenPositions(markers: List<ARMarker>, location: Location) {
+        val projector = poiProjector ?: PoiProjector().also { poiProjector = it }
+        if (projectedMarkers !== markers) {
+            projector.setPois(markers.map { it.wrapped.location })
+            projectedMarkers = markers
+        }
+        projector.project(
+            location,
+            camTrig,
+            screenRotTrig,
+            screenSize.x.toFloat(),
+            screenSize.y.toFloat()
+        )
+        markers.forEachIndexed { index, marker ->
+            val screenX = projector.screenX[index]
+            // NaN if the marker is behind us (or too far to the side), so no need to paint
+            val drawn = !screenX.isNaN()
+            if (drawn) {
+                marker.x = screenX
+                marker.y = projector.screenY[index]
+            }
+            marker.isDrawn = drawn
         }
-        marker.isDrawn = drawn
     }
 
-    override fun postDraw(canvas: Canvas, location: Location) = Unit
+    override fun postDraw(canvas: Canvas, location: Location) {
+        val markerRenderer = this.markerRenderer ?: return
+        val index = markerRectIndex ?: MarkerRectIndex().also { markerRectIndex = it }
+        index.setRects(markerRenderer.drawnRects, OpenGLRenderer.MARKER_RECT_CORNER_RADIUS)
+    }
+
+    override fun onDetachedFromWindow() {
+        super.onDetachedFromWindow()
+        poiProjector?.close()
+        poiProjector = null
+        projectedMarkers = null
+        markerRectIndex?.close()
+        markerRectIndex = null
+    }
 
     @SuppressLint("ClickableViewAccessibility")
     override fun onTouchEvent(event: MotionEvent): Boolean {
         val markerPressed =
             onMarkerPressed?.let { listener ->
                 if (event.action != MotionEvent.ACTION_DOWN) return@let false
-                val pressedMarker =
-                    findNearestMarker(event.x, event.y)?.takeIf { marker ->
-                        abs(marker.x - event.x) < markerWidth / 2 &&
-                            abs(marker.y - event.y) < markerHeight / 2
-                    }
+                val pressedMarker = findPressedMarker(event.x, event.y)
                 if (pressedMarker != null) {
                     listener(pressedMarker)
                     true
@@ -112,14 +115,8 @@ class ARCameraView : ARView<CameraMarkerRenderer> {
         return super.onTouchEvent(event)
     }
 
-    private fun findNearestMarker(x: Float, y: Float): ARMarker? =
-        markers
-            .filter { marker -> marker.isDrawn && markerRenderer?.isOnCurrentPage(marker) ?: true }
-            .minByOrNull { marker ->
-                sqrt((marker.x - x).toDouble().pow(2.0) + (marker.y - y).toDouble().pow(2.0))
-            }
-
-    companion object {
-        private const val SCREEN_DEPTH = 1
+    private fun findPressedMarker(x: Float, y: Float): ARMarker? {
+        val index = markerRectIndex?.hitTest(x, y) ?: return null
+        return markerRenderer?.drawnMarkers?.getOrNull(index)
     }
 }
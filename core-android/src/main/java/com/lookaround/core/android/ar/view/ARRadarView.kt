@@ -43,7 +43,11 @@ class ARRadarView : ARView<RadarMarkerRenderer> {
         setMeasuredDimension(size, size)
     }
 
-    override fun calculateMarkerScreenPosition(marker: ARMarker, location: Location) {
+    override fun calculateMarkerScreenPositions(markers: List<ARMarker>, location: Location) {
+        markers.forEach { marker -> calculateMarkerScreenPosition(marker, location) }
+    }
+
+    private fun calculateMarkerScreenPosition(marker: ARMarker, location: Location) {
         val markerAngle = getAngleBetween(marker, location) + compassAngle
         val pixelDistance = marker.distance * center / maxRange
         val markerY = center - pixelDistance * sin(markerAngle)
@@ -69,13 +69,16 @@ abstract class ARView<R : MarkerRenderer> : View {
         val povLocation = this.povLocation ?: return
         preDraw(canvas, povLocation)
         val markerRenderer = this.markerRenderer ?: return
-        markers.forEach { marker -> calculateMarkerScreenPosition(marker, povLocation) }
+        calculateMarkerScreenPositions(markers, povLocation)
         markerRenderer.draw(markers.filter { it.shouldBeDrawn }, canvas, orientation)
         postDraw(canvas, povLocation)
     }
 
     protected abstract fun preDraw(canvas: Canvas, location: Location)
-    protected abstract fun calculateMarkerScreenPosition(marker: ARMarker, location: Location)
+    protected abstract fun calculateMarkerScreenPositions(
+        markers: List<ARMarker>,
+        location: Location
+    )
     protected abstract fun postDraw(canvas: Canvas, location: Location)
 
     private fun calculateDistancesBetween(location: Location, markers: List<ARMarker>) {
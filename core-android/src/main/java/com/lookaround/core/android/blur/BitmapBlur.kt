@@ -0,0 +1,164 @@
+package com.lookaround.core.android.blur
+
+import android.graphics.Bitmap
+import androidx.annotation.ColorInt
+import java.io.Closeable
+import java.nio.ByteBuffer
+import java.util.concurrent.Executors
+import kotlin.math.max
+import kotlin.math.min
+import kotlinx.coroutines.asCoroutineDispatcher
+import kotlinx.coroutines.withContext
+
+/**
+ * Blurs bitmaps off screen on the GPU, with the summed-area table blur of the camera renderer in
+ * an EGL context of its own. Inputs are downsampled through their mipmaps on the GPU too, so a
+ * blur costs an upload and the readback of a small bitmap instead of a blur on the CPU.
+ *
+ * Blurs run one at a time on a thread of the instance. Needs OpenGL ES 3.1, without it every
+ * blur returns null and callers fall back to a CPU blur.
+ */
+class BitmapBlur : Closeable {
+    private val dispatcher =
+        Executors.newSingleThreadExecutor { Thread(it, "BitmapBlur") }.asCoroutineDispatcher()
+
+    // Written on the thread of dispatcher only.
+    @Volatile private var nativeBlur: Long = 0L
+    @Volatile private var closed = false
+
+    init {
+        dispatcher.executor.execute { nativeBlur = create() }
+    }
+
+    class Result(val bitmap: Bitmap, @ColorInt val dominantColor: Int?)
+
+    /**
+     * @param downsampleFactor power of 2 the size of the result is divided by, lowered for
+     * bitmaps too small for it.
+     * @param sigma of the gaussian approximated, in pixels of the result.
+     * @return null if the blur is not supported or failed.
+     */
+    suspend fun blur(
+        bitmap: Bitmap,
+        downsampleFactor: Int = DEFAULT_DOWNSAMPLE_FACTOR,
+        sigma: Float = DEFAULT_SIGMA,
+        extractDominantColor: Boolean = false
+    ): Result? {
+        val input =
+            if (bitmap.config == Bitmap.Config.ARGB_8888) bitmap
+            else bitmap.copy(Bitmap.Config.ARGB_8888, false) ?: return null
+        return blurInto(input.width, input.height, downsampleFactor, extractDominantColor) {
+            nativeBlur,
+            levels,
+            output ->
+            blurBitmap(nativeBlur, input, levels, sigma, output)
+        }
+    }
+
+    /**
+     * Blurs RGBA pixels of a direct [buffer], rows of [width] pixels [rowStride] bytes apart.
+     *
+     * @see blur
+     */
+    suspend fun blur(
+        buffer: ByteBuffer,
+        width: Int,
+        height: Int,
+        rowStride: Int = width * 4,
+        downsampleFactor: Int = DEFAULT_DOWNSAMPLE_FACTOR,
+        sigma: Float = DEFAULT_SIGMA,
+        extractDominantColor: Boolean = false
+    ): Result? {
+        require(buffer.isDirect) { "Only direct buffers can be blurred." }
+        return blurInto(width, height, downsampleFactor, extractDominantColor) {
+            nativeBlur,
+            levels,
+            output ->
+            blurBuffer(nativeBlur, buffer, width, height, rowStride, levels, sigma, output)
+        }
+    }
+
+    private suspend fun blurInto(
+        width: Int,
+        height: Int,
+        downsampleFactor: Int,
+        extractDominantColor: Boolean,
+        blur: (nativeBlur: Long, levels: Int, output: Bitmap) -> Boolean
+    ): Result? {
+        require(downsampleFactor > 0 && downsampleFactor and (downsampleFactor - 1) == 0) {
+            "Downsample factor must be a power of 2."
+        }
+        if (closed || width <= 0 || height <= 0) return null
+        // The mip chain ends at 1x1.
+        val levels =
+            min(
+                Integer.numberOfTrailingZeros(downsampleFactor),
+                31 - Integer.numberOfLeadingZeros(max(width, height))
+            )
+        val output =
+            Bitmap.createBitmap(
+                max(width shr levels, 1),
+                max(height shr levels, 1),
+                Bitmap.Config.ARGB_8888
+            )
+        return withContext(dispatcher) {
+            val nativeBlur = nativeBlur
+            if (nativeBlur == 0L || !blur(nativeBlur, levels, output)) {
+                output.recycle()
+                return@withContext null
+            }
+            val dominantColor =
+                if (extractDominantColor) dominantColor(output).takeIf { it != 0 } else null
+            Result(output, dominantColor)
+        }
+    }
+
+    override fun close() {
+        if (closed) return
+        closed = true
+        dispatcher.executor.execute {
+            if (nativeBlur != 0L) destroy(nativeBlur)
+            nativeBlur = 0L
+        }
+        // Blurs already queued still run before the native blur is destroyed.
+        dispatcher.close()
+    }
+
+    companion object {
+        const val DEFAULT_DOWNSAMPLE_FACTOR = 8
+        // About the look of a HokoBlur gaussian of radius 10.
+        const val DEFAULT_SIGMA = 4f
+
+        init {
+            System.loadLibrary("opengl_renderer_jni")
+        }
+
+        @JvmStatic private external fun create(): Long
+
+        @JvmStatic private external fun destroy(nativeBlur: Long)
+
+        @JvmStatic
+        private external fun blurBitmap(
+            nativeBlur: Long,
+            input: Bitmap,
+            levels: Int,
+            sigma: Float,
+            output: Bitmap
+        ): Boolean
+
+        @JvmStatic
+        private external fun blurBuffer(
+            nativeBlur: Long,
+            input: ByteBuffer,
+            width: Int,
+            height: Int,
+            rowStride: Int,
+            levels: Int,
+            sigma: Float,
+            output: Bitmap
+        ): Boolean
+
+        /** @return the dominant color as ARGB, 0 if [bitmap] is not ARGB_8888. */
+        @JvmStatic private external fun dominantColor(bitmap: Bitmap): Int
+    }
+}
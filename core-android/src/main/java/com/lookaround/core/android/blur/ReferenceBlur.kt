@@ -0,0 +1,50 @@
+package com.lookaround.core.android.blur
+
+import android.graphics.Bitmap
+import androidx.annotation.WorkerThread
+import com.lookaround.core.android.camera.OpenGLRenderer
+
+/**
+ * The blur of the camera renderer computed on the CPU, vectorized and split across cores: the
+ * same pyramid, kernel and 8 bit targets, so its output matches the renderer's blurred snapshots
+ * (see [OpenGLRenderer.requestBlurredSnapshot]) up to GPU rounding. A fallback for snapshots
+ * where no renderer context could be created, and the reference GPU variants are checked
+ * against.
+ */
+object ReferenceBlur {
+    const val MIN_LOD = -2f
+    const val MAX_LOD = 2f
+
+    init {
+        System.loadLibrary("opengl_renderer_jni")
+    }
+
+    /**
+     * @param level one of OpenGLRenderer.BLURRED_SNAPSHOT_LEVEL_* constants.
+     * @param lod blur strength from [MIN_LOD] (none) to [MAX_LOD] (fully blurred), as animated by
+     * the renderer.
+     * @return null if [bitmap] is too small for the quarter level or could not be read.
+     */
+    @WorkerThread
+    fun blur(
+        bitmap: Bitmap,
+        level: Int = OpenGLRenderer.BLURRED_SNAPSHOT_LEVEL_QUARTER,
+        lod: Float = MAX_LOD
+    ): Bitmap? {
+        val input =
+            if (bitmap.config == Bitmap.Config.ARGB_8888) bitmap
+            else bitmap.copy(Bitmap.Config.ARGB_8888, false) ?: return null
+        val width = input.width shr level
+        val height = input.height shr level
+        if (width <= 0 || height <= 0) return null
+        val output = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+        if (!blur(input, level, lod, output)) {
+            output.recycle()
+            return null
+        }
+        return output
+    }
+
+    @JvmStatic
+    private external fun blur(input: Bitmap, level: Int, lod: Float, output: Bitmap): Boolean
+}
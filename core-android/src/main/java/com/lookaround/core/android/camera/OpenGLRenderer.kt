@@ -1,9 +1,20 @@
 package com.lookaround.core.android.camera
 
 import android.annotation.SuppressLint
+import android.graphics.Bitmap
+import android.graphics.Canvas
+import android.graphics.Color
+import android.graphics.ImageFormat
+import android.graphics.Paint
+import android.graphics.Rect
 import android.graphics.RectF
 import android.graphics.SurfaceTexture
+import android.graphics.Typeface
+import android.hardware.HardwareBuffer
+import android.media.Image
+import android.media.ImageReader
 import android.opengl.Matrix
+import android.os.Build
 import android.os.Process
 import android.util.Size
 import android.view.Surface
@@ -20,6 +31,8 @@ import com.lookaround.core.android.camera.surface.impl.SurfaceViewRenderSurface
 import com.lookaround.core.android.camera.surface.impl.TextureViewRenderSurface
 import com.lookaround.core.android.ext.shouldUseTextureView
 import com.lookaround.core.android.model.RoundedRectF
+import java.io.File
+import java.nio.ByteBuffer
 import java.util.*
 import java.util.concurrent.Executor
 import java.util.concurrent.RejectedExecutionException
@@ -32,7 +45,20 @@ import kotlinx.coroutines.flow.MutableSharedFlow
 import kotlinx.coroutines.flow.MutableStateFlow
 import timber.log.Timber
 
-class OpenGLRenderer {
+/**
+ * @param nativeRenderLoop Draws camera frames on a native thread which owns the EGL context,
+ * instead of on the executor. Late frames are coalesced and presented at times scheduled against
+ * their capture timestamps, and frames do not cross JNI.
+ * @param cacheDir Where the GPU capabilities probed on the first launch on a driver are kept,
+ * along with the fastest blur passes measured for it. Probed on every launch if null.
+ * @param backend Draws camera frames with GL, or with [VulkanRenderer] where the device supports
+ * it. Decided when the first surface arrives. Always GL with [nativeRenderLoop].
+ */
+class OpenGLRenderer(
+    private val nativeRenderLoop: Boolean = false,
+    private val cacheDir: File? = null,
+    private val backend: RendererBackend = RendererBackend.Gl
+) {
     companion object {
         init {
             System.loadLibrary("opengl_renderer_jni")
@@ -43,6 +69,35 @@ class OpenGLRenderer {
         const val MARKER_RECT_CORNER_RADIUS = 100f
         private const val MARKER_RECTS_MAX_SIZE = 24
         private const val COORDINATES_PER_RECT = 5
+
+        const val BLURRED_SNAPSHOT_LEVEL_FULL = 0
+        const val BLURRED_SNAPSHOT_LEVEL_HALF = 1
+        const val BLURRED_SNAPSHOT_LEVEL_QUARTER = 2
+
+        /** centerX, centerY, width (all in surface pixels), opacity, icon index. */
+        const val SPRITE_COMPONENTS = 5
+
+        /** left, baseline (surface pixels), font size (pixels), opacity, text index. */
+        const val LABEL_COMPONENTS = 5
+
+        private const val LABEL_GLYPHS_RASTER_SIZE = 48f
+        // Basic Latin, Latin-1 Supplement, Latin Extended-A and the ellipsis of shortened labels.
+        private val LABEL_GLYPHS_CODEPOINTS = (0x20..0x17F) + 0x2026
+        private const val LABEL_GLYPHS_CACHE_FILE_NAME = "label_glyphs_sdf.bin"
+        private const val GPU_CAPABILITIES_CACHE_FILE_NAME = "gpu_capabilities.bin"
+
+        /** About a frame: readbacks usually finish within one or two. */
+        private const val READBACK_POLL_INTERVAL_MS = 16L
+
+        /** Roughly 10 minutes of 30 fps frames with a dozen marker rects. */
+        const val DEFAULT_FRAME_TRACE_MAX_BYTES = 64L * 1024 * 1024
+
+        // The frames in flight, the one being drawn and one more for acquireLatestImage.
+        private const val PREVIEW_MAX_IMAGES = VulkanRenderer.MAX_FRAMES_IN_FLIGHT + 2
+
+        // AHardwareBuffer rows start at the top, unlike those of the GL external texture.
+        private val HARDWARE_BUFFER_TEXTURE_TRANSFORM =
+            floatArrayOf(1f, 0f, 0f, 0f, 0f, -1f, 0f, 0f, 0f, 0f, 1f, 0f, 0f, 1f, 0f, 1f)
     }
 
     private val executor =
@@ -63,9 +118,35 @@ class OpenGLRenderer {
 
     private val tempVec = FloatArray(8)
     private var nativeContext = 0L
+    private val capabilitiesCachePath: String?
+        get() = cacheDir?.let { File(it, GPU_CAPABILITIES_CACHE_FILE_NAME).absolutePath }
     private var isShutdown = false
+    // Loaded into the context once it is created, and again after it was recreated.
+    private var spriteAtlasIcons: List<Bitmap>? = null
+    private var labelGlyphsCacheDir: File? = null
+    private var labelTexts: List<String>? = null
+
+    /** Whether labels can be drawn, which [loadLabelGlyphs] enables once it succeeded. */
+    @Volatile
+    var labelGlyphsLoaded: Boolean = false
+        private set
+
+    // Decided once, when the first surface arrives. Frames then come from previewImageReader
+    // and nativeContext stays 0.
+    private var vulkanRenderer: VulkanRenderer? = null
+    private var vulkanRendererChecked = false
+    private var previewImageReader: ImageReader? = null
+    // Acquired images, oldest first; the last one is drawn and the others may still be in flight.
+    private val previewImages = ArrayDeque<Image>()
+
+    // Setters push commands from the main thread without a hop to the executor; the render
+    // thread applies them at the start of the next frame. Each thread holds its own reference
+    // to the queue and releases it when it is done with it.
+    private var commandQueue = createCommandQueue()
+    private val renderCommandQueue = shareCommandQueue(commandQueue)
     private var numOutstandingSurfaces = 0
     private var frameUpdateListener: Pair<Executor, (Long) -> Unit>? = null
+    private var readbackPollScheduled = false
 
     private val activeStreamStateObserver = AtomicReference<PreviewStreamStateObserver?>()
     private val previewStreamStateFlow = MutableStateFlow(StreamState.IDLE)
@@ -80,12 +161,45 @@ class OpenGLRenderer {
     val oglFatalErrorsFlow: Flow<Unit>
         get() = oglFatalErrorsSharedFlow
 
+    private val dominantColorsSharedFlow =
+        MutableSharedFlow<Int>(
+            extraBufferCapacity = 1,
+            onBufferOverflow = BufferOverflow.DROP_OLDEST
+        )
+
+    /**
+     * Dominant colors of the blurred camera preview, extracted on the GPU from the smallest blur
+     * level. A color is emitted only when it noticeably differs from the previously emitted one.
+     */
+    val dominantColorsFlow: Flow<Int>
+        get() = dominantColorsSharedFlow
+
+    private val blurredSnapshotSize = IntArray(2)
+    private val blurredSnapshotsSharedFlow =
+        MutableSharedFlow<Bitmap>(
+            extraBufferCapacity = 1,
+            onBufferOverflow = BufferOverflow.DROP_OLDEST
+        )
+
+    /** Fully blurred frames captured on request - see [requestBlurredSnapshot]. */
+    val blurredSnapshotsFlow: Flow<Bitmap>
+        get() = blurredSnapshotsSharedFlow
+
     private var markerRects: List<RoundedRectF> = emptyList()
         set(value) {
             field = value.take(MARKER_RECTS_MAX_SIZE)
+            postRenderLoopRects()
         }
     var otherRects: List<RoundedRectF> = emptyList()
+        set(value) {
+            field = value
+            postRenderLoopRects()
+        }
     var markerRectsDisabled: Boolean = false
+        set(value) {
+            field = value
+            postRenderLoopRects()
+        }
 
     private val rectsCoordinates: FloatArray
         get() {
@@ -114,29 +228,272 @@ class OpenGLRenderer {
         markerRects = rects.map { RoundedRectF(it, MARKER_RECT_CORNER_RADIUS) }
     }
 
+    // The native render loop keeps its own copy of the rects, which are otherwise passed along
+    // with every frame.
+    private fun postRenderLoopRects() {
+        if (!nativeRenderLoop || isShutdown) return
+        try {
+            executor.execute { if (nativeContext != 0L) pushRenderLoopRects() }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    @WorkerThread
+    private fun pushRenderLoopRects() {
+        setRenderLoopRects(
+            nativeContext,
+            rectsCoordinates = rectsCoordinates,
+            allRectsCount = markerRects.size + otherRects.size,
+            otherRectsCount = otherRects.size
+        )
+    }
+
     @MainThread
     fun setBlurEnabled(enabled: Boolean, animated: Boolean) {
-        if (isShutdown || nativeContext == 0L) return
+        if (commandQueue == 0L) return
+        setBlurEnabled(commandQueue, enabled = enabled, animated = animated)
+    }
+
+    /**
+     * Blurs with box filters read from summed-area tables, at the same cost for any blur radius,
+     * instead of the separable gaussian passes. Ignored on devices without compute shaders.
+     */
+    @MainThread
+    fun setSatBlurEnabled(enabled: Boolean) {
+        if (commandQueue == 0L) return
+        setSatBlurEnabled(commandQueue, enabled)
+    }
+
+    @MainThread
+    fun setContrastingColor(red: Int, green: Int, blue: Int) {
+        if (commandQueue == 0L) return
+        setContrastingColor(
+            commandQueue,
+            red = red.toFloat() / 256f,
+            green = green.toFloat() / 256f,
+            blue = blue.toFloat() / 256f
+        )
+    }
+
+    /**
+     * Requests a capture of the renderer's already blurred output at the given blur level (one of
+     * BLURRED_SNAPSHOT_LEVEL_* constants). The capture is taken on the first fully blurred frame
+     * and read back asynchronously - it is emitted by [blurredSnapshotsFlow] a few frames later.
+     */
+    fun requestBlurredSnapshot(level: Int = BLURRED_SNAPSHOT_LEVEL_QUARTER) {
+        if (isShutdown) return
         try {
             executor.execute {
-                setBlurEnabled(nativeContext, enabled = enabled, animated = animated)
+                if (nativeContext != 0L) requestBlurredSnapshot(nativeContext, level)
             }
         } catch (e: RejectedExecutionException) {
             Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
         }
     }
 
-    @MainThread
-    fun setContrastingColor(red: Int, green: Int, blue: Int) {
-        if (isShutdown || nativeContext == 0L) return
+    /**
+     * Starts recording the inputs of every rendered frame (transforms, marker rects, timestamps)
+     * and the blur and contrasting color changes into [file], replacing it. Recording stops when
+     * [maxBytes] are used up. Replay the trace with [replayFrameTrace], on any device.
+     */
+    fun startFrameTrace(file: File, maxBytes: Long = DEFAULT_FRAME_TRACE_MAX_BYTES) {
+        if (isShutdown) return
         try {
             executor.execute {
-                setContrastingColor(
-                    nativeContext,
-                    red = red.toFloat() / 256f,
-                    green = green.toFloat() / 256f,
-                    blue = blue.toFloat() / 256f
-                )
+                if (nativeContext == 0L) return@execute
+                if (!startFrameTrace(nativeContext, file.absolutePath, maxBytes)) {
+                    Timber.tag("OGL").e("Failed to start frame trace.")
+                }
+            }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    fun stopFrameTrace() {
+        if (isShutdown) return
+        try {
+            executor.execute { if (nativeContext != 0L) stopFrameTrace(nativeContext) }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    /**
+     * Draws the frames of a trace recorded by [startFrameTrace] offscreen, as fast as possible,
+     * and records them with their CPU and GPU times into [output] - compare both with the
+     * frame_trace_report host tool. Rendering to the output surface pauses meanwhile.
+     *
+     * Traces written by the golden_scenes host tool store their camera frame, which is drawn
+     * instead of the current one. With [captureFrames], the pixels of every drawn frame are
+     * recorded too, for the golden_diff host tool to compare replays of pipeline variants - each
+     * takes width * height * 4 bytes of [maxOutputBytes].
+     *
+     * @return The number of replayed frames, -1 if the trace could not be replayed.
+     */
+    fun replayFrameTrace(
+        trace: File,
+        output: File,
+        maxOutputBytes: Long = DEFAULT_FRAME_TRACE_MAX_BYTES,
+        captureFrames: Boolean = false
+    ): ListenableFuture<Int> =
+        CallbackToFutureAdapter.getFuture { completer: CallbackToFutureAdapter.Completer<Int> ->
+            try {
+                executor.execute {
+                    completer.set(
+                        if (nativeContext == 0L) -1
+                        else {
+                            replayFrameTrace(
+                                nativeContext,
+                                trace.absolutePath,
+                                output.absolutePath,
+                                maxOutputBytes,
+                                captureFrames
+                            )
+                        }
+                    )
+                }
+            } catch (e: RejectedExecutionException) {
+                completer.set(-1)
+            }
+            "replayFrameTrace [$this]"
+        }
+
+    /**
+     * Packs marker icons into the native sprite atlas. Icons are referenced by their index in
+     * [icons] in [setSprites]. Bitmaps must be ARGB_8888 and should already be scaled down to
+     * roughly the size they are drawn at. Icons loaded before the first surface is attached are
+     * packed once the context is created.
+     */
+    fun loadSpriteAtlas(icons: List<Bitmap>) {
+        if (isShutdown) return
+        try {
+            executor.execute {
+                spriteAtlasIcons = icons
+                if (nativeContext != 0L) loadSpriteAtlasIntoContext(icons)
+            }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    /**
+     * Replaces the sprites drawn on top of the preview with one instanced draw per frame.
+     *
+     * @param sprites [SPRITE_COMPONENTS] floats per sprite.
+     */
+    fun setSprites(sprites: FloatArray, count: Int) {
+        if (isShutdown) return
+        val spritesCopy = sprites.copyOf(count * SPRITE_COMPONENTS)
+        try {
+            executor.execute {
+                if (nativeContext != 0L) setSprites(nativeContext, spritesCopy, count)
+            }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    /**
+     * Loads the signed distance field glyph atlas used for marker labels from [cacheDir], or
+     * generates (and caches) it from the default bold typeface if there is no cached one yet.
+     * Glyphs requested before the first surface is attached are loaded once the context is created.
+     */
+    fun loadLabelGlyphs(cacheDir: File) {
+        if (isShutdown) return
+        try {
+            executor.execute {
+                labelGlyphsCacheDir = cacheDir
+                if (nativeContext != 0L) loadLabelGlyphsIntoContext(cacheDir)
+            }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    @WorkerThread
+    private fun loadLabelGlyphsIntoContext(cacheDir: File) {
+        val cachePath = File(cacheDir, LABEL_GLYPHS_CACHE_FILE_NAME).absolutePath
+        if (loadGlyphAtlas(nativeContext, cachePath, LABEL_GLYPHS_RASTER_SIZE)) {
+            labelGlyphsLoaded = true
+            return
+        }
+        val codepoints = IntArray(LABEL_GLYPHS_CODEPOINTS.size)
+        val metrics = FloatArray(codepoints.size * 3)
+        val glyphs = rasterizeLabelGlyphs(codepoints, metrics)
+        if (buildGlyphAtlas(
+                nativeContext,
+                cachePath,
+                LABEL_GLYPHS_RASTER_SIZE,
+                codepoints,
+                metrics,
+                glyphs
+            )
+        ) {
+            labelGlyphsLoaded = true
+        } else {
+            Timber.tag("OGL").e("Failed to build label glyph atlas.")
+        }
+        glyphs.forEach(Bitmap::recycle)
+    }
+
+    @WorkerThread
+    private fun rasterizeLabelGlyphs(codepoints: IntArray, metrics: FloatArray): Array<Bitmap> {
+        val paint =
+            Paint(Paint.ANTI_ALIAS_FLAG).apply {
+                typeface = Typeface.DEFAULT_BOLD
+                textSize = LABEL_GLYPHS_RASTER_SIZE
+            }
+        val bounds = Rect()
+        return LABEL_GLYPHS_CODEPOINTS.mapIndexed { index, codepoint ->
+                val glyph = String(Character.toChars(codepoint))
+                paint.getTextBounds(glyph, 0, glyph.length, bounds)
+                codepoints[index] = codepoint
+                metrics[index * 3] = paint.measureText(glyph)
+                metrics[index * 3 + 1] = bounds.left.toFloat()
+                metrics[index * 3 + 2] = -bounds.top.toFloat()
+                Bitmap.createBitmap(
+                        bounds.width().coerceAtLeast(1),
+                        bounds.height().coerceAtLeast(1),
+                        Bitmap.Config.ALPHA_8
+                    )
+                    .also {
+                        Canvas(it)
+                            .drawText(glyph, -bounds.left.toFloat(), -bounds.top.toFloat(), paint)
+                    }
+            }
+            .toTypedArray()
+    }
+
+    /**
+     * Registers label texts, which are laid out once and referenced by their index in [texts] in
+     * [setLabels].
+     */
+    fun setLabelTexts(texts: List<String>) {
+        if (isShutdown) return
+        try {
+            executor.execute {
+                labelTexts = texts
+                if (nativeContext != 0L) setLabelTexts(nativeContext, texts.toTypedArray())
+            }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    /**
+     * Replaces the labels drawn on top of the preview (and sprites) with one instanced draw per
+     * frame.
+     *
+     * @param labels [LABEL_COMPONENTS] floats per label.
+     */
+    fun setLabels(labels: FloatArray, count: Int) {
+        if (isShutdown) return
+        val labelsCopy = labels.copyOf(count * LABEL_COMPONENTS)
+        try {
+            executor.execute {
+                if (nativeContext != 0L) setLabels(nativeContext, labelsCopy, count)
             }
         } catch (e: RejectedExecutionException) {
             Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
@@ -169,17 +526,37 @@ class OpenGLRenderer {
             )
             activeStreamStateObserver.set(streamStateObserver)
 
-            if (nativeContext == 0L) {
-                nativeContext = catchAndEmitFatalErrors(::initContext) ?: return@setSurfaceProvider
-            }
+            val inputSurface: Surface
+            val releaseInput: () -> Unit
+            if (initVulkanRendererIfNeeded() != null) {
+                val imageReader = resetPreviewImageReader(surfaceRequest.resolution)
+                inputSurface = imageReader.surface
+                releaseInput = {
+                    if (imageReader === previewImageReader) {
+                        previewImageReader = null
+                        closePreviewImages()
+                    }
+                    imageReader.close()
+                }
+            } else {
+                if (!initContextIfNeeded()) return@setSurfaceProvider
 
-            val surfaceTexture = resetPreviewTexture(surfaceRequest.resolution)
-            val inputSurface = Surface(surfaceTexture)
+                val surfaceTexture = resetPreviewTexture(surfaceRequest.resolution)
+                inputSurface = Surface(surfaceTexture)
+                releaseInput = {
+                    if (surfaceTexture === previewTexture) {
+                        previewTexture = null
+                        if (nativeRenderLoop && nativeContext != 0L) {
+                            setRenderLoopInput(nativeContext, null, 0, 0)
+                        }
+                    }
+                    inputSurface.release()
+                    surfaceTexture.release()
+                }
+            }
             numOutstandingSurfaces++
             surfaceRequest.provideSurface(inputSurface, executor) {
-                inputSurface.release()
-                surfaceTexture.release()
-                if (surfaceTexture === previewTexture) previewTexture = null
+                releaseInput()
                 numOutstandingSurfaces--
                 doShutdownIfNeeded()
                 if (activeStreamStateObserver.compareAndSet(streamStateObserver, null)) {
@@ -195,13 +572,23 @@ class OpenGLRenderer {
         if (isShutdown) return
         try {
             executor.execute {
-                if (nativeContext == 0L) {
-                    nativeContext = catchAndEmitFatalErrors(::initContext) ?: return@execute
-                }
+                val vulkanRenderer = initVulkanRendererIfNeeded()
+                if (vulkanRenderer == null && !initContextIfNeeded()) return@execute
 
-                if (setWindowSurface(nativeContext, surface)) {
+                val attached =
+                    vulkanRenderer?.setWindowSurface(surface, surfaceSize.width, surfaceSize.height)
+                        ?: setWindowSurface(nativeContext, surface)
+                if (attached) {
                     this.surfaceRotationDegrees = surfaceRotationDegrees
                     this.surfaceSize = surfaceSize
+                    if (nativeRenderLoop) {
+                        setRenderLoopSurface(
+                            nativeContext,
+                            width = surfaceSize.width,
+                            height = surfaceSize.height,
+                            rotationDegrees = surfaceRotationDegrees
+                        )
+                    }
                 } else {
                     this.surfaceSize = null
                 }
@@ -231,7 +618,23 @@ class OpenGLRenderer {
         try {
             executor.execute {
                 this.surfaceRotationDegrees = surfaceRotationDegrees
-                if (previewTexture != null && nativeContext != 0L) renderLatest()
+                if (vulkanRenderer != null) {
+                    if (previewImages.isNotEmpty()) renderLatest()
+                    return@execute
+                }
+                if (nativeContext == 0L) return@execute
+                if (!nativeRenderLoop) {
+                    if (previewTexture != null) renderLatest()
+                    return@execute
+                }
+                // The loop picks up the rotation with the next camera frame.
+                val surfaceSize = surfaceSize ?: return@execute
+                setRenderLoopSurface(
+                    nativeContext,
+                    width = surfaceSize.width,
+                    height = surfaceSize.height,
+                    rotationDegrees = surfaceRotationDegrees
+                )
             }
         } catch (e: RejectedExecutionException) {
             Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
@@ -250,7 +653,11 @@ class OpenGLRenderer {
         CallbackToFutureAdapter.getFuture { completer: CallbackToFutureAdapter.Completer<Unit> ->
             try {
                 executor.execute {
-                    if (nativeContext != 0L) {
+                    val vulkanRenderer = vulkanRenderer
+                    if (vulkanRenderer != null) {
+                        vulkanRenderer.setWindowSurface(null, 0, 0)
+                        surfaceSize = null
+                    } else if (nativeContext != 0L) {
                         setWindowSurface(nativeContext, null)
                         surfaceSize = null
                     }
@@ -263,14 +670,66 @@ class OpenGLRenderer {
             "detachOutputSurface [$this]"
         }
 
+    /**
+     * Presents the frames drawn to the output surface on [surface] as well, e.g. the input surface
+     * of a video encoder or a picture-in-picture view. Frames are drawn once and scaled to the
+     * size of [surface], keeping their aspect ratio, at most [maxFramesPerSecond] times a second
+     * (0 for every frame). Nothing is presented while no output surface is attached.
+     *
+     * @return The id to pass to [removeMirrorSurface], -1 if [surface] could not be added.
+     */
+    fun addMirrorSurface(surface: Surface, maxFramesPerSecond: Int = 0): ListenableFuture<Int> =
+        CallbackToFutureAdapter.getFuture { completer: CallbackToFutureAdapter.Completer<Int> ->
+            try {
+                executor.execute {
+                    completer.set(
+                        if (nativeContext == 0L) -1
+                        else addMirrorSurface(nativeContext, surface, maxFramesPerSecond)
+                    )
+                }
+            } catch (e: RejectedExecutionException) {
+                completer.set(-1)
+            }
+            "addMirrorSurface [$this]"
+        }
+
+    /**
+     * Stops presenting frames on the surface added as [id] by [addMirrorSurface]. It is safe to
+     * release the surface once the returned future has completed.
+     */
+    fun removeMirrorSurface(id: Int): ListenableFuture<Unit> =
+        CallbackToFutureAdapter.getFuture { completer: CallbackToFutureAdapter.Completer<Unit> ->
+            try {
+                executor.execute {
+                    if (nativeContext != 0L) removeMirrorSurface(nativeContext, id)
+                    completer.set(Unit)
+                }
+            } catch (e: RejectedExecutionException) {
+                // The context and its surfaces are released on shutdown.
+                completer.set(Unit)
+            }
+            "removeMirrorSurface [$this]"
+        }
+
+    @MainThread
     fun shutdown() {
+        if (commandQueue != 0L) {
+            releaseCommandQueue(commandQueue)
+            commandQueue = 0L
+        }
         try {
             executor.execute {
+                if (isShutdown) return@execute
                 isShutdown = true
+                // Waits for the frames in flight before their images go back to the camera.
+                vulkanRenderer?.close()
+                vulkanRenderer = null
+                closePreviewImages()
                 if (nativeContext != 0L) {
                     closeContext(nativeContext)
                     nativeContext = 0
                 }
+                releaseCommandQueue(renderCommandQueue)
                 doShutdownIfNeeded()
             }
         } catch (e: RejectedExecutionException) {
@@ -278,6 +737,25 @@ class OpenGLRenderer {
         }
     }
 
+    @WorkerThread
+    private fun initContextIfNeeded(): Boolean {
+        if (nativeContext != 0L) return true
+        nativeContext =
+            catchAndEmitFatalErrors { initContext(renderCommandQueue, capabilitiesCachePath) }
+                ?: return false
+        spriteAtlasIcons?.let(::loadSpriteAtlasIntoContext)
+        labelGlyphsCacheDir?.let(::loadLabelGlyphsIntoContext)
+        labelTexts?.let { setLabelTexts(nativeContext, it.toTypedArray()) }
+        return true
+    }
+
+    @WorkerThread
+    private fun loadSpriteAtlasIntoContext(icons: List<Bitmap>) {
+        if (!loadSpriteAtlas(nativeContext, icons.toTypedArray())) {
+            Timber.tag("OGL").e("Failed to load sprite atlas.")
+        }
+    }
+
     @WorkerThread
     private fun doShutdownIfNeeded() {
         if (isShutdown && numOutstandingSurfaces == 0) {
@@ -286,27 +764,102 @@ class OpenGLRenderer {
         }
     }
 
+    @WorkerThread
+    private fun initVulkanRendererIfNeeded(): VulkanRenderer? {
+        if (vulkanRendererChecked) return vulkanRenderer
+        vulkanRendererChecked = true
+        val assets = (backend as? RendererBackend.Vulkan)?.assets ?: return null
+        if (nativeRenderLoop) return null
+        vulkanRenderer = VulkanRenderer.createIfSupported(renderCommandQueue, assets)
+        if (vulkanRenderer == null) Timber.tag("OGL").i("Vulkan is unavailable, using GL.")
+        return vulkanRenderer
+    }
+
+    @WorkerThread
+    private fun resetPreviewImageReader(size: Size): ImageReader {
+        // The images of the previous reader are not drawn again.
+        closePreviewImages()
+        val imageReader =
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                ImageReader.newInstance(
+                    size.width,
+                    size.height,
+                    ImageFormat.PRIVATE,
+                    PREVIEW_MAX_IMAGES,
+                    HardwareBuffer.USAGE_GPU_SAMPLED_IMAGE
+                )
+            } else {
+                ImageReader.newInstance(
+                    size.width,
+                    size.height,
+                    ImageFormat.PRIVATE,
+                    PREVIEW_MAX_IMAGES
+                )
+            }
+        return imageReader.apply {
+            previewImageReader = this
+            setOnImageAvailableListener(
+                { reader ->
+                    if (reader === previewImageReader && vulkanRenderer != null) {
+                        reader.acquireLatestImage()?.let { image ->
+                            previewImages.addLast(image)
+                            while (previewImages.size > VulkanRenderer.MAX_FRAMES_IN_FLIGHT + 1) {
+                                previewImages.removeFirst().close()
+                            }
+                            renderLatest()
+                        }
+                    }
+                },
+                executor.handler
+            )
+            previewResolution = size
+        }
+    }
+
+    @WorkerThread
+    private fun closePreviewImages() {
+        while (previewImages.isNotEmpty()) previewImages.removeFirst().close()
+    }
+
     @WorkerThread
     private fun resetPreviewTexture(size: Size): SurfaceTexture {
-        previewTexture?.detachFromGLContext()
+        // The render loop thread owns the context, it detaches the previous texture itself.
+        if (!nativeRenderLoop) previewTexture?.detachFromGLContext()
         return SurfaceTexture(getTexName(nativeContext)).apply {
             previewTexture = this
             setDefaultBufferSize(size.width, size.height)
             setOnFrameAvailableListener(
                 { surfaceTexture ->
                     if (surfaceTexture === previewTexture && nativeContext != 0L) {
-                        surfaceTexture.updateTexImage()
-                        renderLatest()
+                        if (nativeRenderLoop) {
+                            notifyFrameAvailable(nativeContext)
+                        } else {
+                            surfaceTexture.updateTexImage()
+                            renderLatest()
+                        }
                     }
                 },
                 executor.handler
             )
             previewResolution = size
+            if (nativeRenderLoop) {
+                if (setRenderLoopInput(nativeContext, this, size.width, size.height)) {
+                    pushRenderLoopRects()
+                } else {
+                    oglFatalErrorsSharedFlow.tryEmit(Unit)
+                }
+            }
         }
     }
 
     @WorkerThread
     private fun renderLatest() {
+        val vulkanRenderer = vulkanRenderer
+        if (vulkanRenderer != null) {
+            renderLatestImage(vulkanRenderer)
+            return
+        }
+
         val previewTexture = requireNotNull(this.previewTexture)
         // Get the timestamp so we can pass it along to the output surface (not strictly necessary)
         val timestampNs = previewTexture.timestamp
@@ -317,7 +870,8 @@ class OpenGLRenderer {
         if (surfaceSize == null) return
 
         calculateSurfaceTransform()
-        val success =
+        // False when the frame failed or would look the same as the last drawn one.
+        val drawn =
             renderTexture(
                 nativeContext = nativeContext,
                 timestampNs = timestampNs,
@@ -327,7 +881,52 @@ class OpenGLRenderer {
                 allRectsCount = markerRects.size + otherRects.size,
                 otherRectsCount = otherRects.size
             )
-        if (!success) return
+        if (drawn) onFrameRendered(timestampNs)
+    }
+
+    @WorkerThread
+    private fun renderLatestImage(vulkanRenderer: VulkanRenderer) {
+        val image = previewImages.last()
+        HARDWARE_BUFFER_TEXTURE_TRANSFORM.copyInto(previewTransform)
+        if (surfaceSize == null) return
+        val hardwareBuffer = image.hardwareBuffer ?: return
+
+        calculateSurfaceTransform()
+        val drawn =
+            try {
+                vulkanRenderer.render(
+                    hardwareBuffer = hardwareBuffer,
+                    timestampNs = image.timestamp,
+                    vertexTransform = surfaceTransform,
+                    textureTransform = previewTransform,
+                    rectsCoordinates = rectsCoordinates,
+                    allRectsCount = markerRects.size + otherRects.size,
+                    otherRectsCount = otherRects.size
+                )
+            } finally {
+                // The renderer holds its own reference to the buffer.
+                hardwareBuffer.close()
+            }
+        if (drawn) onFrameRendered(image.timestamp)
+    }
+
+    /** Called on the native render loop thread after it has drawn a frame. */
+    @Suppress("unused")
+    private fun onNativeFrameRendered(timestampNs: Long) {
+        try {
+            executor.execute { if (nativeContext != 0L) onFrameRendered(timestampNs) }
+        } catch (e: RejectedExecutionException) {
+            Timber.tag("OGL").i("Renderer already shutting down. Ignore.")
+        }
+    }
+
+    @WorkerThread
+    private fun onFrameRendered(timestampNs: Long) {
+        // Readbacks are GL only, a Vulkan renderer leaves nativeContext 0.
+        if (nativeContext != 0L) {
+            emitReadbacks()
+            if (pollReadbacks(nativeContext)) schedulePollReadbacks()
+        }
 
         frameUpdateListener?.let { (executor, listener) ->
             try {
@@ -338,6 +937,48 @@ class OpenGLRenderer {
         }
     }
 
+    @WorkerThread
+    private fun emitReadbacks() {
+        val dominantColor = getDominantColor(nativeContext)
+        if (dominantColor != Color.TRANSPARENT) dominantColorsSharedFlow.tryEmit(dominantColor)
+        emitBlurredSnapshotIfReady()
+    }
+
+    /**
+     * Keeps polling readbacks still in flight after a frame. Frames which would look the same as
+     * the last drawn one are never drawn, so without this a static scene or a paused camera
+     * would hold back the dominant color and snapshots they read back.
+     */
+    @WorkerThread
+    private fun schedulePollReadbacks() {
+        if (readbackPollScheduled) return
+        readbackPollScheduled =
+            executor.handler.postDelayed(
+                {
+                    readbackPollScheduled = false
+                    if (nativeContext == 0L) return@postDelayed
+                    val pending = pollReadbacks(nativeContext)
+                    emitReadbacks()
+                    if (pending) schedulePollReadbacks()
+                },
+                READBACK_POLL_INTERVAL_MS
+            )
+    }
+
+    @WorkerThread
+    private fun emitBlurredSnapshotIfReady() {
+        val pixels =
+            acquireBlurredSnapshot(nativeContext, size = blurredSnapshotSize) ?: return
+        try {
+            val (width, height) = blurredSnapshotSize
+            val snapshot = Bitmap.createBitmap(width, height, Bitmap.Config.ARGB_8888)
+            snapshot.copyPixelsFromBuffer(pixels)
+            blurredSnapshotsSharedFlow.tryEmit(snapshot)
+        } finally {
+            releaseBlurredSnapshot(nativeContext)
+        }
+    }
+
     /**
      * Calculates the dimensions of the source texture after it has been transformed from the raw
      * sensor texture to an image which is in the device's 'natural' orientation.
@@ -527,11 +1168,21 @@ class OpenGLRenderer {
         Matrix.rotateM(surfaceTransform, 0, -surfaceRotationDegrees.toFloat(), 0f, 0f, 1.0f)
     }
 
-    @WorkerThread private external fun initContext(): Long
+    @WorkerThread
+    private external fun initContext(commandQueue: Long, capabilitiesCachePath: String?): Long
 
     @WorkerThread
     private external fun setWindowSurface(nativeContext: Long, surface: Surface?): Boolean
 
+    @WorkerThread
+    private external fun addMirrorSurface(
+        nativeContext: Long,
+        surface: Surface,
+        maxFramesPerSecond: Int
+    ): Int
+
+    @WorkerThread private external fun removeMirrorSurface(nativeContext: Long, id: Int): Boolean
+
     @WorkerThread private external fun getTexName(nativeContext: Long): Int
 
     @WorkerThread
@@ -545,14 +1196,102 @@ class OpenGLRenderer {
         otherRectsCount: Int
     ): Boolean
 
+    @WorkerThread private external fun getDominantColor(nativeContext: Long): Int
+
+    /** Returns whether a readback is still in flight. */
+    @WorkerThread private external fun pollReadbacks(nativeContext: Long): Boolean
+
+    @WorkerThread private external fun requestBlurredSnapshot(nativeContext: Long, level: Int)
+
+    @WorkerThread
+    private external fun acquireBlurredSnapshot(nativeContext: Long, size: IntArray): ByteBuffer?
+
+    @WorkerThread private external fun releaseBlurredSnapshot(nativeContext: Long)
+
+    @WorkerThread
+    private external fun loadSpriteAtlas(nativeContext: Long, icons: Array<Bitmap>): Boolean
+
+    @WorkerThread
+    private external fun setSprites(nativeContext: Long, sprites: FloatArray, spritesCount: Int)
+
+    @WorkerThread
+    private external fun loadGlyphAtlas(
+        nativeContext: Long,
+        cachePath: String,
+        rasterSize: Float
+    ): Boolean
+
+    @WorkerThread
+    private external fun buildGlyphAtlas(
+        nativeContext: Long,
+        cachePath: String,
+        rasterSize: Float,
+        codepoints: IntArray,
+        metrics: FloatArray,
+        glyphs: Array<Bitmap>
+    ): Boolean
+
+    @WorkerThread private external fun setLabelTexts(nativeContext: Long, texts: Array<String>)
+
+    @WorkerThread
+    private external fun setLabels(nativeContext: Long, labels: FloatArray, labelsCount: Int)
+
+    @WorkerThread
+    private external fun startFrameTrace(nativeContext: Long, path: String, maxBytes: Long): Boolean
+
+    @WorkerThread private external fun stopFrameTrace(nativeContext: Long)
+
+    @WorkerThread
+    private external fun replayFrameTrace(
+        nativeContext: Long,
+        tracePath: String,
+        outputPath: String,
+        maxOutputBytes: Long,
+        captureOutputs: Boolean
+    ): Int
+
     @WorkerThread private external fun closeContext(nativeContext: Long)
 
     @WorkerThread
-    private external fun setBlurEnabled(nativeContext: Long, enabled: Boolean, animated: Boolean)
+    private external fun setRenderLoopInput(
+        nativeContext: Long,
+        surfaceTexture: SurfaceTexture?,
+        previewWidth: Int,
+        previewHeight: Int
+    ): Boolean
+
+    @WorkerThread private external fun notifyFrameAvailable(nativeContext: Long)
 
     @WorkerThread
-    private external fun setContrastingColor(
+    private external fun setRenderLoopSurface(
+        nativeContext: Long,
+        width: Int,
+        height: Int,
+        rotationDegrees: Int
+    )
+
+    @WorkerThread
+    private external fun setRenderLoopRects(
         nativeContext: Long,
+        rectsCoordinates: FloatArray,
+        allRectsCount: Int,
+        otherRectsCount: Int
+    )
+
+    private external fun createCommandQueue(): Long
+
+    private external fun shareCommandQueue(commandQueue: Long): Long
+
+    private external fun releaseCommandQueue(commandQueue: Long)
+
+    @MainThread
+    private external fun setBlurEnabled(commandQueue: Long, enabled: Boolean, animated: Boolean)
+
+    @MainThread private external fun setSatBlurEnabled(commandQueue: Long, enabled: Boolean)
+
+    @MainThread
+    private external fun setContrastingColor(
+        commandQueue: Long,
         red: Float,
         green: Float,
         blue: Float
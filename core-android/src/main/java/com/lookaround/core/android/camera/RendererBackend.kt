@@ -0,0 +1,15 @@
+package com.lookaround.core.android.camera
+
+import android.content.res.AssetManager
+
+/** Graphics API [OpenGLRenderer] draws camera frames with. */
+sealed interface RendererBackend {
+    object Gl : RendererBackend
+
+    /**
+     * [VulkanRenderer] with the shaders compiled into assets/shaders of [assets], GL where the
+     * device does not support it. Sprites, labels, blurred snapshots, dominant colors, mirror
+     * surfaces and SAT blur are GL only.
+     */
+    class Vulkan(val assets: AssetManager) : RendererBackend
+}
@@ -0,0 +1,109 @@
+package com.lookaround.core.android.camera
+
+import android.content.res.AssetManager
+import android.hardware.HardwareBuffer
+import android.view.Surface
+import androidx.annotation.WorkerThread
+import java.io.Closeable
+
+/**
+ * Vulkan backend of [OpenGLRenderer]'s camera post-processing: the blur, the marker rects and the
+ * contrasting color, drawn from camera frames imported as [HardwareBuffer]s. Sprites, labels,
+ * snapshots, mirror surfaces and SAT blur stay GL only. All calls must come from the render
+ * thread.
+ */
+internal class VulkanRenderer private constructor(private var nativeRenderer: Long) : Closeable {
+    /** Presents frames on [surface] from now on, none if it is null. */
+    @WorkerThread
+    fun setWindowSurface(surface: Surface?, width: Int, height: Int): Boolean {
+        check(nativeRenderer != 0L) { "VulkanRenderer is closed." }
+        return setWindowSurface(nativeRenderer, surface, width, height)
+    }
+
+    /**
+     * Draws the camera frame in [hardwareBuffer], which must stay unchanged until
+     * [MAX_FRAMES_IN_FLIGHT] more frames were drawn. Takes the transforms and rects of
+     * [OpenGLRenderer].
+     *
+     * @return false if the frame failed or would look the same as the last drawn one.
+     */
+    @WorkerThread
+    fun render(
+        hardwareBuffer: HardwareBuffer,
+        timestampNs: Long,
+        vertexTransform: FloatArray,
+        textureTransform: FloatArray,
+        rectsCoordinates: FloatArray,
+        allRectsCount: Int,
+        otherRectsCount: Int
+    ): Boolean {
+        check(nativeRenderer != 0L) { "VulkanRenderer is closed." }
+        return renderHardwareBuffer(
+            nativeRenderer,
+            hardwareBuffer,
+            timestampNs,
+            vertexTransform,
+            textureTransform,
+            rectsCoordinates,
+            allRectsCount,
+            otherRectsCount
+        )
+    }
+
+    @WorkerThread
+    override fun close() {
+        if (nativeRenderer == 0L) return
+        destroy(nativeRenderer)
+        nativeRenderer = 0L
+    }
+
+    companion object {
+        init {
+            System.loadLibrary("opengl_renderer_jni")
+        }
+
+        const val MAX_FRAMES_IN_FLIGHT = 2
+
+        /** Whether the device has Vulkan 1.1 and imports camera buffers, YUV ones included. */
+        val isSupported: Boolean by lazy { probe() }
+
+        /**
+         * @param commandQueue The render thread's reference to the command queue of
+         * [OpenGLRenderer], whose commands are applied at the start of each frame.
+         * @param assets Holding the shaders compiled into assets/shaders.
+         * @return null if the device is not supported or a shader is missing.
+         */
+        @WorkerThread
+        fun createIfSupported(commandQueue: Long, assets: AssetManager): VulkanRenderer? {
+            if (!isSupported) return null
+            val nativeRenderer = create(commandQueue, assets)
+            return if (nativeRenderer == 0L) null else VulkanRenderer(nativeRenderer)
+        }
+
+        @JvmStatic private external fun probe(): Boolean
+
+        @JvmStatic private external fun create(commandQueue: Long, assets: AssetManager): Long
+
+        @JvmStatic private external fun destroy(nativeRenderer: Long)
+
+        @JvmStatic
+        private external fun setWindowSurface(
+            nativeRenderer: Long,
+            surface: Surface?,
+            width: Int,
+            height: Int
+        ): Boolean
+
+        @JvmStatic
+        private external fun renderHardwareBuffer(
+            nativeRenderer: Long,
+            hardwareBuffer: HardwareBuffer,
+            timestampNs: Long,
+            vertexTransform: FloatArray,
+            textureTransform: FloatArray,
+            rectsCoordinates: FloatArray,
+            allRectsCount: Int,
+            otherRectsCount: Int
+        ): Boolean
+    }
+}
@@ -0,0 +1,69 @@
+package com.lookaround.core.android.model
+
+import androidx.annotation.DrawableRes
+import com.lookaround.core.android.R
+import com.lookaround.core.model.IPlaceType
+
+/** Images of the place types offered as categories, also drawn as AR marker icons. */
+val placeTypeDrawables: Map<IPlaceType, Int> =
+    linkedMapOf(
+        Amenity.PARKING to R.drawable.parking,
+        Amenity.FUEL to R.drawable.fuel,
+        Amenity.CAR_WASH to R.drawable.car_wash,
+        Amenity.ATM to R.drawable.atm,
+        Amenity.POST_OFFICE to R.drawable.post_office,
+        Amenity.TOILETS to R.drawable.toilet,
+        Amenity.RESTAURANT to R.drawable.restaurant,
+        Amenity.CAFE to R.drawable.cafe,
+        Amenity.FAST_FOOD to R.drawable.fast_food,
+        Amenity.BAR to R.drawable.bar,
+        Amenity.PUB to R.drawable.pub,
+        Amenity.ICE_CREAM to R.drawable.ice_cream,
+        Amenity.BUS_STATION to R.drawable.bus_station,
+        Amenity.TAXI to R.drawable.taxi,
+        Amenity.CAR_RENTAL to R.drawable.car_rental,
+        Shop.CONVENIENCE to R.drawable.convenience,
+        Shop.SUPERMARKET to R.drawable.supermarket,
+        Shop.MALL to R.drawable.mall,
+        Shop.CLOTHES to R.drawable.clothes,
+        Shop.SHOES to R.drawable.shoes,
+        Shop.ALCOHOL to R.drawable.alcohol,
+        Shop.HAIRDRESSER to R.drawable.hairdresser,
+        Shop.CAR to R.drawable.car,
+        Shop.HARDWARE to R.drawable.hardware,
+        Shop.ELECTRONICS to R.drawable.electronics,
+        Shop.BOOKS to R.drawable.books,
+        Tourism.HOTEL to R.drawable.hotel,
+        Tourism.VIEWPOINT to R.drawable.viewpoint,
+        Tourism.MUSEUM to R.drawable.museum,
+        Tourism.GALLERY to R.drawable.gallery,
+        Tourism.CAMP_SITE to R.drawable.camp_site,
+        Tourism.THEME_PARK to R.drawable.theme_park,
+        Leisure.NATURE_RESERVE to R.drawable.nature_reserve,
+        Tourism.ZOO to R.drawable.zoo,
+        Amenity.CINEMA to R.drawable.cinema,
+        Amenity.THEATRE to R.drawable.theatre,
+        Amenity.NIGHTCLUB to R.drawable.nightclub,
+        Amenity.EVENTS_VENUE to R.drawable.events_venue,
+        Amenity.CASINO to R.drawable.casino,
+        Amenity.LIBRARY to R.drawable.library,
+        Leisure.PARK to R.drawable.park,
+        Leisure.GARDEN to R.drawable.garden,
+        Leisure.PLAYGROUND to R.drawable.playground,
+        Leisure.PITCH to R.drawable.pitch,
+        Leisure.SPORTS_CENTRE to R.drawable.sports_centre,
+        Leisure.SWIMMING_POOL to R.drawable.swimming_pool,
+        Leisure.GOLF_COURSE to R.drawable.golf_course,
+        Amenity.PHARMACY to R.drawable.pharmacy,
+        Amenity.HOSPITAL to R.drawable.hospital,
+        Amenity.DOCTORS to R.drawable.doctors,
+        Amenity.VETERINARY to R.drawable.veterinary
+    )
+
+/** The first place type of [placeTypeDrawables] among the tags of this marker, if any. */
+val Marker.placeType: IPlaceType?
+    get() = placeTypeDrawables.keys.firstOrNull { tags[it.typeKey] == it.typeValue }
+
+@get:DrawableRes
+val IPlaceType.drawableId: Int
+    get() = placeTypeDrawables.getValue(this)
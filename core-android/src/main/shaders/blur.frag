@@ -0,0 +1,49 @@
+#version 450
+
+// A separable pass of the blur pyramid, the kernel of the GL renderer's passes.
+layout(set = 0, binding = 0) uniform Frame {
+    mat4 vertTransform;
+    mat4 texTransform;
+    vec4 contrastingColor;
+    vec4 lods;
+} frame;
+
+layout(set = 1, binding = 0) uniform sampler2D inputTexture;
+
+layout(push_constant) uniform Pass {
+    vec2 outputSize;
+    uint pyramid;
+    uint flags;
+} pass;
+
+const uint PASS_VERTICAL = 1u;
+
+const float MIN_LOD = -2.;
+const float sigma = 3.;
+const float r = sigma * 2.;
+const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
+
+layout(location = 0) in vec2 texCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+vec4 gaussBlur(vec2 uv, vec2 d) {
+    vec4 c = texture(inputTexture, uv);
+    for (float i = 1.; i < r; ++i) {
+        float w = exp(-i * i * invTwoSigmaSqr);
+        c += (texture(inputTexture, uv + d * i) + texture(inputTexture, uv - d * i)) * w;
+    }
+    return c / c.a;
+}
+
+void main() {
+    float lod = frame.lods[pass.pyramid];
+    if (lod <= MIN_LOD) {
+        fragColor = texture(inputTexture, texCoord);
+        return;
+    }
+    float step = exp2(lod);
+    fragColor = gaussBlur(texCoord, (pass.flags & PASS_VERTICAL) != 0u
+                                    ? vec2(0., step / pass.outputSize.y)
+                                    : vec2(step / pass.outputSize.x, 0.));
+}
@@ -0,0 +1,45 @@
+#version 450
+
+// The first, vertical pass of the blur pyramid, from the camera frame. Its sampler is
+// immutable, with the Ycbcr conversion of the camera buffers when they are YUV.
+layout(set = 0, binding = 0) uniform Frame {
+    mat4 vertTransform;
+    mat4 texTransform;
+    vec4 contrastingColor;
+    vec4 lods;
+} frame;
+
+layout(set = 1, binding = 0) uniform sampler2D camera;
+
+layout(push_constant) uniform Pass {
+    vec2 outputSize;
+    uint pyramid;
+    uint flags;
+} pass;
+
+const float MIN_LOD = -2.;
+const float sigma = 3.;
+const float r = sigma * 2.;
+const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
+
+layout(location = 1) in vec2 cameraCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+vec4 gaussBlur(vec2 uv, vec2 d) {
+    vec4 c = texture(camera, uv);
+    for (float i = 1.; i < r; ++i) {
+        float w = exp(-i * i * invTwoSigmaSqr);
+        c += (texture(camera, uv + d * i) + texture(camera, uv - d * i)) * w;
+    }
+    return c / c.a;
+}
+
+void main() {
+    float lod = frame.lods[pass.pyramid];
+    if (lod <= MIN_LOD) {
+        fragColor = texture(camera, cameraCoord);
+        return;
+    }
+    fragColor = gaussBlur(cameraCoord, vec2(0., exp2(lod) / pass.outputSize.y));
+}
@@ -0,0 +1,58 @@
+#version 450
+
+// The last pass of the frame: the horizontal pass of the full size level of both pyramids,
+// the rects one where the mask drawn by the previous subpass covers the output. The background
+// is the camera frame itself while the blur is off.
+layout(set = 0, binding = 0) uniform Frame {
+    mat4 vertTransform;
+    mat4 texTransform;
+    vec4 contrastingColor;
+    vec4 lods;
+} frame;
+
+layout(set = 1, binding = 0) uniform sampler2D background;
+layout(set = 1, binding = 1) uniform sampler2D rectsBackground;
+layout(input_attachment_index = 0, set = 1, binding = 2) uniform subpassInput mask;
+
+layout(set = 2, binding = 0) uniform sampler2D camera;
+
+layout(push_constant) uniform Pass {
+    vec2 outputSize;
+    uint pyramid;
+    uint flags;
+} pass;
+
+const uint PASS_BLURRED_BACKGROUND = 2u;
+
+const float MIN_LOD = -2.;
+const float sigma = 3.;
+const float r = sigma * 2.;
+const float invTwoSigmaSqr = 1. / (2. * sigma * sigma);
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 1) in vec2 cameraCoord;
+
+layout(location = 0) out vec4 fragColor;
+
+vec4 gaussBlurH(sampler2D tex, vec2 uv, float lod) {
+    if (lod <= MIN_LOD) return texture(tex, uv);
+    vec2 d = vec2(exp2(lod) / pass.outputSize.x, 0.);
+    vec4 c = texture(tex, uv);
+    for (float i = 1.; i < r; ++i) {
+        float w = exp(-i * i * invTwoSigmaSqr);
+        c += (texture(tex, uv + d * i) + texture(tex, uv - d * i)) * w;
+    }
+    return c / c.a;
+}
+
+void main() {
+    if (subpassLoad(mask).r > 0.) {
+        vec4 color = gaussBlurH(rectsBackground, texCoord, frame.lods.y);
+        fragColor = vec4(mix(color.rgb, frame.contrastingColor.rgb, frame.contrastingColor.a),
+                         color.a);
+    } else if ((pass.flags & PASS_BLURRED_BACKGROUND) != 0u) {
+        fragColor = gaussBlurH(background, texCoord, frame.lods.x);
+    } else {
+        fragColor = texture(camera, cameraCoord);
+    }
+}
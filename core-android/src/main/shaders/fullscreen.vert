@@ -0,0 +1,27 @@
+#version 450
+
+// The fullscreen triangle of the GL renderer, generated from the vertex index. Targets of the
+// blur passes keep the rows of the GL framebuffers, bottom row first; the composite pass flips
+// them onto the output, whose first row is the top one.
+layout(constant_id = 0) const bool FLIP_Y = false;
+
+layout(set = 0, binding = 0) uniform Frame {
+    mat4 vertTransform;
+    mat4 texTransform;
+    // Alpha is the mix compounded over the separable passes, 0 without a color.
+    vec4 contrastingColor;
+    // Of the background and of the rects pyramid.
+    vec4 lods;
+} frame;
+
+layout(location = 0) out vec2 texCoord;
+layout(location = 1) out vec2 cameraCoord;
+
+void main() {
+    vec2 position = vec2(float((gl_VertexIndex << 1) & 2), float(gl_VertexIndex & 2)) * 2. - 1.;
+    texCoord = (position + 1.) * .5;
+    // Affine, so transformed per vertex.
+    vec2 transformed = ((frame.vertTransform * vec4(position, 0., 1.)).xy + 1.) * .5;
+    cameraCoord = (frame.texTransform * vec4(transformed, 0., 1.)).xy;
+    gl_Position = vec4(position.x, FLIP_Y ? -position.y : position.y, 0., 1.);
+}
@@ -0,0 +1,18 @@
+#version 450
+
+// Marks the pixels inside rounded rects, the stencil of the GL renderer.
+layout(location = 0) flat in vec4 bounds;
+layout(location = 1) flat in float cornerRadius;
+
+layout(location = 0) out float coverage;
+
+float udRoundBox(vec2 p, vec2 b, float r) {
+    return length(max(abs(p) - b + r, 0.)) - r;
+}
+
+void main() {
+    vec2 res = bounds.zw - bounds.xy;
+    vec2 coord = gl_FragCoord.xy - bounds.xy;
+    if (udRoundBox(2. * coord - res, res, cornerRadius) > 1.) discard;
+    coverage = 1.;
+}
@@ -0,0 +1,32 @@
+#version 450
+
+// One instanced quad per visible rect, covering its bounds in output pixels.
+struct Rect {
+    // Left, top, right, bottom, top-left origin.
+    vec4 bounds;
+    // In the half pixels of the GL renderer's rounded box, in x.
+    vec4 cornerRadius;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Rects {
+    Rect rects[];
+};
+
+layout(push_constant) uniform Pass {
+    vec2 outputSize;
+    uint pyramid;
+    uint flags;
+} pass;
+
+layout(location = 0) flat out vec4 bounds;
+layout(location = 1) flat out float cornerRadius;
+
+void main() {
+    Rect rect = rects[gl_InstanceIndex];
+    // A triangle strip of 4 vertices.
+    vec2 corner = vec2(float(gl_VertexIndex & 1), float((gl_VertexIndex >> 1) & 1));
+    vec2 pixel = mix(rect.bounds.xy, rect.bounds.zw, corner);
+    bounds = rect.bounds;
+    cornerRadius = rect.cornerRadius.x;
+    gl_Position = vec4(pixel / pass.outputSize * 2. - 1., 0., 1.);
+}
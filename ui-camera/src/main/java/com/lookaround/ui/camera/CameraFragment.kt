@@ -4,10 +4,13 @@ import android.Manifest
 import android.content.SharedPreferences
 import android.content.res.Configuration
 import android.graphics.Bitmap
+import android.graphics.BitmapFactory
 import android.graphics.Color
 import android.graphics.drawable.BitmapDrawable
+import android.media.ThumbnailUtils
 import android.os.Bundle
 import android.view.View
+import androidx.annotation.WorkerThread
 import androidx.camera.core.ImageProxy
 import androidx.constraintlayout.widget.ConstraintLayout
 import androidx.core.content.ContextCompat
@@ -21,8 +24,6 @@ import androidx.transition.AutoTransition
 import androidx.transition.Transition
 import androidx.transition.TransitionManager
 import by.kirich1409.viewbindingdelegate.viewBinding
-import com.hoko.blur.HokoBlur
-import com.hoko.blur.processor.BlurProcessor
 import com.imxie.exvpbs.ViewPagerBottomSheetBehavior
 import com.lookaround.core.android.ar.marker.ARMarker
 import com.lookaround.core.android.ar.marker.SimpleARMarker
@@ -33,7 +34,9 @@ import com.lookaround.core.android.ar.renderer.impl.RadarMarkerRenderer
 import com.lookaround.core.android.ar.view.ARRadarView
 import com.lookaround.core.android.architecture.filterSignals
 import com.lookaround.core.android.architecture.mapStates
+import com.lookaround.core.android.blur.ReferenceBlur
 import com.lookaround.core.android.camera.OpenGLRenderer
+import com.lookaround.core.android.camera.RendererBackend
 import com.lookaround.core.android.ext.*
 import com.lookaround.core.android.model.*
 import com.lookaround.core.delegate.lazyAsync
@@ -51,7 +54,9 @@ import com.permissionx.guolindev.PermissionX
 import dagger.hilt.android.AndroidEntryPoint
 import dagger.hilt.android.WithFragmentBindings
 import kotlin.math.min
+import kotlin.math.roundToInt
 import kotlinx.coroutines.*
+import kotlinx.coroutines.channels.BufferOverflow
 import kotlinx.coroutines.flow.*
 import timber.log.Timber
 
@@ -88,7 +93,20 @@ class CameraFragment :
             }
         }
 
-    private val openGLRenderer: OpenGLRenderer by lazy(LazyThreadSafetyMode.NONE, ::OpenGLRenderer)
+    private val openGLRenderer: OpenGLRenderer by
+        lazy(LazyThreadSafetyMode.NONE) {
+            val context = requireContext()
+            val vulkan =
+                defaultSharedPreferences.getBoolean(
+                    getString(R.string.preference_vulkan_renderer_key),
+                    false
+                )
+            OpenGLRenderer(
+                cacheDir = context.cacheDir,
+                backend =
+                    if (vulkan) RendererBackend.Vulkan(context.assets) else RendererBackend.Gl
+            )
+        }
 
     private val cameraInitializationResult: Deferred<CameraInitializationResult> by
         lifecycleScope.lazyAsync {
@@ -105,15 +123,14 @@ class CameraFragment :
 
     private val blurBackgroundVisibilityFlow = MutableSharedFlow<Int>()
 
-    private val blurProcessor: BlurProcessor by
-        lazy(LazyThreadSafetyMode.NONE) {
-            HokoBlur.with(requireContext())
-                .sampleFactor(8f)
-                .scheme(HokoBlur.SCHEME_OPENGL)
-                .mode(HokoBlur.MODE_GAUSSIAN)
-                .radius(15)
-                .processor()
-        }
+    // Without a GL context there are no blurred snapshots, so the next camera frame is blurred
+    // on the CPU instead, for the background behind the initialization failure.
+    private var referenceBlurPending = false
+    private val referenceBlurredSnapshotsFlow =
+        MutableSharedFlow<Bitmap>(
+            extraBufferCapacity = 1,
+            onBufferOverflow = BufferOverflow.DROP_OLDEST
+        )
 
     override fun onViewCreated(view: View, savedInstanceState: Bundle?) {
         binding.blurBackground.background =
@@ -340,19 +357,33 @@ class CameraFragment :
         if (!startSensor()) return false
 
         openGLRenderer.oglFatalErrorsFlow
-            .onEach { cameraViewModel.intent(CameraIntent.CameraInitializationFailed) }
+            .onEach {
+                referenceBlurPending = true
+                cameraViewModel.intent(CameraIntent.CameraInitializationFailed)
+            }
+            .launchIn(viewLifecycleOwner.lifecycleScope)
+
+        openGLRenderer.dominantColorsFlow
+            .onEach(::updateContrastingColorUsing)
             .launchIn(viewLifecycleOwner.lifecycleScope)
 
+        loadMarkerLayers()
+
         viewLifecycleOwner.lifecycleScope.launch {
             try {
                 val (preview, _, imageFlow) = cameraInitializationResult.await()
                 openGLRenderer.attachInputPreview(preview, binding.cameraPreview)
                 if (isRunningOnEmulator()) return@launch
 
-                var initial = true
                 imageFlow
-                    .map(ImageProxy::bitmap::get)
-                    .filterNotNull()
+                    .onEach { image ->
+                        if (referenceBlurPending) {
+                            referenceBlurPending = false
+                            launch(Dispatchers.Default) { blurOnCpu(image) }
+                        } else {
+                            image.close()
+                        }
+                    }
                     .filter {
                         val mainState = mainViewModel.state
                         !mainState.drawerOpen &&
@@ -360,10 +391,14 @@ class CameraFragment :
                                 ViewPagerBottomSheetBehavior.STATE_HIDDEN &&
                             latestARState == CameraARState.ENABLED
                     }
-                    .map(blurProcessor::blurAndGeneratePalette)
+                    .onEach { openGLRenderer.requestBlurredSnapshot() }
+                    .launchIn(this)
+
+                var initial = true
+                merge(openGLRenderer.blurredSnapshotsFlow, referenceBlurredSnapshotsFlow)
+                    .map { blurred -> blurred to blurred.palette }
                     .flowOn(Dispatchers.Default)
                     .collect { (blurred, palette) ->
-                        updateContrastingColorUsing(palette)
                         blurAndUpdateViewsUsing(blurred, palette)
                         if (initial) {
                             withContext(Dispatchers.IO) {
@@ -382,6 +417,40 @@ class CameraFragment :
         return true
     }
 
+    @WorkerThread
+    private fun blurOnCpu(image: ImageProxy) {
+        val frame = image.bitmap ?: return
+        // Analysis frames are already a fraction of the screen, so they are blurred at full size.
+        val blurred = ReferenceBlur.blur(frame, OpenGLRenderer.BLURRED_SNAPSHOT_LEVEL_FULL)
+        frame.recycle()
+        if (blurred != null) referenceBlurredSnapshotsFlow.tryEmit(blurred)
+    }
+
+    private fun loadMarkerLayers() {
+        openGLRenderer.loadLabelGlyphs(requireContext().cacheDir)
+        val resources = resources
+        val sizePx = cameraMarkerRenderer.markerIconSizePx.roundToInt()
+        viewLifecycleOwner.lifecycleScope.launch {
+            val icons =
+                withContext(Dispatchers.Default) {
+                    val options =
+                        BitmapFactory.Options().apply {
+                            inPreferredConfig = Bitmap.Config.ARGB_8888
+                        }
+                    placeTypeDrawables.values.map { drawableId ->
+                        ThumbnailUtils.extractThumbnail(
+                            BitmapFactory.decodeResource(resources, drawableId, options),
+                            sizePx,
+                            sizePx,
+                            ThumbnailUtils.OPTIONS_RECYCLE_INPUT
+                        )
+                    }
+                }
+            openGLRenderer.loadSpriteAtlas(icons)
+            cameraMarkerRenderer.openGLRenderer = openGLRenderer
+        }
+    }
+
     private fun startSensor(): Boolean {
         orientationManager.smoothFactor = defaultSharedPreferences.smoothFactor
         if (!orientationManager.startSensor(requireContext())) {
@@ -394,16 +463,14 @@ class CameraFragment :
         return true
     }
 
-    private suspend fun updateContrastingColorUsing(palette: Palette) {
-        val contrastingColor = colorContrastingTo(palette.dominantSwatch?.rgb ?: return)
-        withContext(Dispatchers.Main) {
-            openGLRenderer.setContrastingColor(
-                red = Color.red(contrastingColor),
-                green = Color.green(contrastingColor),
-                blue = Color.blue(contrastingColor)
-            )
-            mainViewModel.signal(MainSignal.ContrastingColorUpdated(contrastingColor))
-        }
+    private suspend fun updateContrastingColorUsing(dominantColor: Int) {
+        val contrastingColor = colorContrastingTo(dominantColor)
+        openGLRenderer.setContrastingColor(
+            red = Color.red(contrastingColor),
+            green = Color.green(contrastingColor),
+            blue = Color.blue(contrastingColor)
+        )
+        mainViewModel.signal(MainSignal.ContrastingColorUpdated(contrastingColor))
     }
 
     private suspend fun blurAndUpdateViewsUsing(blurred: Bitmap, palette: Palette) {
@@ -643,6 +710,7 @@ class CameraFragment :
 
     override fun onDestroy() {
         openGLRenderer.shutdown()
+        cameraMarkerRenderer.close()
         super.onDestroy()
     }
 
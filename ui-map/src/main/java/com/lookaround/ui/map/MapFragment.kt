@@ -19,6 +19,7 @@ import com.lookaround.core.android.ar.orientation.OrientationManager
 import com.lookaround.core.android.architecture.filterSignals
 import com.lookaround.core.android.architecture.mapStates
 import com.lookaround.core.android.architecture.onEachSignal
+import com.lookaround.core.android.blur.BitmapBlur
 import com.lookaround.core.android.ext.*
 import com.lookaround.core.android.ext.MarkerPickResult
 import com.lookaround.core.android.map.UserLocationMapComponent
@@ -106,6 +107,10 @@ class MapFragment :
                 .processor()
         }
 
+    // Blurs on the GPU, blurProcessor is the fallback for devices without ES 3.1.
+    private val bitmapBlurDelegate = lazy(LazyThreadSafetyMode.NONE) { BitmapBlur() }
+    private val bitmapBlur: BitmapBlur by bitmapBlurDelegate
+
     override fun onCreate(savedInstanceState: Bundle?) {
         super.onCreate(savedInstanceState)
         currentMarker =
@@ -192,6 +197,11 @@ class MapFragment :
         binding.map.onDestroy()
     }
 
+    override fun onDestroy() {
+        if (bitmapBlurDelegate.isInitialized()) bitmapBlur.close()
+        super.onDestroy()
+    }
+
     override fun onResume() {
         super.onResume()
         binding.map.onResume()
@@ -497,9 +507,12 @@ class MapFragment :
 
                 val bitmap = mapController.await().captureFrame(true)
                 val (blurred, palette) =
-                    withContext(Dispatchers.Default) {
-                        blurProcessor.blurAndGeneratePalette(bitmap)
+                    bitmapBlur.blur(bitmap)?.let {
+                        withContext(Dispatchers.Default) { it.bitmap to it.bitmap.palette }
                     }
+                        ?: withContext(Dispatchers.Default) {
+                            blurProcessor.blurAndGeneratePalette(bitmap)
+                        }
                 mainViewModel.state.bitmapCache.put(BlurredBackgroundType.MAP, blurred to palette)
                 val blurBackgroundDrawable = BitmapDrawable(resources, blurred)
                 binding.blurBackground.background = blurBackgroundDrawable
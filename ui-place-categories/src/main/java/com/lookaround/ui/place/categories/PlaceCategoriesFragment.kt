@@ -2,6 +2,7 @@ package com.lookaround.ui.place.categories
 
 import android.content.res.Configuration
 import android.os.Bundle
+import android.os.Parcelable
 import android.view.View
 import android.view.ViewGroup
 import androidx.compose.foundation.ExperimentalFoundationApi
@@ -26,6 +27,7 @@ import com.google.accompanist.insets.ProvideWindowInsets
 import com.lookaround.core.android.ext.addCollapseTopViewOnScrollListener
 import com.lookaround.core.android.ext.scrollToTopAndShow
 import com.lookaround.core.android.model.Amenity
+import com.lookaround.core.android.model.drawableId
 import com.lookaround.core.android.model.Leisure
 import com.lookaround.core.android.model.Shop
 import com.lookaround.core.android.model.Tourism
@@ -280,67 +282,71 @@ class PlaceCategoriesFragment : Fragment(R.layout.fragment_place_categories) {
     }
 
     companion object {
+        private fun <PT> placeType(type: PT): PlaceTypeListItem
+            where PT : IPlaceType, PT : Parcelable =
+            PlaceTypeListItem.PlaceType(type, type.drawableId)
+
         private val allPlaceTypeListItems: List<PlaceTypeListItem> =
             listOf(
                 PlaceTypeListItem.PlaceCategory("General"),
-                PlaceTypeListItem.PlaceType(Amenity.PARKING, R.drawable.parking),
-                PlaceTypeListItem.PlaceType(Amenity.FUEL, R.drawable.fuel),
-                PlaceTypeListItem.PlaceType(Amenity.CAR_WASH, R.drawable.car_wash),
-                PlaceTypeListItem.PlaceType(Amenity.ATM, R.drawable.atm),
-                PlaceTypeListItem.PlaceType(Amenity.POST_OFFICE, R.drawable.post_office),
-                PlaceTypeListItem.PlaceType(Amenity.TOILETS, R.drawable.toilet),
+                placeType(Amenity.PARKING),
+                placeType(Amenity.FUEL),
+                placeType(Amenity.CAR_WASH),
+                placeType(Amenity.ATM),
+                placeType(Amenity.POST_OFFICE),
+                placeType(Amenity.TOILETS),
                 PlaceTypeListItem.PlaceCategory("Food & drinks"),
-                PlaceTypeListItem.PlaceType(Amenity.RESTAURANT, R.drawable.restaurant),
-                PlaceTypeListItem.PlaceType(Amenity.CAFE, R.drawable.cafe),
-                PlaceTypeListItem.PlaceType(Amenity.FAST_FOOD, R.drawable.fast_food),
-                PlaceTypeListItem.PlaceType(Amenity.BAR, R.drawable.bar),
-                PlaceTypeListItem.PlaceType(Amenity.PUB, R.drawable.pub),
-                PlaceTypeListItem.PlaceType(Amenity.ICE_CREAM, R.drawable.ice_cream),
+                placeType(Amenity.RESTAURANT),
+                placeType(Amenity.CAFE),
+                placeType(Amenity.FAST_FOOD),
+                placeType(Amenity.BAR),
+                placeType(Amenity.PUB),
+                placeType(Amenity.ICE_CREAM),
                 PlaceTypeListItem.PlaceCategory("Transport"),
-                PlaceTypeListItem.PlaceType(Amenity.BUS_STATION, R.drawable.bus_station),
-                PlaceTypeListItem.PlaceType(Amenity.TAXI, R.drawable.taxi),
-                PlaceTypeListItem.PlaceType(Amenity.CAR_RENTAL, R.drawable.car_rental),
+                placeType(Amenity.BUS_STATION),
+                placeType(Amenity.TAXI),
+                placeType(Amenity.CAR_RENTAL),
                 PlaceTypeListItem.PlaceCategory("Shop"),
-                PlaceTypeListItem.PlaceType(Shop.CONVENIENCE, R.drawable.convenience),
-                PlaceTypeListItem.PlaceType(Shop.SUPERMARKET, R.drawable.supermarket),
-                PlaceTypeListItem.PlaceType(Shop.MALL, R.drawable.mall),
-                PlaceTypeListItem.PlaceType(Shop.CLOTHES, R.drawable.clothes),
-                PlaceTypeListItem.PlaceType(Shop.SHOES, R.drawable.shoes),
-                PlaceTypeListItem.PlaceType(Shop.ALCOHOL, R.drawable.alcohol),
-                PlaceTypeListItem.PlaceType(Shop.HAIRDRESSER, R.drawable.hairdresser),
-                PlaceTypeListItem.PlaceType(Shop.CAR, R.drawable.car),
-                PlaceTypeListItem.PlaceType(Shop.HARDWARE, R.drawable.hardware),
-                PlaceTypeListItem.PlaceType(Shop.ELECTRONICS, R.drawable.electronics),
-                PlaceTypeListItem.PlaceType(Shop.BOOKS, R.drawable.books),
+                placeType(Shop.CONVENIENCE),
+                placeType(Shop.SUPERMARKET),
+                placeType(Shop.MALL),
+                placeType(Shop.CLOTHES),
+                placeType(Shop.SHOES),
+                placeType(Shop.ALCOHOL),
+                placeType(Shop.HAIRDRESSER),
+                placeType(Shop.CAR),
+                placeType(Shop.HARDWARE),
+                placeType(Shop.ELECTRONICS),
+                placeType(Shop.BOOKS),
                 PlaceTypeListItem.PlaceCategory("Tourism"),
-                PlaceTypeListItem.PlaceType(Tourism.HOTEL, R.drawable.hotel),
-                PlaceTypeListItem.PlaceType(Tourism.VIEWPOINT, R.drawable.viewpoint),
-                PlaceTypeListItem.PlaceType(Tourism.MUSEUM, R.drawable.museum),
-                PlaceTypeListItem.PlaceType(Tourism.GALLERY, R.drawable.gallery),
-                PlaceTypeListItem.PlaceType(Tourism.CAMP_SITE, R.drawable.camp_site),
-                PlaceTypeListItem.PlaceType(Tourism.THEME_PARK, R.drawable.theme_park),
-                PlaceTypeListItem.PlaceType(Leisure.NATURE_RESERVE, R.drawable.nature_reserve),
-                PlaceTypeListItem.PlaceType(Tourism.ZOO, R.drawable.zoo),
+                placeType(Tourism.HOTEL),
+                placeType(Tourism.VIEWPOINT),
+                placeType(Tourism.MUSEUM),
+                placeType(Tourism.GALLERY),
+                placeType(Tourism.CAMP_SITE),
+                placeType(Tourism.THEME_PARK),
+                placeType(Leisure.NATURE_RESERVE),
+                placeType(Tourism.ZOO),
                 PlaceTypeListItem.PlaceCategory("Entertainment"),
-                PlaceTypeListItem.PlaceType(Amenity.CINEMA, R.drawable.cinema),
-                PlaceTypeListItem.PlaceType(Amenity.THEATRE, R.drawable.theatre),
-                PlaceTypeListItem.PlaceType(Amenity.NIGHTCLUB, R.drawable.nightclub),
-                PlaceTypeListItem.PlaceType(Amenity.EVENTS_VENUE, R.drawable.events_venue),
-                PlaceTypeListItem.PlaceType(Amenity.CASINO, R.drawable.casino),
-                PlaceTypeListItem.PlaceType(Amenity.LIBRARY, R.drawable.library),
+                placeType(Amenity.CINEMA),
+                placeType(Amenity.THEATRE),
+                placeType(Amenity.NIGHTCLUB),
+                placeType(Amenity.EVENTS_VENUE),
+                placeType(Amenity.CASINO),
+                placeType(Amenity.LIBRARY),
                 PlaceTypeListItem.PlaceCategory("Leisure"),
-                PlaceTypeListItem.PlaceType(Leisure.PARK, R.drawable.park),
-                PlaceTypeListItem.PlaceType(Leisure.GARDEN, R.drawable.garden),
-                PlaceTypeListItem.PlaceType(Leisure.PLAYGROUND, R.drawable.playground),
-                PlaceTypeListItem.PlaceType(Leisure.PITCH, R.drawable.pitch),
-                PlaceTypeListItem.PlaceType(Leisure.SPORTS_CENTRE, R.drawable.sports_centre),
-                PlaceTypeListItem.PlaceType(Leisure.SWIMMING_POOL, R.drawable.swimming_pool),
-                PlaceTypeListItem.PlaceType(Leisure.GOLF_COURSE, R.drawable.golf_course),
+                placeType(Leisure.PARK),
+                placeType(Leisure.GARDEN),
+                placeType(Leisure.PLAYGROUND),
+                placeType(Leisure.PITCH),
+                placeType(Leisure.SPORTS_CENTRE),
+                placeType(Leisure.SWIMMING_POOL),
+                placeType(Leisure.GOLF_COURSE),
                 PlaceTypeListItem.PlaceCategory("Health"),
-                PlaceTypeListItem.PlaceType(Amenity.PHARMACY, R.drawable.pharmacy),
-                PlaceTypeListItem.PlaceType(Amenity.HOSPITAL, R.drawable.hospital),
-                PlaceTypeListItem.PlaceType(Amenity.DOCTORS, R.drawable.doctors),
-                PlaceTypeListItem.PlaceType(Amenity.VETERINARY, R.drawable.veterinary),
+                placeType(Amenity.PHARMACY),
+                placeType(Amenity.HOSPITAL),
+                placeType(Amenity.DOCTORS),
+                placeType(Amenity.VETERINARY),
             )
     }
 }